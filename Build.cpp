@@ -53,6 +53,9 @@ Build build(Flags flags) noexcept {
 	proc64.add_source_recursively("./src/");
 	proc64.del_source("src/cbt_hook.cpp");
 	proc64.del_source("src/Main32.cpp");
+	proc64.del_source("src/File_Posix.cpp");
+	proc64.del_source("src/ErrorCode_Posix.cpp");
+	proc64.del_source("src/QueryServer_Posix.cpp");
 	proc64.del_source_recursively("./src/OS/");
 	if (Env::Win32) proc64.add_source_recursively("./src/OS/win/");
 	//if (Env::Win32) b.add_source("./src/Mes_Touches.rc");
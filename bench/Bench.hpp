@@ -0,0 +1,63 @@
+#pragma once
+// What the benchmarks of mes_touches_bench share, see bench.cpp for the command line.
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+struct KeyEntry;
+struct ClickEntry;
+struct AppUsage;
+struct MouseState;
+
+struct Timer {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double ms() const noexcept {
+		auto dt = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::milli>(dt).count();
+	}
+};
+
+template<typename F>
+double best_of(size_t runs, F&& f) noexcept {
+	double best = 1e30;
+	for (size_t i = 0; i < runs; ++i) {
+		Timer t;
+		f();
+		auto ms = t.ms();
+		best = best < ms ? best : ms;
+	}
+	return best;
+}
+
+struct BenchResult {
+	std::string name; // group/what/variant, stable across runs so results can be compared.
+	size_t n{ 0 }; // items handled in one run: entries, frames...
+	double ms{ 0 }; // of the best run.
+	size_t bytes{ 0 }; // read or written in one run, 0 if it doesn't apply.
+	double baseline_ms{ 0 }; // the same work done the old way, 0 if there is none.
+};
+
+struct BenchOptions {
+	// The history sizes of the state benchmarks, the ui ones use the smallest.
+	std::vector<size_t> sizes;
+	size_t n_frames{ 0 };
+	size_t runs{ 0 };
+	std::filesystem::path dir; // scratch space for the save files.
+};
+
+// Prints the result and keeps it for the json output.
+extern void report(BenchResult x) noexcept;
+
+// The same seed gives the same history, a run compares with the previous ones only if it does.
+extern std::vector<KeyEntry> make_key_entries(size_t n, std::uint64_t seed) noexcept;
+extern std::vector<ClickEntry> make_clicks(size_t n, std::uint64_t seed) noexcept;
+extern std::vector<AppUsage> make_usages(size_t n, std::uint64_t seed) noexcept;
+// The two displays the clicks of make_clicks land on.
+extern void add_bench_displays(MouseState& ms) noexcept;
+
+extern void bench_serialization(const BenchOptions& opts) noexcept;
+extern void bench_ingest(const BenchOptions& opts) noexcept;
+extern void bench_files(const BenchOptions& opts) noexcept;
+extern void bench_ui(const BenchOptions& opts) noexcept;
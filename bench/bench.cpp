@@ -0,0 +1,256 @@
+// Benchmarks of the ingest, the save files and the ui, run
+// mes_touches_bench [--sizes n,...] [--frames n] [--runs n] [--only group,...] [--json path]
+// The groups are serialization, ingest, files and ui. The sizes are the number of entries of the
+// histories, 1M and 10M by default, 100M needs a few GB of memory. --json writes the results for
+// the regression tracking, the names stay the same from one run to the next.
+// Everything here must stay portable so it can run on the ci box, not only on windows.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "ByteStream.hpp"
+#include "Common.hpp"
+
+Logs logs;
+
+static std::vector<BenchResult> results;
+
+void report(BenchResult x) noexcept {
+	auto per_s = x.n / (x.ms / 1000.0);
+	printf("%-44s %12zu %10.2f ms %14.0f /s", x.name.c_str(), x.n, x.ms, per_s);
+	if (x.bytes) printf(" %9.1f MB/s", x.bytes / (x.ms / 1000.0) / 1'000'000.0);
+	if (x.baseline_ms > 0) printf("  x%5.2f vs %.2f ms", x.baseline_ms / x.ms, x.baseline_ms);
+	printf("\n");
+	fflush(stdout);
+	results.push_back(std::move(x));
+}
+
+// The keyboard entry as it is in keyboard.mto: u8 key code then u64 timestamp.
+struct BenchKeyEntry {
+	static constexpr size_t Packed_Size = 9;
+
+	std::uint8_t key_code;
+	std::uint64_t timestamp;
+};
+
+// What insert_uint*/read_uint* did before ByteWriter, one push_back per byte, kept here as the
+// baseline.
+namespace legacy {
+	void insert_uint8(std::vector<std::byte>& bytes, std::uint8_t x) noexcept {
+		bytes.push_back((std::byte)x);
+	}
+	void insert_uint64(std::vector<std::byte>& bytes, std::uint64_t x) noexcept {
+		for (size_t i = 0; i < 8; ++i) bytes.push_back((std::byte)((x >> (8 * i)) & 0xff));
+	}
+	std::uint64_t read_uint64(const std::vector<std::byte>& bytes, size_t offset) noexcept {
+		std::uint64_t x{ 0 };
+		for (size_t i = 0; i < 8; ++i) x |= ((std::uint64_t)(std::uint8_t)bytes[offset + i]) << (8 * i);
+		return x;
+	}
+};
+
+void bench_serialization(const BenchOptions& opts) noexcept {
+	auto n = opts.sizes.front();
+	std::mt19937_64 rng{ 0 };
+	std::vector<BenchKeyEntry> entries(n);
+	std::uint64_t t = 1'600'000'000'000;
+	for (auto& x : entries) {
+		t += rng() % 2'000;
+		x.key_code = (std::uint8_t)(rng() % 255);
+		x.timestamp = t;
+	}
+
+	std::vector<std::byte> legacy_bytes;
+	std::vector<std::byte> bytes;
+
+	auto legacy_write = best_of(opts.runs, [&] {
+		legacy_bytes.clear();
+		legacy_bytes.shrink_to_fit();
+		for (auto& x : entries) {
+			legacy::insert_uint8(legacy_bytes, x.key_code);
+			legacy::insert_uint64(legacy_bytes, x.timestamp);
+		}
+	});
+	auto write = best_of(opts.runs, [&] {
+		bytes.clear();
+		bytes.shrink_to_fit();
+		ByteWriter writer{ bytes };
+		writer.reserve(BenchKeyEntry::Packed_Size * entries.size());
+		auto dst = writer.claim(BenchKeyEntry::Packed_Size * entries.size());
+		for (auto& x : entries) {
+			dst[0] = (std::byte)x.key_code;
+			store_le(dst + 1, x.timestamp);
+			dst += BenchKeyEntry::Packed_Size;
+		}
+	});
+	if (bytes != legacy_bytes) {
+		printf("ByteWriter output differs from the legacy encoding.\n");
+		exit(1);
+	}
+	report({ "serialization/key_entries/write", n, write, bytes.size(), legacy_write });
+
+	std::vector<BenchKeyEntry> legacy_out;
+	std::vector<BenchKeyEntry> out;
+	auto legacy_read = best_of(opts.runs, [&] {
+		legacy_out.clear();
+		for (size_t i = 0; i < bytes.size(); i += BenchKeyEntry::Packed_Size) {
+			BenchKeyEntry x;
+			x.key_code = (std::uint8_t)bytes[i];
+			x.timestamp = legacy::read_uint64(bytes, i + 1);
+			legacy_out.push_back(x);
+		}
+	});
+	auto read = best_of(opts.runs, [&] {
+		out.resize(bytes.size() / BenchKeyEntry::Packed_Size);
+		auto src = bytes.data();
+		for (auto& x : out) {
+			x.key_code = (std::uint8_t)src[0];
+			x.timestamp = load_le<std::uint64_t>(src + 1);
+			src += BenchKeyEntry::Packed_Size;
+		}
+	});
+	for (size_t i = 0; i < n; ++i) if (out[i].timestamp != legacy_out[i].timestamp) {
+		printf("ByteReader output differs from the legacy decoding.\n");
+		exit(1);
+	}
+	report({ "serialization/key_entries/read", n, read, bytes.size(), legacy_read });
+
+	// The minute index, a plain u16 array that is copied in one go on little endian hosts.
+	std::vector<std::uint16_t> counts(n / 4);
+	for (auto& x : counts) x = (std::uint16_t)(rng() % 200);
+
+	auto legacy_array = best_of(opts.runs, [&] {
+		legacy_bytes.clear();
+		legacy_bytes.shrink_to_fit();
+		for (auto x : counts) {
+			legacy_bytes.push_back((std::byte)(x & 0xff));
+			legacy_bytes.push_back((std::byte)(x >> 8));
+		}
+	});
+	auto array = best_of(opts.runs, [&] {
+		bytes.clear();
+		bytes.shrink_to_fit();
+		ByteWriter writer{ bytes };
+		writer.reserve(2 * counts.size());
+		writer.write_array(counts.data(), counts.size());
+	});
+	if (bytes != legacy_bytes) {
+		printf("ByteWriter::write_array output differs from the legacy encoding.\n");
+		exit(1);
+	}
+	report({ "serialization/u16_array/write", counts.size(), array, bytes.size(), legacy_array });
+}
+
+
+static std::vector<size_t> parse_sizes(const char* x) noexcept {
+	std::vector<size_t> sizes;
+	while (*x) {
+		char* end;
+		auto n = (size_t)strtoull(x, &end, 10);
+		if (end == x) break;
+		if (n > 0) sizes.push_back(n);
+		x = *end == ',' ? end + 1 : end;
+	}
+	return sizes;
+}
+
+static bool write_json(const char* path, const BenchOptions& opts) noexcept {
+	auto f = fopen(path, "wb");
+	if (!f) return false;
+	defer{ fclose(f); };
+
+	auto now = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+	fprintf(
+		f,
+		"{\"timestamp\":%lld,\"runs\":%zu,\"frames\":%zu,\"results\":[",
+		(long long)now,
+		opts.runs,
+		opts.n_frames
+	);
+	for (size_t i = 0; i < results.size(); ++i) {
+		auto& x = results[i];
+		// The names are ours, no escaping needed.
+		fprintf(
+			f,
+			"%s\n{\"name\":\"%s\",\"n\":%zu,\"ms\":%.4f,\"per_s\":%.1f,\"bytes\":%zu,\"baseline_ms\":%.4f}",
+			i ? "," : "",
+			x.name.c_str(),
+			x.n,
+			x.ms,
+			x.n / (x.ms / 1000.0),
+			x.bytes,
+			x.baseline_ms
+		);
+	}
+	fprintf(f, "\n]}\n");
+	return !ferror(f);
+}
+
+int main(int argc, char** argv) {
+	BenchOptions opts;
+	opts.sizes = { 1'000'000, 10'000'000 };
+	opts.n_frames = 200;
+	opts.runs = 5;
+	opts.dir = std::filesystem::temp_directory_path() / "mes_touches_bench";
+
+	std::string only;
+	const char* json = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--sizes" && has_value) opts.sizes = parse_sizes(argv[++i]);
+		else if (arg == "--frames" && has_value) opts.n_frames = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--runs" && has_value) opts.runs = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--only" && has_value) only = argv[++i];
+		else if (arg == "--json" && has_value) json = argv[++i];
+		// The old command line, a single number of entries.
+		else if (arg[0] != '-') opts.sizes = parse_sizes(argv[i]);
+		else {
+			fprintf(
+				stderr,
+				"usage: mes_touches_bench [--sizes n,...] [--frames n] [--runs n] "
+				"[--only serialization,ingest,files,ui] [--json path]\n"
+			);
+			return 2;
+		}
+	}
+	if (opts.sizes.empty() || opts.n_frames == 0 || opts.runs == 0) {
+		fprintf(stderr, "The sizes, frames and runs must be positive.\n");
+		return 2;
+	}
+	std::sort(std::begin(opts.sizes), std::end(opts.sizes));
+
+	std::error_code ec;
+	std::filesystem::create_directories(opts.dir, ec);
+	if (ec) {
+		fprintf(stderr, "Couldn't create %s: %s\n", opts.dir.string().c_str(), ec.message().c_str());
+		return 1;
+	}
+
+	auto wanted = [&](const char* group) {
+		auto list = "," + only + ",";
+		return only.empty() || list.find(std::string(",") + group + ",") != std::string::npos;
+	};
+
+	printf("%-44s %12s %13s %16s\n", "name", "n", "best", "rate");
+	if (wanted("serialization")) bench_serialization(opts);
+	if (wanted("ingest")) bench_ingest(opts);
+	if (wanted("files")) bench_files(opts);
+	if (wanted("ui")) bench_ui(opts);
+
+	std::filesystem::remove_all(opts.dir, ec);
+
+	if (json && !write_json(json, opts)) {
+		fprintf(stderr, "Couldn't write %s.\n", json);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,380 @@
+// The ingest and the save files, on histories made up with a fixed seed.
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "Bench.hpp"
+#include "ByteStream.hpp"
+#include "file.hpp"
+#include "Event.hpp"
+#include "Mouse.hpp"
+#include "keyboard.hpp"
+
+constexpr std::uint64_t Start_Ms = 1'600'000'000'000;
+constexpr std::uint32_t Display_Width = 1920;
+constexpr std::uint32_t Display_Height = 1080;
+constexpr size_t N_Exes = 40;
+
+// Bursts of typing with pauses in between, mostly letters and the space bar. The holds have
+// their own generator, the keys and the times are the same as before they were added.
+std::vector<KeyEntry> make_key_entries(size_t n, std::uint64_t seed) noexcept {
+	std::mt19937_64 rng{ seed };
+	std::mt19937_64 hold_rng{ ~seed };
+	std::vector<KeyEntry> entries(n);
+	auto t = Start_Ms;
+	for (auto& x : entries) {
+		t += rng() % 64 == 0 ? rng() % 600'000 : 40 + rng() % 300;
+		auto r = rng() % 100;
+		if (r < 15)      x.key_code = 0x20;
+		else if (r < 85) x.key_code = (std::uint8_t)('A' + rng() % 26);
+		else             x.key_code = (std::uint8_t)(rng() % 255);
+		x.timestamp = t;
+		x.hold.ms = (std::uint16_t)(50 + hold_rng() % 150);
+		x.hold.modifiers = hold_rng() % 50 == 0 ? KeyHold::Ctrl : 0;
+	}
+	return entries;
+}
+
+// On two displays side by side, see add_bench_displays.
+std::vector<ClickEntry> make_clicks(size_t n, std::uint64_t seed) noexcept {
+	std::mt19937_64 rng{ seed };
+	std::vector<ClickEntry> clicks(n);
+	auto t = Start_Ms / 1'000;
+	for (auto& x : clicks) {
+		t += rng() % 16 == 0 ? rng() % 600 : rng() % 3;
+		x = {};
+		auto r = rng() % 100;
+		x.button_code = (std::uint8_t)(r < 70 ? MouseState::ButtonMap::Left :
+			r < 80 ? MouseState::ButtonMap::Right :
+			r < 90 ? MouseState::ButtonMap::Wheel_Down : MouseState::ButtonMap::Wheel_Up);
+		x.x = (std::uint32_t)(rng() % (2 * Display_Width));
+		x.y = (std::uint32_t)(rng() % Display_Height);
+		x.timestamp = t;
+	}
+	return clicks;
+}
+
+// A few exes, each with its share of documents, one usage after the other.
+std::vector<AppUsage> make_usages(size_t n, std::uint64_t seed) noexcept {
+	std::mt19937_64 rng{ seed };
+	std::vector<AppUsage> usages(n);
+	auto t = Start_Ms * 1'000;
+	auto n_docs = n / 20 + 1;
+	for (auto& x : usages) {
+		x = {};
+		snprintf(x.exe_name.data(), x.exe_name.size(), "app_%zu.exe", (size_t)(rng() % N_Exes));
+		snprintf(x.doc_name.data(), x.doc_name.size(), "document %zu", (size_t)(rng() % n_docs));
+		x.timestamp_start = t;
+		t += 1'000'000 + rng() % 300'000'000;
+		x.timestamp_end = t;
+	}
+	return usages;
+}
+
+void add_bench_displays(MouseState& ms) noexcept {
+	for (std::uint32_t i = 0; i < 2; ++i) {
+		Display d{};
+		d.width = Display_Width;
+		d.height = Display_Height;
+		d.x = i * Display_Width;
+		snprintf(d.unique_hash_char, sizeof(d.unique_hash_char), "display %u", i);
+		d.timestamp_end = UINT64_MAX;
+		ms.add_display(d);
+	}
+}
+
+static std::string size_name(size_t n) noexcept {
+	if (n % 1'000'000 == 0) return std::to_string(n / 1'000'000) + "M";
+	if (n % 1'000 == 0) return std::to_string(n / 1'000) + "K";
+	return std::to_string(n);
+}
+
+static void fail(const char* what) noexcept {
+	printf("%s failed, see the logs.\n", what);
+	exit(1);
+}
+
+// What the hook thread hands over, in the order it does it. The states grow as they do in the
+// app, without reserve.
+void bench_ingest(const BenchOptions& opts) noexcept {
+	auto n = opts.sizes.front();
+	auto keys = make_key_entries(n, 1);
+	auto clicks = make_clicks(n, 2);
+	auto usages = make_usages(n / 10, 3);
+
+	auto keyboard = best_of(opts.runs, [&] {
+		KeyboardState ks{};
+		for (auto& x : keys) ks.increment_key(x);
+	});
+	report({ "ingest/increment_key", n, keyboard });
+
+	// What the keyboard hook does for each key: a down and its up.
+	auto pairing = best_of(opts.runs, [&] {
+		KeyPairing p;
+		std::uint32_t sum = 0;
+		for (auto& x : keys) {
+			p.down(x.key_code, x.timestamp - x.hold.ms);
+			sum += p.up(x.key_code, x.timestamp).ms;
+		}
+		if (sum == 0) fail("key pairing");
+	});
+	report({ "ingest/key_pairing", n, pairing });
+
+	auto mouse = best_of(opts.runs, [&] {
+		MouseState ms{};
+		add_bench_displays(ms);
+		for (auto& x : clicks) ms.increment_button(x);
+	});
+	report({ "ingest/increment_button", n, mouse });
+
+	// The pointer going in circles at 1000 Hz, with a pause every 3s. The n of add_move is the
+	// samples that made it through the decimator.
+	std::vector<MoveSample> samples;
+	auto decimate = best_of(opts.runs, [&] {
+		MoveDecimator decimator;
+		samples.clear();
+		auto out = [&](const MoveSample& x) { samples.push_back(x); };
+		for (size_t i = 0; i < n; ++i) {
+			auto angle = i * 0.002;
+			auto x = (std::int32_t)(Display_Width / 2 + 400 * std::cos(angle));
+			auto y = (std::int32_t)(Display_Height / 2 + 400 * std::sin(angle));
+			decimator.move(x, y, Start_Ms + i + i / 3'000 * 500, out);
+		}
+		decimator.flush(out);
+	});
+	report({ "ingest/move_decimator", n, decimate });
+
+	auto moves = best_of(opts.runs, [&] {
+		MouseState ms{};
+		add_bench_displays(ms);
+		for (auto& x : samples) ms.add_move(x);
+	});
+	report({ "ingest/add_move", samples.size(), moves });
+
+	// Flicks of a free spinning wheel, a message every 4ms for 1.2s then 2s still, turning the
+	// other way every 1000 messages. The n of wheel_entries is what made it through, the hook
+	// queued one entry per message before.
+	std::vector<ClickEntry> wheels;
+	auto coalesce = best_of(opts.runs, [&] {
+		WheelCoalescer coalescer;
+		wheels.clear();
+		auto out = [&](std::optional<ClickEntry> x) {
+			if (x) wheels.push_back(*x);
+		};
+		for (size_t i = 0; i < n; ++i) {
+			auto t = Start_Ms + i * 4 + i / 300 * 2'000;
+			out(coalescer.idle(t));
+			out(coalescer.wheel(i % 2'000 < 1'000 ? -120 : 120, 100, 100, t));
+		}
+		out(coalescer.flush());
+	});
+	report({ "ingest/wheel_coalescer", n, coalesce });
+
+	auto wheel_entries = best_of(opts.runs, [&] {
+		MouseState ms{};
+		add_bench_displays(ms);
+		for (auto& x : wheels) ms.increment_button(x);
+	});
+	report({ "ingest/wheel_entries", wheels.size(), wheel_entries });
+
+	// Presses of the left and right buttons: clicks, doubles, drags and long presses. The n of
+	// add_gesture is the gestures, against the n downs and ups, no up waits for them here.
+	std::vector<ClickGesture> gestures;
+	auto classify = best_of(opts.runs, [&] {
+		ClickClassifier classifier;
+		gestures.clear();
+		auto out = [&](const ClickGesture& x) { gestures.push_back(x); };
+		std::mt19937_64 rng{ 5 };
+		auto t = Start_Ms;
+		std::int32_t x = 0;
+		std::int32_t y = 0;
+		bool again = false;
+		for (size_t i = 0; i + 1 < n; i += 2) {
+			auto r = rng() % 100;
+			auto button = (std::uint8_t)(r < 80 ? 0 : 2);
+			if (!again) {
+				x = (std::int32_t)(rng() % Display_Width);
+				y = (std::int32_t)(rng() % Display_Height);
+			}
+			auto held = r % 10 == 0 ? 700 : 60 + rng() % 80;
+			std::int32_t moved = r % 10 == 1 ? 200 : 0;
+			classifier.event({ button, true, x, y, t }, out);
+			classifier.event({ button, false, x + moved, y, t + held }, out);
+			// The next press is at the same place, maybe the second of a double.
+			again = !again && r < 30;
+			t += held + (again ? 100 : 600 + rng() % 2'000);
+			classifier.expire(t, out);
+		}
+	});
+	report({ "ingest/click_classifier", n, classify });
+
+	auto add_gesture = best_of(opts.runs, [&] {
+		MouseState ms{};
+		for (auto& x : gestures) ms.add_gesture(x);
+	});
+	report({ "ingest/add_gesture", gestures.size(), add_gesture });
+
+	auto event = best_of(opts.runs, [&] {
+		EventState es{};
+		for (auto& x : usages) es.register_event(x);
+	});
+	report({ "ingest/register_event", usages.size(), event });
+}
+
+// The formats before the current one are only ever read, they are written here the way the old
+// versions did.
+static void write_keyboard_legacy(
+	const KeyboardState& ks, std::uint8_t version, const std::filesystem::path& path
+) {
+	size_t record_size = version == 0 ? 5 : KeyEntry::Packed_Size;
+	std::vector<std::byte> bytes;
+	ByteWriter writer{ bytes };
+	writer.reserve(5 + 256 * 4 + record_size * ks.key_entries.size());
+	writer.write(Keyboard_File_Signature);
+	writer.write(version);
+	for (auto x : ks.key_times) writer.write((std::uint32_t)x);
+	writer.write((std::uint32_t)ks.key_entries.size());
+
+	auto dst = writer.claim(record_size * ks.key_entries.size());
+	for (auto& x : ks.key_entries) {
+		dst[0] = (std::byte)x.key_code;
+		if (version == 0) store_le(dst + 1, (std::uint32_t)(x.timestamp / 1'000));
+		else              store_le(dst + 1, (std::uint64_t)(x.timestamp / 1'000));
+		dst += record_size;
+	}
+	if (file_replace_atomic(bytes, path)) fail("write_keyboard_legacy");
+}
+
+// Version 0 had 88 bytes displays and 13 bytes clicks, the timestamps on 32 bits.
+static void write_mouse_legacy(const MouseState& ms, const std::filesystem::path& path) {
+	std::vector<std::byte> bytes;
+	ByteWriter writer{ bytes };
+	writer.write(Mouse_File_Signature);
+	writer.write((std::uint8_t)0);
+	for (auto x : ms.buttons) writer.write((std::uint32_t)x);
+	writer.write((std::uint32_t)ms.click_entries.size());
+	writer.write((std::uint32_t)ms.display_entries.size());
+	for (auto& d : ms.display_entries) {
+		writer.write(d.width);
+		writer.write(d.height);
+		writer.write(d.x);
+		writer.write(d.y);
+		writer.write_bytes((const std::byte*)d.unique_hash_char, Display::Unique_Hash_Size);
+		writer.write_bytes((const std::byte*)d.custom_name, Display::Custom_Name_Size);
+		writer.write((std::uint32_t)d.timestamp_start);
+		writer.write((std::uint32_t)d.timestamp_end);
+	}
+
+	auto dst = writer.claim(13 * ms.click_entries.size());
+	for (auto& x : ms.click_entries) {
+		dst[0] = (std::byte)x.button_code;
+		store_le(dst + 1, x.x);
+		store_le(dst + 5, x.y);
+		store_le(dst + 9, (std::uint32_t)x.timestamp);
+		dst += 13;
+	}
+	if (file_replace_atomic(bytes, path)) fail("write_mouse_legacy");
+}
+
+// The lazy loads only read the header, the bytes of the file would make no sense for them.
+template<typename F>
+static void bench_load(
+	const std::string& name,
+	size_t n,
+	const std::filesystem::path& path,
+	bool whole_file,
+	const BenchOptions& opts,
+	F&& f
+) noexcept {
+	size_t bytes = 0;
+	if (whole_file) bytes = (size_t)get_file_length(path).value_or(0);
+
+	auto ms = best_of(opts.runs, [&] { if (!f()) fail(name.c_str()); });
+	report({ name, n, ms, bytes });
+}
+
+static void bench_keyboard_files(size_t n, const BenchOptions& opts) noexcept {
+	auto path = opts.dir / "keyboard.mto";
+	auto suffix = "/" + size_name(n);
+
+	KeyboardState ks{};
+	for (auto& x : make_key_entries(n, 1)) ks.increment_key(x);
+
+	auto save = best_of(opts.runs, [&] { if (!ks.save_to_file(path)) fail("keyboard save"); });
+	report({ "files/keyboard/save/v2" + suffix, n, save, (size_t)*get_file_length(path) });
+
+	bench_load("files/keyboard/load/v2" + suffix, n, path, true, opts, [&] {
+		return KeyboardState::load_from_file(path).has_value();
+	});
+	bench_load("files/keyboard/load_lazy/v2" + suffix, n, path, false, opts, [&] {
+		return KeyboardState::load_from_file(path, true).has_value();
+	});
+	// The entries read on the first look at the key list.
+	bench_load("files/keyboard/load_lazy_entries/v2" + suffix, n, path, true, opts, [&] {
+		auto x = KeyboardState::load_from_file(path, true);
+		return x && x->ensure_entries_loaded();
+	});
+
+	for (std::uint8_t version : { 0, 1 }) {
+		write_keyboard_legacy(ks, version, path);
+		auto name = "files/keyboard/load/v" + std::to_string(version) + suffix;
+		bench_load(name, n, path, true, opts, [&] {
+			return KeyboardState::load_from_file(path).has_value();
+		});
+	}
+}
+
+static void bench_mouse_files(size_t n, const BenchOptions& opts) noexcept {
+	auto path = opts.dir / "mouse.mto";
+	auto suffix = "/" + size_name(n);
+
+	MouseState ms{};
+	add_bench_displays(ms);
+	for (auto& x : make_clicks(n, 2)) ms.increment_button(x);
+
+	auto save = best_of(opts.runs, [&] { if (!ms.save_to_file(path)) fail("mouse save"); });
+	report({ "files/mouse/save/v1" + suffix, n, save, (size_t)*get_file_length(path) });
+
+	bench_load("files/mouse/load/v1" + suffix, n, path, true, opts, [&] {
+		return MouseState::load_from_file(path, true).has_value();
+	});
+	bench_load("files/mouse/load_lazy/v1" + suffix, n, path, false, opts, [&] {
+		return MouseState::load_from_file(path, true, true).has_value();
+	});
+
+	write_mouse_legacy(ms, path);
+	bench_load("files/mouse/load/v0" + suffix, n, path, true, opts, [&] {
+		return MouseState::load_from_file(path, true).has_value();
+	});
+}
+
+static void bench_event_files(size_t n, const BenchOptions& opts) noexcept {
+	auto path = opts.dir / "event.mto";
+	auto suffix = "/" + size_name(n);
+
+	EventState es{};
+	for (auto& x : make_usages(n, 3)) es.register_event(x);
+
+	auto save = best_of(opts.runs, [&] { if (!es.save_to_file(path)) fail("event save"); });
+	report({ "files/event/save/v0" + suffix, n, save, (size_t)*get_file_length(path) });
+
+	bench_load("files/event/load/v0" + suffix, n, path, true, opts, [&] {
+		return EventState::load_from_file(path).has_value();
+	});
+	bench_load("files/event/load_lazy/v0" + suffix, n, path, false, opts, [&] {
+		return EventState::load_from_file(path, true).has_value();
+	});
+}
+
+// Each size has its own history, the states are dropped before the next one is made so the
+// 100M one fits.
+void bench_files(const BenchOptions& opts) noexcept {
+	for (auto n : opts.sizes) {
+		bench_keyboard_files(n, opts);
+		bench_mouse_files(n, opts);
+		// An usage lasts minutes where a key lasts a fraction of a second, they are fewer.
+		bench_event_files(n / 10, opts);
+	}
+}
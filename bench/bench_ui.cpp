@@ -0,0 +1,114 @@
+// The windows drawn in a headless imgui context: no backend, the draw lists are built and thrown
+// away, which is what the app pays on the cpu each frame.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "imgui.h"
+
+#include "Bench.hpp"
+#include "Event.hpp"
+#include "Mouse.hpp"
+#include "keyboard.hpp"
+#include "render_stats.hpp"
+
+struct HeadlessImGui {
+	HeadlessImGui() noexcept {
+		ImGui::CreateContext();
+		auto& io = ImGui::GetIO();
+		io.DisplaySize = { 1920, 1080 };
+		io.DeltaTime = 1.f / 60.f;
+		io.IniFilename = nullptr;
+
+		unsigned char* pixels;
+		int width;
+		int height;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+	~HeadlessImGui() noexcept { ImGui::DestroyContext(); }
+
+	// The window drawn by f gets the whole screen, a new window would be too small to show
+	// anything.
+	template<typename F>
+	void frame(F&& f) noexcept {
+		ImGui::NewFrame();
+		ImGui::SetNextWindowPos({ 0, 0 });
+		ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+		f();
+		ImGui::Render();
+	}
+};
+
+// The frames in a row, once the caches are warm.
+template<typename F>
+static void bench_frames(
+	HeadlessImGui& imgui, const std::string& name, const BenchOptions& opts, F&& render
+) noexcept {
+	imgui.frame(render);
+
+	Timer t;
+	for (size_t i = 0; i < opts.n_frames; ++i) imgui.frame(render);
+	report({ name + "/frame", opts.n_frames, t.ms() });
+}
+
+// The frame after a change, with the cache built again.
+template<typename Dirty, typename F>
+static void bench_rebuild(
+	HeadlessImGui& imgui, const std::string& name, const BenchOptions& opts, Dirty&& dirty, F&& render
+) noexcept {
+	auto ms = best_of(opts.runs, [&] {
+		dirty();
+		imgui.frame(render);
+	});
+	report({ name + "/rebuild", 1, ms });
+}
+
+void bench_ui(const BenchOptions& opts) noexcept {
+	auto n = opts.sizes.front();
+	HeadlessImGui imgui;
+
+	{
+		std::optional<KeyboardState> ks = KeyboardState{};
+		for (auto& x : make_key_entries(n, 1)) ks->increment_key(x);
+
+		KeyboardWindow window;
+		window.render_key_list_checkbox = true;
+		bench_frames(imgui, "ui/keyboard_window", opts, [&] { window.render(ks); });
+
+		// The history of the most used key, decoded from the postings.
+		window.key_details.key = (std::uint8_t)0x20;
+		window.key_details.title = "Data of: space";
+		auto dirty = [&] { window.key_details.count = 0; };
+		bench_rebuild(imgui, "ui/key_details", opts, dirty, [&] { window.render(ks); });
+	}
+
+	{
+		std::optional<MouseState> ms = MouseState{};
+		add_bench_displays(*ms);
+		for (auto& x : make_clicks(n, 2)) ms->increment_button(x);
+
+		MouseWindow window;
+		window.render_buttons_list_checkbox = true;
+		bench_frames(imgui, "ui/mouse_window", opts, [&] { window.render(ms); });
+
+		// The usage plot goes through every click for each of its points.
+		auto dirty = [&] { ms->cache.usage_plot.dirty = true; };
+		bench_rebuild(imgui, "ui/render_mouse_plot", opts, dirty, [&] {
+			ImGui::Begin("Plot");
+			render_mouse_plot(*ms);
+			ImGui::End();
+		});
+	}
+
+	{
+		std::optional<EventState> es = EventState{};
+		for (auto& x : make_usages(n / 10, 3)) es->register_event(x);
+
+		EventWindow window;
+		// Every exe opened, the worst case for the rows.
+		for (auto& x : es->apps_usages) window.opened.insert(x.exe_name);
+		auto render = [&] { window.render(es); };
+		bench_frames(imgui, "ui/event_window", opts, render);
+		bench_rebuild(imgui, "ui/event_window/cache", opts, [&] { es->cache.dirty = true; }, render);
+	}
+}
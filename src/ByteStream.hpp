@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// The save files are little endian. On a little endian host a value is stored with a single
+// memcpy and arrays of integers are copied in one go, otherwise we swap the bytes.
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+constexpr bool Host_Little_Endian = true;
+#else
+constexpr bool Host_Little_Endian = false;
+#endif
+
+template<typename T>
+[[nodiscard]] inline T byte_swap_any(T x) noexcept {
+	static_assert(std::is_integral_v<T>);
+	std::make_unsigned_t<T> u = (std::make_unsigned_t<T>)x;
+	std::make_unsigned_t<T> r = 0;
+	for (size_t i = 0; i < sizeof(T); ++i, u >>= 8) r = (r << 8) | (u & 0xff);
+	return (T)r;
+}
+
+template<typename T>
+inline void store_le(std::byte* dst, T x) noexcept {
+	static_assert(std::is_integral_v<T>);
+	if constexpr (!Host_Little_Endian && sizeof(T) > 1) x = byte_swap_any(x);
+	memcpy(dst, &x, sizeof(T));
+}
+
+template<typename T>
+[[nodiscard]] inline T load_le(const std::byte* src) noexcept {
+	static_assert(std::is_integral_v<T>);
+	T x;
+	memcpy(&x, src, sizeof(T));
+	if constexpr (!Host_Little_Endian && sizeof(T) > 1) x = byte_swap_any(x);
+	return x;
+}
+
+// Appends to a byte vector. reserve with the size computed from the record counts first so
+// the vector grows once, then every write is a memcpy in already allocated memory.
+struct ByteWriter {
+	std::vector<std::byte>& bytes;
+
+	explicit ByteWriter(std::vector<std::byte>& bytes) noexcept : bytes(bytes) {}
+
+	void reserve(size_t n) noexcept { bytes.reserve(bytes.size() + n); }
+
+	// Grows the vector by n bytes and returns where to write them, for the fixed width records
+	// that are packed field by field with store_le.
+	[[nodiscard]] std::byte* claim(size_t n) noexcept {
+		auto size = bytes.size();
+		bytes.resize(size + n);
+		return bytes.data() + size;
+	}
+
+	template<typename T>
+	void write(T x) noexcept { store_le(claim(sizeof(T)), x); }
+
+	void write_bytes(const void* data, size_t n) noexcept {
+		if (n > 0) memcpy(claim(n), data, n);
+	}
+
+	template<typename T>
+	void write_array(const T* data, size_t n) noexcept {
+		static_assert(std::is_integral_v<T>);
+		if constexpr (Host_Little_Endian || sizeof(T) == 1) {
+			write_bytes(data, n * sizeof(T));
+		}
+		else {
+			auto dst = claim(n * sizeof(T));
+			for (size_t i = 0; i < n; ++i) store_le(dst + i * sizeof(T), data[i]);
+		}
+	}
+};
+
+// Reads from a byte vector. There are no bound checks in read, the callers check the size of
+// the whole block with can_read before reading it, like the loaders always did.
+struct ByteReader {
+	const std::byte* data;
+	size_t size;
+	size_t offset;
+
+	explicit ByteReader(const std::vector<std::byte>& bytes, size_t offset = 0) noexcept :
+		data(bytes.data()), size(bytes.size()), offset(offset) {}
+
+	[[nodiscard]] bool can_read(size_t n) const noexcept {
+		return offset <= size && n <= size - offset;
+	}
+	[[nodiscard]] const std::byte* current() const noexcept { return data + offset; }
+	void skip(size_t n) noexcept { offset += n; }
+
+	template<typename T>
+	[[nodiscard]] T read() noexcept {
+		auto x = load_le<T>(data + offset);
+		offset += sizeof(T);
+		return x;
+	}
+
+	void read_bytes(void* dst, size_t n) noexcept {
+		if (n > 0) memcpy(dst, data + offset, n);
+		offset += n;
+	}
+
+	template<typename T>
+	void read_array(T* dst, size_t n) noexcept {
+		static_assert(std::is_integral_v<T>);
+		if constexpr (Host_Little_Endian || sizeof(T) == 1) {
+			read_bytes(dst, n * sizeof(T));
+		}
+		else {
+			for (size_t i = 0; i < n; ++i) dst[i] = read<T>();
+		}
+	}
+};
@@ -0,0 +1,48 @@
+#include "ClickGestures.hpp"
+#include <algorithm>
+
+#include "ByteStream.hpp"
+
+void ClickGestures::up(std::uint8_t button, std::uint64_t click, std::uint64_t timestamp) noexcept {
+	if (button >= ClickGesture::N_Buttons) return;
+
+	// Full, the oldest can only be an up that will never get its gesture.
+	if (n_waiting[button] == Max_Waiting) pop(button, 1);
+	waiting[button][n_waiting[button]++] = { click, timestamp };
+}
+
+void ClickGestures::pop(std::uint8_t button, size_t n) noexcept {
+	auto& ups = waiting[button];
+	std::copy(std::begin(ups) + n, std::begin(ups) + n_waiting[button], std::begin(ups));
+	n_waiting[button] -= (std::uint8_t)n;
+}
+
+std::uint64_t ClickGestures::count(std::uint8_t kind) const noexcept {
+	std::uint64_t sum = 0;
+	for (std::uint8_t i = 0; i < ClickGesture::N_Buttons; ++i) sum += count(kind, i);
+	return sum;
+}
+
+// u32 N_Buttons, the counts by kind and button, u64 drag distance and u64 long press ms.
+void ClickGestures::save(std::vector<std::byte>& out) const noexcept {
+	ByteWriter writer{ out };
+	writer.reserve(4 + 8 * counts.size() + 16);
+	writer.write((std::uint32_t)ClickGesture::N_Buttons);
+	writer.write_array(counts.data(), counts.size());
+	writer.write(drag_distance);
+	writer.write(long_press_ms);
+}
+
+[[nodiscard]] bool ClickGestures::load(
+	const std::vector<std::byte>& in, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ in, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(4 + 8 * counts.size() + 16)) return false;
+	if (reader.read<std::uint32_t>() != ClickGesture::N_Buttons) return false;
+
+	reader.read_array(counts.data(), counts.size());
+	drag_distance = reader.read<std::uint64_t>();
+	long_press_ms = reader.read<std::uint64_t>();
+	return true;
+}
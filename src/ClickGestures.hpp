@@ -0,0 +1,197 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// A button going down or up as the mouse hook sees it. The clicks only keep the ups, in seconds.
+struct ButtonEvent {
+	std::uint8_t button; // MouseState::ButtonMap
+	bool down;
+	std::int32_t x; // in the hook's coordinates, only the distances matter.
+	std::int32_t y;
+	std::uint64_t timestamp; // ms since epoch.
+};
+
+// What a press of a button was. One for a double click, where the downs and ups would be four.
+// Only its kind is kept, in the clicks of its ups, the rest goes to the counters.
+struct ClickGesture {
+	enum Kind : std::uint8_t {
+		Single = 0,
+		Double,
+		Drag,
+		Long_Press,
+		Count
+	};
+	static constexpr size_t N_Buttons = 32;
+
+	std::uint8_t kind;
+	std::uint8_t button;
+	std::uint16_t held_ms; // down to up, of the second press for a double. Capped.
+	std::uint32_t distance; // pixels between the down and the up of a drag, 0 otherwise.
+	std::uint64_t timestamp; // ms since epoch, of the (first) down.
+};
+
+// In the ingest, pairs the downs and ups of each button into gestures. A click is held back until
+// the next down of its button or Double_Ms, to see if it's the first of a double. Fixed size, no
+// allocation, an event is O(1).
+struct ClickClassifier {
+	// The windows defaults: GetDoubleClickTime, SM_CXDOUBLECLK and SM_CXDRAG.
+	static constexpr std::uint64_t Double_Ms = 500;
+	static constexpr double Double_Px = 4;
+	static constexpr double Drag_Px = 4;
+	static constexpr std::uint64_t Long_Press_Ms = 500;
+	// A down older than that lost its up (the hook was off, the session locked).
+	static constexpr std::uint64_t Stale_Ms = 60'000;
+
+	struct Press {
+		std::uint64_t down_at{ 0 }; // 0 if the button is up.
+		std::int32_t x{ 0 };
+		std::int32_t y{ 0 };
+
+		// The single click waiting for its second one, click_at is its down, 0 if none.
+		std::uint64_t click_at{ 0 };
+		std::int32_t click_x{ 0 };
+		std::int32_t click_y{ 0 };
+		std::uint16_t click_ms{ 0 };
+	};
+	std::array<Press, ClickGesture::N_Buttons> presses{};
+
+	// Calls out(ClickGesture) for the gestures the event ends.
+	template<typename F>
+	void event(const ButtonEvent& e, F&& out) noexcept {
+		if (e.button >= presses.size()) return;
+		auto& p = presses[e.button];
+
+		if (e.down) {
+			bool double_click =
+				p.click_at &&
+				e.timestamp >= p.click_at &&
+				e.timestamp - p.click_at <= Double_Ms &&
+				distance(p.click_x, p.click_y, e.x, e.y) <= Double_Px;
+			if (p.click_at && !double_click) end_single(e.button, out);
+			p.down_at = e.timestamp;
+			p.x = e.x;
+			p.y = e.y;
+			return;
+		}
+
+		auto down_at = p.down_at;
+		p.down_at = 0;
+		if (!down_at || e.timestamp < down_at || e.timestamp - down_at > Stale_Ms) return;
+
+		auto held = e.timestamp - down_at;
+		auto moved = distance(p.x, p.y, e.x, e.y);
+		ClickGesture g{};
+		g.button = e.button;
+		g.held_ms = (std::uint16_t)(held < UINT16_MAX ? held : UINT16_MAX);
+		g.timestamp = down_at;
+
+		if (moved > Drag_Px) {
+			end_single(e.button, out);
+			g.kind = ClickGesture::Drag;
+			g.distance = (std::uint32_t)(moved + 0.5);
+			out(g);
+		}
+		else if (held >= Long_Press_Ms) {
+			end_single(e.button, out);
+			g.kind = ClickGesture::Long_Press;
+			out(g);
+		}
+		else if (p.click_at) {
+			g.kind = ClickGesture::Double;
+			g.timestamp = p.click_at;
+			p.click_at = 0;
+			out(g);
+		}
+		else {
+			p.click_at = down_at;
+			p.click_x = p.x;
+			p.click_y = p.y;
+			p.click_ms = g.held_ms;
+		}
+	}
+
+	// The clicks that can't become doubles anymore at now (ms since epoch) are singles.
+	template<typename F>
+	void expire(std::uint64_t now, F&& out) noexcept {
+		for (std::uint8_t i = 0; i < presses.size(); ++i) {
+			auto& p = presses[i];
+			if (p.click_at && !p.down_at && now > p.click_at + Double_Ms) end_single(i, out);
+		}
+	}
+
+private:
+	static double distance(
+		std::int32_t ax, std::int32_t ay, std::int32_t bx, std::int32_t by
+	) noexcept {
+		double dx = (double)bx - ax;
+		double dy = (double)by - ay;
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	template<typename F>
+	void end_single(std::uint8_t button, F&& out) noexcept {
+		auto& p = presses[button];
+		if (!p.click_at) return;
+		out(ClickGesture{ ClickGesture::Single, button, p.click_ms, 0, p.click_at });
+		p.click_at = 0;
+	}
+};
+
+// The counters of the gestures and the ups waiting for theirs. The ups of a button get their
+// gestures in order: a single is only known at the next down or after Double_Ms but always before
+// the gesture of the next up. An up that gets none (its down was lost) is skipped by the gesture
+// of a later down. Fixed size, no allocation.
+struct ClickGestures {
+	static constexpr size_t Max_Waiting = 4; // a double and what a lost down left.
+
+	struct Up {
+		std::uint64_t click; // the serial of its click, see MouseState::clicks_added.
+		std::uint64_t timestamp; // ms since epoch.
+	};
+
+	// By kind * ClickGesture::N_Buttons + button.
+	std::array<std::uint64_t, ClickGesture::Count * ClickGesture::N_Buttons> counts{};
+	std::uint64_t drag_distance{ 0 }; // pixels, of all the drags.
+	std::uint64_t long_press_ms{ 0 }; // of all the long presses.
+
+	// By button, the oldest first.
+	std::array<std::array<Up, Max_Waiting>, ClickGesture::N_Buttons> waiting{};
+	std::array<std::uint8_t, ClickGesture::N_Buttons> n_waiting{};
+
+	void up(std::uint8_t button, std::uint64_t click, std::uint64_t timestamp) noexcept;
+
+	// Counts the gesture and calls f(click) for the clicks of its ups, two for a double.
+	template<typename F>
+	void add(const ClickGesture& x, F&& f) noexcept {
+		if (x.kind >= ClickGesture::Count || x.button >= ClickGesture::N_Buttons) return;
+
+		counts[x.kind * ClickGesture::N_Buttons + x.button]++;
+		if (x.kind == ClickGesture::Drag) drag_distance += x.distance;
+		if (x.kind == ClickGesture::Long_Press) long_press_ms += x.held_ms;
+
+		auto& ups = waiting[x.button];
+		auto& n = n_waiting[x.button];
+		size_t skipped = 0;
+		while (skipped < n && ups[skipped].timestamp < x.timestamp) ++skipped;
+		size_t want = x.kind == ClickGesture::Double ? 2 : 1;
+		auto taken = (std::min)((size_t)(n - skipped), want);
+		for (size_t i = 0; i < taken; ++i) f(ups[skipped + i].click);
+		pop(x.button, skipped + taken);
+	}
+
+	[[nodiscard]] std::uint64_t count(std::uint8_t kind, std::uint8_t button) const noexcept {
+		return counts[kind * ClickGesture::N_Buttons + button];
+	}
+	[[nodiscard]] std::uint64_t count(std::uint8_t kind) const noexcept;
+
+	// The counters, the ups are not saved.
+	void save(std::vector<std::byte>& out) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& in, size_t offset, size_t size) noexcept;
+
+private:
+	void pop(std::uint8_t button, size_t n) noexcept;
+};
@@ -1,41 +1,18 @@
 #include "Common.hpp"
 
-#include <Windows.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <filesystem>
 
 #include "file.hpp"
+#include "ByteStream.hpp"
 const std::filesystem::path App_Data_Dir_Name{ "Mes Touches" };
 
 [[nodiscard]] std::filesystem::path get_app_data_path() noexcept {
 	return get_user_data_path() / App_Data_Dir_Name;
 }
 
-[[nodiscard]] std::string get_last_os_error() noexcept {
-	LPSTR buffer = nullptr;
-	size_t size = FormatMessageA(
-		FORMAT_MESSAGE_ALLOCATE_BUFFER |
-		FORMAT_MESSAGE_FROM_SYSTEM |
-		FORMAT_MESSAGE_IGNORE_INSERTS,
-		NULL,
-		GetLastError(),
-		MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-		(LPSTR)&buffer,
-		0,
-		NULL
-	);
-
-	std::string message(buffer, size);
-	LocalFree(buffer);
-	return message;
-}
-[[nodiscard]] std::string format_errno(errno_t x) noexcept {
-	std::string result;
-	result.resize(100);
-	strerror_s(result.data(), result.capacity(), x);
-	return result;
-}
-
 std::uint32_t byte_swap(std::uint32_t x) noexcept {
 	return
 		((x >> 24) & 0xff) | // move byte 3 to byte 0
@@ -45,59 +22,157 @@ std::uint32_t byte_swap(std::uint32_t x) noexcept {
 }
 
 
+// Kept for the small headers and the sections, the big arrays go through ByteWriter directly.
 void insert_uint64(std::vector<std::byte>& bytes, std::uint64_t x) noexcept {
-	bytes.push_back((std::byte)((x & 0x00000000000000ff) >> 0));
-	bytes.push_back((std::byte)((x & 0x000000000000ff00) >> 8));
-	bytes.push_back((std::byte)((x & 0x0000000000ff0000) >> 16));
-	bytes.push_back((std::byte)((x & 0x00000000ff000000) >> 24));
-	bytes.push_back((std::byte)((x & 0x000000ff00000000) >> 32));
-	bytes.push_back((std::byte)((x & 0x0000ff0000000000) >> 40));
-	bytes.push_back((std::byte)((x & 0x00ff000000000000) >> 48));
-	bytes.push_back((std::byte)((x & 0xff00000000000000) >> 56));
+	ByteWriter{ bytes }.write(x);
 };
 void insert_uint32(std::vector<std::byte>& bytes, std::uint32_t x) noexcept {
-	bytes.push_back((std::byte)((x & 0x000000ff) >> 0));
-	bytes.push_back((std::byte)((x & 0x0000ff00) >> 8));
-	bytes.push_back((std::byte)((x & 0x00ff0000) >> 16));
-	bytes.push_back((std::byte)((x & 0xff000000) >> 24));
+	ByteWriter{ bytes }.write(x);
 };
 void insert_uint16(std::vector<std::byte>& bytes, std::uint16_t x) noexcept {
-	bytes.push_back((std::byte)((x & 0x00ff) >> 0));
-	bytes.push_back((std::byte)((x & 0xff00) >> 8));
+	ByteWriter{ bytes }.write(x);
 };
 void insert_uint8(std::vector<std::byte>& bytes, std::uint8_t x) noexcept {
 	bytes.push_back((std::byte)x);
 };
 
 [[nodiscard]] std::uint32_t read_uint32(const std::vector<std::byte>& bytes, size_t offset) noexcept {
-	std::uint32_t x{ 0 };
-	x = x | (std::uint32_t)(((std::uint8_t)bytes[offset + 0]) << 0);
-	x = x | (std::uint32_t)(((std::uint8_t)bytes[offset + 1]) << 8);
-	x = x | (std::uint32_t)(((std::uint8_t)bytes[offset + 2]) << 16);
-	x = x | (std::uint32_t)(((std::uint8_t)bytes[offset + 3]) << 24);
-	return x;
+	return load_le<std::uint32_t>(bytes.data() + offset);
 };
 [[nodiscard]] std::uint64_t read_uint64(const std::vector<std::byte>& bytes, size_t offset) noexcept {
-	std::uint64_t x{ 0 };
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 0])) << (std::uint64_t)0);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 1])) << (std::uint64_t)8);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 2])) << (std::uint64_t)16);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 3])) << (std::uint64_t)24);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 4])) << (std::uint64_t)32);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 5])) << (std::uint64_t)40);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 6])) << (std::uint64_t)48);
-	x = x | (((std::uint64_t)((std::uint8_t)bytes[offset + 7])) << (std::uint64_t)56);
-	return x;
+	return load_le<std::uint64_t>(bytes.data() + offset);
 };
 [[nodiscard]] std::uint16_t read_uint16(const std::vector<std::byte>& raw, size_t offset) noexcept {
-	return
-		(uint16_t)(((uint8_t)raw[offset + 0]) << 0)
-		| (uint16_t)(((uint8_t)raw[offset + 1]) << 8);
+	return load_le<std::uint16_t>(raw.data() + offset);
 };
 [[nodiscard]] std::uint8_t read_uint8(const std::vector<std::byte>& bytes, size_t offset) noexcept {
-	std::uint8_t x{ 0 };
-	x |= (std::uint8_t)(((std::uint8_t)bytes[offset + 0]) << 0);
-	return x;
+	return (std::uint8_t)bytes[offset];
 };
 
+std::vector<std::byte>& FileParts::bytes() noexcept {
+	if (parts.empty() || !parts.back().path.empty()) parts.emplace_back();
+	return parts.back().bytes;
+}
+
+void FileParts::copy(
+	const std::filesystem::path& path, std::uint64_t offset, std::uint64_t size
+) noexcept {
+	if (size == 0) return;
+	Part part;
+	part.path = path;
+	part.offset = offset;
+	part.size = size;
+	parts.push_back(std::move(part));
+}
+
+void FileParts::append(FileParts&& other) noexcept {
+	for (auto& x : other.parts) parts.push_back(std::move(x));
+	other.parts.clear();
+}
+
+std::uint64_t FileParts::size() const noexcept {
+	std::uint64_t size = 0;
+	for (auto& x : parts) size += x.path.empty() ? x.bytes.size() : x.size;
+	return size;
+}
+
+int FileParts::write(std::FILE* f) const noexcept {
+	std::vector<std::byte> block;
+	for (auto& x : parts) {
+		if (x.path.empty()) {
+			if (fwrite(x.bytes.data(), 1, x.bytes.size(), f) != x.bytes.size()) return EIO;
+			continue;
+		}
+
+		for (std::uint64_t done = 0; done < x.size;) {
+			auto n = (size_t)(std::min<std::uint64_t>)(x.size - done, File_Copy_Block);
+			block.clear();
+			if (auto err = file_read_range(x.path, x.offset + done, n, block); err) return err;
+			if (fwrite(block.data(), 1, n, f) != n) return EIO;
+			done += n;
+		}
+	}
+	return 0;
+}
+
+std::vector<FileSection> insert_sections(
+	FileParts& out, std::vector<std::pair<std::uint32_t, FileParts>>&& sections
+) noexcept {
+	std::vector<FileSection> written;
+
+	ByteWriter{ out.bytes() }.write((std::uint32_t)sections.size());
+	auto offset = out.size();
+	for (auto& [tag, payload] : sections) {
+		auto size = payload.size();
+		ByteWriter header{ out.bytes() };
+		header.write(tag);
+		header.write((std::uint32_t)size);
+		offset += 8;
+		written.push_back({ tag, (size_t)offset, (size_t)size });
+		out.append(std::move(payload));
+		offset += size;
+	}
+	return written;
+}
+
+[[nodiscard]] std::optional<std::vector<FileSection>>
+read_sections(const std::vector<std::byte>& bytes, size_t offset) noexcept {
+	std::vector<FileSection> sections;
+
+	// A file without the trailer is just a file with no sections.
+	if (offset == bytes.size()) return sections;
+	if (offset + 4 > bytes.size()) return std::nullopt;
+
+	auto n = read_uint32(bytes, offset);
+	offset += 4;
+
+	for (size_t i = 0; i < n; ++i) {
+		if (offset + 8 > bytes.size()) return std::nullopt;
+
+		FileSection section;
+		section.tag = read_uint32(bytes, offset + 0);
+		section.size = read_uint32(bytes, offset + 4);
+		section.offset = offset + 8;
+		if (section.offset + section.size > bytes.size()) return std::nullopt;
+
+		sections.push_back(section);
+		offset = section.offset + section.size;
+	}
+
+	return sections;
+}
+
+[[nodiscard]] std::optional<std::vector<FileSection>> read_file_sections(
+	const std::filesystem::path& path, std::uint64_t offset, std::uint64_t file_size
+) noexcept {
+	std::vector<FileSection> sections;
 
+	if (offset == file_size) return sections;
+	std::vector<std::byte> header;
+	if (offset + 4 > file_size || file_read_range(path, offset, 4, header)) return std::nullopt;
+
+	auto n = read_uint32(header, 0);
+	offset += 4;
+
+	for (size_t i = 0; i < n; ++i) {
+		header.clear();
+		if (offset + 8 > file_size || file_read_range(path, offset, 8, header)) return std::nullopt;
+
+		FileSection section;
+		section.tag = read_uint32(header, 0);
+		section.size = read_uint32(header, 4);
+		section.offset = (size_t)(offset + 8);
+		if (section.offset + section.size > file_size) return std::nullopt;
+
+		sections.push_back(section);
+		offset = section.offset + section.size;
+	}
+
+	return sections;
+}
+
+[[nodiscard]] const FileSection*
+find_section(const std::vector<FileSection>& sections, std::uint32_t tag) noexcept {
+	for (auto& x : sections) if (x.tag == tag) return &x;
+	return nullptr;
+}
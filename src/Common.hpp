@@ -1,7 +1,9 @@
 #pragma once
 #include <filesystem>
+#include <optional>
 #include <vector>
 #include "Logs.hpp"
+#include "file.hpp"
 
 namespace details {
 	template<typename Callable>
@@ -13,7 +15,10 @@ namespace details {
 	};
 };
 
-#define defer details::Defer _CONCAT(defer_, __COUNTER__) = [&]
+// _CONCAT is msvc's, this one builds everywhere.
+#define CONCAT_(a, b) a##b
+#define CONCAT(a, b) CONCAT_(a, b)
+#define defer details::Defer CONCAT(defer_, __COUNTER__) = [&]
 #define BEG(x) std::begin(x)
 #define BEG_END(x) std::begin(x), std::end(x)
 
@@ -35,6 +40,46 @@ extern std::uint32_t read_uint32(const std::vector<std::byte>& bytes, size_t off
 extern std::uint16_t read_uint16(const std::vector<std::byte>& bytes, size_t offset) noexcept;
 extern std::uint8_t read_uint8(const std::vector<std::byte>& bytes, size_t offset) noexcept;
 
+// Save files can end with a list of tagged sections: u32 count then for each u32 tag,
+// u32 size and the payload. Readers skip the tags they don't know, that way adding a new
+// aggregate to a file doesn't need a new version.
+struct FileSection {
+	std::uint32_t tag;
+	size_t offset;
+	size_t size;
+};
+
+// Appends the sections to out, returns where each payload landed in it.
+extern std::vector<FileSection> insert_sections(
+	FileParts& out, std::vector<std::pair<std::uint32_t, FileParts>>&& sections
+) noexcept;
+[[nodiscard]] extern std::optional<std::vector<FileSection>>
+read_sections(const std::vector<std::byte>& bytes, size_t offset) noexcept;
+// The same straight from the file, for the lazy loads: only the headers are read, the offsets
+// are in the file and the payloads are left to file_read_range.
+[[nodiscard]] extern std::optional<std::vector<FileSection>> read_file_sections(
+	const std::filesystem::path& path, std::uint64_t offset, std::uint64_t file_size
+) noexcept;
+[[nodiscard]] extern const FileSection*
+find_section(const std::vector<FileSection>& sections, std::uint32_t tag) noexcept;
+
+// A block of fixed width records left in the file when a state is loaded lazily, the counters
+// and the sections are in memory but the raw entries are only read when something asks for them.
+// The records appended in memory since the load come after the ones of the block.
+struct PendingRecords {
+	std::filesystem::path path;
+	std::uint64_t offset{ 0 };
+	size_t count{ 0 };
+	size_t record_size{ 0 };
+};
+
+// A section left in the file by a lazy load, read the first time something needs it.
+struct PendingSection {
+	std::filesystem::path path;
+	std::uint64_t offset{ 0 };
+	size_t size{ 0 };
+};
+
 
 extern std::uint32_t byte_swap(std::uint32_t x) noexcept;
 
@@ -43,4 +88,3 @@ extern std::filesystem::path get_user_data_path() noexcept;
 extern const std::filesystem::path App_Data_Dir_Name;
 [[nodiscard]] extern std::filesystem::path get_app_data_path() noexcept;
 extern Logs logs;
-[[nodiscard]] extern std::string format_errno(errno_t x) noexcept;
@@ -3,3 +3,6 @@
 #include <cstdint>
 
 [[nodiscard]] extern std::string format_error_code(std::int64_t x) noexcept;
+
+// The message of an errno value, what the file functions return.
+[[nodiscard]] extern std::string format_errno(int x) noexcept;
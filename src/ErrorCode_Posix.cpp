@@ -0,0 +1,13 @@
+#include "ErrorCode.hpp"
+
+#include <cstring>
+
+// On posix the system errors are errno values too.
+[[nodiscard]] std::string format_error_code(std::int64_t x) noexcept {
+	return format_errno((int)x);
+}
+
+[[nodiscard]] std::string format_errno(int x) noexcept {
+	// strerror_r comes in a gnu and a posix flavour, strerror is enough for the tools.
+	return std::strerror(x);
+}
@@ -20,3 +20,10 @@
 	LocalFree(buffer);
 	return message;
 }
+
+[[nodiscard]] std::string format_errno(int x) noexcept {
+	std::string result;
+	result.resize(100);
+	strerror_s(result.data(), result.capacity(), x);
+	return result;
+}
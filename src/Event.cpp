@@ -2,7 +2,12 @@
 
 #include "imgui.h"
 #include "Common.hpp"
+#include "ErrorCode.hpp"
+#include "ByteStream.hpp"
+#include "Parallel.hpp"
+#include "WriteAheadLog.hpp"
 #include "Logs.hpp"
+#include "render_stats.hpp"
 
 #include "file.hpp"
 #include "TimeInfo.hpp"
@@ -10,6 +15,7 @@
 #include "xstd.hpp"
 
 #include <set>
+#include <cstring>
 #include <array>
 #include <vector>
 
@@ -18,12 +24,106 @@ struct Version_0 {
 	static constexpr size_t Version_Offset           = 4;
 	static constexpr size_t Size_Table_Offset      = 5;
 	static constexpr size_t Size_Table_Size        = 4;
+	static constexpr size_t Usage_List_Offset      = Size_Table_Offset + Size_Table_Size;
 };
 
-std::optional<EventState> version0_read(const std::vector<std::byte>& bytes) noexcept;
-bool version0_write(const EventState& state, std::filesystem::path path) noexcept;
+static std::optional<EventState> version0_read(const std::vector<std::byte>& bytes) noexcept;
+static bool version0_write(const EventState& state, std::filesystem::path path) noexcept;
 
-std::optional<EventState> version0_read(const std::vector<std::byte>& bytes) noexcept {
+void encode_usage(const AppUsage& x, std::byte* dst) noexcept {
+	memcpy(dst, x.exe_name.data(), AppUsage::Max_String_Size);
+	memcpy(dst + AppUsage::Max_String_Size, x.doc_name.data(), AppUsage::Max_String_Size);
+	store_le(dst + 2 * AppUsage::Max_String_Size, x.timestamp_start);
+	store_le(dst + 2 * AppUsage::Max_String_Size + 8, x.timestamp_end);
+}
+void decode_usages(const std::byte* src, AppUsage* dst, size_t n) noexcept {
+	parallel_blocks(n, Min_Decode_Block, [&](size_t begin, size_t end) {
+		auto record = src + AppUsage::Byte_Size * begin;
+		for (size_t i = begin; i < end; ++i, record += AppUsage::Byte_Size) {
+			auto& x = dst[i];
+			memcpy(x.exe_name.data(), record, AppUsage::Max_String_Size);
+			memcpy(x.doc_name.data(), record + AppUsage::Max_String_Size, AppUsage::Max_String_Size);
+			x.timestamp_start = load_le<std::uint64_t>(record + 2 * AppUsage::Max_String_Size);
+			x.timestamp_end = load_le<std::uint64_t>(record + 2 * AppUsage::Max_String_Size + 8);
+		}
+	});
+}
+
+// The usages are in us, the weeks in ms.
+void add_usage_week(EventState& es, const AppUsage& x) noexcept {
+	auto start = x.timestamp_start / 1'000;
+	auto end = x.timestamp_end / 1'000;
+	es.week.add_span(es.clock, start, end);
+	es.app_weeks[x.exe_name].add_span(es.clock, start, end);
+}
+// Before the sections had them the weeks were rebuilt from the usages.
+void replay_weeks(EventState& es) noexcept {
+	es.week = {};
+	es.app_weeks.clear();
+	for (auto& x : es.apps_usages) add_usage_week(es, x);
+}
+
+// u32 n exes, then per exe u8 name size, the name and its week.
+void save_app_weeks(const EventState& es, std::vector<std::byte>& bytes) noexcept {
+	ByteWriter writer{ bytes };
+	writer.write((std::uint32_t)es.app_weeks.size());
+	for (auto& [name, week] : es.app_weeks) {
+		auto n = strnlen(name.data(), name.size());
+		writer.write((std::uint8_t)n);
+		writer.write_bytes(name.data(), n);
+		week.save(bytes);
+	}
+}
+[[nodiscard]] bool load_app_weeks(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size, EventState& es
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(4)) return false;
+
+	std::map<AppUsage::Stack_String, WeekHours> loaded;
+	auto n = reader.read<std::uint32_t>();
+	for (size_t i = 0; i < n; ++i) {
+		if (!reader.can_read(1)) return false;
+		AppUsage::Stack_String name{};
+		auto n_chars = reader.read<std::uint8_t>();
+		if (n_chars >= name.size() || !reader.can_read(n_chars)) return false;
+		reader.read_bytes(name.data(), n_chars);
+
+		auto read = loaded[name].load(bytes, reader.offset, reader.size - reader.offset);
+		if (!read) return false;
+		reader.skip(read);
+	}
+
+	es.app_weeks = std::move(loaded);
+	return true;
+}
+
+// The usages can be followed by a section list, with the generation, the weeks and the sessions.
+// Returns false when the weeks are missing and need a replay.
+bool read_event_sections(
+	const std::vector<std::byte>& bytes, size_t offset, EventState& es
+) noexcept {
+	auto sections = read_sections(bytes, offset);
+	if (!sections) return false;
+
+	auto generation = find_section(*sections, WriteAheadLog::Generation_Tag);
+	if (generation && generation->size >= 8) es.generation = read_uint64(bytes, generation->offset);
+
+	// The sessions can't be rebuilt, the keys and the clicks are in the other files.
+	auto sessions = find_section(*sections, EventState::Sessions_Tag);
+	if (sessions && !es.sessions.load(bytes, sessions->offset, sessions->size)) {
+		logs.write(LogTag::FileIO, "read_event_sections, the sessions section is ill formed.");
+	}
+
+	auto week = find_section(*sections, EventState::Week_Tag);
+	auto app_weeks = find_section(*sections, EventState::App_Weeks_Tag);
+	return
+		week && es.week.load(bytes, week->offset, week->size) &&
+		app_weeks && load_app_weeks(bytes, app_weeks->offset, app_weeks->size, es);
+}
+
+static std::optional<EventState> version0_read(const std::vector<std::byte>& bytes) noexcept {
 	size_t it = Version_0::Size_Table_Offset + Version_0::Size_Table_Size;
 	if (bytes.size() < it) {
 		ErrorDescription error;
@@ -52,38 +152,108 @@ std::optional<EventState> version0_read(const std::vector<std::byte>& bytes) noe
 		return std::nullopt;
 	}
 
-	for (size_t i = 0; i < es.apps_usages.size(); ++i) {
-		for (size_t j = 0; j < AppUsage::Max_String_Size; ++j, ++it)
-			es.apps_usages[i].exe_name[j] = read_uint8(bytes, it);
-		for (size_t j = 0; j < AppUsage::Max_String_Size; ++j, ++it)
-			es.apps_usages[i].doc_name[j] = read_uint8(bytes, it);
-		es.apps_usages[i].timestamp_start = read_uint64(bytes, it + 0);
-		es.apps_usages[i].timestamp_end = read_uint64(bytes, it + 8);
-		it += 16;
-	}
+	decode_usages(bytes.data() + it, es.apps_usages.data(), es.apps_usages.size());
+	if (!read_event_sections(bytes, n, es)) replay_weeks(es);
 	return es;
 }
 
-bool version0_write(const EventState& state, std::filesystem::path path) noexcept {
-	std::vector<std::byte> bytes;
-	insert_uint32(bytes, Event_File_Signature);
-	insert_uint8(bytes, 0);
-
-	insert_uint32(bytes, state.apps_usages.size());
+static bool version0_write(const EventState& state, std::filesystem::path path) noexcept {
+	FileParts parts;
+	size_t n_pending = state.pending_usages ? state.pending_usages->count : 0;
+	size_t n_usages = n_pending + state.apps_usages.size();
+
+	ByteWriter header{ parts.bytes() };
+	header.write(Event_File_Signature);
+	header.write((std::uint8_t)0);
+	header.write((std::uint32_t)n_usages);
+
+	// The usages that were never loaded are copied as is from the old file, before we overwrite
+	// it.
+	if (state.pending_usages) {
+		auto& pending = *state.pending_usages;
+		parts.copy(pending.path, pending.offset, n_pending * pending.record_size);
+	}
 
+	ByteWriter writer{ parts.bytes() };
+	auto dst = writer.claim(AppUsage::Byte_Size * state.apps_usages.size());
 	for (auto& x : state.apps_usages) {
-		for (auto& c : x.exe_name) insert_uint8(bytes, c);
-		for (auto& c : x.doc_name) insert_uint8(bytes, c);
-		insert_uint64(bytes, x.timestamp_start);
-		insert_uint64(bytes, x.timestamp_end);
+		encode_usage(x, dst);
+		dst += AppUsage::Byte_Size;
 	}
 
-	return file_overwrite_byte(bytes, path) == 0;
+	std::vector<std::pair<std::uint32_t, FileParts>> sections;
+	sections.push_back({ WriteAheadLog::Generation_Tag, {} });
+	ByteWriter{ sections.back().second.bytes() }.write(state.generation);
+	sections.push_back({ EventState::Week_Tag, {} });
+	state.week.save(sections.back().second.bytes());
+	sections.push_back({ EventState::App_Weeks_Tag, {} });
+	save_app_weeks(state, sections.back().second.bytes());
+	sections.push_back({ EventState::Sessions_Tag, {} });
+	state.sessions.save(sections.back().second.bytes());
+	insert_sections(parts, std::move(sections));
+
+	return file_replace_atomic(parts, path) == 0;
+}
+
+// Only the count is read, the file is the count followed by the fixed width usages.
+static std::optional<EventState> version0_read_lazy(const std::filesystem::path& path) noexcept {
+	auto file_size = get_file_length(path);
+	std::vector<std::byte> bytes;
+	bool header_read =
+		file_size && *file_size >= Version_0::Usage_List_Offset &&
+		file_read_range(path, 0, Version_0::Usage_List_Offset, bytes) == 0;
+	if (!header_read) {
+		ErrorDescription error;
+		error.location = "version0_read_lazy:EventState";
+		error.quick_desc = "The event file is too short. It's ill-formed.";
+		error.message = "Couldn't read the first " + std::to_string(Version_0::Usage_List_Offset) +
+			" bytes of: " + path.generic_string();
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return std::nullopt;
+	}
+
+	size_t count = read_uint32(bytes, Version_0::Size_Table_Offset);
+	auto n = Version_0::Usage_List_Offset + AppUsage::Byte_Size * (std::uint64_t)count;
+	if (*file_size < n) {
+		ErrorDescription error;
+		error.location = "version0_read_lazy:EventState";
+		error.quick_desc = "The event file is too short. It's ill-formed.";
+		error.message = "The file is: " + std::to_string(*file_size) + " when it should be at"
+			"least" + std::to_string(n) + " bytes long.";
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return std::nullopt;
+	}
+
+	EventState es;
+	es.pending_usages = PendingRecords{
+		path, Version_0::Usage_List_Offset, count, AppUsage::Byte_Size
+	};
+
+	bytes.clear();
+	bool weeks_read =
+		file_read_range(path, n, (size_t)(*file_size - n), bytes) == 0 &&
+		read_event_sections(bytes, 0, es);
+	if (!weeks_read) {
+		if (!es.ensure_usages_loaded()) return std::nullopt;
+		replay_weeks(es);
+	}
+	return es;
 }
 
 std::optional<EventState> EventState::load_from_file(
-	std::filesystem::path path
+	std::filesystem::path path, bool lazy
 ) noexcept {
+	if (lazy) {
+		std::vector<std::byte> header;
+		bool current_version =
+			file_read_range(path, 0, 5, header) == 0 &&
+			read_uint32(header, 0) == Event_File_Signature &&
+			read_uint8(header, 4) == 0;
+		if (current_version) return version0_read_lazy(path);
+	}
+
 	const auto& opt_bytes = file_read_byte(path);
 	if (!opt_bytes) {
 		ErrorDescription error;
@@ -128,8 +298,11 @@ std::optional<EventState> EventState::load_from_file(
 	auto version_number = read_uint8(bytes, it);
 
 	switch (version_number) {
-	case 0:
-		return version0_read(bytes);
+	case 0: {
+		auto opt = version0_read(bytes);
+		if (opt) opt->index_usages();
+		return opt;
+	}
 	default: {
 		ErrorDescription error;
 		error.location = "EventState::load_from_file";
@@ -142,34 +315,82 @@ std::optional<EventState> EventState::load_from_file(
 }
 
 bool EventState::save_to_file(std::filesystem::path path) noexcept {
-	return version0_write(*this, path);
+	if (!version0_write(*this, path)) return false;
+	modifications_since_save = 0;
+	return true;
+}
+
+bool EventState::ensure_usages_loaded() noexcept {
+	if (!pending_usages) return true;
+	auto& pending = *pending_usages;
+
+	std::vector<std::byte> bytes;
+	auto err = file_read_range(pending.path, pending.offset, pending.count * pending.record_size, bytes);
+	if (err) {
+		ErrorDescription error;
+		error.location = "EventState::ensure_usages_loaded";
+		error.quick_desc = "Couldn't read the app usages from the event save file.";
+		error.message = format_errno(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return false;
+	}
+
+	std::vector<AppUsage> usages(pending.count + apps_usages.size());
+	decode_usages(bytes.data(), usages.data(), pending.count);
+	std::copy(BEG_END(apps_usages), std::begin(usages) + pending.count);
+
+	apps_usages = std::move(usages);
+	pending_usages.reset();
+	index_usages();
+	cache.dirty = true;
+	return true;
+}
+
+void ExeDocs::add(const AppUsage::Stack_String& doc_name, std::uint64_t t) noexcept {
+	auto hash = hash_name(doc_name);
+	docs.add(doc_name, hash, t);
+	distinct.add(hash);
+}
+
+// Only the part of the usage after from is counted.
+static void add_usage_docs(
+	std::map<AppUsage::Stack_String, ExeDocs>& exes, const AppUsage& x, std::uint64_t from
+) noexcept {
+	auto start = std::max(x.timestamp_start, from);
+	auto t = x.timestamp_end > start ? x.timestamp_end - start : 0;
+	exes[x.exe_name].add(x.doc_name, t);
 }
 
 void EventState::register_event(AppUsage event) noexcept {
 	apps_usages.push_back(event);
+	usage_times.insert(event.timestamp_start, event.timestamp_end, apps_usages.size() - 1);
+	add_usage_week(*this, event);
+	add_usage_docs(exe_docs, event, 0);
+	// The usage ends when the focus goes to another window, the user is there.
+	sessions.feed(event.timestamp_end / 1'000);
 	modifications_since_save++;
 
 	cache.dirty = true;
-
-	check_resave();
 }
 
-void EventState::check_resave() noexcept {
-	if (modifications_since_save >= Save_Every_Mod) {
-		//>TODO: do that in another thread it's kind of a dick move to block inputs...
-		if (!save_to_file(get_user_data_path() / App_Data_Dir_Name / Default_Path)) {
-			logs.lock_and_write("Can't save incremental change...");
-		}
-		// we reset it anyway to not spam File IO.
-		modifications_since_save = 0;
+void EventState::index_usages() noexcept {
+	std::vector<IntervalTree::Interval> intervals;
+	intervals.reserve(apps_usages.size());
+	for (size_t i = 0; i < apps_usages.size(); ++i) {
+		auto& x = apps_usages[i];
+		intervals.push_back({ x.timestamp_start, x.timestamp_end, i });
 	}
+	usage_times.build(std::move(intervals));
+
+	exe_docs.clear();
+	for (auto& x : apps_usages) add_usage_docs(exe_docs, x, 0);
 }
 
 
 void EventWindow::render(std::optional<EventState>& state) noexcept {
 	ImGui::Begin("Event");
 	defer { ImGui::End(); };
-
 	if (reset_time_start == 0 && ImGui::Button("Reset")) {
 		reset_time_start = time(nullptr);
 	}
@@ -197,6 +418,9 @@ void EventWindow::render(std::optional<EventState>& state) noexcept {
 		ImGui::Text("There was a problem loading event.mto, you can try to reset the file.");
 		return;
 	}
+	if (!state->ensure_usages_loaded()) {
+		ImGui::Text("Couldn't read the usages from event.mto, see the logs.");
+	}
 
 	ImGui::SameLine();
 	if (ImGui::Button("Save")) save = true;
@@ -207,91 +431,172 @@ void EventWindow::render(std::optional<EventState>& state) noexcept {
 
 	ImGui::Separator();
 	state->cache.dirty |= ImGui::Checkbox("Sort less", &sort_less);
+	ImGui::SameLine();
+	ImGui::PushItemWidth(150);
+	state->cache.dirty |=
+		ImGui::Combo("##Range", &range, "All time\0Last day\0Last week\0Last month\0");
+	ImGui::PopItemWidth();
 	ImGui::Separator();
 
+	if (ImGui::CollapsingHeader("Week")) {
+		const char* preview = week_exe[0] ? week_exe.data() : "All apps";
+		if (ImGui::BeginCombo("App", preview)) {
+			if (ImGui::Selectable("All apps", !week_exe[0])) week_exe = {};
+			for (auto& [name, _] : state->app_weeks) {
+				if (ImGui::Selectable(name.data(), name == week_exe)) week_exe = name;
+			}
+			ImGui::EndCombo();
+		}
+		static const WeekHours empty;
+		auto it = state->app_weeks.find(week_exe);
+		auto& week = !week_exe[0] ? state->week : it != state->app_weeks.end() ? it->second : empty;
+		render_week_hours("App time by weekday and hour", week, 1 / 3'600'000.0, "hours");
+		ImGui::Separator();
+	}
+	if (ImGui::CollapsingHeader("Sessions")) {
+		render_sessions(state->sessions);
+		ImGui::Separator();
+	}
+
 
 	if (state->cache.dirty) {
-		state->cache.doc_to_time.clear();
-		state->cache.exe_to_time.clear();
-		state->cache.exe_to_docs.clear();
-		for (auto& x : state->apps_usages) {
-			state->cache.doc_to_time[x.doc_name] +=
-				x.timestamp_end - x.timestamp_start;
-			state->cache.exe_to_time[x.exe_name] +=
-				x.timestamp_end - x.timestamp_start;
-			state->cache.exe_to_docs[x.exe_name].insert(x.doc_name);
+		auto& cache = state->cache;
+		// All time is kept up to date by register_event, a shorter range is sketched from the
+		// usages it overlaps.
+		const auto* sketches = &state->exe_docs;
+		if (range != 0) {
+			cache.ranged.clear();
+			auto from = get_microseconds_epoch() - Ranges_Us[range];
+			state->usage_times.overlapping(from, UINT64_MAX, [&](size_t i) {
+				add_usage_docs(cache.ranged, state->apps_usages[i], from);
+			});
+			sketches = &cache.ranged;
 		}
 
 		auto cmp = [&](const auto& a, const auto& b) { return sort_less ? (a < b) : (a > b); };
 
-		state->cache.exe_to_time_sorted.clear();
-		state->cache.exe_to_time_sorted.reserve(state->cache.exe_to_time.size());
-		for (auto& x : state->cache.exe_to_time) {
-			auto& name = x.first;
-			state->cache.exe_to_time_sorted.push_back(name);
-
-			auto& vec = state->cache.exe_to_docs_sorted[name];
-			vec.clear();
-			vec.reserve(state->cache.exe_to_docs[name].size());
-			for (auto& y : state->cache.exe_to_docs[name]) vec.push_back(y);
-			std::sort(
-				std::begin(vec),
-				std::end(vec),
-				[&](auto& a, auto& b) {
-					return cmp(
-						state->cache.doc_to_time[a],
-						state->cache.doc_to_time[b]
-					);
-				}
-			);
+		cache.exes.clear();
+		cache.exes.reserve(sketches->size());
+		for (auto& [name, sketch] : *sketches) {
+			auto& exe = cache.exes.emplace_back();
+			exe.name = name;
+			exe.docs = sketch.docs;
+
+			// Exact until a document was evicted, and then there were more than the capacity.
+			exe.n_docs = exe.docs.entries.size();
+			if (exe.docs.evicted) {
+				auto estimate = (size_t)(sketch.distinct.estimate() + 0.5);
+				exe.n_docs = (std::max)(estimate, SpaceSaving::Capacity + 1);
+			}
+
+			// The top ones are picked by their guaranteed time, sort less only flips them.
+			exe.docs.sort();
+			auto& docs = exe.docs.entries;
+			if (docs.size() > EventCache::Top_Docs) docs.resize(EventCache::Top_Docs);
+			if (sort_less) std::reverse(std::begin(docs), std::end(docs));
 		}
 
 		std::sort(
-			std::begin(state->cache.exe_to_time_sorted),
-			std::end(state->cache.exe_to_time_sorted),
-			[&](auto& a, auto& b) {
-				return cmp(state->cache.exe_to_time[a], state->cache.exe_to_time[b]);
-			}
+			std::begin(cache.exes),
+			std::end(cache.exes),
+			[&](auto& a, auto& b) { return cmp(a.docs.total, b.docs.total); }
 		);
 
 		state->cache.dirty = false;
+		state->cache.rows_dirty = true;
 	}
 
-	ImGui::Text("N %zu", state->apps_usages.size());
-
-	ImGui::Columns(2);
-
-
+	if (state->cache.rows_dirty) {
+		auto& cache = state->cache;
+		cache.rows.clear();
+
+		static const AppUsage::Stack_String Other_Name = { "Other documents" };
+		char buffer[128];
+		for (auto& exe : cache.exes) {
+			auto& name = exe.name;
+			auto& docs = exe.docs.entries;
+			snprintf(
+				buffer,
+				sizeof(buffer),
+				"% 25.3lf for %s% 3d documents.",
+				exe.docs.total / 1'000'000.0,
+				exe.docs.evicted ? "~" : "",
+				(int)exe.n_docs
+			);
+			cache.rows.push_back({ &name, true, buffer });
+
+			if (opened.count(name) == 0) continue;
+			std::uint64_t shown = 0;
+			for (auto& doc : docs) {
+				shown += doc.count;
+				if (doc.error == 0) {
+					snprintf(buffer, sizeof(buffer), "% 25.3lf", doc.count / 1'000'000.0);
+				}
+				else {
+					snprintf(
+						buffer,
+						sizeof(buffer),
+						"% 25.3lf at most, %.3lf at least",
+						doc.count / 1'000'000.0,
+						(doc.count - doc.error) / 1'000'000.0
+					);
+				}
+				cache.rows.push_back({ &doc.name, false, buffer });
+			}
 
-	for (auto& name : state->cache.exe_to_time_sorted) {
-		bool open = ImGui::TreeNode(name.data(), "%s", name.data());
+			if (exe.n_docs <= docs.size()) continue;
+			snprintf(
+				buffer,
+				sizeof(buffer),
+				"% 25.3lf for %s% 3d documents.",
+				(exe.docs.total - shown) / 1'000'000.0,
+				exe.docs.evicted ? "~" : "",
+				(int)(exe.n_docs - docs.size())
+			);
+			cache.rows.push_back({ &Other_Name, false, buffer });
+		}
 
-		ImGui::NextColumn();
+		cache.rows_dirty = false;
+	}
 
-		ImGui::Text(
-			"% 25.3lf for % 3d documents.",
-			state->cache.exe_to_time[name] / 1'000'000.0,
-			(int)state->cache.exe_to_docs[name].size()
-		);
+	ImGui::Text("N %zu", state->apps_usages.size());
 
-		ImGui::NextColumn();
+	ImGui::BeginChild("Usages");
+	defer{ ImGui::EndChild(); };
+	ImGui::Columns(2);
 
-		if (open) {
-			defer { ImGui::TreePop(); };
-
-			for (auto& doc : state->cache.exe_to_docs_sorted[name]) {
-				ImGuiTreeNodeFlags flags =
-					ImGuiTreeNodeFlags_Leaf |
-					ImGuiTreeNodeFlags_NoTreePushOnOpen |
-					ImGuiTreeNodeFlags_Bullet;
-				ImGui::TreeNodeEx(doc.data(), flags, "%s", doc.data());
-				ImGui::NextColumn();
-				ImGui::Text(
-					"% 25.3lf", state->cache.doc_to_time[doc] / 1'000'000.0
-				);
-				ImGui::NextColumn();
+	// Only the visible rows are submitted, so the cost doesn't depend on the number of documents.
+	ImGuiListClipper clipper((int)state->cache.rows.size());
+	while (clipper.Step()) for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+		auto& row = state->cache.rows[i];
+		ImGui::PushID(i);
+		defer{ ImGui::PopID(); };
+
+		if (row.is_exe) {
+			bool open = opened.count(*row.name) > 0;
+			ImGui::SetNextItemOpen(open);
+			ImGui::TreeNodeEx(
+				row.name->data(), ImGuiTreeNodeFlags_NoTreePushOnOpen, "%s", row.name->data()
+			);
+			if (ImGui::IsItemToggledOpen()) {
+				if (open) opened.erase(*row.name);
+				else      opened.insert(*row.name);
+				state->cache.rows_dirty = true;
 			}
 		}
+		else {
+			ImGuiTreeNodeFlags flags =
+				ImGuiTreeNodeFlags_Leaf |
+				ImGuiTreeNodeFlags_NoTreePushOnOpen |
+				ImGuiTreeNodeFlags_Bullet;
+			ImGui::Indent();
+			ImGui::TreeNodeEx(row.name->data(), flags, "%s", row.name->data());
+			ImGui::Unindent();
+		}
+
+		ImGui::NextColumn();
+		ImGui::TextUnformatted(row.text.c_str());
+		ImGui::NextColumn();
 	}
 	ImGui::Columns(1);
 }
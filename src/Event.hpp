@@ -2,12 +2,19 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <optional>
 #include <filesystem>
 #include <array>
+#include <type_traits>
 
 #include "xstd.hpp"
+#include "Common.hpp"
+#include "IntervalTree.hpp"
+#include "WeekHours.hpp"
+#include "Sessions.hpp"
+#include "HeavyHitters.hpp"
 
 struct AppUsage {
 	static constexpr size_t Id = 0;
@@ -15,6 +22,7 @@ struct AppUsage {
 	static constexpr size_t Byte_Size = Max_String_Size * 2 + 16;
 
 	using Stack_String = std::array<char, Max_String_Size>;
+	static_assert(std::is_same_v<Stack_String, SketchName>);
 
 	Stack_String exe_name = {};
 	Stack_String doc_name = {};
@@ -24,50 +32,102 @@ struct AppUsage {
 
 constexpr std::uint32_t Event_File_Signature = 'NEVE'; // 'EVEN' byte swapped.
 
+// The documents of an exe are sketched, browsers and editors make a new title for every page.
+struct ExeDocs {
+	SpaceSaving docs; // its total is the time of the exe.
+	HyperLogLog distinct;
+
+	void add(const AppUsage::Stack_String& doc_name, std::uint64_t t) noexcept;
+};
+
 struct EventCache {
+	// The documents of an exe shown by name, its other ones are summed in one row.
+	static constexpr size_t Top_Docs = 32;
+	static_assert(Top_Docs <= SpaceSaving::Capacity);
+
+	struct Exe {
+		AppUsage::Stack_String name;
+		SpaceSaving docs; // a copy of the sketch cut to Top_Docs, the sort is in place.
+		size_t n_docs{ 0 }; // from the sketches before the docs are cut to Top_Docs.
+	};
+
 	bool dirty = true;
-	std::map<AppUsage::Stack_String, uint64_t> exe_to_time;
-	std::vector<AppUsage::Stack_String> exe_to_time_sorted;
-	std::map<AppUsage::Stack_String, uint64_t> doc_to_time;
-	std::map<AppUsage::Stack_String, std::set<AppUsage::Stack_String>>
-		exe_to_docs;
-	std::map<AppUsage::Stack_String, std::vector<AppUsage::Stack_String>>
-		exe_to_docs_sorted;
+	// The sketches of the range when it's not all time, EventState keeps those of all time.
+	std::map<AppUsage::Stack_String, ExeDocs> ranged;
+	std::vector<Exe> exes; // sorted.
+
+	// Flattened tree, only the exe rows and the documents of the opened exe. The names point
+	// in exes above so it has to be rebuilt along it.
+	struct Row {
+		const AppUsage::Stack_String* name;
+		bool is_exe;
+		std::string text;
+	};
+	bool rows_dirty = true;
+	std::vector<Row> rows;
 };
 
+// The version 0 record, also used by the write ahead log.
+extern void encode_usage(const AppUsage& x, std::byte* dst) noexcept;
+extern void decode_usages(const std::byte* src, AppUsage* dst, size_t n) noexcept;
+
 struct EventState {
 	inline static const std::filesystem::path Default_Path = "event.mto";
-	inline static const size_t Save_Every_Mod = 50;
+	static constexpr std::uint32_t Week_Tag = 'KEEW'; // 'WEEK' byte swapped.
+	static constexpr std::uint32_t App_Weeks_Tag = 'WPPA'; // 'APPW' byte swapped.
+	static constexpr std::uint32_t Sessions_Tag = 'SSES'; // 'SESS' byte swapped.
 
 	mutable EventCache cache;
 
 	double last_update_countdown = 0.0;
 
 	std::vector<AppUsage> apps_usages;
+	// Set by a lazy load, the usages in the file that are not in apps_usages yet.
+	std::optional<PendingRecords> pending_usages;
+	// [timestamp_start, timestamp_end] of apps_usages by index.
+	IntervalTree usage_times;
+	// The ms spent in the apps by local weekday and hour, all of them and by exe.
+	WeekHours week;
+	std::map<AppUsage::Stack_String, WeekHours> app_weeks;
+	LocalClock clock;
+	// Fed with the focus changes here and the keys and clicks by the ingest, not in the write
+	// ahead log.
+	ActivitySessions sessions;
+	// The documents of each exe over all time, fed by register_event. Not in the file, they are
+	// rebuilt with the usage tree once the usages are loaded.
+	std::map<AppUsage::Stack_String, ExeDocs> exe_docs;
 
 	size_t modifications_since_save{ 0 };
+	std::uint64_t generation{ 0 }; // of the last snapshot, see WriteAheadLog.
 
+	// With lazy only the record count is read, the usages stay in the file until
+	// ensure_usages_loaded.
 	[[nodiscard]] static std::optional<EventState> load_from_file(
-		std::filesystem::path path
+		std::filesystem::path path, bool lazy = false
 	) noexcept;
 	[[nodiscard]] bool save_to_file(std::filesystem::path path) noexcept;
+	[[nodiscard]] bool ensure_usages_loaded() noexcept;
 
 
 	void register_event(AppUsage event) noexcept;
-
-	void check_resave() noexcept;
+	// Rebuilds usage_times and exe_docs from apps_usages.
+	void index_usages() noexcept;
 
 	bool reset_everything() noexcept;
 };
 
 struct EventWindow {
 	static constexpr size_t Reset_Button_Time = 5;
+	static constexpr std::uint64_t Ranges_Us[] = {
+		0, 24ull * 3'600'000'000, 7 * 24ull * 3'600'000'000, 30 * 24ull * 3'600'000'000
+	};
 
 	bool render_buttons_list_checkbox = false;
 	size_t reset_button_timer = Reset_Button_Time;
 	time_t reset_time_start = 0;
 
 	bool sort_less{ false };
+	int range{ 0 }; // in Ranges_Us, the totals only count that much of the past, 0 is everything.
 
 	bool save{ false };
 	bool reset{ false };
@@ -76,6 +136,9 @@ struct EventWindow {
 	
 	bool unhook{ false };
 
+	std::set<AppUsage::Stack_String> opened;
+	AppUsage::Stack_String week_exe{}; // of the week heatmap, empty for all of them.
+
 	void render(std::optional<EventState>& state) noexcept;
 
 };
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "Export.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <string_view>
+
+#include "ByteStream.hpp"
+#include "SaveReader.hpp"
+
+constexpr size_t Max_String_Size = Save_String_Size;
+
+struct Column {
+	const char* name;
+	std::uint8_t width;
+};
+constexpr Column Keyboard_Columns[] = { { "timestamp_ms", 8 }, { "key_code", 1 } };
+constexpr Column Mouse_Columns[] = {
+	{ "timestamp_s", 8 }, { "button", 1 }, { "x", 4 }, { "y", 4 }
+};
+constexpr Column Event_Columns[] = {
+	{ "start_us", 8 }, { "end_us", 8 }, { "exe", Max_String_Size }, { "doc", Max_String_Size }
+};
+
+struct ColumnList {
+	const Column* columns;
+	size_t size;
+};
+static ColumnList columns_of(SaveKind kind) noexcept {
+	switch (kind) {
+	case SaveKind::Keyboard: return { Keyboard_Columns, std::size(Keyboard_Columns) };
+	case SaveKind::Mouse:    return { Mouse_Columns, std::size(Mouse_Columns) };
+	default:                 return { Event_Columns, std::size(Event_Columns) };
+	}
+}
+
+// One record of any kind, the strings point in the record.
+struct Row {
+	std::uint64_t t0{ 0 }; // the timestamp, or the start of a usage.
+	std::uint64_t t1{ 0 }; // the end of a usage.
+	std::uint8_t code{ 0 }; // key or button.
+	std::int32_t x{ 0 };
+	std::int32_t y{ 0 };
+	std::string_view exe;
+	std::string_view doc;
+};
+
+static std::string_view fixed_string(const std::byte* src) noexcept {
+	auto str = (const char*)src;
+	return { str, strnlen(str, Max_String_Size) };
+}
+
+static Row decode_row(SaveKind kind, const std::byte* record) noexcept {
+	Row row;
+	switch (kind) {
+	case SaveKind::Keyboard:
+		row.code = (std::uint8_t)record[0];
+		row.t0 = load_le<std::uint64_t>(record + 1);
+		break;
+	case SaveKind::Mouse:
+		row.code = (std::uint8_t)record[0];
+		row.x = (std::int32_t)load_le<std::uint32_t>(record + 1);
+		row.y = (std::int32_t)load_le<std::uint32_t>(record + 5);
+		row.t0 = load_le<std::uint64_t>(record + 9);
+		break;
+	default:
+		row.exe = fixed_string(record);
+		row.doc = fixed_string(record + Max_String_Size);
+		row.t0 = load_le<std::uint64_t>(record + 2 * Max_String_Size);
+		row.t1 = load_le<std::uint64_t>(record + 2 * Max_String_Size + 8);
+		break;
+	}
+	return row;
+}
+
+// Calls visit(record) for each record of the save file then for each one of its log that follows
+// the same generation.
+template<typename F>
+static int stream_save(SaveKind kind, const std::filesystem::path& path, F&& visit) noexcept {
+	SaveReader reader;
+	if (auto err = reader.open(kind, path)) return err;
+	while (auto record = reader.next()) visit(record);
+	return reader.error;
+}
+
+struct RowWriter {
+	SaveKind kind;
+	ExportFormat format;
+	std::FILE* out;
+
+	// The columnar format buffers a block.
+	std::vector<std::vector<std::byte>> blocks;
+	size_t n_block_rows{ 0 };
+
+	RowWriter(SaveKind kind, ExportFormat format, std::FILE* out) noexcept :
+		kind(kind), format(format), out(out) {}
+
+	void begin() noexcept;
+	void write(const Row& row) noexcept;
+	void flush() noexcept;
+};
+
+static void write_csv_string(std::FILE* out, std::string_view str) noexcept {
+	fputc('"', out);
+	for (auto c : str) {
+		if (c == '"') fputc('"', out);
+		fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static void write_json_string(std::FILE* out, std::string_view str) noexcept {
+	fputc('"', out);
+	for (auto c : str) {
+		if (c == '"' || c == '\\') {
+			fputc('\\', out);
+			fputc(c, out);
+		}
+		else if ((unsigned char)c < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned)c);
+		}
+		else {
+			fputc(c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+void RowWriter::begin() noexcept {
+	auto [columns, n] = columns_of(kind);
+
+	switch (format) {
+	case ExportFormat::Csv:
+		for (size_t i = 0; i < n; ++i) fprintf(out, i ? ",%s" : "%s", columns[i].name);
+		fputc('\n', out);
+		break;
+	case ExportFormat::Columns: {
+		std::vector<std::byte> header;
+		ByteWriter writer{ header };
+		writer.write(ExportOptions::Columns_Signature);
+		writer.write((std::uint8_t)0);
+		writer.write((std::uint8_t)kind);
+		writer.write((std::uint8_t)n);
+		for (size_t i = 0; i < n; ++i) {
+			auto size = strlen(columns[i].name);
+			writer.write(columns[i].width);
+			writer.write((std::uint8_t)size);
+			writer.write_bytes(columns[i].name, size);
+		}
+		fwrite(header.data(), 1, header.size(), out);
+
+		blocks.resize(n);
+		for (size_t i = 0; i < n; ++i) blocks[i].reserve(columns[i].width * ExportOptions::Chunk_Records);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void RowWriter::write(const Row& row) noexcept {
+	auto t0 = (unsigned long long)row.t0;
+	auto t1 = (unsigned long long)row.t1;
+
+	switch (format) {
+	case ExportFormat::Csv:
+		switch (kind) {
+		case SaveKind::Keyboard:
+			fprintf(out, "%llu,%u\n", t0, (unsigned)row.code);
+			break;
+		case SaveKind::Mouse:
+			fprintf(out, "%llu,%u,%d,%d\n", t0, (unsigned)row.code, (int)row.x, (int)row.y);
+			break;
+		default:
+			fprintf(out, "%llu,%llu,", t0, t1);
+			write_csv_string(out, row.exe);
+			fputc(',', out);
+			write_csv_string(out, row.doc);
+			fputc('\n', out);
+			break;
+		}
+		break;
+	case ExportFormat::Json_Lines:
+		switch (kind) {
+		case SaveKind::Keyboard:
+			fprintf(out, "{\"timestamp_ms\":%llu,\"key_code\":%u}\n", t0, (unsigned)row.code);
+			break;
+		case SaveKind::Mouse:
+			fprintf(
+				out,
+				"{\"timestamp_s\":%llu,\"button\":%u,\"x\":%d,\"y\":%d}\n",
+				t0,
+				(unsigned)row.code,
+				(int)row.x,
+				(int)row.y
+			);
+			break;
+		default:
+			fprintf(out, "{\"start_us\":%llu,\"end_us\":%llu,\"exe\":", t0, t1);
+			write_json_string(out, row.exe);
+			fputs(",\"doc\":", out);
+			write_json_string(out, row.doc);
+			fputs("}\n", out);
+			break;
+		}
+		break;
+	case ExportFormat::Columns: {
+		auto string = [](std::vector<std::byte>& block, std::string_view str) {
+			ByteWriter writer{ block };
+			auto dst = writer.claim(Max_String_Size);
+			memset(dst, 0, Max_String_Size);
+			memcpy(dst, str.data(), str.size());
+		};
+
+		switch (kind) {
+		case SaveKind::Keyboard:
+			ByteWriter{ blocks[0] }.write(row.t0);
+			ByteWriter{ blocks[1] }.write(row.code);
+			break;
+		case SaveKind::Mouse:
+			ByteWriter{ blocks[0] }.write(row.t0);
+			ByteWriter{ blocks[1] }.write(row.code);
+			ByteWriter{ blocks[2] }.write(row.x);
+			ByteWriter{ blocks[3] }.write(row.y);
+			break;
+		default:
+			ByteWriter{ blocks[0] }.write(row.t0);
+			ByteWriter{ blocks[1] }.write(row.t1);
+			string(blocks[2], row.exe);
+			string(blocks[3], row.doc);
+			break;
+		}
+
+		if (++n_block_rows == ExportOptions::Chunk_Records) flush();
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void RowWriter::flush() noexcept {
+	if (format != ExportFormat::Columns || n_block_rows == 0) return;
+
+	std::byte n[4];
+	store_le(n, (std::uint32_t)n_block_rows);
+	fwrite(n, 1, sizeof(n), out);
+	for (auto& x : blocks) {
+		fwrite(x.data(), 1, x.size(), out);
+		x.clear();
+	}
+	n_block_rows = 0;
+}
+
+const char* export_format_extension(ExportFormat format) noexcept {
+	switch (format) {
+	case ExportFormat::Csv:        return "csv";
+	case ExportFormat::Json_Lines: return "jsonl";
+	case ExportFormat::Columns:    return "columns";
+	default:                       return "unknown";
+	}
+}
+
+int export_records(
+	SaveKind kind,
+	const std::filesystem::path& path,
+	std::FILE* out,
+	const ExportOptions& options,
+	ExportStats& stats
+) noexcept {
+	if (kind >= SaveKind::Count || options.format >= ExportFormat::Count) return EINVAL;
+
+	auto app_match = [&](std::string_view exe) {
+		return exe.find(options.app) != std::string_view::npos;
+	};
+
+	// The keys and the clicks don't know their app. They and the usages both come in time order,
+	// so the usages are read as the records go and only the ends of the matching ones still open
+	// are kept, in ms like the filter.
+	bool by_app = !options.app.empty() && kind != SaveKind::Event;
+	SaveReader usages;
+	const std::byte* next_usage = nullptr;
+	if (by_app) {
+		if (auto err = usages.open(SaveKind::Event, options.event_path)) return err;
+		next_usage = usages.next();
+	}
+	std::priority_queue<std::uint64_t, std::vector<std::uint64_t>, std::greater<>> open_ends;
+	auto app_opened = [&](std::uint64_t t) {
+		for (; next_usage; next_usage = usages.next()) {
+			auto row = decode_row(SaveKind::Event, next_usage);
+			if (row.t0 / 1'000 > t) break;
+			if (app_match(row.exe)) open_ends.push(row.t1 / 1'000);
+		}
+		while (!open_ends.empty() && open_ends.top() < t) open_ends.pop();
+		return !open_ends.empty();
+	};
+
+	RowWriter writer{ kind, options.format, out };
+	writer.begin();
+
+	auto err = stream_save(kind, path, [&](const std::byte* record) {
+		stats.n_read++;
+		auto row = decode_row(kind, record);
+
+		if (kind == SaveKind::Event) {
+			if (row.t0 / 1'000 > options.to_ms || row.t1 / 1'000 < options.from_ms) return;
+			if (!options.app.empty() && !app_match(row.exe)) return;
+		}
+		else {
+			auto t = kind == SaveKind::Mouse ? row.t0 * 1'000 : row.t0;
+			if (t < options.from_ms || t > options.to_ms) return;
+
+			if (by_app && !app_opened(t)) return;
+		}
+
+		writer.write(row);
+		stats.n_written++;
+	});
+	writer.flush();
+
+	if (err) return err;
+	if (usages.error) return usages.error;
+	if (ferror(out)) return EIO;
+	return 0;
+}
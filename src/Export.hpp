@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <filesystem>
+
+#include "SaveReader.hpp"
+
+// Streams the records of a save file, then the ones of its write ahead log that aren't in it
+// yet, to csv, json lines or a columnar binary file. The files are read through SaveReader so the
+// memory doesn't depend on the size of the history, and it also runs on Linux against copied files.
+//
+// The columnar file:
+// Header: u32 signature, u8 version, u8 kind, u8 n columns, then for each column u8 width in
+//         bytes, u8 name size and the name.
+// Blocks: until the end of the file, u32 n rows then for each column its n values back to back,
+//         little endian integers or zero padded strings.
+
+enum class ExportFormat : std::uint8_t {
+	Csv = 0,
+	Json_Lines,
+	Columns,
+	Count
+};
+
+struct ExportOptions {
+	static constexpr std::uint32_t Columns_Signature = 'LCTM'; // 'MTCL' byte swapped.
+	static constexpr size_t Chunk_Records = 1 << 16;
+
+	ExportFormat format{ ExportFormat::Csv };
+
+	// In ms since epoch, only the records in [from_ms, to_ms] are written. A usage is written if
+	// it overlaps the range.
+	std::uint64_t from_ms{ 0 };
+	std::uint64_t to_ms{ UINT64_MAX };
+
+	// Part of the exe name, empty for all the apps. The keys and the clicks are kept if they
+	// happened while a window of a matching exe was opened, for that the usages are read from
+	// event_path, only the matching ones are kept in memory.
+	std::string app;
+	std::filesystem::path event_path;
+};
+
+struct ExportStats {
+	size_t n_read{ 0 };
+	size_t n_written{ 0 };
+};
+
+[[nodiscard]] extern const char* export_format_extension(ExportFormat format) noexcept;
+
+// Writes the records of the save file at path to out. Returns 0 or an errno value, EILSEQ if
+// the file isn't a save file of that kind in its current version.
+[[nodiscard]] extern int export_records(
+	SaveKind kind,
+	const std::filesystem::path& path,
+	std::FILE* out,
+	const ExportOptions& options,
+	ExportStats& stats
+) noexcept;
@@ -0,0 +1,239 @@
+#include "file.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "Common.hpp"
+#include "ByteStream.hpp"
+#include "Logs.hpp"
+
+// The file functions of File_Win.cpp for the bench and the tools on linux. The app itself only
+// builds on windows, this follows the same contracts: errno values back, logs on failures.
+
+std::filesystem::path get_user_data_path() noexcept {
+	if (auto x = std::getenv("XDG_DATA_HOME"); x && *x) return x;
+	if (auto x = std::getenv("HOME"); x && *x) return std::filesystem::path{ x } / ".local/share";
+
+	logs.write(LogTag::FileIO, "get_user_data_path, no XDG_DATA_HOME nor HOME, using the cwd.");
+	std::error_code ec;
+	return std::filesystem::current_path(ec);
+}
+
+static std::FILE* open(const std::filesystem::path& path, const char* mode, int& err) noexcept {
+	auto f = std::fopen(path.c_str(), mode);
+	err = f ? 0 : (errno ? errno : EIO);
+	return f;
+}
+
+static std::optional<std::uint64_t> length_of(std::FILE* f) noexcept {
+	if (fseeko(f, 0, SEEK_END)) return std::nullopt;
+	auto length = ftello(f);
+	if (length < 0) return std::nullopt;
+	return (std::uint64_t)length;
+}
+
+std::optional<std::vector<std::byte>> file_read_byte(const std::filesystem::path& path) noexcept {
+	int err;
+	auto f = open(path, "rb", err);
+	if (!f) {
+		logs.write(LogTag::FileIO, "file_read_byte, fopen: {}", err);
+		return std::nullopt;
+	}
+	defer{ fclose(f); };
+
+	auto length = length_of(f);
+	if (!length || fseeko(f, 0, SEEK_SET)) {
+		logs.write(LogTag::FileIO, "file_read_byte, fseek: {}", errno);
+		return std::nullopt;
+	}
+
+	std::vector<std::byte> bytes((size_t)*length);
+	if (fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) {
+		logs.write(LogTag::FileIO, "file_read_byte, fread: {}", errno);
+		return std::nullopt;
+	}
+	return bytes;
+}
+
+int
+file_write_byte(const std::vector<std::byte>& bytes, const std::filesystem::path& path) noexcept {
+	int err;
+	auto f = open(path, "rb+", err);
+	if (!f) return err;
+	defer{ fclose(f); };
+
+	if (fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size()) return EIO;
+	return 0;
+}
+
+int file_overwrite_byte(
+	const std::vector<std::byte>& bytes, const std::filesystem::path& path
+) noexcept {
+	int err;
+	auto f = open(path, "wb+", err);
+	if (!f) return err;
+	defer{ fclose(f); };
+
+	if (fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size()) return EIO;
+	return 0;
+}
+
+std::optional<uint32_t>
+file_read_uint32_t(const std::filesystem::path& path, size_t offset) noexcept {
+	std::vector<std::byte> bytes;
+	if (file_read_range(path, offset, 4, bytes)) return std::nullopt;
+	return load_le<std::uint32_t>(bytes.data());
+}
+
+int file_write_integer(const std::filesystem::path& path, uint32_t x, size_t offset) noexcept {
+	return file_replace_uint32_t(path, x, offset);
+}
+
+int file_insert_byte(
+	const std::filesystem::path& path, const std::vector<std::byte>& x, size_t offset
+) noexcept {
+	int err;
+	auto f = open(path, "rb+", err);
+	if (!f) return err;
+	defer{ fclose(f); };
+
+	auto length = length_of(f);
+	if (!length || *length < offset) return EIO;
+
+	std::vector<std::byte> tail((size_t)(*length - offset));
+	if (fseeko(f, (off_t)offset, SEEK_SET)) return errno;
+	if (fread(tail.data(), 1, tail.size(), f) != tail.size()) return EIO;
+
+	if (fseeko(f, (off_t)offset, SEEK_SET)) return errno;
+	if (fwrite(x.data(), 1, x.size(), f) != x.size()) {
+		// we try to restore the file.
+		fseeko(f, (off_t)offset, SEEK_SET);
+		fwrite(tail.data(), 1, tail.size(), f);
+		return EIO;
+	}
+	if (fwrite(tail.data(), 1, tail.size(), f) != tail.size()) return EIO;
+	return 0;
+}
+
+int file_replace_byte(
+	const std::filesystem::path& path, const std::vector<std::byte>& x, size_t offset
+) noexcept {
+	int err;
+	auto f = open(path, "rb+", err);
+	if (!f) return err;
+	defer{ fclose(f); };
+
+	auto length = length_of(f);
+	if (!length || *length <= offset) return EIO;
+	if (fseeko(f, (off_t)offset, SEEK_SET)) return errno;
+
+	if (fwrite(x.data(), 1, x.size(), f) != x.size()) return EIO;
+	return 0;
+}
+
+int file_replace_uint32_t(const std::filesystem::path& path, uint32_t x, size_t offset) noexcept {
+	std::vector<std::byte> bytes;
+	insert_uint32(bytes, x);
+	return file_replace_byte(path, bytes, offset);
+}
+
+std::optional<uint64_t> get_file_length(const std::filesystem::path& path) noexcept {
+	int err;
+	auto f = open(path, "rb", err);
+	if (!f) {
+		logs.write(LogTag::FileIO, "get_file_length, fopen: {}", err);
+		return std::nullopt;
+	}
+	defer{ fclose(f); };
+
+	auto length = length_of(f);
+	if (!length) logs.write(LogTag::FileIO, "get_file_length, fseek: {}", errno);
+	return length;
+}
+
+int file_read_range(
+	const std::filesystem::path& path, uint64_t offset, size_t size, std::vector<std::byte>& out
+) noexcept {
+	int err;
+	auto f = open(path, "rb", err);
+	if (!f) {
+		logs.write(LogTag::FileIO, "file_read_range, fopen: {}", err);
+		return err;
+	}
+	defer{ fclose(f); };
+
+	if (fseeko(f, (off_t)offset, SEEK_SET)) {
+		err = errno;
+		logs.write(LogTag::FileIO, "file_read_range, fseek: {}", err);
+		return err;
+	}
+
+	auto old_size = out.size();
+	out.resize(old_size + size);
+	auto read = fread(out.data() + old_size, 1, size, f);
+	if (read != size) {
+		out.resize(old_size);
+		logs.write(LogTag::FileIO, "file_read_range, fread: {} of {}", read, size);
+		return EIO;
+	}
+	return 0;
+}
+
+// Writes a temporary file with write(f), syncs it and renames it over path.
+template<typename F>
+static int replace_atomic(const std::filesystem::path& path, F&& write) noexcept {
+	auto tmp = path;
+	tmp += ".tmp";
+
+	{
+		int err;
+		auto f = open(tmp, "wb", err);
+		if (!f) {
+			logs.write(LogTag::FileIO, "file_replace_atomic, fopen: {}", err);
+			return err;
+		}
+		defer{ fclose(f); };
+
+		err = write(f);
+		if (err || fflush(f) || fsync(fileno(f))) {
+			logs.write(LogTag::FileIO, "file_replace_atomic, write: {}", err ? err : EIO);
+			return err ? err : EIO;
+		}
+	}
+
+	// rename replaces path in one step on the same file system.
+	if (std::rename(tmp.c_str(), path.c_str())) {
+		auto err = errno;
+		logs.write(LogTag::FileIO, "file_replace_atomic, rename: {}", err);
+		return err;
+	}
+	return 0;
+}
+
+int
+file_replace_atomic(const std::vector<std::byte>& bytes, const std::filesystem::path& path) noexcept {
+	return replace_atomic(path, [&](std::FILE* f) {
+		auto wrote = fwrite(bytes.data(), 1, bytes.size(), f);
+		if (wrote == bytes.size()) return 0;
+		logs.write(LogTag::FileIO, "file_replace_atomic, fwrite: {} of {}", wrote, bytes.size());
+		return EIO;
+	});
+}
+
+int file_replace_atomic(const FileParts& parts, const std::filesystem::path& path) noexcept {
+	return replace_atomic(path, [&](std::FILE* f) { return parts.write(f); });
+}
+
+std::FILE* file_open_append(const std::filesystem::path& path) noexcept {
+	int err;
+	auto f = open(path, "ab", err);
+	if (!f) logs.write(LogTag::FileIO, "file_open_append, fopen: {}", err);
+	return f;
+}
+
+int file_append_sync(std::FILE* file, const std::vector<std::byte>& bytes) noexcept {
+	if (fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) return EIO;
+	if (fflush(file)) return EIO;
+	return fsync(fileno(file)) ? errno : 0;
+}
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <ShlObj.h>
 #include <stdio.h>
+#include <io.h>
 
 #include "Common.hpp"
 #include "Logs.hpp"
@@ -54,9 +55,11 @@ std::filesystem::path get_user_data_path() noexcept {
 
 std::optional<std::vector<std::byte>> file_read_byte(const std::filesystem::path& path) noexcept {
 	if (!std::filesystem::is_regular_file(path)) {
-		logs.lock_and_write(
-			"std::filesystem::is_regular_file: "
-			+ path.generic_string()+ " " + std::filesystem::current_path().generic_string()
+		logs.write(
+			LogTag::FileIO,
+			"std::filesystem::is_regular_file: {} {}",
+			path.generic_string(),
+			std::filesystem::current_path().generic_string()
 		);
 		return std::nullopt;
 	}
@@ -64,7 +67,7 @@ std::optional<std::vector<std::byte>> file_read_byte(const std::filesystem::path
 	FILE* file;
 	auto err = fopen_s(&file, path.generic_string().c_str(), "rb");
 	if (!file || err) {
-		logs.lock_and_write("file_read_byte, fopen: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "file_read_byte, fopen: {}", err);
 		return std::nullopt;
 	}
 	defer{ fclose(file); };
@@ -76,7 +79,7 @@ std::optional<std::vector<std::byte>> file_read_byte(const std::filesystem::path
 	std::vector<std::byte> bytes(length);
 	size_t read = fread(bytes.data(), sizeof(std::byte), length, file);
 	if (read != length) {
-		logs.lock_and_write("file_read_byte, fread: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "file_read_byte, fread: {}", err);
 		return std::nullopt;
 	}
 
@@ -119,7 +122,7 @@ std::optional<uint32_t> file_read_uint32_t(const std::filesystem::path& path, si
 	FILE* f;
 	auto err = fopen_s(&f, path.generic_string().c_str(), "rb");
 	if (!f || err) {
-		logs.lock_and_write("file_read_uint32_t, fopen: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "file_read_uint32_t, fopen: {}", err);
 		return std::nullopt;
 	}
 	defer{ fclose(f); };
@@ -129,9 +132,7 @@ std::optional<uint32_t> file_read_uint32_t(const std::filesystem::path& path, si
 	rewind(f);
 
 	if (f_length <= offset) {
-		logs.lock_and_write(
-			"file_read_uint32_t, fseek: " + std::to_string(err) + ": " + std::to_string(offset)
-		);
+		logs.write(LogTag::FileIO, "file_read_uint32_t, fseek: {}: {}", err, offset);
 		return std::nullopt;
 	}
 
@@ -139,7 +140,7 @@ std::optional<uint32_t> file_read_uint32_t(const std::filesystem::path& path, si
 	uint8_t x[4];
 	size_t read = fread(x, 1, 4, f);
 	if (read != 4) {
-		logs.lock_and_write("file_read_uint32_t, fopen: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "file_read_uint32_t, fopen: {}", err);
 		return std::nullopt;
 	}
 
@@ -244,18 +245,47 @@ std::optional<uint64_t> get_file_length(const std::filesystem::path& path) noexc
 	FILE* f;
 	auto err = fopen_s(&f, path.generic_string().c_str(), "rb+");
 	if (!f || err) {
-		logs.lock_and_write("file_read_uint32_t, fopen: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "file_read_uint32_t, fopen: {}", err);
 		return std::nullopt;
 	}
 	defer{ fclose(f); };
 
-	err = fseek(f, 0, SEEK_END);
-	if (!err) {
-		logs.lock_and_write("file_read_uint32_t, fseek: " + std::to_string(err));
+	err = _fseeki64(f, 0, SEEK_END);
+	if (err) {
+		logs.write(LogTag::FileIO, "get_file_length, fseek: {}", err);
 		return std::nullopt;
 	}
 
-	return (uint64_t)ftell(f);
+	return (uint64_t)_ftelli64(f);
+}
+
+int file_read_range(
+	const std::filesystem::path& path, uint64_t offset, size_t size, std::vector<std::byte>& out
+) noexcept {
+	FILE* f;
+	auto err = fopen_s(&f, path.generic_string().c_str(), "rb");
+	if (!f || err) {
+		logs.write(LogTag::FileIO, "file_read_range, fopen: {}", err);
+		return err ? err : EIO;
+	}
+	defer{ fclose(f); };
+
+	err = _fseeki64(f, (__int64)offset, SEEK_SET);
+	if (err) {
+		logs.write(LogTag::FileIO, "file_read_range, fseek: {}", err);
+		return err;
+	}
+
+	auto old_size = out.size();
+	out.resize(old_size + size);
+	auto read = fread(out.data() + old_size, 1, size, f);
+	if (read != size) {
+		out.resize(old_size);
+		logs.write(LogTag::FileIO, "file_read_range, fread: {} of {}", read, size);
+		return EIO;
+	}
+
+	return 0;
 }
 
 
@@ -268,3 +298,67 @@ int file_replace_uint32_t(const std::filesystem::path& path, uint32_t x, size_t
 
 	return file_replace_byte(path, bytes, offset);
 }
+
+// Writes a temporary file with write(f), commits it and moves it over path.
+template<typename F>
+static int replace_atomic(const std::filesystem::path& path, F&& write) noexcept {
+	auto tmp = path;
+	tmp += ".tmp";
+
+	{
+		FILE* f;
+		auto err = fopen_s(&f, tmp.generic_string().c_str(), "wb");
+		if (!f || err) {
+			logs.write(LogTag::FileIO, "file_replace_atomic, fopen: {}", err);
+			return err ? err : EIO;
+		}
+		defer{ fclose(f); };
+
+		err = write(f);
+		if (err || fflush(f) || _commit(_fileno(f))) {
+			logs.write(LogTag::FileIO, "file_replace_atomic, write: {}", err ? err : EIO);
+			return err ? err : EIO;
+		}
+	}
+
+	auto moved = MoveFileExW(
+		tmp.native().c_str(), path.native().c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+	);
+	if (!moved) {
+		logs.write(LogTag::FileIO, "file_replace_atomic, MoveFileExW: {}", (std::uint32_t)GetLastError());
+		return EIO;
+	}
+
+	return 0;
+}
+
+int
+file_replace_atomic(const std::vector<std::byte>& bytes, const std::filesystem::path& path) noexcept {
+	return replace_atomic(path, [&](FILE* f) {
+		auto wrote = fwrite(bytes.data(), 1, bytes.size(), f);
+		if (wrote == bytes.size()) return 0;
+		logs.write(LogTag::FileIO, "file_replace_atomic, fwrite: {} of {}", wrote, bytes.size());
+		return EIO;
+	});
+}
+
+int file_replace_atomic(const FileParts& parts, const std::filesystem::path& path) noexcept {
+	return replace_atomic(path, [&](FILE* f) { return parts.write(f); });
+}
+
+std::FILE* file_open_append(const std::filesystem::path& path) noexcept {
+	FILE* f;
+	auto err = fopen_s(&f, path.generic_string().c_str(), "ab");
+	if (!f || err) {
+		logs.write(LogTag::FileIO, "file_open_append, fopen: {}", err);
+		return nullptr;
+	}
+	return f;
+}
+
+int file_append_sync(std::FILE* file, const std::vector<std::byte>& bytes) noexcept {
+	auto wrote = fwrite(bytes.data(), 1, bytes.size(), file);
+	if (wrote != bytes.size()) return EIO;
+	if (fflush(file)) return EIO;
+	return _commit(_fileno(file));
+}
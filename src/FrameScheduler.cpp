@@ -0,0 +1,57 @@
+#include "FrameScheduler.hpp"
+
+void FrameScheduler::notify_input(std::uint64_t now) noexcept {
+	input_pending = true;
+	last_input = now;
+}
+
+void FrameScheduler::notify_data(std::uint64_t) noexcept {
+	data_pending = true;
+}
+
+// The earliest time we have a reason to render, Infinite if there is none.
+[[nodiscard]] std::uint64_t FrameScheduler::due_time() const noexcept {
+	auto due = Infinite;
+	auto earliest = [&](std::uint64_t t) { due = due < t ? due : t; };
+
+	if (input_pending || last_input + Input_Linger_Ms > last_frame) {
+		earliest(last_frame + Min_Frame_Ms);
+	}
+	if (data_pending) earliest(last_frame + Data_Period_Ms);
+	if (live_period_ms > 0) earliest(last_frame + live_period_ms);
+
+	return due;
+}
+
+[[nodiscard]] bool FrameScheduler::should_render(std::uint64_t now) noexcept {
+	stats.wakeups++;
+
+	if (due_time() > now) return false;
+
+	if (input_pending || last_input + Input_Linger_Ms > last_frame) current = Reason::Input;
+	else if (data_pending && last_frame + Data_Period_Ms <= now)    current = Reason::Data;
+	else                                                            current = Reason::Live;
+	return true;
+}
+
+void FrameScheduler::frame_rendered(std::uint64_t now) noexcept {
+	stats.frames++;
+	switch (current) {
+	case Reason::Input: stats.input_frames++; break;
+	case Reason::Data:  stats.data_frames++;  break;
+	case Reason::Live:  stats.live_frames++;  break;
+	default: break;
+	}
+	current = Reason::None;
+
+	// A frame shows everything, whatever the reason it was rendered for.
+	input_pending = false;
+	data_pending = false;
+	last_frame = now;
+}
+
+[[nodiscard]] std::uint64_t FrameScheduler::next_timeout(std::uint64_t now) const noexcept {
+	auto due = due_time();
+	if (due == Infinite) return Infinite;
+	return due > now ? due - now : 0;
+}
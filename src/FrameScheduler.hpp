@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Decides when the stats window needs a new frame. It knows nothing about the os, the caller
+// tells it what happened and when (in ms), then waits for next_timeout before asking again.
+// We render:
+//  - on input, and a little while after so ImGui can settle (hover, animations, ...),
+//  - when the ingest thread says the data changed, at most every Data_Period_Ms,
+//  - every live_period_ms for the live plots if it's not 0.
+// Otherwise we don't render at all.
+struct FrameScheduler {
+	static constexpr std::uint64_t Infinite = UINT64_MAX;
+	static constexpr std::uint64_t Min_Frame_Ms = 16;
+	static constexpr std::uint64_t Input_Linger_Ms = 250;
+	static constexpr std::uint64_t Data_Period_Ms = 250;
+
+	struct Stats {
+		size_t wakeups{ 0 };
+		size_t frames{ 0 };
+		size_t input_frames{ 0 };
+		size_t data_frames{ 0 };
+		size_t live_frames{ 0 };
+	};
+
+	std::uint64_t live_period_ms{ 1'000 };
+	Stats stats;
+
+	void notify_input(std::uint64_t now) noexcept;
+	void notify_data(std::uint64_t now) noexcept;
+
+	// Counts as a wakeup, if it returns true the caller must render and call frame_rendered.
+	[[nodiscard]] bool should_render(std::uint64_t now) noexcept;
+	void frame_rendered(std::uint64_t now) noexcept;
+
+	// How long we can sleep before should_render could become true, in ms, if nothing happens.
+	[[nodiscard]] std::uint64_t next_timeout(std::uint64_t now) const noexcept;
+
+private:
+	enum class Reason { None, Input, Data, Live };
+
+	std::uint64_t last_frame{ 0 };
+	std::uint64_t last_input{ 0 };
+	bool input_pending{ true }; // The first frame.
+	bool data_pending{ false };
+	Reason current{ Reason::None };
+
+	[[nodiscard]] std::uint64_t due_time() const noexcept;
+};
@@ -0,0 +1,76 @@
+#include "HeavyHitters.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+std::uint64_t hash_name(const SketchName& name) noexcept {
+	std::uint64_t h = 14'695'981'039'346'656'037ull;
+	for (size_t i = 0; i < name.size() && name[i]; ++i) {
+		h ^= (std::uint8_t)name[i];
+		h *= 1'099'511'628'211ull;
+	}
+
+	// The splitmix64 finalizer, FNV alone leaves the high bits of short names alike.
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+void HyperLogLog::add(std::uint64_t hash) noexcept {
+	constexpr std::uint8_t Max_Rank = 64 - Precision + 1;
+
+	// The high bits pick the register, it keeps the longest run of leading zeros of the rest.
+	auto& reg = registers[hash >> (64 - Precision)];
+	auto rest = hash << Precision;
+	std::uint8_t rank = 1;
+	while (rank < Max_Rank && !(rest & (1ull << 63))) {
+		rest <<= 1;
+		rank++;
+	}
+	if (rank > reg) reg = rank;
+}
+
+double HyperLogLog::estimate() const noexcept {
+	constexpr double m = (double)N_Registers;
+	constexpr double Alpha = 0.7213 / (1 + 1.079 / m);
+
+	double sum = 0;
+	size_t zeros = 0;
+	for (auto x : registers) {
+		sum += std::ldexp(1.0, -(int)x);
+		zeros += x == 0;
+	}
+
+	auto e = Alpha * m * m / sum;
+	if (e <= 2.5 * m && zeros) e = m * std::log(m / zeros);
+	return e;
+}
+
+void SpaceSaving::add(const SketchName& name, std::uint64_t hash, std::uint64_t weight) noexcept {
+	total += weight;
+
+	for (auto& x : entries) if (x.hash == hash && x.name == name) {
+		x.count += weight;
+		return;
+	}
+
+	if (entries.size() < Capacity) {
+		entries.push_back({ name, hash, weight, 0 });
+		return;
+	}
+
+	auto cmp = [](const Entry& a, const Entry& b) { return a.count < b.count; };
+	auto& min = *std::min_element(std::begin(entries), std::end(entries), cmp);
+	min = { name, hash, min.count + weight, min.count };
+	evicted = true;
+}
+
+void SpaceSaving::sort() noexcept {
+	auto cmp = [](const Entry& a, const Entry& b) {
+		return a.count - a.error > b.count - b.error;
+	};
+	std::sort(std::begin(entries), std::end(entries), cmp);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The names of the usages, nul terminated.
+using SketchName = std::array<char, 128>;
+
+// FNV-1a of the name up to its nul, with a final mix so every bit of it can be used.
+[[nodiscard]] extern std::uint64_t hash_name(const SketchName& name) noexcept;
+
+// HyperLogLog (Flajolet et al.), the number of distinct hashes in a fixed 1 KB, about 3% off.
+// Exact enough for a few names thanks to the linear counting of the small cardinalities.
+struct HyperLogLog {
+	static constexpr size_t Precision = 10;
+	static constexpr size_t N_Registers = (size_t)1 << Precision;
+
+	std::array<std::uint8_t, N_Registers> registers{};
+
+	void add(std::uint64_t hash) noexcept;
+	[[nodiscard]] double estimate() const noexcept;
+};
+
+// Weighted Space-Saving (Metwally et al.), the heaviest names of a stream in Capacity entries.
+// A name that isn't there takes the place of the lightest one and inherits its count as the
+// error: the real weight of a name is in [count - error, count], and any name heavier than
+// total / Capacity is there. The counts sum to total.
+struct SpaceSaving {
+	static constexpr size_t Capacity = 64;
+
+	struct Entry {
+		SketchName name;
+		std::uint64_t hash;
+		std::uint64_t count;
+		std::uint64_t error;
+	};
+
+	std::vector<Entry> entries; // unordered until sort.
+	std::uint64_t total{ 0 };
+	bool evicted{ false }; // false while the counts are exact and every name is there.
+
+	void add(const SketchName& name, std::uint64_t hash, std::uint64_t weight) noexcept;
+	// By the guaranteed count, count - error, the heaviest first. A name that just came in over
+	// the lightest one goes last.
+	void sort() noexcept;
+};
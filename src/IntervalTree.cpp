@@ -0,0 +1,81 @@
+#include "IntervalTree.hpp"
+
+static bool by_start(const IntervalTree::Interval& a, const IntervalTree::Interval& b) noexcept {
+	return a.start < b.start;
+}
+
+void IntervalTree::build(std::vector<Interval> intervals) noexcept {
+	sorted = std::move(intervals);
+	tail.clear();
+	std::stable_sort(std::begin(sorted), std::end(sorted), by_start);
+	rebuild();
+}
+
+void IntervalTree::insert(std::uint64_t start, std::uint64_t end, size_t id) noexcept {
+	if (id >= position.size()) position.resize(id + 1, npos);
+
+	if (!sorted.empty() && start < sorted.back().start) {
+		tail.push_back({ start, end, id });
+		position[id] = npos;
+		if (tail.size() < Max_Tail) return;
+
+		std::stable_sort(std::begin(tail), std::end(tail), by_start);
+		auto n = sorted.size();
+		sorted.insert(std::end(sorted), std::begin(tail), std::end(tail));
+		std::inplace_merge(std::begin(sorted), std::begin(sorted) + n, std::end(sorted), by_start);
+		tail.clear();
+		rebuild();
+		return;
+	}
+
+	sorted.push_back({ start, end, id });
+	position[id] = sorted.size() - 1;
+	if (sorted.size() > capacity) rebuild();
+	else                          update(sorted.size() - 1);
+}
+
+void IntervalTree::set_end(size_t id, std::uint64_t end) noexcept {
+	if (id >= position.size()) return;
+
+	if (position[id] == npos) {
+		for (auto& x : tail) if (x.id == id) x.end = end;
+		return;
+	}
+
+	sorted[position[id]].end = end;
+	update(position[id]);
+}
+
+void IntervalTree::clear() noexcept {
+	*this = {};
+}
+
+size_t IntervalTree::size() const noexcept {
+	return sorted.size() + tail.size();
+}
+
+void IntervalTree::rebuild() noexcept {
+	capacity = 16;
+	while (capacity < sorted.size()) capacity *= 2;
+
+	max_end.assign(2 * capacity, 0);
+	for (size_t i = 0; i < sorted.size(); ++i) max_end[capacity + i] = sorted[i].end;
+	for (size_t i = capacity - 1; i > 0; --i) {
+		max_end[i] = std::max(max_end[2 * i], max_end[2 * i + 1]);
+	}
+
+	for (auto& x : position) x = npos;
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		if (sorted[i].id >= position.size()) position.resize(sorted[i].id + 1, npos);
+		position[sorted[i].id] = i;
+	}
+	for (auto& x : tail) if (x.id >= position.size()) position.resize(x.id + 1, npos);
+}
+
+void IntervalTree::update(size_t i) noexcept {
+	auto node = capacity + i;
+	max_end[node] = sorted[i].end;
+	for (node /= 2; node > 0; node /= 2) {
+		max_end[node] = std::max(max_end[2 * node], max_end[2 * node + 1]);
+	}
+}
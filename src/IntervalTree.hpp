@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// Closed intervals [start, end] tagged with the index of what they belong to (a display, an app
+// usage), to find the ones overlapping a time range without scanning all of them.
+// The intervals are sorted by start under a segment tree of the max end. The ones overlapping
+// [a, b] are in the prefix that starts before b, and the tree skips the subtrees that end before
+// a, so a query is O(log n) per interval found.
+// Ours mostly come in start order and are appended in O(log n). The others wait in a small
+// unsorted tail, scanned by the queries, until it's merged back.
+struct IntervalTree {
+	static constexpr size_t Max_Tail = 64;
+	static constexpr size_t npos = SIZE_MAX;
+
+	struct Interval {
+		std::uint64_t start;
+		std::uint64_t end;
+		size_t id;
+	};
+
+	// The ids are small indices (in display_entries, in apps_usages), each inserted once.
+	void build(std::vector<Interval> intervals) noexcept;
+	void insert(std::uint64_t start, std::uint64_t end, size_t id) noexcept;
+	// For a display that got disconnected.
+	void set_end(size_t id, std::uint64_t end) noexcept;
+	void clear() noexcept;
+	[[nodiscard]] size_t size() const noexcept;
+
+	// Calls f(id) for each interval overlapping [a, b], in no particular order.
+	template<typename F>
+	void overlapping(std::uint64_t a, std::uint64_t b, F&& f) const noexcept {
+		for (auto& x : tail) if (x.start <= b && a <= x.end) f(x.id);
+		if (sorted.empty() || max_end[1] < a) return;
+
+		auto p = std::upper_bound(
+			std::begin(sorted), std::end(sorted), b,
+			[](std::uint64_t t, const Interval& x) { return t < x.start; }
+		) - std::begin(sorted);
+		visit(1, 0, capacity, (size_t)p, a, f);
+	}
+	template<typename F>
+	void containing(std::uint64_t t, F&& f) const noexcept {
+		overlapping(t, t, f);
+	}
+
+private:
+	std::vector<Interval> sorted;
+	std::vector<Interval> tail;
+	size_t capacity{ 0 }; // leaves of the tree, a power of two.
+	std::vector<std::uint64_t> max_end; // 1 is the root, the leaves start at capacity.
+	std::vector<size_t> position; // in sorted by id, npos for the tail.
+
+	void rebuild() noexcept;
+	void update(size_t i) noexcept;
+
+	template<typename F>
+	void visit(size_t node, size_t lo, size_t hi, size_t p, std::uint64_t a, F& f) const noexcept {
+		if (lo >= p || max_end[node] < a) return;
+		if (hi - lo == 1) {
+			f(sorted[lo].id);
+			return;
+		}
+
+		auto mid = (lo + hi) / 2;
+		visit(2 * node, lo, mid, p, a, f);
+		visit(2 * node + 1, mid, hi, p, a, f);
+	}
+};
@@ -0,0 +1,148 @@
+#include "KeyHolds.hpp"
+#include <cstring>
+#include <utility>
+
+#include "ByteStream.hpp"
+#include "VirtualKeys.hpp"
+
+std::uint8_t modifier_of_key(std::uint8_t key_code) noexcept {
+	switch (key_code) {
+	case VK_CONTROL:
+	case VK_LCONTROL:
+	case VK_RCONTROL:
+		return KeyHold::Ctrl;
+	case VK_SHIFT:
+	case VK_LSHIFT:
+	case VK_RSHIFT:
+		return KeyHold::Shift;
+	case VK_MENU:
+	case VK_LMENU:
+	case VK_RMENU:
+		return KeyHold::Alt;
+	case VK_LWIN:
+	case VK_RWIN:
+		return KeyHold::Win;
+	default:
+		return 0;
+	}
+}
+
+void append_modifiers_name(std::uint8_t modifiers, char* dst, size_t size) noexcept {
+	constexpr std::pair<std::uint8_t, const char*> names[] = {
+		{ KeyHold::Ctrl, "Ctrl+" },
+		{ KeyHold::Shift, "Shift+" },
+		{ KeyHold::Alt, "Alt+" },
+		{ KeyHold::Win, "Win+" },
+	};
+	if (size == 0) return;
+	dst[0] = '\0';
+	for (auto& [bit, name] : names) {
+		if (!(modifiers & bit)) continue;
+		auto n = strlen(dst);
+		if (n + strlen(name) >= size) return;
+		memcpy(dst + n, name, strlen(name) + 1);
+	}
+}
+
+// The low level hook sees the left and right keys, the generic ones are there for the injected
+// inputs.
+static constexpr std::uint8_t Modifier_Keys[] = {
+	VK_CONTROL, VK_LCONTROL, VK_RCONTROL,
+	VK_SHIFT, VK_LSHIFT, VK_RSHIFT,
+	VK_MENU, VK_LMENU, VK_RMENU,
+	VK_LWIN, VK_RWIN,
+};
+
+std::uint8_t KeyPairing::modifiers(std::uint64_t timestamp) const noexcept {
+	std::uint8_t result = 0;
+	for (auto x : Modifier_Keys) {
+		if (down_at[x] && timestamp - down_at[x] < Stale_Ms) result |= modifier_of_key(x);
+	}
+	return result;
+}
+
+void KeyPairing::down(std::uint8_t key_code, std::uint64_t timestamp) noexcept {
+	// The repeats of a held key, unless its key up was lost.
+	if (down_at[key_code] && timestamp - down_at[key_code] < Stale_Ms) return;
+
+	down_at[key_code] = timestamp;
+	modifiers_at_down[key_code] = modifiers(timestamp);
+}
+
+KeyHold KeyPairing::up(std::uint8_t key_code, std::uint64_t timestamp) noexcept {
+	KeyHold hold;
+	auto t = down_at[key_code];
+	down_at[key_code] = 0;
+	if (t == 0 || timestamp < t) return hold;
+
+	// The modifiers of a chord are released right after the key, sometimes right before.
+	hold.modifiers = modifiers_at_down[key_code];
+	hold.ms = (std::uint16_t)(timestamp - t < KeyHold::Max_Ms ? timestamp - t : KeyHold::Max_Ms);
+	return hold;
+}
+
+void HoldStats::add(std::uint8_t key_code, KeyHold hold) noexcept {
+	if (key_code >= N_Keys || hold.ms == KeyHold::Unknown_Ms) return;
+
+	total_ms[key_code] += hold.ms;
+	n_holds[key_code]++;
+
+	auto modifiers = hold.modifiers % KeyHold::N_Modifier_Sets;
+	if (is_chord(modifiers) && !modifier_of_key(key_code)) {
+		chords[modifiers * N_Keys + key_code]++;
+		n_chords++;
+	}
+}
+
+double HoldStats::average_ms(std::uint8_t key_code) const noexcept {
+	if (key_code >= N_Keys || n_holds[key_code] == 0) return 0;
+	return total_ms[key_code] / (double)n_holds[key_code];
+}
+
+// u32 N_Keys, per key u64 total ms and u32 holds, then u32 n chords used and per chord u16 index
+// in chords and u32 count.
+void HoldStats::save(std::vector<std::byte>& bytes) const noexcept {
+	size_t n_used = 0;
+	for (auto x : chords) n_used += x != 0;
+
+	ByteWriter writer{ bytes };
+	writer.reserve(4 + 12 * N_Keys + 4 + 6 * n_used);
+	writer.write((std::uint32_t)N_Keys);
+	for (size_t i = 0; i < N_Keys; ++i) {
+		writer.write(total_ms[i]);
+		writer.write(n_holds[i]);
+	}
+	writer.write((std::uint32_t)n_used);
+	for (size_t i = 0; i < chords.size(); ++i) if (chords[i]) {
+		writer.write((std::uint16_t)i);
+		writer.write(chords[i]);
+	}
+}
+
+[[nodiscard]] bool HoldStats::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(4 + 12 * N_Keys + 4) || reader.read<std::uint32_t>() != N_Keys) {
+		return false;
+	}
+
+	HoldStats loaded;
+	for (size_t i = 0; i < N_Keys; ++i) {
+		loaded.total_ms[i] = reader.read<std::uint64_t>();
+		loaded.n_holds[i] = reader.read<std::uint32_t>();
+	}
+	auto n_used = reader.read<std::uint32_t>();
+	if (!reader.can_read(6 * (size_t)n_used)) return false;
+	for (size_t i = 0; i < n_used; ++i) {
+		auto idx = reader.read<std::uint16_t>();
+		auto n = reader.read<std::uint32_t>();
+		if (idx >= loaded.chords.size()) return false;
+		loaded.chords[idx] = n;
+		loaded.n_chords += n;
+	}
+
+	*this = loaded;
+	return true;
+}
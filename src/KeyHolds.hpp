@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// How long a key is held and what modifiers are down with it. The keyboard hook pairs each key
+// up with its key down, the entries carry the result.
+struct KeyHold {
+	enum Modifier : std::uint8_t {
+		Ctrl = 1,
+		Shift = 2,
+		Alt = 4,
+		Win = 8,
+	};
+	static constexpr size_t N_Modifier_Sets = 16;
+
+	// The key up came without its key down: the hook started with the key held, or the entry
+	// comes from a file or a log without holds.
+	static constexpr std::uint16_t Unknown_Ms = UINT16_MAX;
+	static constexpr std::uint16_t Max_Ms = UINT16_MAX - 1;
+	// A column of the save file: u8 modifiers, u16 hold ms.
+	static constexpr size_t Packed_Size = 3;
+
+	std::uint8_t modifiers{ 0 };
+	std::uint16_t ms{ Unknown_Ms };
+};
+
+[[nodiscard]] extern std::uint8_t modifier_of_key(std::uint8_t key_code) noexcept;
+// Ctrl, Alt or Win, shift alone is just typing.
+[[nodiscard]] inline bool is_chord(std::uint8_t modifiers) noexcept {
+	return modifiers & (KeyHold::Ctrl | KeyHold::Alt | KeyHold::Win);
+}
+// "Ctrl+Shift+", empty without modifiers.
+extern void append_modifiers_name(std::uint8_t modifiers, char* dst, size_t size) noexcept;
+
+// The key downs waiting for their key up, by key code. A held key repeats its key down, only the
+// first one counts. Fixed size so the hook never allocates, a key down or up is O(1).
+struct KeyPairing {
+	// A key down older than that lost its key up (the hook was off, the session locked), it
+	// can't be held anymore.
+	static constexpr std::uint64_t Stale_Ms = 60'000;
+
+	std::array<std::uint64_t, 256> down_at{}; // ms since epoch, 0 if not down.
+	std::array<std::uint8_t, 256> modifiers_at_down{};
+
+	void down(std::uint8_t key_code, std::uint64_t timestamp) noexcept;
+	[[nodiscard]] KeyHold up(std::uint8_t key_code, std::uint64_t timestamp) noexcept;
+
+	[[nodiscard]] std::uint8_t modifiers(std::uint64_t timestamp) const noexcept;
+};
+
+// The counters of the holds, they are kept even when the entries are compacted.
+struct HoldStats {
+	static constexpr size_t N_Keys = 255;
+
+	std::array<std::uint64_t, N_Keys> total_ms{};
+	std::array<std::uint32_t, N_Keys> n_holds{}; // the ones with a known hold.
+	// By modifiers * N_Keys + key code, only the chords.
+	std::array<std::uint32_t, KeyHold::N_Modifier_Sets * N_Keys> chords{};
+	size_t n_chords{ 0 };
+
+	void add(std::uint8_t key_code, KeyHold hold) noexcept;
+
+	[[nodiscard]] double average_ms(std::uint8_t key_code) const noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+};
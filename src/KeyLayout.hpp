@@ -0,0 +1,382 @@
+#pragma once
+#include <array>
+#include <utility>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#include "VirtualKeys.hpp"
+
+// What we know of each virtual key code: its name, what kind of key it is and where it is on the
+// keyboard. The whole table is built at compile time, a lookup is an index and never allocates.
+// The codes of the letters follow the labels of the keys, not their place: on an AZERTY keyboard
+// the key under Q on a QWERTY one sends 'A'. The layouts move those keys and rename the OEM ones.
+
+enum class KeyboardLayout : std::uint8_t {
+	Qwerty = 0,
+	Azerty,
+	Qwertz,
+	Count
+};
+// For an ImGui::Combo.
+constexpr const char* Keyboard_Layout_Names = "QWERTY\0AZERTY\0QWERTZ\0";
+
+enum class KeyCategory : std::uint8_t {
+	Unassigned = 0,
+	Reserved,
+	Oem_Specific,
+	Mouse,
+	Letter,
+	Digit,
+	Punctuation,
+	Whitespace,
+	Editing,
+	Navigation,
+	Modifier,
+	Lock,
+	Function,
+	Numpad,
+	Media,
+	Ime,
+	System,
+};
+
+// The finger that types the key in touch typing, from the left pinky to the right one.
+enum class Finger : std::uint8_t {
+	None = 0,
+	Left_Pinky,
+	Left_Ring,
+	Left_Middle,
+	Left_Index,
+	Thumb,
+	Right_Index,
+	Right_Middle,
+	Right_Ring,
+	Right_Pinky,
+	Count
+};
+
+enum class KeyRow : std::uint8_t {
+	None = 0,
+	Function,
+	Number,
+	Top,
+	Home,
+	Bottom,
+	Space,
+	Count
+};
+
+struct KeyInfo {
+	std::string_view name{ "Unassigned" };
+	KeyCategory category{ KeyCategory::Unassigned };
+	Finger finger{ Finger::None };
+	KeyRow row{ KeyRow::None };
+};
+using KeyTable = std::array<KeyInfo, 256>;
+
+// A key a layout names or moves, the category stays the one of the base table.
+struct KeyOverride {
+	int code;
+	std::string_view name;
+	Finger finger;
+	KeyRow row;
+};
+
+constexpr void set_key(
+	KeyTable& t,
+	int code,
+	std::string_view name,
+	KeyCategory category,
+	Finger finger = Finger::None,
+	KeyRow row = KeyRow::None
+) noexcept {
+	t[code] = { name, category, finger, row };
+}
+constexpr void set_keys(
+	KeyTable& t, int first, int last, std::string_view name, KeyCategory category
+) noexcept {
+	for (int i = first; i <= last; ++i) t[i] = { name, category };
+}
+
+// A US keyboard.
+constexpr KeyTable make_base_key_table() noexcept {
+	using C = KeyCategory;
+	using F = Finger;
+	using R = KeyRow;
+	KeyTable t{};
+
+	set_keys(t, 0x07, 0x07, "Reserved", C::Reserved);
+	set_keys(t, 0x0A, 0x0B, "Reserved", C::Reserved);
+	set_keys(t, 0x5E, 0x5E, "Reserved", C::Reserved);
+	set_keys(t, 0x88, 0x8F, "Reserved", C::Reserved);
+	set_keys(t, 0xB8, 0xB9, "Reserved", C::Reserved);
+	set_keys(t, 0xC1, 0xDA, "Reserved", C::Reserved);
+	set_keys(t, 0xE0, 0xE0, "Reserved", C::Reserved);
+	set_keys(t, 0xFC, 0xFC, "Reserved", C::Reserved);
+	set_keys(t, 0x92, 0x96, "OEM specific", C::Oem_Specific);
+	set_keys(t, 0xE1, 0xE1, "OEM specific", C::Oem_Specific);
+	set_keys(t, 0xE3, 0xE4, "OEM specific", C::Oem_Specific);
+	set_keys(t, 0xE6, 0xE6, "OEM specific", C::Oem_Specific);
+	set_keys(t, 0xE9, 0xF5, "OEM specific", C::Oem_Specific);
+
+	set_key(t, VK_LBUTTON, "Left button", C::Mouse);
+	set_key(t, VK_RBUTTON, "Right button", C::Mouse);
+	set_key(t, VK_CANCEL, "Cancel", C::System);
+	set_key(t, VK_MBUTTON, "Middle button", C::Mouse);
+	set_key(t, 0x05, "X1 button", C::Mouse);
+	set_key(t, 0x06, "X2 button", C::Mouse);
+
+	set_key(t, VK_BACK, "Backspace", C::Editing, F::Right_Pinky, R::Number);
+	set_key(t, VK_TAB, "Tab", C::Whitespace, F::Left_Pinky, R::Top);
+	set_key(t, VK_CLEAR, "Clear", C::Editing);
+	set_key(t, VK_RETURN, "Enter", C::Whitespace, F::Right_Pinky, R::Home);
+	set_key(t, VK_SHIFT, "Shift", C::Modifier);
+	set_key(t, VK_CONTROL, "Ctrl", C::Modifier);
+	set_key(t, VK_MENU, "Alt", C::Modifier);
+	set_key(t, VK_PAUSE, "Pause", C::System);
+	set_key(t, VK_CAPITAL, "Caps Lock", C::Lock, F::Left_Pinky, R::Home);
+	set_key(t, 0x15, "Kana", C::Ime);
+	set_key(t, 0x16, "IME on", C::Ime);
+	set_key(t, 0x17, "Junja", C::Ime);
+	set_key(t, 0x18, "IME final", C::Ime);
+	set_key(t, 0x19, "Kanji", C::Ime);
+	set_key(t, 0x1A, "IME off", C::Ime);
+	set_key(t, VK_ESCAPE, "Esc", C::System, F::Left_Pinky, R::Function);
+	set_key(t, 0x1C, "Convert", C::Ime);
+	set_key(t, 0x1D, "Non convert", C::Ime);
+	set_key(t, 0x1E, "IME accept", C::Ime);
+	set_key(t, 0x1F, "IME mode change", C::Ime);
+
+	set_key(t, VK_SPACE, "Space", C::Whitespace, F::Thumb, R::Space);
+	set_key(t, VK_PRIOR, "Page Up", C::Navigation);
+	set_key(t, VK_NEXT, "Page Down", C::Navigation);
+	set_key(t, VK_END, "End", C::Navigation);
+	set_key(t, VK_HOME, "Home", C::Navigation);
+	set_key(t, VK_LEFT, "Left", C::Navigation);
+	set_key(t, VK_UP, "Up", C::Navigation);
+	set_key(t, VK_RIGHT, "Right", C::Navigation);
+	set_key(t, VK_DOWN, "Down", C::Navigation);
+	set_key(t, VK_SELECT, "Select", C::System);
+	set_key(t, VK_PRINT, "Print", C::System);
+	set_key(t, VK_EXECUTE, "Execute", C::System);
+	set_key(t, VK_SNAPSHOT, "Print Screen", C::System);
+	set_key(t, VK_INSERT, "Insert", C::Editing);
+	set_key(t, VK_DELETE, "Delete", C::Editing);
+	set_key(t, VK_HELP, "Help", C::System);
+
+	constexpr std::string_view digits[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+	constexpr F digit_fingers[] = {
+		F::Right_Pinky, F::Left_Pinky, F::Left_Ring, F::Left_Middle, F::Left_Index,
+		F::Left_Index, F::Right_Index, F::Right_Index, F::Right_Middle, F::Right_Ring,
+	};
+	for (int i = 0; i < 10; ++i) {
+		set_key(t, '0' + i, digits[i], C::Digit, digit_fingers[i], R::Number);
+	}
+
+	constexpr std::string_view letters[] = {
+		"A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
+		"N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z",
+	};
+	// By letter, where they are on a QWERTY keyboard.
+	constexpr std::pair<F, R> places[] = {
+		{ F::Left_Pinky, R::Home }, // A
+		{ F::Left_Index, R::Bottom }, // B
+		{ F::Left_Middle, R::Bottom }, // C
+		{ F::Left_Middle, R::Home }, // D
+		{ F::Left_Middle, R::Top }, // E
+		{ F::Left_Index, R::Home }, // F
+		{ F::Left_Index, R::Home }, // G
+		{ F::Right_Index, R::Home }, // H
+		{ F::Right_Middle, R::Top }, // I
+		{ F::Right_Index, R::Home }, // J
+		{ F::Right_Middle, R::Home }, // K
+		{ F::Right_Ring, R::Home }, // L
+		{ F::Right_Index, R::Bottom }, // M
+		{ F::Right_Index, R::Bottom }, // N
+		{ F::Right_Ring, R::Top }, // O
+		{ F::Right_Pinky, R::Top }, // P
+		{ F::Left_Pinky, R::Top }, // Q
+		{ F::Left_Index, R::Top }, // R
+		{ F::Left_Ring, R::Home }, // S
+		{ F::Left_Index, R::Top }, // T
+		{ F::Right_Index, R::Top }, // U
+		{ F::Left_Index, R::Bottom }, // V
+		{ F::Left_Ring, R::Top }, // W
+		{ F::Left_Ring, R::Bottom }, // X
+		{ F::Right_Index, R::Top }, // Y
+		{ F::Left_Pinky, R::Bottom }, // Z
+	};
+	for (int i = 0; i < 26; ++i) {
+		set_key(t, 'A' + i, letters[i], C::Letter, places[i].first, places[i].second);
+	}
+
+	set_key(t, VK_LWIN, "Left Win", C::Modifier);
+	set_key(t, VK_RWIN, "Right Win", C::Modifier);
+	set_key(t, VK_APPS, "Menu", C::System);
+	set_key(t, 0x5F, "Sleep", C::System);
+
+	set_key(t, VK_NUMPAD0, "Num 0", C::Numpad, F::Thumb, R::Space);
+	set_key(t, VK_NUMPAD1, "Num 1", C::Numpad, F::Right_Index, R::Bottom);
+	set_key(t, VK_NUMPAD2, "Num 2", C::Numpad, F::Right_Middle, R::Bottom);
+	set_key(t, VK_NUMPAD3, "Num 3", C::Numpad, F::Right_Ring, R::Bottom);
+	set_key(t, VK_NUMPAD4, "Num 4", C::Numpad, F::Right_Index, R::Home);
+	set_key(t, VK_NUMPAD5, "Num 5", C::Numpad, F::Right_Middle, R::Home);
+	set_key(t, VK_NUMPAD6, "Num 6", C::Numpad, F::Right_Ring, R::Home);
+	set_key(t, VK_NUMPAD7, "Num 7", C::Numpad, F::Right_Index, R::Top);
+	set_key(t, VK_NUMPAD8, "Num 8", C::Numpad, F::Right_Middle, R::Top);
+	set_key(t, VK_NUMPAD9, "Num 9", C::Numpad, F::Right_Ring, R::Top);
+	set_key(t, VK_MULTIPLY, "Num *", C::Numpad, F::Right_Ring, R::Number);
+	set_key(t, VK_ADD, "Num +", C::Numpad, F::Right_Pinky, R::Top);
+	set_key(t, VK_SEPARATOR, "Num separator", C::Numpad);
+	set_key(t, VK_SUBTRACT, "Num -", C::Numpad, F::Right_Pinky, R::Number);
+	set_key(t, VK_DECIMAL, "Num .", C::Numpad, F::Right_Ring, R::Space);
+	set_key(t, VK_DIVIDE, "Num /", C::Numpad, F::Right_Middle, R::Number);
+
+	constexpr std::string_view function_keys[] = {
+		"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12",
+		"F13", "F14", "F15", "F16", "F17", "F18", "F19", "F20", "F21", "F22", "F23", "F24",
+	};
+	constexpr F function_fingers[] = {
+		F::Left_Pinky, F::Left_Ring, F::Left_Middle, F::Left_Index,
+		F::Right_Index, F::Right_Index, F::Right_Middle, F::Right_Ring,
+		F::Right_Pinky, F::Right_Pinky, F::Right_Pinky, F::Right_Pinky,
+	};
+	for (int i = 0; i < 24; ++i) {
+		auto finger = i < 12 ? function_fingers[i] : F::None;
+		auto row = i < 12 ? R::Function : R::None;
+		set_key(t, VK_F1 + i, function_keys[i], C::Function, finger, row);
+	}
+
+	set_key(t, VK_NUMLOCK, "Num Lock", C::Lock, F::Right_Index, R::Number);
+	set_key(t, VK_SCROLL, "Scroll Lock", C::Lock);
+
+	set_key(t, VK_LSHIFT, "Left Shift", C::Modifier, F::Left_Pinky, R::Bottom);
+	set_key(t, VK_RSHIFT, "Right Shift", C::Modifier, F::Right_Pinky, R::Bottom);
+	set_key(t, VK_LCONTROL, "Left Ctrl", C::Modifier, F::Left_Pinky, R::Space);
+	set_key(t, VK_RCONTROL, "Right Ctrl", C::Modifier, F::Right_Pinky, R::Space);
+	set_key(t, VK_LMENU, "Left Alt", C::Modifier, F::Thumb, R::Space);
+	set_key(t, VK_RMENU, "Right Alt", C::Modifier, F::Thumb, R::Space);
+
+	set_key(t, 0xA6, "Browser back", C::Media);
+	set_key(t, 0xA7, "Browser forward", C::Media);
+	set_key(t, 0xA8, "Browser refresh", C::Media);
+	set_key(t, 0xA9, "Browser stop", C::Media);
+	set_key(t, 0xAA, "Browser search", C::Media);
+	set_key(t, 0xAB, "Browser favorites", C::Media);
+	set_key(t, 0xAC, "Browser home", C::Media);
+	set_key(t, 0xAD, "Volume mute", C::Media);
+	set_key(t, 0xAE, "Volume down", C::Media);
+	set_key(t, 0xAF, "Volume up", C::Media);
+	set_key(t, 0xB0, "Next track", C::Media);
+	set_key(t, 0xB1, "Previous track", C::Media);
+	set_key(t, 0xB2, "Stop media", C::Media);
+	set_key(t, 0xB3, "Play/Pause", C::Media);
+	set_key(t, 0xB4, "Mail", C::Media);
+	set_key(t, 0xB5, "Select media", C::Media);
+	set_key(t, 0xB6, "App 1", C::Media);
+	set_key(t, 0xB7, "App 2", C::Media);
+
+	set_key(t, VK_OEM_1, ";", C::Punctuation, F::Right_Pinky, R::Home);
+	set_key(t, VK_OEM_PLUS, "=", C::Punctuation, F::Right_Pinky, R::Number);
+	set_key(t, VK_OEM_COMMA, ",", C::Punctuation, F::Right_Middle, R::Bottom);
+	set_key(t, VK_OEM_MINUS, "-", C::Punctuation, F::Right_Pinky, R::Number);
+	set_key(t, VK_OEM_PERIOD, ".", C::Punctuation, F::Right_Ring, R::Bottom);
+	set_key(t, VK_OEM_2, "/", C::Punctuation, F::Right_Pinky, R::Bottom);
+	set_key(t, VK_OEM_3, "`", C::Punctuation, F::Left_Pinky, R::Number);
+	set_key(t, VK_OEM_4, "[", C::Punctuation, F::Right_Pinky, R::Top);
+	set_key(t, VK_OEM_5, "\\", C::Punctuation, F::Right_Pinky, R::Top);
+	set_key(t, VK_OEM_6, "]", C::Punctuation, F::Right_Pinky, R::Top);
+	set_key(t, VK_OEM_7, "'", C::Punctuation, F::Right_Pinky, R::Home);
+	set_key(t, VK_OEM_8, "OEM 8", C::Punctuation);
+	set_key(t, VK_OEM_102, "\\ (ISO)", C::Punctuation, F::Left_Pinky, R::Bottom);
+
+	set_key(t, 0xE5, "IME process", C::Ime);
+	set_key(t, 0xE7, "Packet", C::System);
+	set_key(t, 0xF6, "Attn", C::System);
+	set_key(t, 0xF7, "CrSel", C::System);
+	set_key(t, 0xF8, "ExSel", C::System);
+	set_key(t, 0xF9, "Erase EOF", C::System);
+	set_key(t, VK_PLAY, "Play", C::Media);
+	set_key(t, VK_ZOOM, "Zoom", C::Media);
+	set_key(t, 0xFD, "PA1", C::System);
+	set_key(t, 0xFE, "Clear", C::Editing);
+	return t;
+}
+
+// The french layout (kbdfr), the names are in utf-8 like the rest of the ui.
+constexpr KeyOverride Azerty_Keys[] = {
+	{ 'A', "A", Finger::Left_Pinky, KeyRow::Top },
+	{ 'Z', "Z", Finger::Left_Ring, KeyRow::Top },
+	{ 'Q', "Q", Finger::Left_Pinky, KeyRow::Home },
+	{ 'M', "M", Finger::Right_Pinky, KeyRow::Home },
+	{ 'W', "W", Finger::Left_Pinky, KeyRow::Bottom },
+	{ '1', "1 &", Finger::Left_Pinky, KeyRow::Number },
+	{ '2', "2 \xC3\xA9", Finger::Left_Ring, KeyRow::Number }, // 2 é
+	{ '3', "3 \"", Finger::Left_Middle, KeyRow::Number },
+	{ '4', "4 '", Finger::Left_Index, KeyRow::Number },
+	{ '5', "5 (", Finger::Left_Index, KeyRow::Number },
+	{ '6', "6 -", Finger::Right_Index, KeyRow::Number },
+	{ '7', "7 \xC3\xA8", Finger::Right_Index, KeyRow::Number }, // 7 è
+	{ '8', "8 _", Finger::Right_Middle, KeyRow::Number },
+	{ '9', "9 \xC3\xA7", Finger::Right_Ring, KeyRow::Number }, // 9 ç
+	{ '0', "0 \xC3\xA0", Finger::Right_Pinky, KeyRow::Number }, // 0 à
+	{ VK_OEM_7, "\xC2\xB2", Finger::Left_Pinky, KeyRow::Number }, // ²
+	{ VK_OEM_4, ")", Finger::Right_Pinky, KeyRow::Number },
+	{ VK_OEM_PLUS, "=", Finger::Right_Pinky, KeyRow::Number },
+	{ VK_OEM_6, "^", Finger::Right_Pinky, KeyRow::Top },
+	{ VK_OEM_1, "$", Finger::Right_Pinky, KeyRow::Top },
+	{ VK_OEM_3, "\xC3\xB9", Finger::Right_Pinky, KeyRow::Home }, // ù
+	{ VK_OEM_5, "*", Finger::Right_Pinky, KeyRow::Home },
+	{ VK_OEM_102, "<", Finger::Left_Pinky, KeyRow::Bottom },
+	{ VK_OEM_COMMA, ",", Finger::Right_Index, KeyRow::Bottom },
+	{ VK_OEM_PERIOD, ";", Finger::Right_Middle, KeyRow::Bottom },
+	{ VK_OEM_2, ":", Finger::Right_Ring, KeyRow::Bottom },
+	{ VK_OEM_8, "!", Finger::Right_Pinky, KeyRow::Bottom },
+	{ VK_RMENU, "AltGr", Finger::Thumb, KeyRow::Space },
+};
+
+// The german layout (kbdgr).
+constexpr KeyOverride Qwertz_Keys[] = {
+	{ 'Z', "Z", Finger::Right_Index, KeyRow::Top },
+	{ 'Y', "Y", Finger::Left_Pinky, KeyRow::Bottom },
+	{ VK_OEM_5, "^", Finger::Left_Pinky, KeyRow::Number },
+	{ VK_OEM_4, "\xC3\x9F", Finger::Right_Pinky, KeyRow::Number }, // ß
+	{ VK_OEM_6, "\xC2\xB4", Finger::Right_Pinky, KeyRow::Number }, // ´
+	{ VK_OEM_1, "\xC3\x9C", Finger::Right_Pinky, KeyRow::Top }, // Ü
+	{ VK_OEM_PLUS, "+", Finger::Right_Pinky, KeyRow::Top },
+	{ VK_OEM_3, "\xC3\x96", Finger::Right_Pinky, KeyRow::Home }, // Ö
+	{ VK_OEM_7, "\xC3\x84", Finger::Right_Pinky, KeyRow::Home }, // Ä
+	{ VK_OEM_2, "#", Finger::Right_Pinky, KeyRow::Home },
+	{ VK_OEM_102, "<", Finger::Left_Pinky, KeyRow::Bottom },
+	{ VK_OEM_MINUS, "-", Finger::Right_Pinky, KeyRow::Bottom },
+	{ VK_RMENU, "AltGr", Finger::Thumb, KeyRow::Space },
+};
+
+template<size_t N>
+constexpr KeyTable make_key_table(const KeyOverride (&keys)[N]) noexcept {
+	auto t = make_base_key_table();
+	for (auto& x : keys) {
+		t[x.code].name = x.name;
+		t[x.code].finger = x.finger;
+		t[x.code].row = x.row;
+	}
+	return t;
+}
+
+inline constexpr std::array<KeyTable, (size_t)KeyboardLayout::Count> Key_Tables = {
+	make_base_key_table(),
+	make_key_table(Azerty_Keys),
+	make_key_table(Qwertz_Keys),
+};
+
+[[nodiscard]] constexpr const KeyInfo& key_info(
+	std::uint8_t key_code, KeyboardLayout layout
+) noexcept {
+	return Key_Tables[(size_t)layout < Key_Tables.size() ? (size_t)layout : 0][key_code];
+}
+[[nodiscard]] constexpr std::string_view key_name(
+	std::uint8_t key_code, KeyboardLayout layout
+) noexcept {
+	return key_info(key_code, layout).name;
+}
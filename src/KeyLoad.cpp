@@ -0,0 +1,119 @@
+#include "KeyLoad.hpp"
+
+#include "ByteStream.hpp"
+
+bool KeyBigrams::add(std::uint8_t key_code, std::uint64_t timestamp) noexcept {
+	bool pair = last_at && timestamp >= last_at && timestamp - last_at <= Gap_Ms;
+	if (pair) {
+		if (counts.empty()) counts.resize(N_Keys * N_Keys);
+		counts[last_key * N_Keys + key_code]++;
+		n_bigrams++;
+	}
+	last_key = key_code;
+	last_at = timestamp;
+	return pair;
+}
+
+// u32 N_Keys, u32 n pairs used then per pair u16 index in counts and u32 count. A few thousand
+// pairs are ever typed out of the 65536.
+void KeyBigrams::save(std::vector<std::byte>& bytes) const noexcept {
+	size_t n_used = 0;
+	for (auto x : counts) n_used += x != 0;
+
+	ByteWriter writer{ bytes };
+	writer.reserve(8 + 6 * n_used);
+	writer.write((std::uint32_t)N_Keys);
+	writer.write((std::uint32_t)n_used);
+	for (size_t i = 0; i < counts.size(); ++i) if (counts[i]) {
+		writer.write((std::uint16_t)i);
+		writer.write(counts[i]);
+	}
+}
+
+[[nodiscard]] bool KeyBigrams::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(8) || reader.read<std::uint32_t>() != N_Keys) return false;
+
+	auto n_used = reader.read<std::uint32_t>();
+	if (!reader.can_read(6 * (size_t)n_used)) return false;
+
+	KeyBigrams loaded;
+	if (n_used > 0) loaded.counts.resize(N_Keys * N_Keys);
+	for (size_t i = 0; i < n_used; ++i) {
+		auto idx = reader.read<std::uint16_t>();
+		auto n = reader.read<std::uint32_t>();
+		loaded.counts[idx] = n;
+		loaded.n_bigrams += n;
+	}
+
+	*this = std::move(loaded);
+	return true;
+}
+
+void KeyLoad::add_key(std::uint8_t key_code, std::uint64_t n) noexcept {
+	auto& info = key_info(key_code, layout);
+	fingers[(size_t)info.finger] += n;
+	rows[(size_t)info.row] += n;
+}
+
+void KeyLoad::add_bigram(std::uint8_t first, std::uint8_t second, std::uint64_t n) noexcept {
+	auto a = key_info(first, layout).finger;
+	auto b = key_info(second, layout).finger;
+	if (a == Finger::None || b == Finger::None) return;
+
+	if (a == b && first != second) same_finger += n;
+
+	auto hand_a = hand_of(a);
+	auto hand_b = hand_of(b);
+	if (hand_a == Hand::None || hand_b == Hand::None) return;
+	if (hand_a != hand_b) alternations += n;
+	else                  same_hand += n;
+}
+
+void KeyLoad::add(std::uint8_t key_code, std::uint64_t timestamp) noexcept {
+	auto previous = bigrams.last_key;
+	add_key(key_code, 1);
+	if (bigrams.add(key_code, timestamp)) add_bigram(previous, key_code, 1);
+}
+
+void KeyLoad::set_layout(KeyboardLayout x, const std::array<size_t, 0xff>& key_times) noexcept {
+	layout = x;
+	fingers = {};
+	rows = {};
+	same_finger = 0;
+	alternations = 0;
+	same_hand = 0;
+
+	for (size_t i = 0; i < key_times.size(); ++i) {
+		if (key_times[i]) add_key((std::uint8_t)i, key_times[i]);
+	}
+	for (size_t i = 0; i < bigrams.counts.size(); ++i) if (bigrams.counts[i]) {
+		auto first = (std::uint8_t)(i / KeyBigrams::N_Keys);
+		auto second = (std::uint8_t)(i % KeyBigrams::N_Keys);
+		add_bigram(first, second, bigrams.counts[i]);
+	}
+}
+
+void KeyLoad::clear() noexcept {
+	auto x = layout;
+	*this = {};
+	layout = x;
+}
+
+std::uint64_t KeyLoad::hand_keys(Hand hand) const noexcept {
+	std::uint64_t n = 0;
+	for (size_t i = 0; i < fingers.size(); ++i) if (hand_of((Finger)i) == hand) n += fingers[i];
+	return n;
+}
+
+double KeyLoad::alternation_rate() const noexcept {
+	auto n = alternations + same_hand;
+	return n ? alternations / (double)n : 0;
+}
+
+double KeyLoad::same_finger_rate() const noexcept {
+	return bigrams.n_bigrams ? same_finger / (double)bigrams.n_bigrams : 0;
+}
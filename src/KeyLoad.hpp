@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "KeyLayout.hpp"
+
+// The pairs of keys typed one after the other, by key code. They don't depend on the layout, the
+// load of any layout can be computed from them again.
+struct KeyBigrams {
+	static constexpr size_t N_Keys = 256;
+	// Two keys further apart are not typed in the same move, same as the bursts of the typing.
+	static constexpr std::uint64_t Gap_Ms = 1'000;
+
+	// By first key * N_Keys + second key, empty until the first pair.
+	std::vector<std::uint32_t> counts;
+	std::uint64_t n_bigrams{ 0 };
+	std::uint8_t last_key{ 0 };
+	std::uint64_t last_at{ 0 }; // ms since epoch, 0 if no key yet.
+
+	// Returns true if the key made a pair with the previous one.
+	bool add(std::uint8_t key_code, std::uint64_t timestamp) noexcept;
+
+	[[nodiscard]] std::uint32_t count(std::uint8_t first, std::uint8_t second) const noexcept {
+		return counts.empty() ? 0 : counts[first * N_Keys + second];
+	}
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+};
+
+enum class Hand : std::uint8_t {
+	None = 0,
+	Left,
+	Right,
+};
+// The thumbs type the space with either hand, they have none.
+[[nodiscard]] constexpr Hand hand_of(Finger finger) noexcept {
+	if (finger >= Finger::Left_Pinky && finger <= Finger::Left_Index) return Hand::Left;
+	if (finger >= Finger::Right_Index && finger <= Finger::Right_Pinky) return Hand::Right;
+	return Hand::None;
+}
+
+// Where the keys land on the hands with the fingers of a layout. The counters follow each key in
+// O(1), a change of layout recomputes them from the key counts and the bigrams.
+struct KeyLoad {
+	KeyboardLayout layout{ KeyboardLayout::Qwerty };
+	KeyBigrams bigrams;
+
+	std::array<std::uint64_t, (size_t)Finger::Count> fingers{}; // keys by finger.
+	std::array<std::uint64_t, (size_t)KeyRow::Count> rows{}; // keys by row.
+	// Bigrams of two different keys of the same finger, the repeats of a key are not.
+	std::uint64_t same_finger{ 0 };
+	// Bigrams of two keys that have a hand, typed with both or with one.
+	std::uint64_t alternations{ 0 };
+	std::uint64_t same_hand{ 0 };
+
+	void add(std::uint8_t key_code, std::uint64_t timestamp) noexcept;
+	// key_times are the counters of the state.
+	void set_layout(KeyboardLayout x, const std::array<size_t, 0xff>& key_times) noexcept;
+	void clear() noexcept;
+
+	[[nodiscard]] std::uint64_t hand_keys(Hand hand) const noexcept;
+	// Of the bigrams with a hand on both keys, 0 if none yet.
+	[[nodiscard]] double alternation_rate() const noexcept;
+	[[nodiscard]] double same_finger_rate() const noexcept;
+
+private:
+	void add_key(std::uint8_t key_code, std::uint64_t n) noexcept;
+	void add_bigram(std::uint8_t first, std::uint8_t second, std::uint64_t n) noexcept;
+};
@@ -0,0 +1,225 @@
+#include "KeyPostings.hpp"
+
+#include <cerrno>
+
+#include "ByteStream.hpp"
+
+// The size of the varint at src, 0 if it doesn't end before end.
+static size_t varint_size(const std::uint8_t* src, const std::uint8_t* end) noexcept {
+	for (auto it = src; it < end; ++it) if (!(*it & 0x80)) return it - src + 1;
+	return 0;
+}
+static std::int64_t read_delta(const std::uint8_t* src, size_t n) noexcept {
+	std::uint64_t z = 0;
+	for (size_t i = 0; i < n && i < 10; ++i) z |= (std::uint64_t)(src[i] & 0x7f) << (7 * i);
+	return (std::int64_t)((z >> 1) ^ (0 - (z & 1)));
+}
+
+static void append_delta(std::vector<std::uint8_t>& out, std::int64_t delta) noexcept {
+	auto z = ((std::uint64_t)delta << 1) ^ (std::uint64_t)(delta >> 63);
+	while (z >= 0x80) {
+		out.push_back((std::uint8_t)(z | 0x80));
+		z >>= 7;
+	}
+	out.push_back((std::uint8_t)z);
+}
+
+void KeyPostings::add(std::uint8_t key, std::uint64_t timestamp) noexcept {
+	if (key >= N_Keys) return;
+	auto& list = lists[key];
+
+	if (list.count == 0) list.first = timestamp;
+	append_delta(list.deltas, (std::int64_t)(timestamp - list.last));
+	list.last = timestamp;
+	list.count++;
+}
+
+void KeyPostings::append(const KeyPostings& other) noexcept {
+	for (size_t key = 0; key < N_Keys; ++key) {
+		other.for_each((std::uint8_t)key, [&](std::uint64_t t) { add((std::uint8_t)key, t); });
+	}
+}
+
+bool KeyPostings::drop_before(std::uint64_t cutoff) noexcept {
+	bool dropped = false;
+	for (size_t key = 0; key < N_Keys; ++key) {
+		auto& list = lists[key];
+		if (list.count == 0 || list.first >= cutoff) continue;
+
+		List kept;
+		for_each((std::uint8_t)key, [&](std::uint64_t t) {
+			if (t < cutoff) return;
+			if (kept.count == 0) kept.first = t;
+			append_delta(kept.deltas, (std::int64_t)(t - kept.last));
+			kept.last = t;
+			kept.count++;
+		});
+		dropped |= kept.count != list.count;
+		list = std::move(kept);
+	}
+	return dropped;
+}
+
+size_t KeyPostings::memory_size() const noexcept {
+	size_t size = sizeof(*this);
+	for (auto& x : lists) size += x.deltas.capacity();
+	return size;
+}
+
+// u32 number of lists, then for each u64 first, u64 last, u32 count, u32 size and the deltas.
+void KeyPostings::save(std::vector<std::byte>& bytes) const noexcept {
+	size_t size = 4;
+	for (auto& x : lists) size += 24 + x.deltas.size();
+
+	ByteWriter writer{ bytes };
+	writer.reserve(size);
+	writer.write((std::uint32_t)N_Keys);
+	for (auto& x : lists) {
+		writer.write(x.first);
+		writer.write(x.last);
+		writer.write((std::uint32_t)x.count);
+		writer.write((std::uint32_t)x.deltas.size());
+		writer.write_bytes(x.deltas.data(), x.deltas.size());
+	}
+}
+
+[[nodiscard]] bool KeyPostings::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(4) || reader.read<std::uint32_t>() != N_Keys) return false;
+
+	std::array<List, N_Keys> loaded;
+	for (auto& x : loaded) {
+		if (!reader.can_read(24)) return false;
+		x.first = reader.read<std::uint64_t>();
+		x.last = reader.read<std::uint64_t>();
+		x.count = reader.read<std::uint32_t>();
+		auto n = reader.read<std::uint32_t>();
+		if (!reader.can_read(n)) return false;
+		x.deltas.resize(n);
+		reader.read_bytes(x.deltas.data(), n);
+	}
+
+	lists = std::move(loaded);
+	return true;
+}
+
+// The first timestamp of the deltas of a list in a file at or after cutoff: how many came before
+// it, the byte after its delta and itself. The deltas are read a block at a time.
+static int find_kept(
+	const std::filesystem::path& path,
+	std::uint64_t offset,
+	size_t size,
+	std::uint64_t cutoff,
+	KeyPostings::Cursor& kept
+) noexcept {
+	std::vector<std::byte> block;
+	size_t at = 0;
+	std::uint64_t t = 0;
+	size_t index = 0;
+	while (at < size) {
+		auto n = (std::min)(size - at, FileParts::File_Copy_Block);
+		block.clear();
+		if (auto err = file_read_range(path, offset + at, n, block)) return err;
+
+		auto begin = (const std::uint8_t*)block.data();
+		auto it = begin;
+		auto end = begin + n;
+		while (auto m = varint_size(it, end)) {
+			t += read_delta(it, m);
+			it += m;
+			if (t >= cutoff) {
+				kept = { at + (size_t)(it - begin), index, t };
+				return 0;
+			}
+			index++;
+		}
+		// A delta cut by the block is read again with the next one.
+		if (it == begin) return EINVAL;
+		at += it - begin;
+	}
+
+	kept = { size, index, 0 };
+	return 0;
+}
+
+int KeyPostings::save_after(
+	const std::filesystem::path& path,
+	std::uint64_t offset,
+	size_t size,
+	std::uint64_t cutoff,
+	FileParts& out
+) const noexcept {
+	constexpr size_t Header_Size = 24;
+	constexpr size_t Max_Varint = 10;
+	auto end = offset + size;
+
+	std::vector<std::byte> bytes;
+	if (size < 4) return EINVAL;
+	if (auto err = file_read_range(path, offset, 4, bytes)) return err;
+	if (load_le<std::uint32_t>(bytes.data()) != N_Keys) return EINVAL;
+	ByteWriter{ out.bytes() }.write((std::uint32_t)N_Keys);
+
+	auto at = offset + 4;
+	for (auto& list : lists) {
+		if (at + Header_Size > end) return EINVAL;
+		auto n_head = (size_t)(std::min<std::uint64_t>)(Header_Size + Max_Varint, end - at);
+		bytes.clear();
+		if (auto err = file_read_range(path, at, n_head, bytes)) return err;
+		auto first = load_le<std::uint64_t>(bytes.data());
+		auto last = load_le<std::uint64_t>(bytes.data() + 8);
+		size_t count = load_le<std::uint32_t>(bytes.data() + 16);
+		size_t n = load_le<std::uint32_t>(bytes.data() + 20);
+		auto deltas = at + Header_Size;
+		if (deltas + n > end) return EINVAL;
+		at = deltas + n;
+
+		// The timestamps of the file from kept on, the first one most of the time.
+		Cursor kept{ 0, count, 0 };
+		if (count > 0 && first >= cutoff) {
+			auto head = (const std::uint8_t*)bytes.data() + Header_Size;
+			auto m = varint_size(head, head + (std::min)(n, n_head - Header_Size));
+			if (m == 0) return EINVAL;
+			kept = { m, 0, first };
+		}
+		else if (count > 0) {
+			if (auto err = find_kept(path, deltas, n, cutoff, kept)) return err;
+		}
+		auto n_kept = count - (std::min)(kept.index, count);
+
+		// The first delta of a list is from 0, once moved after other timestamps it's redone.
+		List head;
+		if (n_kept) {
+			append_delta(head.deltas, (std::int64_t)kept.timestamp);
+			head.first = kept.timestamp;
+			head.last = last;
+		}
+		List tail;
+		size_t rest = 0;
+		if (list.count) {
+			auto begin = list.deltas.data();
+			rest = varint_size(begin, begin + list.deltas.size());
+			append_delta(tail.deltas, (std::int64_t)(list.first - head.last));
+			if (!n_kept) head.first = list.first;
+			head.last = list.last;
+		}
+		auto n_copied = n_kept ? n - kept.byte : 0;
+
+		ByteWriter writer{ out.bytes() };
+		writer.write(head.first);
+		writer.write(head.last);
+		writer.write((std::uint32_t)(n_kept + list.count));
+		writer.write((std::uint32_t)(
+			head.deltas.size() + n_copied + tail.deltas.size() + list.deltas.size() - rest
+		));
+		writer.write_bytes(head.deltas.data(), head.deltas.size());
+		out.copy(path, deltas + kept.byte, n_copied);
+
+		ByteWriter after{ out.bytes() };
+		after.write_bytes(tail.deltas.data(), tail.deltas.size());
+		after.write_bytes(list.deltas.data() + rest, list.deltas.size() - rest);
+	}
+	return 0;
+}
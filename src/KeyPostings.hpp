@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "file.hpp"
+
+// For each key code the timestamps (ms since epoch) of its entries, in the order they came, so
+// the history of one key is read without going through the entries of all the others. Each
+// timestamp is stored as the zigzag varint of its delta with the previous one of the same key:
+// 1 or 2 bytes for a key in use, against the 9 of an entry.
+// The deltas are signed so a clock going backward costs a few bytes but loses nothing.
+struct KeyPostings {
+	static constexpr size_t N_Keys = 255;
+
+	struct List {
+		std::vector<std::uint8_t> deltas;
+		std::uint64_t first{ 0 };
+		std::uint64_t last{ 0 };
+		size_t count{ 0 };
+	};
+	std::array<List, N_Keys> lists;
+
+	void add(std::uint8_t key, std::uint64_t timestamp) noexcept;
+
+	// Where a decoding of one list stopped, to go on from there once more timestamps came.
+	struct Cursor {
+		size_t byte{ 0 };
+		size_t index{ 0 };
+		std::uint64_t timestamp{ 0 };
+	};
+
+	// Calls f(timestamp) for each entry of key after the cursor, in order, and moves it past them.
+	template<typename F>
+	void for_each_from(std::uint8_t key, Cursor& cursor, F&& f) const noexcept {
+		if (key >= N_Keys) return;
+		auto& list = lists[key];
+		auto it = list.deltas.data() + cursor.byte;
+		auto end = list.deltas.data() + list.deltas.size();
+		while (it < end) {
+			std::uint64_t z = 0;
+			for (unsigned shift = 0; it < end && shift < 64; shift += 7) {
+				auto byte = *it++;
+				z |= (std::uint64_t)(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) break;
+			}
+			cursor.timestamp += (z >> 1) ^ (0 - (z & 1));
+			cursor.index++;
+			f(cursor.timestamp);
+		}
+		cursor.byte = list.deltas.size();
+	}
+
+	// Calls f(timestamp) for each entry of key, in order.
+	template<typename F>
+	void for_each(std::uint8_t key, F&& f) const noexcept {
+		Cursor cursor;
+		for_each_from(key, cursor, f);
+	}
+
+	// Adds the timestamps of other after the ones of each key.
+	void append(const KeyPostings& other) noexcept;
+
+	// Drops the timestamps before cutoff, as a compaction drops the entries. Returns true if
+	// any was.
+	bool drop_before(std::uint64_t cutoff) noexcept;
+
+	[[nodiscard]] size_t memory_size() const noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+	// What save writes after a load of the size bytes of path at offset, dropping the timestamps
+	// of each list up to its first one at or after cutoff as a compaction drops the entries, then
+	// an append of this. Only the list headers and the dropped deltas are read, the others are
+	// copied. Returns an errno.
+	[[nodiscard]] int save_after(
+		const std::filesystem::path& path,
+		std::uint64_t offset,
+		size_t size,
+		std::uint64_t cutoff,
+		FileParts& out
+	) const noexcept;
+};
@@ -1,79 +1,196 @@
 #include "Logs.hpp"
 
 #include "Common.hpp"
+#include "TimeInfo.hpp"
+
+#include <optional>
 
 #include "imgui.h"
 
-void Logs::lock_and_write(const std::string& str) noexcept {
-	std::lock_guard{ mutex };
-	list.push_back(str);
+[[nodiscard]] const char* log_tag_name(LogTag tag) noexcept {
+	switch (tag) {
+	case LogTag::Info:   return "INFO";
+	case LogTag::Perf:   return "PERF";
+	case LogTag::FileIO: return "FILE";
+	default:             return "????";
+	}
+}
+
+void LogRecord::push_arg(const char* str, size_t size) noexcept {
+	if (size > Text_Size - text_size) size = Text_Size - text_size;
+	memcpy(text + text_size, str, size);
+
+	Arg arg;
+	arg.type = Arg::Type::Text;
+	arg.text.offset = text_size;
+	arg.text.size = (std::uint16_t)size;
+	args[n_args++] = arg;
 
-	LogEntry new_entry;
-	new_entry.message = str;
-	new_entry.tag.push_back("OLD");
-	entries.push_back(new_entry);
+	text_size += (std::uint16_t)size;
 }
-void Logs::lock_and_write(LogEntry entry) noexcept {
-	std::lock_guard{ mutex };
-	entries.push_back(entry);
+
+[[nodiscard]] std::string format_log_record(const LogRecord& record) noexcept {
+	std::string line = "[";
+	line += log_tag_name(record.tag);
+	line += "] ";
+
+	size_t arg_idx = 0;
+	for (auto c = record.format; *c; ++c) {
+		if (c[0] != '{' || c[1] != '}') {
+			line.push_back(*c);
+			continue;
+		}
+		++c;
+
+		if (arg_idx >= record.n_args) continue;
+		auto& arg = record.args[arg_idx++];
+
+		char buffer[32];
+		switch (arg.type) {
+		case LogRecord::Arg::Type::Int:
+			line += std::to_string(arg.i);
+			break;
+		case LogRecord::Arg::Type::Uint:
+			line += std::to_string(arg.u);
+			break;
+		case LogRecord::Arg::Type::Double:
+			snprintf(buffer, sizeof(buffer), "%g", arg.d);
+			line += buffer;
+			break;
+		case LogRecord::Arg::Type::Text:
+			line.append(record.text + arg.text.offset, arg.text.size);
+			break;
+		}
+	}
+
+	if (record.suppressed > 0) {
+		line += " (" + std::to_string(record.suppressed) + " similar suppressed)";
+	}
+	return line;
 }
-void Logs::lock_and_write(ErrorDescription error) noexcept {
-	std::lock_guard{ mutex };
-	errors.push_back(error);
+
+// Finds the site of the record and checks its budget for the current second. The counters are
+// updated without a lock so it's approximate when two threads log the same site at the same
+// time, that's fine for a rate limit.
+[[nodiscard]] bool Logs::rate_limit(LogRecord& record) noexcept {
+	auto start = (size_t)((std::uintptr_t)record.format >> 3) % N_Sites;
+	for (size_t i = 0; i < N_Sites; ++i) {
+		auto& site = sites[(start + i) % N_Sites];
+
+		auto format = site.format.load(std::memory_order_relaxed);
+		if (format == nullptr) site.format.compare_exchange_strong(format, record.format);
+		if (format != nullptr && format != record.format) continue;
+
+		auto second = record.timestamp / 1'000;
+		if (site.second.exchange(second, std::memory_order_relaxed) != second) {
+			site.count.store(0, std::memory_order_relaxed);
+		}
+		if (site.count.fetch_add(1, std::memory_order_relaxed) >= Max_Per_Second) {
+			site.suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		record.suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+		return true;
+	}
+
+	// The table is full, we just don't limit the newcomers.
+	return true;
 }
 
-void Logs::lock_and_clear() noexcept {
-	std::lock_guard{ mutex };
-	list.clear();
-	entries.clear();
+void Logs::push(LogRecord& record) noexcept {
+	record.timestamp = get_milliseconds_epoch();
+	if (!rate_limit(record)) return;
+
+	auto index = next.fetch_add(1, std::memory_order_acq_rel);
+	auto& slot = slots[index % Capacity];
+
+	slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.record = record;
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+[[nodiscard]] std::uint64_t Logs::head() const noexcept {
+	return next.load(std::memory_order_acquire);
+}
+
+[[nodiscard]] std::uint64_t Logs::read(
+	std::uint64_t from, std::vector<LogRecord>& out
+) const noexcept {
+	auto end = head();
+	if (end > Capacity && from < end - Capacity) from = end - Capacity;
+
+	for (; from < end; ++from) {
+		auto& slot = slots[from % Capacity];
+
+		auto sequence = slot.sequence.load(std::memory_order_acquire);
+		// Still being written, we will get it next time.
+		if (sequence < 2 * from + 2) break;
+		// Already overwritten.
+		if (sequence > 2 * from + 2) continue;
+
+		LogRecord copy = slot.record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+		out.push_back(copy);
+	}
+
+	return from;
+}
+
+void Logs::lock_and_write(ErrorDescription error) noexcept {
+	std::lock_guard lock{ mutex };
+	errors.push_back(std::move(error));
+	if (errors.size() > Max_Errors) errors.pop_front();
 }
 
 void LogWindow::render(Logs& l) noexcept {
 	if (!open) return;
 
+	new_records.clear();
+	cursor = l.read(cursor, new_records);
+	for (auto& x : new_records) lines.push_back(format_log_record(x));
+	while (lines.size() > Logs::Capacity) lines.pop_front();
+
 	ImGui::Begin("Log", &open);
 	defer{ ImGui::End(); };
 
 	auto window_width = ImGui::GetWindowContentRegionWidth();
 	ImGui::BeginChild("Text", { window_width / 2, 0 });
 
-	ImGui::Text("Text: %zu -----", l.entries.size());
+	ImGui::Text("Text: %zu -----", lines.size());
 	ImGui::Columns(2);
-	for (size_t i = l.entries.size() - 1; i + 1 > 0; --i) {
-		ImGui::PushID(i);
-		defer{ ImGui::PopID(); };
-
-		auto& x = l.entries[i];
-		std::string line;
-
-		if (!x.tag.empty()) {
-			std::string tag_string = "[";
-			for (auto t : x.tag) {
-				tag_string += t + ", ";
-			}
-			tag_string.pop_back();
-			tag_string.back() = ']';
-			line += tag_string + ' ';
-		}
-
-		line += x.message;
-		ImGui::Text("%s", line.c_str());
-		ImGui::NextColumn();
-		if (ImGui::Button("X")) {
-			l.entries.erase(std::begin(l.entries) + i);
+	std::optional<size_t> to_erase;
+	ImGuiListClipper entries_clipper((int)lines.size());
+	while (entries_clipper.Step()) {
+		for (int j = entries_clipper.DisplayStart; j < entries_clipper.DisplayEnd; ++j) {
+			// Newest first.
+			size_t i = lines.size() - 1 - j;
+			ImGui::PushID(i);
+			defer{ ImGui::PopID(); };
+
+			ImGui::TextUnformatted(lines[i].c_str());
+			ImGui::NextColumn();
+			if (ImGui::Button("X")) to_erase = i;
+			ImGui::NextColumn();
 		}
-		ImGui::NextColumn();
 	}
+	if (to_erase) lines.erase(std::begin(lines) + *to_erase);
 	ImGui::Columns(1);
 	ImGui::EndChild();
 
 	ImGui::SameLine();
 	
 	ImGui::BeginChild("Error", { window_width / 2, 0 });
+	std::lock_guard lock{ l.mutex };
 
 	ImGui::Text("Errors: %zu -----", l.errors.size());
 	ImGui::Columns(3);
-	for (size_t i = l.errors.size() - 1; i + 1 > 0; --i) {
+	std::optional<size_t> error_to_erase;
+	ImGuiListClipper errors_clipper((int)l.errors.size());
+	while (errors_clipper.Step()) for (int j = errors_clipper.DisplayStart; j < errors_clipper.DisplayEnd; ++j) {
+		size_t i = l.errors.size() - 1 - j;
 		ImGui::PushID(i);
 		defer{ ImGui::PopID(); };
 
@@ -101,7 +218,7 @@ void LogWindow::render(Logs& l) noexcept {
 		}
 		ImGui::NextColumn();
 		if (ImGui::Button("X")) {
-			l.errors.erase(std::begin(l.errors) + i);
+			error_to_erase = i;
 		}
 		ImGui::NextColumn();
 		if (ImGui::BeginPopup("Complete")) {
@@ -114,6 +231,7 @@ void LogWindow::render(Logs& l) noexcept {
 			ImGui::Text("Location %s.\n%s", x.location.c_str(), x.message.c_str());
 		}
 	}
+	if (error_to_erase) l.errors.erase(std::begin(l.errors) + *error_to_erase);
 	ImGui::Columns(1);
 	ImGui::EndChild();
 }
@@ -1,7 +1,13 @@
 #pragma once
 #include <mutex>
+#include <deque>
+#include <atomic>
+#include <array>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 struct ErrorDescription {
 	std::string quick_desc;
@@ -17,30 +23,131 @@ struct ErrorDescription {
 	} type;
 };
 
-struct LogEntry {
-	std::vector<std::string> tag;
-	std::string message;
+enum class LogTag : std::uint8_t {
+	Info,
+	Perf,
+	FileIO,
+	Count
+};
+[[nodiscard]] extern const char* log_tag_name(LogTag tag) noexcept;
+
+// A log line, not formatted. format must be a string literal, its address identifies the call
+// site. Each {} in it is replaced by the next argument when the record is formatted.
+struct LogRecord {
+	static constexpr size_t Max_Args = 4;
+	static constexpr size_t Text_Size = 96;
+
+	struct Arg {
+		enum class Type : std::uint8_t { Int, Uint, Double, Text } type;
+		union {
+			std::int64_t i;
+			std::uint64_t u;
+			double d;
+			struct { std::uint16_t offset; std::uint16_t size; } text; // in LogRecord::text.
+		};
+	};
+
+	std::uint64_t timestamp{ 0 }; // ms since epoch.
+	const char* format{ nullptr };
+	LogTag tag{ LogTag::Info };
+	std::uint8_t n_args{ 0 };
+	std::uint16_t text_size{ 0 };
+	std::uint32_t suppressed{ 0 }; // records of the same site dropped just before this one.
+	Arg args[Max_Args];
+	char text[Text_Size]; // string arguments are copied here, truncated if they don't fit.
+
+	void push_arg(const char* str, size_t size) noexcept;
+	template<typename T>
+	void push_arg(const T& x) noexcept {
+		Arg arg;
+		if constexpr (std::is_floating_point_v<T>) {
+			arg.type = Arg::Type::Double;
+			arg.d = (double)x;
+		}
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+			arg.type = Arg::Type::Int;
+			arg.i = (std::int64_t)x;
+		}
+		else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+			arg.type = Arg::Type::Uint;
+			arg.u = (std::uint64_t)x;
+		}
+		else if constexpr (std::is_convertible_v<const T&, const char*>) {
+			const char* str = x;
+			return push_arg(str, strlen(str));
+		}
+		else {
+			return push_arg(x.data(), x.size());
+		}
+		args[n_args++] = arg;
+	}
 };
+[[nodiscard]] extern std::string format_log_record(const LogRecord& record) noexcept;
 
+// Fixed capacity ring of LogRecord, any thread can write in it without locking or allocating,
+// the oldest records are overwritten. Each slot has a sequence number so a reader can tell if
+// the record it copied was overwritten in the meantime.
+// A site writing more than Max_Per_Second records per second gets dropped, the next record that
+// goes through carries how many were suppressed.
 struct Logs {
-	std::vector<ErrorDescription> errors;
-	std::vector<LogEntry> entries;
+	static constexpr size_t Capacity = 1024;
+	static constexpr size_t Max_Errors = 256;
+	static constexpr size_t N_Sites = 128;
+	static constexpr std::uint32_t Max_Per_Second = 5;
 
-	std::vector<std::string> list;
+	// The errors are rare, they come from the file io and the registry, and hold strings anyway
+	// so a mutex is fine.
+	std::deque<ErrorDescription> errors;
 	std::mutex mutex;
 	bool show{ false };
 
+	template<typename... Args>
+	void write(LogTag tag, const char* format, const Args&... args) noexcept {
+		static_assert(sizeof...(Args) <= LogRecord::Max_Args, "Too many arguments to log.");
 
-	void lock_and_clear() noexcept;
-	void lock_and_write(const std::string& str) noexcept;
-	void lock_and_write(LogEntry entry) noexcept;
+		LogRecord record;
+		record.tag = tag;
+		record.format = format;
+		(record.push_arg(args), ...);
+		push(record);
+	}
 	void lock_and_write(ErrorDescription error) noexcept;
+
+	// Index of the next record to be written, all the records before it that are not overwritten
+	// can be read.
+	[[nodiscard]] std::uint64_t head() const noexcept;
+	// Copies the records in [from, head()) that are still in the ring to out, returns the index
+	// to continue from.
+	[[nodiscard]] std::uint64_t read(std::uint64_t from, std::vector<LogRecord>& out) const noexcept;
+
+private:
+	struct Slot {
+		std::atomic<std::uint64_t> sequence{ 0 }; // 2 * index + 1 while writing, 2 * index + 2 after.
+		LogRecord record;
+	};
+	struct Site {
+		std::atomic<const char*> format{ nullptr };
+		std::atomic<std::uint64_t> second{ 0 };
+		std::atomic<std::uint32_t> count{ 0 };
+		std::atomic<std::uint32_t> suppressed{ 0 };
+	};
+
+	std::atomic<std::uint64_t> next{ 0 };
+	std::array<Slot, Capacity> slots;
+	std::array<Site, N_Sites> sites;
+
+	void push(LogRecord& record) noexcept;
+	[[nodiscard]] bool rate_limit(LogRecord& record) noexcept;
 };
 
 struct LogWindow {
 	bool open{ false };
 
+	// The formatted lines of the records read so far, oldest first, at most Logs::Capacity.
+	std::deque<std::string> lines;
+	std::uint64_t cursor{ 0 };
+	std::vector<LogRecord> new_records;
+
 	void render(Logs& logs) noexcept;
 };
 
-
@@ -19,6 +19,7 @@
 #include "GL/wglew.h"
 
 #include <tchar.h>
+#include <d3d9.h>
 
 #include <mutex>
 #include <atomic>
@@ -42,6 +43,11 @@
 #include "Logs.hpp"
 #include "Screen.hpp"
 #include "Event.hpp"
+#include "FrameScheduler.hpp"
+#include "WriteAheadLog.hpp"
+#include "Export.hpp"
+#include "QueryServer.hpp"
+#include "ErrorCode.hpp"
 
 #include "psapi.h"
 
@@ -64,6 +70,8 @@ LRESULT CALLBACK display_hook();
 LRESULT CALLBACK keyboard_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept;
 LRESULT CALLBACK mouse_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept;
 LRESULT CALLBACK event_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept;
+void end_hook_scroll(bool teardown) noexcept;
+constexpr UINT_PTR Wheel_Timer_Id = 1;
 
 std::optional<std::string> get_last_error_message() noexcept;
 std::optional<HGLRC> create_gl_context(HWND handle_window) noexcept;
@@ -77,6 +85,17 @@ struct Mail_Message {
 void make_mail() noexcept;
 std::optional<Mail_Message> read_mail() noexcept;
 
+template<typename State>
+bool snapshot(
+	State& state, WriteAheadLog& wal, const std::filesystem::path& path, std::uint64_t now
+) noexcept;
+void recover_keyboard() noexcept;
+void recover_mouse() noexcept;
+void recover_event() noexcept;
+void export_states(ExportOptions options) noexcept;
+void publish_query_snapshot(std::uint64_t now) noexcept;
+std::shared_ptr<const QuerySnapshot> query_snapshot_source() noexcept;
+
 // It's shared data between the hook process and the windows process.
 struct SharedData {
 	std::mutex mut_keyboard_state;
@@ -93,6 +112,30 @@ struct SharedData {
 	Settings settings;
 
 	HANDLE mail_slot = INVALID_HANDLE_VALUE;
+
+	// Signaled by the ingest thread when one of the states changed, the stats window waits on it.
+	HANDLE data_changed = NULL;
+
+	// A copy of settings.retention for the ingest thread, the settings belong to the ui thread.
+	std::atomic<RetentionPolicy> retention;
+	std::atomic<std::uint16_t> commit_interval_ms = 1'000;
+	std::atomic<std::uint64_t> session_idle_ms = Default_Session_Idle_Gap_Ms;
+
+	// What came since the last snapshot of each state, each one under the lock of its state.
+	WriteAheadLog keyboard_wal;
+	WriteAheadLog mouse_wal;
+	WriteAheadLog event_wal;
+
+	std::atomic<bool> exporting = false;
+
+	// What the query server answers from, published by the ingest thread while clients are
+	// around. The lock is only held to swap the pointer.
+	std::mutex mut_query;
+	std::condition_variable query_published;
+	std::shared_ptr<const QuerySnapshot> query_snapshot;
+	std::atomic<std::uint64_t> last_query_ms = 0;
+	// Set by a client that found no snapshot, under the lock of the event queue.
+	std::atomic<bool> query_wanted = false;
 } shared;
 
 constexpr auto hook_class_name = "Hook MT";
@@ -107,11 +150,18 @@ struct EventQueueCache {
 	bool event_received{ false };
 
 	std::vector<KeyEntry> keyboard;
-	std::vector<ClickEntry> click;
+	std::vector<ClickEntry> click; // the scrolls, the other clicks are the ups of buttons.
+	std::vector<MoveSample> moves;
+	std::vector<ButtonEvent> buttons;
 	std::vector<Display> display;
 	std::vector<AppUsage> app_usages;
 } event_queue_cache;
 
+// The scroll the mouse hook is summing and the ones it couldn't queue yet. The hook, the timer
+// that ends its scrolls and the teardown all run on the main thread.
+static WheelCoalescer hook_wheel;
+static std::vector<ClickEntry> hook_clicks;
+
 void toggle_fullscren(HWND hwnd) {
 	static WINDOWPLACEMENT g_wpPrev = { sizeof(g_wpPrev) };
 
@@ -190,6 +240,14 @@ LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) noexce
 		if ((wParam & 0xfff0) == SC_KEYMENU) // Disable ALT application menu
 			return 0;
 		break;
+	// Set by mouse_hook while a scroll is summed.
+	case WM_TIMER:
+		if (wParam == Wheel_Timer_Id) end_hook_scroll(false);
+		break;
+	// Sent to the top level windows when the time or the timezone is changed.
+	case WM_TIMECHANGE:
+		LocalClock::timezone_changed();
+		break;
 	case WM_DESTROY:
 	case Quit_Request:
 		PostQuitMessage(0);
@@ -245,28 +303,72 @@ int __stdcall WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	std::filesystem::create_directories(get_app_data_path());
 	
+	if (auto opt = Settings::load_from_file(get_app_data_path() / Settings::Default_Path); opt) {
+		shared.settings = *opt;
+	}
+	else {
+		shared.settings.keyboard_layout = detect_keyboard_layout();
+	}
 	shared.settings.copy_system();
-	shared.keyboard_state =
-		KeyboardState::load_from_file(get_app_data_path() / Default_Keyboard_Path);
-	shared.mouse_state =
-		MouseState::load_from_file(get_app_data_path() / MouseState::Default_Path, true);
-	shared.event_state =
-		EventState::load_from_file(get_app_data_path() / EventState::Default_Path);
-
+	shared.retention = shared.settings.retention;
+	shared.commit_interval_ms = shared.settings.commit_interval_ms;
+	shared.session_idle_ms = shared.settings.session_idle_minutes * 60'000ull;
+	shared.data_changed = CreateEvent(NULL, FALSE, FALSE, NULL);
+	defer{ CloseHandle(shared.data_changed); };
+
+	shared.keyboard_wal.path = (get_app_data_path() / Default_Keyboard_Path).replace_extension(".wal");
+	shared.keyboard_wal.record_size = KeyEntry::Log_Size;
+	shared.mouse_wal.path = (get_app_data_path() / MouseState::Default_Path).replace_extension(".wal");
+	shared.mouse_wal.record_size = ClickEntry::Log_Size;
+	shared.event_wal.path = (get_app_data_path() / EventState::Default_Path).replace_extension(".wal");
+	shared.event_wal.record_size = AppUsage::Byte_Size;
+
+	// After the ingest thread is joined, the stats window can still be around so the locks are
+	// taken.
 	defer{
+		auto now = get_milliseconds_epoch();
+		std::scoped_lock lock{
+			shared.mut_keyboard_state, shared.mut_mouse_state, shared.mut_event_state
+		};
 		if (shared.keyboard_state) {
-			(void)shared.keyboard_state->save_to_file(get_app_data_path() / Default_Keyboard_Path);
+			(void)snapshot(
+				*shared.keyboard_state,
+				shared.keyboard_wal,
+				get_app_data_path() / Default_Keyboard_Path,
+				now
+			);
 		}
 
 		if (shared.mouse_state){
-			(void)shared.mouse_state->save_to_file(get_app_data_path() / MouseState::Default_Path);
+			(void)snapshot(
+				*shared.mouse_state, shared.mouse_wal, get_app_data_path() / MouseState::Default_Path, now
+			);
 		}
 
 		if (shared.event_state){
-			(void)shared.event_state->save_to_file(get_app_data_path() / EventState::Default_Path);
+			(void)snapshot(
+				*shared.event_state, shared.event_wal, get_app_data_path() / EventState::Default_Path, now
+			);
 		}
 	};
 
+	// Only the counters and the rollups are read, so it's done before the hooks start. They grow
+	// with the days of history, not with the events: the raw entries, the columns and postings
+	// that go with them and the pointer path stay in the files until something asks.
+	{
+		auto start = get_milliseconds_epoch();
+		shared.keyboard_state =
+			KeyboardState::load_from_file(get_app_data_path() / Default_Keyboard_Path, true);
+		shared.mouse_state =
+			MouseState::load_from_file(get_app_data_path() / MouseState::Default_Path, true, true);
+		shared.event_state =
+			EventState::load_from_file(get_app_data_path() / EventState::Default_Path, true);
+		recover_keyboard();
+		recover_mouse();
+		recover_event();
+		logs.write(LogTag::Perf, "Loaded the counters in {}ms.", get_milliseconds_epoch() - start);
+	}
+
 	// Create application window
 	WNDCLASSEX wc = {
 		sizeof(WNDCLASSEX),
@@ -306,10 +408,30 @@ int __stdcall WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	// so now we are after the creation of the koow window
 	// but before its registration as a hook so it's the perfect time
 	// to start the event_queue process.
-	std::thread{ event_queue_process }.detach();
+	std::thread ingest{ event_queue_process };
 
 	defer{ DestroyWindow(hwnd); };
-	defer{ shared.hook_window = nullptr; };
+	// Before the final snapshot, the thread appends to the states and to their logs.
+	defer{
+		end_hook_scroll(true);
+		{
+			std::lock_guard lock{ event_queue_cache.mutex };
+			shared.hook_window = nullptr;
+		}
+		event_queue_cache.wait_var.notify_all();
+		ingest.join();
+	};
+
+	// The query api for the scripts and the dashboards, see Query.hpp.
+	QueryServer query_server;
+	if (auto err = query_server.start(QueryServer::Default_Name, query_snapshot_source)) {
+		ErrorDescription error;
+		error.location = "main";
+		error.quick_desc = "Couldn't start the query server, is another instance running ?";
+		error.message = format_error_code(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+	}
 
 #if REGISTER_HOOKS
 #if REGISTER_KEYBOARD_HOOK
@@ -335,10 +457,7 @@ int __stdcall WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	sys_tray_icon.show();
 	defer{ sys_tray_icon.remove(); };
 
-	LogEntry entry;
-	entry.message = "Started in: " + std::to_string(get_milliseconds_epoch() - time_start) + "ms.";
-	entry.tag.push_back("PERF");
-	logs.lock_and_write(entry);
+	logs.write(LogTag::Perf, "Started in: {}ms.", get_milliseconds_epoch() - time_start);
 
 #if START_WITH_VISU
 	std::thread{ window_process }.detach();
@@ -449,16 +568,35 @@ void window_process() noexcept {
 	ShowWindow(hwnd, SW_SHOWDEFAULT);
 	UpdateWindow(hwnd);
 
+	FrameScheduler scheduler;
+
 	auto delta_clock = get_microseconds_epoch();
 	while (msg.message != WM_QUIT) {
-		auto dt = (get_microseconds_epoch() - delta_clock) / 1'000'000.0;
-		delta_clock = get_microseconds_epoch();
+		// We sleep until there is a message for one of our windows, the ingest thread tells us
+		// the data changed or the scheduler wants a frame for the live plots.
+		scheduler.live_period_ms = shared.settings.live_fps ? 1'000 / shared.settings.live_fps : 0;
+		auto timeout = scheduler.next_timeout(get_milliseconds_epoch());
+		auto wait = MsgWaitForMultipleObjects(
+			1,
+			&shared.data_changed,
+			FALSE,
+			timeout == FrameScheduler::Infinite ? INFINITE : (DWORD)timeout,
+			QS_ALLINPUT
+		);
+
+		auto now = get_milliseconds_epoch();
+		if (wait == WAIT_OBJECT_0) scheduler.notify_data(now);
 
-		if (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE)) {
+		while (msg.message != WM_QUIT && PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE)) {
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			scheduler.notify_input(now);
 		}
-		if (visu_windows_ended) break;
+		if (msg.message == WM_QUIT || visu_windows_ended) break;
+		if (!scheduler.should_render(now)) continue;
+
+		auto dt = (get_microseconds_epoch() - delta_clock) / 1'000'000.0;
+		delta_clock = get_microseconds_epoch();
 		// Start the Dear ImGui frame
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplWin32_NewFrame();
@@ -500,9 +638,18 @@ void window_process() noexcept {
 
 		ImGui::Begin("Debug");
 		ImGui::Text("%f", 1.f / (float)dt);
+		ImGui::Text(
+			"Frames %zu (input %zu, data %zu, live %zu) for %zu wakeups.",
+			scheduler.stats.frames,
+			scheduler.stats.input_frames,
+			scheduler.stats.data_frames,
+			scheduler.stats.live_frames,
+			scheduler.stats.wakeups
+		);
 		ImGui::End();
 
 
+		key_window.layout = shared.settings.keyboard_layout;
 		{
 			std::lock_guard guard{ shared.mut_keyboard_state };
 			key_window.render(shared.keyboard_state);
@@ -512,6 +659,10 @@ void window_process() noexcept {
 		} {
 			auto t = std::lock_guard{ shared.mut_event_state };
 			eve_window.render(shared.event_state);
+			if (shared.event_state) {
+				join_key_apps(key_window.key_details, *shared.event_state);
+				join_scroll_apps(mou_window.scroll_apps, *shared.event_state);
+			}
 		}
 		set_window.render(shared.settings);
 		log_window.render(logs);
@@ -532,6 +683,7 @@ void window_process() noexcept {
 			if (!shared.keyboard_state->reset_everything()) {
 				ImGui::OpenPopup("Error Prompt");
 			}
+			(void)shared.keyboard_wal.reset(shared.keyboard_state->generation, get_milliseconds_epoch());
 			set_window.reset_keyboard_state = false;
 		}
 		if (set_window.reset_mouse_state && shared.mouse_state) {
@@ -539,6 +691,7 @@ void window_process() noexcept {
 			if (!shared.mouse_state->reset_everything()) {
 				ImGui::OpenPopup("Error Prompt");
 			}
+			(void)shared.mouse_wal.reset(shared.mouse_state->generation, get_milliseconds_epoch());
 			set_window.reset_mouse_state = false;
 		}
 		if (set_window.quit) {
@@ -549,6 +702,25 @@ void window_process() noexcept {
 		if (set_window.install) {
 
 		}
+		if (set_window.save) {
+			(void)shared.settings.save_to_file(get_app_data_path() / Settings::Default_Path);
+			shared.retention = shared.settings.retention;
+			shared.commit_interval_ms = shared.settings.commit_interval_ms;
+			shared.session_idle_ms = shared.settings.session_idle_minutes * 60'000ull;
+			set_window.save = false;
+		}
+
+		if (set_window.export_data) {
+			ExportOptions options;
+			options.format = (ExportFormat)set_window.export_format;
+			if (set_window.export_days > 0) {
+				options.from_ms =
+					get_milliseconds_epoch() - set_window.export_days * RetentionPolicy::Day_Ms;
+			}
+			options.app = set_window.export_app;
+			export_states(options);
+			set_window.export_data = false;
+		}
 
 		if (key_window.reset) {
 			auto t = std::lock_guard{ shared.mut_keyboard_state };
@@ -556,12 +728,14 @@ void window_process() noexcept {
 			if (!shared.keyboard_state->reset_everything()) {
 				ImGui::OpenPopup("Error Prompt");
 			}
+			(void)shared.keyboard_wal.reset(shared.keyboard_state->generation, get_milliseconds_epoch());
 			key_window.reset = false;
 		}
 		if (key_window.save) {
 			auto full_path = get_app_data_path() / Default_Keyboard_Path;
 			auto t = std::lock_guard{ shared.mut_keyboard_state };
-			if (!shared.keyboard_state->save_to_file(full_path)) {
+			auto now = get_milliseconds_epoch();
+			if (!snapshot(*shared.keyboard_state, shared.keyboard_wal, full_path, now)) {
 				ImGui::OpenPopup("Error Prompt");
 			}
 			key_window.save = false;
@@ -569,9 +743,12 @@ void window_process() noexcept {
 		if (key_window.reload) {
 			auto full_path = get_app_data_path() / Default_Keyboard_Path;
 			auto t = std::lock_guard{ shared.mut_keyboard_state };
-			auto opt = KeyboardState::load_from_file(full_path);
+			// What's only in the log is put back after the load.
+			(void)shared.keyboard_wal.commit();
+			auto opt = KeyboardState::load_from_file(full_path, true);
 			if (opt) shared.keyboard_state = *opt;
 			else ImGui::OpenPopup("Error Prompt");
+			recover_keyboard();
 			key_window.reload = false;
 		}
 
@@ -581,12 +758,14 @@ void window_process() noexcept {
 			if (!shared.mouse_state->reset_everything()) {
 				ImGui::OpenPopup("Error Prompt");
 			}
+			(void)shared.mouse_wal.reset(shared.mouse_state->generation, get_milliseconds_epoch());
 			mou_window.reset = false;
 		}
 		if (mou_window.save) {
 			auto full_path = get_app_data_path() / MouseState::Default_Path;
 			auto t = std::lock_guard{ shared.mut_mouse_state };
-			if (!shared.mouse_state->save_to_file(full_path)) {
+			auto now = get_milliseconds_epoch();
+			if (!snapshot(*shared.mouse_state, shared.mouse_wal, full_path, now)) {
 				ImGui::OpenPopup("Error Prompt");
 			}
 			mou_window.save = false;
@@ -594,9 +773,11 @@ void window_process() noexcept {
 		if (mou_window.reload) {
 			auto full_path = get_app_data_path() / MouseState::Default_Path;
 			auto t = std::lock_guard{ shared.mut_mouse_state };
-			auto opt = MouseState::load_from_file(full_path, mou_window.strict);
+			(void)shared.mouse_wal.commit();
+			auto opt = MouseState::load_from_file(full_path, mou_window.strict, true);
 			if (opt) shared.mouse_state = *opt;
 			else ImGui::OpenPopup("Error Prompt");
+			recover_mouse();
 			mou_window.reload = false;
 		}
 
@@ -607,12 +788,14 @@ void window_process() noexcept {
 			if (!shared.event_state->reset_everything()) {
 				ImGui::OpenPopup("Error Prompt");
 			}
+			(void)shared.event_wal.reset(shared.event_state->generation, get_milliseconds_epoch());
 			eve_window.reset = false;
 		}
 		if (eve_window.save) {
 			auto full_path = get_app_data_path() / EventState::Default_Path;
 			auto t = std::lock_guard{ shared.mut_event_state };
-			if (!shared.event_state->save_to_file(full_path)) {
+			auto now = get_milliseconds_epoch();
+			if (!snapshot(*shared.event_state, shared.event_wal, full_path, now)) {
 				ImGui::OpenPopup("Error Prompt");
 			}
 			eve_window.save = false;
@@ -620,9 +803,11 @@ void window_process() noexcept {
 		if (eve_window.reload) {
 			auto full_path = get_app_data_path() / EventState::Default_Path;
 			auto t = std::lock_guard{ shared.mut_event_state };
-			auto opt = EventState::load_from_file(full_path);
+			(void)shared.event_wal.commit();
+			auto opt = EventState::load_from_file(full_path, true);
 			if (opt) shared.event_state = *opt;
 			else ImGui::OpenPopup("Error Prompt");
+			recover_event();
 			eve_window.reload = false;
 		}
 		if (eve_window.unhook){
@@ -636,37 +821,39 @@ void window_process() noexcept {
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 		SwapBuffers(dc_window);
-		//using namespace std::chrono_literals;
-		//std::this_thread::sleep_for(16ms);
+		scheduler.frame_rendered(get_milliseconds_epoch());
 	}
 }
 
 LRESULT CALLBACK keyboard_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept {
 	thread_local std::vector<KeyEntry> key_entries_to_add;
+	thread_local KeyPairing pairing;
 
 	auto time_start = get_microseconds_epoch();
 	defer{
 		auto time_end = get_microseconds_epoch();
 		auto dt = time_end - time_start;
 
-		if (dt > 500) {
-			LogEntry entry;
-			entry.message = "Keyboard hook blocked for: " + std::to_string(dt) + "us.";
-			entry.tag.push_back("PERF");
-			logs.lock_and_write(entry);
-		}
+		if (dt > 500) logs.write(LogTag::Perf, "Keyboard hook blocked for: {}us.", dt);
 	};
 
 
 	if (n_code < 0) return CallNextHookEx(NULL, n_code, w_param, l_param);
 
 	switch (w_param) {
+	case WM_KEYDOWN:
+	case WM_SYSKEYDOWN: {
+		auto& arg = *(KBDLLHOOKSTRUCT*)l_param;
+		pairing.down((uint8_t)arg.vkCode, get_milliseconds_epoch());
+		break;
+	}
 	case WM_KEYUP:
 	case WM_SYSKEYUP: {
 		auto& arg = *(KBDLLHOOKSTRUCT*)l_param;
 		KeyEntry entry;
 		entry.key_code = (uint8_t)arg.vkCode;
-		entry.timestamp = get_seconds_epoch();
+		entry.timestamp = get_milliseconds_epoch();
+		entry.hold = pairing.up(entry.key_code, entry.timestamp);
 
 		key_entries_to_add.push_back(entry);
 		break;
@@ -689,85 +876,130 @@ LRESULT CALLBACK keyboard_hook(int n_code, WPARAM w_param, LPARAM l_param) noexc
 }
 
 LRESULT CALLBACK mouse_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept {
-	thread_local std::vector<ClickEntry> click_entries_to_add;
+	thread_local std::vector<MoveSample> moves_to_add;
+	thread_local std::vector<ButtonEvent> buttons_to_add;
+	thread_local MoveDecimator decimator;
+	auto add_move = [](const MoveSample& x) { moves_to_add.push_back(x); };
+	auto add_wheel = [](std::optional<ClickEntry> x) {
+		if (x) hook_clicks.push_back(*x);
+	};
 
 	auto time_start = get_microseconds_epoch();
 	defer{
 		auto time_end = get_microseconds_epoch();
 		auto dt = time_end - time_start;
 
-		if (dt > 500) {
-			LogEntry entry;
-			entry.message = "Mouse hook blocked for: " + std::to_string(dt) + "us.";
-			entry.tag.push_back("PERF");
-			logs.lock_and_write(entry);
-		}
+		if (dt > 500) logs.write(LogTag::Perf, "Mouse hook blocked for: {}us.", dt);
 	};
 
 	if (n_code < 0) return CallNextHookEx(NULL, n_code, w_param, l_param);
 
+	// A scroll ends with the first message after the gap, whatever it is.
+	auto now_ms = get_milliseconds_epoch();
+	add_wheel(hook_wheel.idle(now_ms));
 
 	switch (w_param) {
+	case WM_MOUSEMOVE: {
+		auto& arg = *(MSLLHOOKSTRUCT*)l_param;
+		decimator.move(arg.pt.x, arg.pt.y, now_ms, add_move);
+		break;
+	}
+	case WM_MOUSEWHEEL: {
+		auto& arg = *(MSLLHOOKSTRUCT*)l_param;
+		decimator.flush(add_move);
+		auto raw = (short)(arg.mouseData >> (8 * sizeof(WORD)));
+		add_wheel(hook_wheel.wheel(raw, arg.pt.x, arg.pt.y, now_ms));
+		// Pushed back by each notch, it ends the scroll if no other message comes.
+		SetTimer(shared.hook_window, Wheel_Timer_Id, (UINT)WheelCoalescer::Gap_Ms, NULL);
+		break;
+	}
+	case WM_LBUTTONDOWN:
+	case WM_RBUTTONDOWN:
+	case WM_MBUTTONDOWN:
+	case WM_XBUTTONDOWN:
 	case WM_LBUTTONUP:
 	case WM_RBUTTONUP:
 	case WM_MBUTTONUP:
-	case WM_XBUTTONUP:
-	case WM_MOUSEWHEEL: {
+	case WM_XBUTTONUP: {
 		auto& arg = *(MSLLHOOKSTRUCT*)l_param;
-		ClickEntry click;
-		click.timestamp = get_seconds_epoch();
+		// The path goes up to the click, the scroll before it comes before it.
+		decimator.flush(add_move);
+		add_wheel(hook_wheel.flush());
+
+		std::uint8_t button = 0;
 		switch (w_param) {
+		case WM_LBUTTONDOWN:
 		case WM_LBUTTONUP:
-			click.button_code = (uint8_t)MouseState::ButtonMap::Left;
+			button = (uint8_t)MouseState::ButtonMap::Left;
 			break;
+		case WM_RBUTTONDOWN:
 		case WM_RBUTTONUP:
-			click.button_code = (uint8_t)MouseState::ButtonMap::Right;
-			break;
-		case WM_MOUSEWHEEL:
-			if ((short)(arg.mouseData >> (8 * sizeof(WORD))) > 0) {
-				click.button_code = (uint8_t)MouseState::ButtonMap::Wheel_Up;
-			}
-			else {
-				click.button_code = (uint8_t)MouseState::ButtonMap::Wheel_Down;
-			}
+			button = (uint8_t)MouseState::ButtonMap::Right;
 			break;
+		case WM_MBUTTONDOWN:
 		case WM_MBUTTONUP:
-			click.button_code = (uint8_t)MouseState::ButtonMap::Wheel;
+			button = (uint8_t)MouseState::ButtonMap::Wheel;
 			break;
+		case WM_XBUTTONDOWN:
 		case WM_XBUTTONUP:
 			if ((arg.mouseData >> (8 * sizeof(WORD))) == XBUTTON1) {
-				click.button_code = (uint8_t)MouseState::ButtonMap::Mouse_3;
+				button = (uint8_t)MouseState::ButtonMap::Mouse_3;
 			}
 			else {
-				click.button_code = (uint8_t)MouseState::ButtonMap::Mouse_4;
+				button = (uint8_t)MouseState::ButtonMap::Mouse_4;
 			}
 			break;
 		}
 
-		click.x = arg.pt.x;
-		click.y = arg.pt.y;
-		click_entries_to_add.push_back(click);
-
+		// The downs only go to the gestures, the ingest makes the clicks from the ups.
+		bool down =
+			w_param == WM_LBUTTONDOWN || w_param == WM_RBUTTONDOWN ||
+			w_param == WM_MBUTTONDOWN || w_param == WM_XBUTTONDOWN;
+		buttons_to_add.push_back({ button, down, arg.pt.x, arg.pt.y, now_ms });
 		break;
 	}
 	default:
 		break;
 	}
 
-	if (!click_entries_to_add.empty() && event_queue_cache.mutex.try_lock()) {
+	bool queued =
+		!hook_clicks.empty() || !moves_to_add.empty() || !buttons_to_add.empty();
+	if (queued && event_queue_cache.mutex.try_lock()) {
 		defer{
 			event_queue_cache.mutex.unlock();
 			event_queue_cache.wait_var.notify_all();
 		};
 
-		for (auto& x : click_entries_to_add) event_queue_cache.click.push_back(x);
+		for (auto& x : hook_clicks) event_queue_cache.click.push_back(x);
+		for (auto& x : moves_to_add) event_queue_cache.moves.push_back(x);
+		for (auto& x : buttons_to_add) event_queue_cache.buttons.push_back(x);
 
-		click_entries_to_add.resize(0);
+		hook_clicks.resize(0);
+		moves_to_add.resize(0);
+		buttons_to_add.resize(0);
 	}
 
 	return CallNextHookEx(NULL, n_code, w_param, l_param);
 }
 
+// Ends the scroll in progress if the wheel stopped, or at the teardown whatever it is, then queues
+// the clicks the hook still holds. Without it the last scroll would wait for the next mouse
+// message, and be lost if none came before the exit.
+void end_hook_scroll(bool teardown) noexcept {
+	auto x = teardown ? hook_wheel.flush() : hook_wheel.idle(get_milliseconds_epoch());
+	if (x) hook_clicks.push_back(*x);
+	if (!hook_wheel.pending) KillTimer(shared.hook_window, Wheel_Timer_Id);
+	if (hook_clicks.empty()) return;
+
+	// Not in the hook, we can wait for the ingest to let go of the queue.
+	{
+		std::lock_guard lock{ event_queue_cache.mutex };
+		for (auto& c : hook_clicks) event_queue_cache.click.push_back(c);
+	}
+	event_queue_cache.wait_var.notify_all();
+	hook_clicks.resize(0);
+}
+
 LRESULT CALLBACK event_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept {
 	thread_local std::unordered_map<HWND, std::uint64_t> opened;
 	thread_local std::vector<AppUsage> entries_to_add;
@@ -866,58 +1098,484 @@ LRESULT CALLBACK event_hook(int n_code, WPARAM w_param, LPARAM l_param) noexcept
 ClickEntry transform_click_to_canonical(ClickEntry x) noexcept;
 void update_displays_from_click(MouseState& state, ClickEntry x) noexcept;
 
+// Saves the state as the next generation and restarts its log, everything the log had is in the
+// save. If the save fails the log goes on as if nothing happened.
+template<typename State>
+bool snapshot(
+	State& state, WriteAheadLog& wal, const std::filesystem::path& path, std::uint64_t now
+) noexcept {
+	state.generation++;
+	if (!state.save_to_file(path)) {
+		state.generation--;
+		return false;
+	}
+
+	if (auto err = wal.reset(state.generation, now); err) {
+		// The old log has the old generation, it won't be replayed on top of the save.
+		logs.write(LogTag::FileIO, "Couldn't restart the log after a snapshot: {}", err);
+	}
+	return true;
+}
+
+// Called with the state lock held, after a load. The entries of the log that aren't in the save
+// are fed again, as they came, then a snapshot makes them part of it. A log left by a version
+// whose records were legacy_size bytes is read with legacy_decode.
+template<typename Entry, typename State, typename Decode, typename Apply>
+void recover(
+	State& state,
+	WriteAheadLog& wal,
+	const std::filesystem::path& path,
+	Decode decode,
+	Apply apply,
+	size_t legacy_size = 0,
+	Decode legacy_decode = nullptr
+) noexcept {
+	auto now = get_milliseconds_epoch();
+	auto record_size = wal.record_size;
+	auto bytes = WriteAheadLog::read(wal.path, record_size, state.generation);
+	if (bytes.empty() && legacy_size) {
+		bytes = WriteAheadLog::read(wal.path, legacy_size, state.generation);
+		record_size = legacy_size;
+		decode = legacy_decode;
+	}
+	if (bytes.empty()) {
+		if (auto err = wal.reset(state.generation, now); err) {
+			logs.write(LogTag::FileIO, "Couldn't start the log: {}", err);
+		}
+		return;
+	}
+
+	std::vector<Entry> entries(bytes.size() / record_size);
+	decode(bytes.data(), entries.data(), entries.size());
+	for (auto& x : entries) apply(state, x);
+
+	logs.write(LogTag::Perf, "Replayed {} entries in {}ms.", entries.size(), get_milliseconds_epoch() - now);
+	(void)snapshot(state, wal, path, now);
+}
+
+void recover_keyboard() noexcept {
+	if (!shared.keyboard_state) return;
+	recover<KeyEntry>(
+		*shared.keyboard_state,
+		shared.keyboard_wal,
+		get_app_data_path() / Default_Keyboard_Path,
+		decode_logged_key_entries,
+		[](KeyboardState& state, KeyEntry x) { state.increment_key(x); },
+		KeyEntry::Packed_Size,
+		decode_key_entries
+	);
+}
+void recover_mouse() noexcept {
+	if (!shared.mouse_state) return;
+	// The clicks are logged in canonical coordinates, the displays they came from are known
+	// already.
+	recover<ClickEntry>(
+		*shared.mouse_state,
+		shared.mouse_wal,
+		get_app_data_path() / MouseState::Default_Path,
+		decode_logged_clicks,
+		[](MouseState& state, ClickEntry x) { (void)state.increment_button(x); },
+		ClickEntry::Byte_Size,
+		decode_clicks
+	);
+}
+void recover_event() noexcept {
+	if (!shared.event_state) return;
+	recover<AppUsage>(
+		*shared.event_state,
+		shared.event_wal,
+		get_app_data_path() / EventState::Default_Path,
+		decode_usages,
+		[](EventState& state, const AppUsage& x) { state.register_event(x); }
+	);
+}
+
+// Commits the batches whose oldest entry is as old as the interval, a long or broken log is
+// replaced by a snapshot. Returns when the next batch is due.
+std::uint64_t commit_logs(std::uint64_t interval, std::uint64_t now) noexcept {
+	// So a failing disk isn't retried in a loop.
+	constexpr std::uint64_t Retry_Delay_Ms = 1'000;
+
+	std::uint64_t next = UINT64_MAX;
+	auto commit = [&](auto& mutex, auto& state, WriteAheadLog& wal, const std::filesystem::path& path) {
+		std::lock_guard lock{ mutex };
+		if (!state) return;
+
+		if (now >= wal.commit_time(interval)) {
+			auto err = wal.commit();
+			if (err) logs.write(LogTag::FileIO, "Couldn't commit to the log: {}", err);
+			if (err || wal.snapshot_due(now)) (void)snapshot(*state, wal, path, now);
+		}
+
+		auto t = wal.commit_time(interval);
+		if (t <= now) t = now + Retry_Delay_Ms;
+		if (t < next) next = t;
+	};
+
+	commit(
+		shared.mut_keyboard_state,
+		shared.keyboard_state,
+		shared.keyboard_wal,
+		get_app_data_path() / Default_Keyboard_Path
+	);
+	commit(
+		shared.mut_mouse_state,
+		shared.mouse_state,
+		shared.mouse_wal,
+		get_app_data_path() / MouseState::Default_Path
+	);
+	commit(
+		shared.mut_event_state,
+		shared.event_state,
+		shared.event_wal,
+		get_app_data_path() / EventState::Default_Path
+	);
+	return next;
+}
+
+// The exporter reads the save files and their logs, so the batches are committed first and it
+// sees everything. It runs in the background, it only reads the files.
+void export_states(ExportOptions options) noexcept {
+	if (shared.exporting.exchange(true)) return;
+
+	{
+		std::lock_guard lock{ shared.mut_keyboard_state };
+		(void)shared.keyboard_wal.commit();
+	} {
+		std::lock_guard lock{ shared.mut_mouse_state };
+		(void)shared.mouse_wal.commit();
+	} {
+		std::lock_guard lock{ shared.mut_event_state };
+		(void)shared.event_wal.commit();
+	}
+
+	std::thread{ [options] () mutable {
+		defer{ shared.exporting = false; };
+
+		auto dir = get_app_data_path() / "export";
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+		options.event_path = get_app_data_path() / EventState::Default_Path;
+
+		std::filesystem::path paths[] = {
+			get_app_data_path() / Default_Keyboard_Path,
+			get_app_data_path() / MouseState::Default_Path,
+			get_app_data_path() / EventState::Default_Path,
+		};
+		for (size_t i = 0; i < (size_t)SaveKind::Count; ++i) {
+			auto kind = (SaveKind)i;
+			auto out_path = dir / save_kind_name(kind);
+			out_path.replace_extension(export_format_extension(options.format));
+
+			auto start = get_milliseconds_epoch();
+			std::FILE* out = nullptr;
+			auto err = fopen_s(&out, out_path.generic_string().c_str(), "wb");
+
+			ExportStats stats;
+			if (!err) {
+				err = export_records(kind, paths[i], out, options, stats);
+				fclose(out);
+			}
+			if (err) {
+				ErrorDescription error;
+				error.location = "export_states";
+				error.quick_desc = "Couldn't export " + paths[i].generic_string();
+				error.message = format_errno(err);
+				error.type = ErrorDescription::Type::FileIO;
+				logs.lock_and_write(error);
+				continue;
+			}
+
+			logs.write(
+				LogTag::Info,
+				"Exported {} of {} {} records in {}ms.",
+				stats.n_written,
+				stats.n_read,
+				save_kind_name(kind),
+				get_milliseconds_epoch() - start
+			);
+		}
+	} }.detach();
+}
+
+// Copies the states for the query server, the records only from where the last snapshot stopped.
+// The clients never wait on the states, only on the swap of the pointer.
+void publish_query_snapshot(std::uint64_t now) noexcept {
+	// Kept between the calls, its chunks are shared with the last snapshot.
+	static QuerySnapshot next;
+
+	if (now > shared.last_query_ms + QuerySnapshot::Idle_Ms) {
+		if (next.time == 0) return;
+		next = {};
+		std::lock_guard lock{ shared.mut_query };
+		shared.query_snapshot = nullptr;
+		return;
+	}
+
+	auto start = get_milliseconds_epoch();
+	next.time = now;
+	{
+		std::lock_guard lock{ shared.mut_keyboard_state };
+		auto& x = next.keyboard;
+		x.loaded = shared.keyboard_state.has_value();
+		if (x.loaded) {
+			auto& state = *shared.keyboard_state;
+			std::copy(std::begin(state.key_times), std::end(state.key_times), std::begin(x.counts));
+			x.minutes = state.minutes;
+			x.complete = !state.pending_entries;
+			x.keys.sync(state.key_entries, [](const KeyEntry& y) {
+				return QueryKey{ y.timestamp, y.key_code };
+			});
+		}
+	}
+	{
+		std::lock_guard lock{ shared.mut_mouse_state };
+		auto& x = next.mouse;
+		x.loaded = shared.mouse_state.has_value();
+		if (x.loaded) {
+			auto& state = *shared.mouse_state;
+			std::copy(std::begin(state.buttons), std::end(state.buttons), std::begin(x.counts));
+			x.minutes = state.minutes;
+			x.complete = !state.pending_clicks;
+			x.clicks.sync(state.click_entries, [](const ClickEntry& y) {
+				return QueryClick{ y.timestamp, y.button_code, (std::int32_t)y.x, (std::int32_t)y.y };
+			});
+		}
+	}
+	{
+		std::lock_guard lock{ shared.mut_event_state };
+		auto& x = next.event;
+		x.loaded = shared.event_state.has_value();
+		if (x.loaded) {
+			auto& state = *shared.event_state;
+			x.complete = !state.pending_usages;
+			x.usages.sync(state.apps_usages, [](const AppUsage& y) {
+				return QueryUsage{ y.timestamp_start, y.timestamp_end, y.exe_name, y.doc_name };
+			});
+		}
+	}
+
+	auto snapshot = std::make_shared<const QuerySnapshot>(next);
+	{
+		std::lock_guard lock{ shared.mut_query };
+		shared.query_snapshot = std::move(snapshot);
+	}
+	shared.query_published.notify_all();
+
+	// The first one copies all the records, the next ones only what came since.
+	auto time = get_milliseconds_epoch() - start;
+	if (time > 10) logs.write(LogTag::Perf, "Published a query snapshot in {}ms.", time);
+}
+
+// Called by the clients of the query server for each request.
+std::shared_ptr<const QuerySnapshot> query_snapshot_source() noexcept {
+	std::unique_lock lock{ shared.mut_query };
+	shared.last_query_ms = get_milliseconds_epoch();
+
+	// The first request in a while, the ingest thread publishes one right away.
+	if (!shared.query_snapshot) {
+		{
+			std::lock_guard queue_lock{ event_queue_cache.mutex };
+			shared.query_wanted = true;
+		}
+		event_queue_cache.wait_var.notify_one();
+
+		using namespace std::chrono;
+		shared.query_published.wait_for(lock, 2s, [] { return shared.query_snapshot != nullptr; });
+	}
+	return shared.query_snapshot;
+}
+
+// Applies the retention policy, the states are saved right away so the dropped entries leave the
+// files too.
+void compact_states(RetentionPolicy policy, std::uint64_t now) noexcept {
+	auto start = get_milliseconds_epoch();
+	bool changed = false;
+
+	{
+		std::lock_guard lock{ shared.mut_keyboard_state };
+		if (shared.keyboard_state && shared.keyboard_state->compact(policy, now)) {
+			(void)snapshot(
+				*shared.keyboard_state,
+				shared.keyboard_wal,
+				get_app_data_path() / Default_Keyboard_Path,
+				now
+			);
+			changed = true;
+		}
+	}
+	{
+		std::lock_guard lock{ shared.mut_mouse_state };
+		if (shared.mouse_state && shared.mouse_state->compact(policy, now)) {
+			(void)snapshot(
+				*shared.mouse_state, shared.mouse_wal, get_app_data_path() / MouseState::Default_Path, now
+			);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		logs.write(LogTag::Perf, "Compacted the states in {}ms.", get_milliseconds_epoch() - start);
+		SetEvent(shared.data_changed);
+	}
+}
+
 void event_queue_process() noexcept {
+	std::uint64_t next_compaction = 0;
+	std::uint64_t next_query_snapshot = 0;
+	// Its presses go from one batch of the queue to the next.
+	ClickClassifier classifier;
+	// The keys, buttons and moves of the batches, until the event state is there to take them.
+	ActivitySpans activity;
+
 	while (shared.hook_window != nullptr) {
+		// Outside of the queue lock, the hooks keep queuing while we compact or sync.
+		auto now = get_milliseconds_epoch();
+		if (now >= next_compaction) {
+			next_compaction = now + RetentionPolicy::Compaction_Period_Ms;
+			compact_states(shared.retention, now);
+		}
+		auto next_commit = commit_logs(shared.commit_interval_ms, now);
+
+		// Only while clients are around, it holds a copy of all the records.
+		bool querying = now <= shared.last_query_ms + QuerySnapshot::Idle_Ms;
+		if (shared.query_wanted.exchange(false) || now >= next_query_snapshot) {
+			publish_query_snapshot(now);
+			next_query_snapshot = now + QuerySnapshot::Snapshot_Period_Ms;
+		}
+		auto deadline = querying ? (std::min)(next_commit, next_query_snapshot) : next_commit;
+
 		std::unique_lock lk{ event_queue_cache.mutex };
 
 		auto test_function = [] {
 			return
 				!event_queue_cache.click.empty() ||
+				!event_queue_cache.moves.empty() ||
+				!event_queue_cache.buttons.empty() ||
 				!event_queue_cache.display.empty() ||
 				!event_queue_cache.keyboard.empty() ||
 				!event_queue_cache.app_usages.empty();
 		};
-		event_queue_cache.wait_var.wait(lk, test_function);
+		auto wake_function = [&] {
+			return test_function() || shared.query_wanted || shared.hook_window == nullptr;
+		};
+		if (deadline == UINT64_MAX) {
+			event_queue_cache.wait_var.wait(lk, wake_function);
+		}
+		else {
+			// Woken up by the deadline of a batch or of a snapshot there may be nothing to ingest,
+			// we just loop around.
+			auto timeout = std::chrono::milliseconds(deadline - now);
+			event_queue_cache.wait_var.wait_for(lk, timeout, wake_function);
+		}
 		event_queue_cache.event_received = false;
-
+		now = get_milliseconds_epoch();
+
+		bool changed = false;
+		defer{ if (changed) SetEvent(shared.data_changed); };
+		activity.idle_gap_ms = shared.session_idle_ms;
+
+		// The states can be reloaded or reset by the ui at any time, so we only look at them under
+		// their lock. A state that failed to load keeps its events queued.
+		bool mouse_queued =
+			!event_queue_cache.click.empty() ||
+			!event_queue_cache.moves.empty() ||
+			!event_queue_cache.buttons.empty() ||
+			!event_queue_cache.display.empty();
 		if (
-			shared.mouse_state &&
-			(!event_queue_cache.click.empty() || !event_queue_cache.display.empty())&&
+			mouse_queued &&
 			// Maybe we should be more aggresive and do a lock here instead ?
 			shared.mut_mouse_state.try_lock()
 		) {
 			defer{ shared.mut_mouse_state.unlock(); };
 
-			for (auto& x : event_queue_cache.click) {
-				update_displays_from_click(*shared.mouse_state, x);
-				shared.mouse_state->increment_button(transform_click_to_canonical(x));
+			if (shared.mouse_state) {
+				auto add_click = [&](const ClickEntry& x) {
+					update_displays_from_click(*shared.mouse_state, x);
+					auto canonical = transform_click_to_canonical(x);
+					shared.mouse_state->increment_button(canonical);
+					encode_logged_click(canonical, shared.mouse_wal.append(now));
+				};
+				auto add_gesture = [](const ClickGesture& x) {
+					shared.mouse_state->add_gesture(x);
+				};
+
+				// The clicks are the ups, in order with the scrolls the hook summed. The up waits
+				// in the gestures for its kind.
+				auto& scrolls = event_queue_cache.click;
+				size_t next_scroll = 0;
+				for (auto& x : event_queue_cache.buttons) {
+					activity.feed(x.timestamp);
+					if (!x.down) {
+						while (
+							next_scroll < scrolls.size() &&
+							scrolls[next_scroll].timestamp * 1'000 <= x.timestamp
+						) {
+							add_click(scrolls[next_scroll++]);
+						}
+
+						ClickEntry click;
+						click.timestamp = x.timestamp / 1'000;
+						click.button_code = x.button;
+						click.x = x.x;
+						click.y = x.y;
+						add_click(click);
+						shared.mouse_state->add_button_up(x);
+					}
+					classifier.event(x, add_gesture);
+				}
+				while (next_scroll < scrolls.size()) add_click(scrolls[next_scroll++]);
+				event_queue_cache.click.clear();
+				event_queue_cache.display.clear();
+
+				if (!event_queue_cache.moves.empty()) {
+					auto screens = get_all_screens();
+					for (auto x : event_queue_cache.moves) {
+						activity.feed(x.timestamp);
+						x.x += screens.main_x;
+						x.y += screens.main_y;
+						shared.mouse_state->add_move(x);
+					}
+					event_queue_cache.moves.clear();
+				}
+
+				event_queue_cache.buttons.clear();
+				classifier.expire(get_milliseconds_epoch(), add_gesture);
+				changed = true;
 			}
-			event_queue_cache.click.clear();
-			event_queue_cache.display.clear();
 		}
 
-		if (
-			shared.keyboard_state &&
-			!event_queue_cache.keyboard.empty() &&
-			shared.mut_keyboard_state.try_lock()
-		) {
+		if (!event_queue_cache.keyboard.empty() && shared.mut_keyboard_state.try_lock()) {
 			defer{ shared.mut_keyboard_state.unlock(); };
-				
-			for (auto x : event_queue_cache.keyboard) shared.keyboard_state->increment_key(x);
-			event_queue_cache.keyboard.clear();
+
+			if (shared.keyboard_state) {
+				for (auto x : event_queue_cache.keyboard) {
+					activity.feed(x.timestamp);
+					shared.keyboard_state->increment_key(x);
+					encode_logged_key_entry(x, shared.keyboard_wal.append(now));
+				}
+				event_queue_cache.keyboard.clear();
+				changed = true;
+			}
 		}
-		
-		if (
-			shared.event_state &&
-			!event_queue_cache.app_usages.empty() &&
-			shared.mut_event_state.try_lock()
-		) {
+
+		bool event_queued = !event_queue_cache.app_usages.empty() || !activity.empty();
+		if (event_queued && shared.mut_event_state.try_lock()) {
 			defer{ shared.mut_event_state.unlock(); };
 
-			for (auto& x : event_queue_cache.app_usages)
-				shared.event_state->register_event(x);
+			if (shared.event_state) {
+				auto& sessions = shared.event_state->sessions;
+				sessions.idle_gap_ms = shared.session_idle_ms;
+				activity.drain([&](const ActivitySession& x) { sessions.add(x); });
+
+				for (auto& x : event_queue_cache.app_usages) {
+					shared.event_state->register_event(x);
+					encode_usage(x, shared.event_wal.append(now));
+				}
 
-			event_queue_cache.app_usages.clear();
+				event_queue_cache.app_usages.clear();
+				changed = true;
+			}
 		}
 
 		// If after one loop we still test positive. That means that we are going to loop and keep
@@ -925,7 +1583,7 @@ void event_queue_process() noexcept {
 		// So let's just chill for a sec.
 		if (test_function()) {
 			using namespace std::chrono;
-			std::this_thread::sleep_for(1s);
+			event_queue_cache.wait_var.wait_for(lk, 1s);
 		}
 	}
 }
@@ -950,10 +1608,13 @@ void update_displays_from_click(MouseState& state, ClickEntry x) noexcept {
 
 	auto screens = get_all_screens();
 
+	// We are intersted only in the displays that are alive.
+	std::vector<size_t> alive;
+	state.display_times.containing(MAX, [&](size_t i) { alive.push_back(i); });
+
 	std::unordered_set<Screen> screens_found;
-	for (auto& d : state.display_entries) {
-		// We are intersted only in the displays that are alive.
-		if (d.timestamp_end != MAX) continue;
+	for (auto i : alive) {
+		auto& d = state.display_entries[i];
 
 		bool found = false;
 		for (auto& y : screens.screens) {
@@ -968,7 +1629,7 @@ void update_displays_from_click(MouseState& state, ClickEntry x) noexcept {
 		// Then that mean that d has been disconnected and we should terminate it
 		// taking x.timestamp as it's death time.
 		if (!found) {
-			d.timestamp_end = x.timestamp;
+			state.end_display(i, x.timestamp);
 		}
 	}
 
@@ -992,7 +1653,7 @@ void update_displays_from_click(MouseState& state, ClickEntry x) noexcept {
 		d.timestamp_start = x.timestamp;
 		d.timestamp_end = MAX;
 
-		state.display_entries.push_back(d);
+		state.add_display(d);
 	}
 }
 
@@ -0,0 +1,204 @@
+#include "Merge.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include "ByteStream.hpp"
+#include "WriteAheadLog.hpp"
+
+// MouseState::Compaction_Tag, Mouse.hpp pulls the windows code.
+constexpr std::uint32_t Compaction_Tag = 'TPMC';
+constexpr size_t Flush_Bytes = 1 << 20;
+
+// Offsets in the 96 bytes of a display and in a click.
+constexpr size_t Display_Y = 12;
+constexpr size_t Display_Hash = 16;
+constexpr size_t Display_Name = 48;
+constexpr size_t Display_Name_Size = 32;
+constexpr size_t Click_Y = 5;
+
+// Makes the zero terminated string of size bytes at dst "<machine>/<string>", cut if too long.
+static void prefix_name(std::byte* dst, size_t size, const std::string& machine) noexcept {
+	auto str = (const char*)dst;
+	auto name = machine + "/" + std::string(str, strnlen(str, size));
+	if (name.size() > size - 1) name.resize(size - 1);
+
+	memset(dst, 0, size);
+	memcpy(dst, name.data(), name.size());
+}
+
+static void move_down(std::byte* y, size_t input) noexcept {
+	store_le(y, (std::uint32_t)(load_le<std::uint32_t>(y) + input * Machine_Stride));
+}
+
+int merge_saves(
+	SaveKind kind,
+	const std::vector<MergeInput>& inputs,
+	const std::filesystem::path& out_path,
+	MergeStats& stats
+) noexcept {
+	if (kind >= SaveKind::Count || inputs.empty()) return EINVAL;
+	auto& layout = Save_Layouts[(size_t)kind];
+
+	std::vector<SaveReader> readers(inputs.size());
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (auto err = readers[i].open(kind, inputs[i].path)) return err;
+	}
+
+	std::vector<std::byte> buffer;
+	ByteWriter writer{ buffer };
+
+	// The counters between the version and the record count are summed, along with the records
+	// of the logs the app would count when it replays them. Both are patched at the end, once the
+	// logs are read.
+	writer.write_bytes(readers[0].header.data(), layout.count_offset + 4);
+	std::vector<std::uint64_t> counters((layout.count_offset - 5) / 4, 0);
+	for (auto& x : readers) {
+		for (size_t j = 0; j < counters.size(); ++j) {
+			counters[j] += load_le<std::uint32_t>(x.header.data() + 5 + 4 * j);
+		}
+	}
+
+	size_t n_displays = 0;
+	if (kind == SaveKind::Mouse) {
+		for (auto& x : readers) n_displays += x.displays.size() / Save_Display_Size;
+		writer.write((std::uint32_t)n_displays);
+
+		for (size_t i = 0; i < readers.size(); ++i) {
+			auto& displays = readers[i].displays;
+			for (size_t off = 0; off < displays.size(); off += Save_Display_Size) {
+				auto dst = writer.claim(Save_Display_Size);
+				memcpy(dst, displays.data() + off, Save_Display_Size);
+
+				move_down(dst + Display_Y, i);
+				prefix_name(dst + Display_Hash, Display_Name_Size, inputs[i].machine);
+				if (dst[Display_Name] != std::byte{ 0 }) {
+					prefix_name(dst + Display_Name, Display_Name_Size, inputs[i].machine);
+				}
+			}
+		}
+	}
+
+	auto out = fopen(out_path.generic_string().c_str(), "wb");
+	if (!out) return errno ? errno : EIO;
+	auto flush = [&] {
+		fwrite(buffer.data(), 1, buffer.size(), out);
+		buffer.clear();
+	};
+	auto fail = [&](int err) {
+		fclose(out);
+		std::error_code ec;
+		std::filesystem::remove(out_path, ec);
+		return err;
+	};
+
+	// The smallest next record first, on a tie the first input. The record of an input stays
+	// valid until its next call to next().
+	auto timestamp = [&](const std::byte* record) {
+		return load_le<std::uint64_t>(record + layout.timestamp_offset);
+	};
+	using Head = std::pair<std::uint64_t, size_t>;
+	std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+	std::vector<const std::byte*> heads(readers.size());
+	std::vector<size_t> n_read(readers.size(), 0);
+
+	for (size_t i = 0; i < readers.size(); ++i) {
+		heads[i] = readers[i].next();
+		if (heads[i]) heap.push({ timestamp(heads[i]), i });
+	}
+
+	while (!heap.empty()) {
+		auto i = heap.top().second;
+		heap.pop();
+
+		auto dst = writer.claim(layout.record_size);
+		memcpy(dst, heads[i], layout.record_size);
+		if (kind == SaveKind::Mouse) move_down(dst + Click_Y, i);
+		if (kind == SaveKind::Event) prefix_name(dst, Save_String_Size, inputs[i].machine);
+
+		auto code = (size_t)heads[i][0];
+		if (n_read[i]++ >= readers[i].n_file_records && code < counters.size()) counters[code]++;
+		stats.n_records++;
+		if (buffer.size() >= Flush_Bytes) flush();
+
+		heads[i] = readers[i].next();
+		if (heads[i]) heap.push({ timestamp(heads[i]), i });
+	}
+
+	for (auto& x : readers) if (x.error) return fail(x.error);
+	if (stats.n_records > UINT32_MAX) return fail(EOVERFLOW);
+
+	// The sections, the generation starts over as the file has no log yet.
+	std::vector<std::pair<std::uint32_t, std::vector<std::byte>>> sections;
+	sections.push_back({ WriteAheadLog::Generation_Tag, {} });
+	ByteWriter{ sections.back().second }.write((std::uint64_t)0);
+
+	// The keys don't say what was dropped, the counters just have more than the records then.
+	if (kind == SaveKind::Keyboard) for (size_t i = 0; i < readers.size(); ++i) {
+		std::uint64_t n_keys = 0;
+		for (size_t off = 5; off < layout.count_offset; off += 4) {
+			n_keys += load_le<std::uint32_t>(readers[i].header.data() + off);
+		}
+		if (n_keys > readers[i].n_file_records) stats.n_compacted++;
+	}
+
+	if (kind == SaveKind::Mouse) {
+		std::uint64_t raw_since = 0;
+		std::vector<std::uint64_t> compacted;
+		compacted.reserve(n_displays);
+
+		for (auto& x : readers) {
+			auto n = x.displays.size() / Save_Display_Size;
+			auto section = x.section(Compaction_Tag);
+
+			std::uint64_t since = 0;
+			if (section && section->size() >= 12) since = load_le<std::uint64_t>(section->data());
+			bool counts =
+				section && section->size() >= 12 &&
+				load_le<std::uint32_t>(section->data() + 8) == n &&
+				section->size() >= 12 + 8 * n;
+
+			bool dropped = since > 0;
+			for (size_t j = 0; j < n; ++j) {
+				compacted.push_back(counts ? load_le<std::uint64_t>(section->data() + 12 + 8 * j) : 0);
+				dropped |= compacted.back() > 0;
+			}
+			if (dropped) stats.n_compacted++;
+			raw_since = std::max(raw_since, since);
+		}
+
+		sections.push_back({ Compaction_Tag, {} });
+		ByteWriter section{ sections.back().second };
+		section.write(raw_since);
+		section.write((std::uint32_t)n_displays);
+		for (auto x : compacted) section.write(x);
+	}
+
+	writer.write((std::uint32_t)sections.size());
+	for (auto& [tag, payload] : sections) {
+		writer.write(tag);
+		writer.write((std::uint32_t)payload.size());
+		writer.write_bytes(payload.data(), payload.size());
+	}
+	flush();
+
+	// Kept at the max if they overflow.
+	buffer.resize(layout.count_offset - 5 + 4);
+	for (size_t j = 0; j < counters.size(); ++j) {
+		store_le(buffer.data() + 4 * j, (std::uint32_t)std::min<std::uint64_t>(counters[j], UINT32_MAX));
+	}
+	store_le(buffer.data() + layout.count_offset - 5, (std::uint32_t)stats.n_records);
+	fseek(out, 5, SEEK_SET);
+	flush();
+
+	if (ferror(out)) return fail(EIO);
+	if (fclose(out) != 0) {
+		std::error_code ec;
+		std::filesystem::remove(out_path, ec);
+		return EIO;
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "SaveReader.hpp"
+
+// Merges the save files of the same kind from several machines into one file of the current
+// version, for combined stats. The records are merged by timestamp with one SaveReader per input,
+// so the memory is a chunk per input whatever the size of the histories.
+// - The key and button counters are summed.
+// - The displays and the exe names are prefixed by "<machine>/" so they stay apart. The displays
+//   and the clicks of the i-th input are also moved down by i * Machine_Stride pixels, a click
+//   then only lands in the displays of its machine.
+// - Only the compaction counts of the displays are carried over in the sections. The app replays
+//   the minutes, the hours and the typing stats from the records the first time it loads the file,
+//   what an input already dropped by a compaction is only left in the counters.
+
+struct MergeInput {
+	std::filesystem::path path;
+	std::string machine;
+};
+
+struct MergeStats {
+	size_t n_records{ 0 };
+	// Inputs with records dropped by a compaction, their minutes and hours can't be rebuilt.
+	size_t n_compacted{ 0 };
+};
+
+constexpr std::uint32_t Machine_Stride = 1 << 24;
+
+// Returns 0 or an errno value, EILSEQ if an input isn't a save file of that kind in its current
+// version. The output can't be one of the inputs.
+[[nodiscard]] extern int merge_saves(
+	SaveKind kind,
+	const std::vector<MergeInput>& inputs,
+	const std::filesystem::path& out_path,
+	MergeStats& stats
+) noexcept;
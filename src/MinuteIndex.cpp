@@ -0,0 +1,187 @@
+#include "MinuteIndex.hpp"
+
+#include <limits>
+
+#include "ByteStream.hpp"
+#include "TimeInfo.hpp"
+
+void MinuteIndex::add(std::uint64_t timestamp) noexcept {
+	auto minute = timestamp / Minute_Ms;
+
+	// Late events for a minute already folded go to their hour.
+	if (!hours.empty() && minute < (first_hour + hours.size()) * Hour_Minutes) {
+		auto hour = minute / Hour_Minutes;
+		if (hour < first_hour) {
+			// A clock set back by years would insert as many hours.
+			if (first_hour - hour > Max_Jump_Minutes / Hour_Minutes) return;
+			hours.insert(std::begin(hours), (size_t)(first_hour - hour), 0);
+			first_hour = hour;
+		}
+		hours[hour - first_hour]++;
+		return;
+	}
+
+	bool inside = minute >= first_minute && minute - first_minute < counts.size();
+	if (!inside && !grow(minute)) return;
+
+	auto& x = counts[minute - first_minute];
+	if (x < std::numeric_limits<std::uint16_t>::max()) x++;
+}
+
+bool MinuteIndex::grow(std::uint64_t minute) noexcept {
+	auto end = first_minute + counts.size();
+	bool far = counts.empty();
+	far |= minute + Max_Jump_Minutes < first_minute || minute > end + Max_Jump_Minutes;
+	// Only asked on the jumps, the next events are inside.
+	if (far && minute > get_milliseconds_epoch() / Minute_Ms + Max_Jump_Minutes) return false;
+	if (far && !counts.empty() && minute < first_minute) return false;
+
+	if (counts.empty()) first_minute = minute;
+	if (minute < first_minute) {
+		// The clock went backward before the first event, it's rare enough to just shift.
+		counts.insert(std::begin(counts), (size_t)(first_minute - minute), 0);
+		first_minute = minute;
+	}
+	if (minute - first_minute >= counts.size()) counts.resize(minute - first_minute + 1, 0);
+	return true;
+}
+
+bool MinuteIndex::compact(std::uint64_t keep_from) noexcept {
+	auto keep_minute = keep_from / Minute_Ms / Hour_Minutes * Hour_Minutes;
+	if (counts.empty() || keep_minute <= first_minute) return false;
+
+	size_t n = (size_t)(keep_minute - first_minute);
+	if (n > counts.size()) n = counts.size();
+
+	for (size_t i = 0; i < n; ++i) {
+		auto hour = (first_minute + i) / Hour_Minutes;
+		if (hours.empty()) first_hour = hour;
+		if (hour - first_hour >= hours.size()) hours.resize(hour - first_hour + 1, 0);
+		hours[hour - first_hour] += counts[i];
+	}
+
+	counts.erase(std::begin(counts), std::begin(counts) + n);
+	first_minute += n;
+	return true;
+}
+
+[[nodiscard]] bool MinuteIndex::empty() const noexcept {
+	return counts.empty() && hours.empty();
+}
+
+[[nodiscard]] std::uint64_t MinuteIndex::origin_minute() const noexcept {
+	return hours.empty() ? first_minute : first_hour * Hour_Minutes;
+}
+
+[[nodiscard]] std::uint64_t MinuteIndex::end_minute() const noexcept {
+	if (!counts.empty()) return first_minute + counts.size();
+	return (first_hour + hours.size()) * Hour_Minutes;
+}
+
+[[nodiscard]] size_t MinuteIndex::total() const noexcept {
+	size_t sum = 0;
+	for (auto x : hours) sum += x;
+	for (auto x : counts) sum += x;
+	return sum;
+}
+
+[[nodiscard]] double MinuteIndex::count_between(std::uint64_t begin, std::uint64_t end) const noexcept {
+	return sum_minutes((double)begin / Minute_Ms, (double)end / Minute_Ms);
+}
+
+[[nodiscard]] double MinuteIndex::sum_minutes(double begin, double end) const noexcept {
+	if (end <= begin) return 0;
+
+	// Sums the buckets of width w starting at first overlapping [begin, end), each weighted by
+	// how much of it is in the range.
+	auto sum = [&](const auto& buckets, std::uint64_t first, double w) {
+		double s = 0;
+		if (buckets.empty()) return s;
+
+		auto first_bucket = (double)first;
+		auto lo = begin / w - first_bucket;
+		auto hi = end / w - first_bucket;
+		if (hi <= 0 || lo >= buckets.size()) return s;
+
+		size_t i = lo > 0 ? (size_t)lo : 0;
+		for (; i < buckets.size() && i < hi; ++i) {
+			auto a = lo > i ? lo : (double)i;
+			auto b = hi < i + 1 ? hi : (double)(i + 1);
+			s += buckets[i] * (b - a);
+		}
+		return s;
+	};
+
+	return sum(hours, first_hour, (double)Hour_Minutes) + sum(counts, first_minute, 1.0);
+}
+
+void MinuteIndex::reduce(size_t step, std::vector<float>& out) const noexcept {
+	if (step == 0) step = 1;
+
+	auto origin = origin_minute();
+	auto n = (end_minute() - origin + step - 1) / step;
+	if (out.size() > n) out.clear();
+
+	size_t start = out.empty() ? 0 : out.size() - 1;
+	out.resize(n, 0);
+
+	for (size_t i = start; i < n; ++i) {
+		auto begin = origin + i * step;
+		// The minutes are summed directly, sum_minutes is only needed for the hours.
+		float sum = 0;
+		if (!hours.empty() && begin < first_hour * Hour_Minutes + hours.size() * Hour_Minutes) {
+			sum = (float)sum_minutes((double)begin, (double)(begin + step));
+		}
+		else if (!counts.empty() && begin + step > first_minute) {
+			auto end = begin + step;
+			size_t j = begin > first_minute ? (size_t)(begin - first_minute) : 0;
+			size_t j_end = end - first_minute < counts.size() ? (size_t)(end - first_minute) : counts.size();
+			for (; j < j_end; ++j) sum += counts[j];
+		}
+		out[i] = sum;
+	}
+}
+
+void MinuteIndex::save(std::vector<std::byte>& bytes) const noexcept {
+	ByteWriter writer{ bytes };
+	writer.reserve(24 + 2 * counts.size() + 4 * hours.size());
+	writer.write(first_minute);
+	writer.write((std::uint32_t)counts.size());
+	writer.write_array(counts.data(), counts.size());
+
+	// The hours were added after, older readers stop after the minutes.
+	writer.write(first_hour);
+	writer.write((std::uint32_t)hours.size());
+	writer.write_array(hours.data(), hours.size());
+}
+
+[[nodiscard]] bool MinuteIndex::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	if (size < 12) return false;
+
+	auto first = load_le<std::uint64_t>(bytes.data() + offset);
+	auto n = load_le<std::uint32_t>(bytes.data() + offset + 8);
+	size_t it = 12 + 2 * (size_t)n;
+	if (size < it) return false;
+
+	first_minute = first;
+	counts.resize(n);
+	ByteReader reader{ bytes, offset + 12 };
+	reader.read_array(counts.data(), counts.size());
+
+	first_hour = 0;
+	hours.clear();
+	if (size >= it + 12) {
+		auto first_h = load_le<std::uint64_t>(bytes.data() + offset + it);
+		auto n_hours = load_le<std::uint32_t>(bytes.data() + offset + it + 8);
+		if (size < it + 12 + 4 * (size_t)n_hours) return false;
+
+		first_hour = first_h;
+		hours.resize(n_hours);
+		ByteReader hours_reader{ bytes, offset + it + 12 };
+		hours_reader.read_array(hours.data(), hours.size());
+	}
+
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Number of events per minute, appended as they come. A coarser view (hours, days, ...) is just
+// a reduction over the array so it never needs to go back to the raw entries.
+// Old minutes can be folded into per hour counts by compact, the hours come right before the
+// minutes and a reduction spreads an hour evenly over its minutes.
+struct MinuteIndex {
+	static constexpr std::uint64_t Minute_Ms = 60'000;
+	static constexpr std::uint64_t Hour_Minutes = 60;
+	// The index is dense, an event further than that outside of it has to be checked first.
+	static constexpr std::uint64_t Max_Jump_Minutes = 24 * Hour_Minutes;
+
+	std::uint64_t first_minute{ 0 }; // minutes since epoch of counts[0].
+	std::vector<std::uint16_t> counts;
+
+	std::uint64_t first_hour{ 0 }; // hours since epoch of hours[0].
+	std::vector<std::uint32_t> hours;
+
+	void add(std::uint64_t timestamp) noexcept;
+
+	// Folds the minutes before keep_from (ms since epoch, rounded down to the hour) into hours.
+	// Returns true if there was something to fold.
+	bool compact(std::uint64_t keep_from) noexcept;
+
+	[[nodiscard]] bool empty() const noexcept;
+	// Minutes since epoch of the start and the end of the index, hours included.
+	[[nodiscard]] std::uint64_t origin_minute() const noexcept;
+	[[nodiscard]] std::uint64_t end_minute() const noexcept;
+
+	[[nodiscard]] size_t total() const noexcept;
+	// Events in [begin, end) (ms since epoch), a minute or an hour only partly in the range
+	// counts for the part that is.
+	[[nodiscard]] double count_between(std::uint64_t begin, std::uint64_t end) const noexcept;
+
+	// Sums the counts in buckets of step minutes, out[i] covers the minutes
+	// [origin_minute() + i * step, origin_minute() + (i + 1) * step).
+	// Only the last bucket of out can still change as events come, so we start from there and
+	// calling this every frame only costs the minutes added since the last call. Clear out when
+	// step or origin_minute() changes.
+	void reduce(size_t step, std::vector<float>& out) const noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+
+private:
+	// Makes room for the minute, false when it's dropped as an outlier: further back than
+	// Max_Jump_Minutes, or ahead of the clock by as much. A longer jump forward is kept, it's the
+	// time the app was off.
+	[[nodiscard]] bool grow(std::uint64_t minute) noexcept;
+	// Same as count_between but in minutes since epoch.
+	[[nodiscard]] double sum_minutes(double begin, double end) const noexcept;
+};
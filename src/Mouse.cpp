@@ -2,17 +2,21 @@
 
 #include <cassert>
 #include <unordered_set>
+#include <algorithm>
 
 #include "imgui.h"
 
 #include "file.hpp"
 #include "Common.hpp"
+#include "ErrorCode.hpp"
+#include "ByteStream.hpp"
+#include "Parallel.hpp"
+#include "WriteAheadLog.hpp"
 #include "Logs.hpp"
 
 #include "render_stats.hpp"
 
 const std::filesystem::path MouseState::Default_Path{ "mouse.mto" };
-const size_t MouseState::Save_Every_Mod{ 50 };
 struct Version_0 {
 	static constexpr size_t File_Signature_Offset     = 0;
 	static constexpr size_t Verison_Offset            = 4;
@@ -20,15 +24,297 @@ struct Version_0 {
 	static constexpr size_t Click_Occurence_Size      = 4 * (MouseState::N_Button_Supported + 2);
 	static constexpr size_t Click_Entry_Size_Offset   = 5 + Click_Occurence_Size;
 	static constexpr size_t Display_Entry_Size_Offset = Click_Entry_Size_Offset + 4;
+	static constexpr size_t Display_List_Offset       = Display_Entry_Size_Offset + 4;
 };
 
-std::optional<MouseState> version0_read(const std::vector<std::byte>& bytes, bool strict) noexcept;
-std::optional<MouseState> version1_read(const std::vector<std::byte>& bytes, bool strict) noexcept;
-bool version0_write(const MouseState& state, const std::filesystem::path& path) noexcept;
+static std::optional<MouseState> version0_read(const std::vector<std::byte>& bytes, bool strict) noexcept;
+static std::optional<MouseState> version1_read(const std::vector<std::byte>& bytes, bool strict) noexcept;
+static std::optional<MouseState> version1_read_lazy(const std::filesystem::path& path, bool strict) noexcept;
+static bool version0_write(
+	const MouseState& state, const std::filesystem::path& path, std::vector<FileSection>& written
+) noexcept;
+
+// The counters are size_t in memory but u32 in the file.
+void read_buttons(const std::vector<std::byte>& bytes, size_t offset, MouseState& ms) noexcept {
+	std::array<std::uint32_t, MouseState::N_Button_Supported + 2> counts;
+	ByteReader reader{ bytes, offset };
+	reader.read_array(counts.data(), counts.size());
+	for (size_t i = 0; i < counts.size(); ++i) ms.buttons[i] = counts[i];
+}
+void write_buttons(ByteWriter& writer, const MouseState& ms) noexcept {
+	std::array<std::uint32_t, MouseState::N_Button_Supported + 2> counts;
+	for (size_t i = 0; i < counts.size(); ++i) counts[i] = (std::uint32_t)ms.buttons[i];
+	writer.write_array(counts.data(), counts.size());
+}
+
+void encode_click(const ClickEntry& x, std::byte* dst) noexcept {
+	dst[0] = (std::byte)x.button_code;
+	store_le(dst + 1, x.x);
+	store_le(dst + 5, x.y);
+	store_le(dst + 9, x.timestamp);
+}
+void decode_clicks(const std::byte* src, ClickEntry* dst, size_t n) noexcept {
+	parallel_blocks(n, Min_Decode_Block, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			auto record = src + ClickEntry::Byte_Size * i;
+			auto& click_entry = dst[i];
+
+			click_entry.button_code = (std::uint8_t)record[0];
+			click_entry.x = load_le<std::uint32_t>(record + 1);
+			click_entry.y = load_le<std::uint32_t>(record + 5);
+			click_entry.timestamp = load_le<std::uint64_t>(record + 9);
+		}
+	});
+}
+void encode_logged_click(const ClickEntry& x, std::byte* dst) noexcept {
+	encode_click(x, dst);
+	dst[ClickEntry::Byte_Size + 0] = (std::byte)x.wheel_scrolled;
+	dst[ClickEntry::Byte_Size + 1] = (std::byte)x.wheel_delta;
+}
+void decode_logged_clicks(const std::byte* src, ClickEntry* dst, size_t n) noexcept {
+	for (size_t i = 0; i < n; ++i, src += ClickEntry::Log_Size) {
+		decode_clicks(src, dst + i, 1);
+		dst[i].wheel_scrolled = (std::uint8_t)src[ClickEntry::Byte_Size + 0];
+		dst[i].wheel_delta = (std::uint8_t)src[ClickEntry::Byte_Size + 1];
+	}
+}
+// The columns after the clicks, a u32 n then record_size bytes per click, paged in with them.
+struct ClickColumn {
+	std::uint32_t tag;
+	size_t record_size;
+	std::optional<PendingRecords> MouseState::* pending;
+	std::uint8_t missing; // every byte of the field of a click the file has no column for.
+	void (*encode)(const ClickEntry& x, std::byte* dst) noexcept;
+	void (*decode)(const std::byte* src, ClickEntry& x) noexcept;
+};
+static constexpr ClickColumn Click_Columns[] = {
+	{
+		MouseState::Wheels_Tag, ClickEntry::Wheel_Packed_Size, &MouseState::pending_wheels, 0,
+		[](const ClickEntry& x, std::byte* dst) noexcept {
+			dst[0] = (std::byte)x.wheel_scrolled;
+			dst[1] = (std::byte)x.wheel_delta;
+		},
+		[](const std::byte* src, ClickEntry& x) noexcept {
+			x.wheel_scrolled = (std::uint8_t)src[0];
+			x.wheel_delta = (std::uint8_t)src[1];
+		}
+	},
+	{
+		MouseState::Gesture_Kinds_Tag, ClickEntry::Gesture_Packed_Size,
+		&MouseState::pending_gestures, ClickGesture::Count,
+		[](const ClickEntry& x, std::byte* dst) noexcept { dst[0] = (std::byte)x.gesture; },
+		[](const std::byte* src, ClickEntry& x) noexcept { x.gesture = (std::uint8_t)src[0]; }
+	},
+};
+static bool is_click_column(std::uint32_t tag) noexcept {
+	for (auto& c : Click_Columns) if (c.tag == tag) return true;
+	return false;
+}
+static void encode_column(
+	const ClickColumn& c, const std::vector<ClickEntry>& clicks, ByteWriter& writer
+) noexcept {
+	auto dst = writer.claim(c.record_size * clicks.size());
+	for (auto& x : clicks) {
+		c.encode(x, dst);
+		dst += c.record_size;
+	}
+}
+static void decode_column(
+	const ClickColumn& c, const std::byte* src, ClickEntry* dst, size_t n
+) noexcept {
+	for (size_t i = 0; i < n; ++i) c.decode(src + c.record_size * i, dst[i]);
+}
+// Only used if it has an entry per click.
+static const std::byte* find_column(
+	const ClickColumn& c,
+	const std::vector<std::byte>& bytes,
+	const std::vector<FileSection>& sections,
+	size_t n
+) noexcept {
+	auto column = find_section(sections, c.tag);
+	if (!column || column->size != 4 + c.record_size * n) return nullptr;
+	if (read_uint32(bytes, column->offset) != n) return nullptr;
+	return bytes.data() + column->offset + 4;
+}
+
+bool click_in_display(const Display& d, const ClickEntry& x) noexcept {
+	if (x.timestamp < d.timestamp_start || x.timestamp > d.timestamp_end) return false;
+	if (d.x > x.x || x.x > d.x + d.width) return false;
+	if (d.y > x.y || x.y > d.y + d.height) return false;
+	return true;
+}
+
+// Before the sections the minutes were not in the file, we build them once from the clicks.
+void replay_minutes(MouseState& ms) noexcept {
+	ms.minutes = {};
+	for (auto& x : ms.click_entries) ms.minutes.add(x.timestamp * 1'000);
+}
+void replay_week(MouseState& ms) noexcept {
+	ms.week = {};
+	for (auto& x : ms.click_entries) ms.week.add(ms.clock, x.timestamp * 1'000);
+}
+
+// The sections come after the clicks, the columns of the pending clicks are copied from the old
+// file.
+[[nodiscard]] int write_mouse_sections(
+	FileParts& parts, const MouseState& ms, std::vector<FileSection>& written
+) noexcept {
+	std::vector<std::pair<std::uint32_t, FileParts>> sections;
+	sections.push_back({ MouseState::Minutes_Tag, {} });
+	ms.minutes.save(sections.back().second.bytes());
+
+	sections.push_back({ MouseState::Compaction_Tag, {} });
+	ByteWriter writer{ sections.back().second.bytes() };
+	writer.write(ms.raw_since);
+	writer.write((std::uint32_t)ms.display_entries.size());
+	for (auto& x : ms.display_entries) writer.write(x.compacted_clicks);
+
+	sections.push_back({ MouseState::Travel_Tag, {} });
+	ByteWriter travel{ sections.back().second.bytes() };
+	travel.write((std::uint32_t)ms.display_entries.size());
+	for (auto& x : ms.display_entries) travel.write(x.travel);
+
+	sections.push_back({ MouseState::Scroll_Tag, {} });
+	ByteWriter scroll{ sections.back().second.bytes() };
+	scroll.write((std::uint32_t)ms.display_entries.size());
+	for (auto& x : ms.display_entries) scroll.write(x.scroll);
+
+	sections.push_back({ MouseState::Moves_Tag, {} });
+	if (ms.pending_moves) {
+		auto& pending = *ms.pending_moves;
+		auto& section = sections.back().second;
+		auto err = ms.moves.save_after(
+			pending.path, pending.offset, pending.size, ms.pending_moves_base, section
+		);
+		if (err) {
+			logs.write(LogTag::FileIO, "write_mouse_sections, MovePath::save_after: {}", err);
+			return err;
+		}
+	}
+	else ms.moves.save(sections.back().second.bytes());
+
+	sections.push_back({ MouseState::Gestures_Tag, {} });
+	ms.gestures.save(sections.back().second.bytes());
+
+	sections.push_back({ MouseState::Week_Tag, {} });
+	ms.week.save(sections.back().second.bytes());
+
+	// The pending clicks first, as in the file.
+	size_t n_pending = ms.pending_clicks ? ms.pending_clicks->count : 0;
+	size_t n_clicks = n_pending + ms.click_entries.size();
+	for (auto& c : Click_Columns) {
+		sections.push_back({ c.tag, {} });
+		auto& column = sections.back().second;
+		ByteWriter{ column.bytes() }.write((std::uint32_t)n_clicks);
+		auto& pending = ms.*c.pending;
+		if (pending && pending->count == n_pending) {
+			column.copy(pending->path, pending->offset, n_pending * c.record_size);
+		}
+		else {
+			auto& out = column.bytes();
+			out.resize(out.size() + n_pending * c.record_size, (std::byte)c.missing);
+		}
+		ByteWriter writer{ column.bytes() };
+		encode_column(c, ms.click_entries, writer);
+	}
+
+	sections.push_back({ WriteAheadLog::Generation_Tag, {} });
+	ByteWriter{ sections.back().second.bytes() }.write(ms.generation);
+
+	written = insert_sections(parts, std::move(sections));
+	return 0;
+}
+// The sections are in bytes, the columns of the clicks are only read here if they are loaded.
+// Returns false when the minutes are missing and need a replay.
+bool read_mouse_sections(
+	const std::vector<std::byte>& bytes, const std::vector<FileSection>& sections, MouseState& ms
+) noexcept {
+	auto compaction = find_section(sections, MouseState::Compaction_Tag);
+	if (compaction && compaction->size >= 12) {
+		ByteReader reader{ bytes, compaction->offset };
+		ms.raw_since = reader.read<std::uint64_t>();
+		auto n = reader.read<std::uint32_t>();
+		if (n == ms.display_entries.size() && compaction->size >= 12 + 8 * (size_t)n) {
+			for (auto& d : ms.display_entries) d.compacted_clicks = reader.read<std::uint64_t>();
+		}
+	}
+
+	auto travel = find_section(sections, MouseState::Travel_Tag);
+	if (travel && travel->size >= 4) {
+		ByteReader reader{ bytes, travel->offset };
+		auto n = reader.read<std::uint32_t>();
+		if (n == ms.display_entries.size() && travel->size >= 4 + 8 * (size_t)n) {
+			for (auto& d : ms.display_entries) d.travel = reader.read<std::uint64_t>();
+		}
+	}
+	auto scroll = find_section(sections, MouseState::Scroll_Tag);
+	if (scroll && scroll->size >= 4) {
+		ByteReader reader{ bytes, scroll->offset };
+		auto n = reader.read<std::uint32_t>();
+		if (n == ms.display_entries.size() && scroll->size >= 4 + 8 * (size_t)n) {
+			for (auto& d : ms.display_entries) d.scroll = reader.read<std::uint64_t>();
+		}
+	}
+	if (!ms.pending_clicks) {
+		auto n_clicks = ms.click_entries.size();
+		for (auto& c : Click_Columns) {
+			if (auto column = find_column(c, bytes, sections, n_clicks)) {
+				decode_column(c, column, ms.click_entries.data(), n_clicks);
+			}
+		}
+	}
+
+	// The moves can't be rebuilt from anything, without the section there are none.
+	auto moves = find_section(sections, MouseState::Moves_Tag);
+	if (moves && !ms.moves.load(bytes, moves->offset, moves->size)) {
+		logs.write(LogTag::FileIO, "read_mouse_sections, the moves section is ill formed.");
+	}
+	auto gestures = find_section(sections, MouseState::Gestures_Tag);
+	if (gestures && !ms.gestures.load(bytes, gestures->offset, gestures->size)) {
+		logs.write(LogTag::FileIO, "read_mouse_sections, the gestures section is ill formed.");
+	}
+
+	// The files before the week have it rebuilt from their clicks, a lazy load needs them now.
+	auto week = find_section(sections, MouseState::Week_Tag);
+	if (!week || !ms.week.load(bytes, week->offset, week->size)) {
+		if (ms.ensure_clicks_loaded()) replay_week(ms);
+	}
+
+	auto generation = find_section(sections, WriteAheadLog::Generation_Tag);
+	if (generation && generation->size >= 8) ms.generation = read_uint64(bytes, generation->offset);
+
+	auto minutes = find_section(sections, MouseState::Minutes_Tag);
+	return minutes && ms.minutes.load(bytes, minutes->offset, minutes->size);
+}
+
+void read_display(ByteReader& reader, Display& d) noexcept {
+	d.width = reader.read<std::uint32_t>();
+	d.height = reader.read<std::uint32_t>();
+	d.x = reader.read<std::uint32_t>();
+	d.y = reader.read<std::uint32_t>();
+	reader.read_bytes(d.unique_hash_char, Display::Unique_Hash_Size);
+	reader.read_bytes(d.custom_name, Display::Custom_Name_Size);
+	d.timestamp_start = reader.read<std::uint64_t>();
+	d.timestamp_end = reader.read<std::uint64_t>();
+}
 
 std::optional<MouseState> MouseState::load_from_file(
-	const std::filesystem::path& path, bool strict
+	const std::filesystem::path& path, bool strict, bool lazy
 ) noexcept {
+	auto indexed = [](std::optional<MouseState> opt) {
+		if (opt) opt->index_displays();
+		return opt;
+	};
+
+	if (lazy) {
+		std::vector<std::byte> header;
+		bool current_version =
+			file_read_range(path, 0, 5, header) == 0 &&
+			read_uint32(header, 0) == Mouse_File_Signature &&
+			read_uint8(header, 4) == 1;
+		if (current_version) return indexed(version1_read_lazy(path, strict));
+	}
+
 	const auto& opt_bytes = file_read_byte(path);
 	if (!opt_bytes) {
 		ErrorDescription error;
@@ -74,9 +360,9 @@ std::optional<MouseState> MouseState::load_from_file(
 
 	switch (version_number) {
 	case 0:
-		return version0_read(bytes, strict);
+		return indexed(version0_read(bytes, strict));
 	case 1:
-		return version1_read(bytes, strict);
+		return indexed(version1_read(bytes, strict));
 	default: {
 		ErrorDescription error;
 		error.location = "MouseState::load_from_file";
@@ -89,34 +375,260 @@ std::optional<MouseState> MouseState::load_from_file(
 }
 
 bool MouseState::save_to_file(const std::filesystem::path& path) noexcept {
-	return version0_write(*this, path);
+	std::vector<FileSection> written;
+	if (!version0_write(*this, path, written)) return false;
+	modifications_since_save = 0;
+
+	// The clicks that were never loaded are now after the new display list, their fields at the
+	// start of the new columns.
+	if (pending_clicks && pending_clicks->path == path) {
+		pending_clicks->offset =
+			Version_0::Display_List_Offset + Display::Byte_Size * display_entries.size();
+	}
+	for (auto& c : Click_Columns) {
+		auto& pending = this->*c.pending;
+		if (pending && pending->path == path) {
+			pending->offset = find_section(written, c.tag)->offset + 4;
+		}
+	}
+	// The samples written have the ones added since the load, they are all in the file now.
+	if (pending_moves && pending_moves->path == path) {
+		auto section = find_section(written, Moves_Tag);
+		pending_moves->offset = section->offset + MovePath::Header_Size;
+		pending_moves->size = section->size - MovePath::Header_Size - MovePath::Ends_Size;
+		pending_moves_base = {};
+		moves.bytes.clear();
+	}
+	return true;
 }
 
-size_t MouseState::increment_button(ClickEntry click) noexcept {
-	for (auto& d : display_entries) {
-		if (click.timestamp > d.timestamp_end) continue;
-		if (d.x > click.x || click.x > d.x + d.width) continue;
-		if (d.y > click.y || click.y > d.y + d.height) continue;
+bool MouseState::ensure_clicks_loaded() noexcept {
+	if (!pending_clicks) return true;
+	auto& pending = *pending_clicks;
 
-		cache.n_keys[d.unique_hash_char].v++;
+	std::vector<std::byte> bytes;
+	auto err = file_read_range(pending.path, pending.offset, pending.count * pending.record_size, bytes);
+	if (err) {
+		ErrorDescription error;
+		error.location = "MouseState::ensure_clicks_loaded";
+		error.quick_desc = "Couldn't read the clicks from the mouse save file.";
+		error.message = format_errno(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return false;
+	}
+
+	std::vector<ClickEntry> clicks(pending.count + click_entries.size());
+	decode_clicks(bytes.data(), clicks.data(), pending.count);
+	for (auto& c : Click_Columns) {
+		auto& column = this->*c.pending;
+		if (!column || column->count != pending.count) continue;
+		bytes.clear();
+		if (!file_read_range(column->path, column->offset, pending.count * c.record_size, bytes)) {
+			decode_column(c, bytes.data(), clicks.data(), pending.count);
+		}
+		else logs.write(LogTag::FileIO, "ensure_clicks_loaded, can't read a column of the clicks.");
 	}
+	std::copy(BEG_END(click_entries), std::begin(clicks) + pending.count);
+
+	click_entries = std::move(clicks);
+	pending_clicks.reset();
+	for (auto& c : Click_Columns) (this->*c.pending).reset();
+
+	cache.usage_plot.dirty = true;
+	for (auto& [_, x] : cache.n_keys) x.dirty = true;
+	return true;
+}
+
+bool MouseState::ensure_moves_loaded() noexcept {
+	if (!pending_moves) return true;
+	auto& pending = *pending_moves;
+
+	std::vector<std::byte> bytes;
+	auto err = file_read_range(pending.path, pending.offset, pending.size, bytes);
+	if (err) {
+		ErrorDescription error;
+		error.location = "MouseState::ensure_moves_loaded";
+		error.quick_desc = "Couldn't read the moves from the mouse save file.";
+		error.message = format_errno(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return false;
+	}
+
+	moves.prepend(bytes, pending_moves_base);
+	pending_moves.reset();
+	pending_moves_base = {};
+	return true;
+}
+
+bool MouseState::compact(const RetentionPolicy& policy, std::uint64_t now) noexcept {
+	size_t dropped = 0;
+	bool dropped_moves = false;
+
+	// The clicks are in seconds and come in order, the ones to drop are at the front of the file
+	// then of memory.
+	if (auto cutoff = policy.raw_cutoff(now) / 1'000; cutoff) {
+		auto drop = [&](const ClickEntry& x) {
+			if (x.timestamp >= cutoff) return false;
+			display_times.containing(x.timestamp, [&](size_t i) {
+				if (click_in_display(display_entries[i], x)) display_entries[i].compacted_clicks++;
+			});
+			return true;
+		};
+
+		if (pending_clicks) {
+			size_t n = 0;
+			auto err = drop_pending_prefix(*pending_clicks, n, [&](const std::byte* record) {
+				ClickEntry x;
+				decode_clicks(record, &x, 1);
+				return drop(x);
+			});
+			if (err) {
+				logs.write(LogTag::FileIO, "MouseState::compact, can't read the clicks: {}", err);
+			}
+			// The columns go along with the clicks, even the ones dropped before an error.
+			for (auto& c : Click_Columns) {
+				auto& column = this->*c.pending;
+				if (!column) continue;
+				column->offset += c.record_size * n;
+				column->count -= n;
+			}
+			dropped += n;
+			if (pending_clicks->count == 0) {
+				pending_clicks.reset();
+				for (auto& c : Click_Columns) (this->*c.pending).reset();
+			}
+		}
+		if (!pending_clicks) {
+			size_t n = 0;
+			while (n < click_entries.size() && drop(click_entries[n])) ++n;
+			click_entries.erase(std::begin(click_entries), std::begin(click_entries) + n);
+			dropped += n;
+		}
+
+		if (dropped > 0 && raw_since < cutoff) raw_since = cutoff;
+		// The samples of the file come first too, once they are all dropped the ones added since
+		// need the file's last one to be re-encoded.
+		if (pending_moves) {
+			auto& pending = *pending_moves;
+			size_t n = 0;
+			auto err = moves.drop_file_before(
+				pending.path, pending.offset, pending.size, pending_moves_base, cutoff * 1'000, n
+			);
+			if (err) {
+				logs.write(LogTag::FileIO, "MouseState::compact, can't read the moves: {}", err);
+			}
+			dropped_moves = n > 0;
+			if (pending.size == 0) (void)ensure_moves_loaded();
+		}
+		if (!pending_moves) dropped_moves = moves.drop_before(cutoff * 1'000) || dropped_moves;
+	}
+
+	bool folded = false;
+	if (auto cutoff = policy.minute_cutoff(now); cutoff) folded = minutes.compact(cutoff);
+
+	if (dropped > 0 || folded) {
+		cache.usage_plot.dirty = true;
+		for (auto& [_, x] : cache.n_keys) x.dirty = true;
+	}
+	return dropped > 0 || folded || dropped_moves;
+}
+
+size_t MouseState::increment_button(ClickEntry click) noexcept {
+	auto n = wheel_notches(click);
+	display_times.containing(click.timestamp, [&](size_t i) {
+		auto& d = display_entries[i];
+		if (!click_in_display(d, click)) return;
+		cache.n_keys[d.unique_hash_char].v++;
+		if (is_wheel(click.button_code)) d.scroll += n;
+	});
 
 	click_entries.push_back(click);
+	clicks_added++;
+	minutes.add(click.timestamp * 1'000);
+	week.add(clock, click.timestamp * 1'000);
 
 	++modifications_since_save;
-	++buttons[click.button_code];
+	buttons[click.button_code] += n;
 
+	return buttons[click.button_code];
+}
+
+void MouseState::add_move(const MoveSample& x) noexcept {
+	moves.add(x);
+	modifications_since_save++;
 
-	if (modifications_since_save >= Save_Every_Mod) {
-		//>TODO: do that in another thread it's kind of a dick move to block inputs...
-		if (!save_to_file(get_user_data_path() / App_Data_Dir_Name / Default_Path)) {
-			logs.lock_and_write("Can't save incremental change...");
+	// The displays are in seconds.
+	display_times.containing(x.timestamp / 1'000, [&](size_t i) {
+		auto& d = display_entries[i];
+		if (d.x <= x.x && x.x <= d.x + d.width && d.y <= x.y && x.y <= d.y + d.height) {
+			d.travel += x.distance;
 		}
-		// we reset it anyway to not spam File IO.
-		modifications_since_save = 0;
+	});
+}
+
+std::optional<ClickEntry> WheelCoalescer::wheel(
+	std::int32_t raw, std::uint32_t x, std::uint32_t y, std::uint64_t now_ms
+) noexcept {
+	auto button = (std::uint8_t)(
+		raw > 0 ? MouseState::ButtonMap::Wheel_Up : MouseState::ButtonMap::Wheel_Down
+	);
+	auto magnitude = raw > 0 ? raw : -raw;
+
+	std::optional<ClickEntry> ended;
+	bool continued =
+		pending &&
+		click.button_code == button &&
+		now_ms - last_ms <= Gap_Ms &&
+		delta + magnitude <= UINT8_MAX * Notch &&
+		(now_ms - start_ms) / Tick_Ms <= UINT8_MAX;
+	if (!continued) {
+		ended = flush();
+		pending = true;
+		click = {};
+		click.button_code = button;
+		click.x = x;
+		click.y = y;
+		click.timestamp = now_ms / 1'000;
+		delta = 0;
+		start_ms = now_ms;
 	}
+	delta += magnitude;
+	last_ms = now_ms;
+	return ended;
+}
 
-	return buttons[click.button_code];
+std::optional<ClickEntry> WheelCoalescer::idle(std::uint64_t now_ms) noexcept {
+	if (!pending || now_ms - last_ms <= Gap_Ms) return std::nullopt;
+	return flush();
+}
+
+std::optional<ClickEntry> WheelCoalescer::flush() noexcept {
+	if (!pending) return std::nullopt;
+	pending = false;
+
+	// A smooth wheel sends fractions of a notch, a scroll is at least one.
+	auto notches = (delta + Notch / 2) / Notch;
+	click.wheel_delta = (std::uint8_t)std::clamp<std::int32_t>(notches, 1, UINT8_MAX);
+	click.wheel_scrolled = (std::uint8_t)std::min<std::uint64_t>(
+		(last_ms - start_ms) / Tick_Ms, UINT8_MAX
+	);
+	return click;
+}
+
+void MouseState::add_button_up(const ButtonEvent& x) noexcept {
+	gestures.up(x.button, clicks_added - 1, x.timestamp);
+}
+
+void MouseState::add_gesture(const ClickGesture& x) noexcept {
+	// The ups are counted from the end, the ones dropped or not loaded are skipped.
+	gestures.add(x, [&](std::uint64_t click) {
+		auto back = clicks_added - click;
+		if (back == 0 || back > click_entries.size()) return;
+		click_entries[click_entries.size() - back].gesture = x.kind;
+	});
+	modifications_since_save++;
 }
 
 bool MouseState::reset_everything() noexcept {
@@ -131,7 +643,6 @@ void MouseWindow::render(std::optional<MouseState>& state) noexcept {
 
 	ImGui::Begin("Mouse");
 	defer{ ImGui::End(); };
-
 	if (reset_time_start == 0 && ImGui::Button("Reset")) {
 		reset_time_start = time(nullptr);
 	}
@@ -203,6 +714,10 @@ void MouseWindow::render(std::optional<MouseState>& state) noexcept {
 	ImGui::Separator();
 	ImGui::Checkbox("Buttons list", &render_buttons_list_checkbox);
 
+	if (!state->ensure_clicks_loaded()) {
+		ImGui::Text("Couldn't read the clicks from mouse.mto, see the logs.");
+	}
+
 	ImGui::Columns(2);
 	ImGui::BeginChild("list");
 	if (render_buttons_list_checkbox) {
@@ -218,10 +733,16 @@ void MouseWindow::render(std::optional<MouseState>& state) noexcept {
 
 	ImGui::Separator();
 
+	render_mouse_travel(*state);
+	render_mouse_scroll(*state, scroll_apps);
+	render_click_gestures(*state);
+	if (ImGui::CollapsingHeader("Week")) {
+		render_week_hours("Clicks by weekday and hour", state->week, 1, "clicks");
+	}
 	render_mouse_plot(*state);
 }
 
-std::optional<MouseState> version0_read(
+static std::optional<MouseState> version0_read(
 	const std::vector<std::byte>& bytes, bool strict
 ) noexcept {
 	size_t it = 5; // we start after the version byte and the signature bytes(4).
@@ -310,10 +831,12 @@ std::optional<MouseState> version0_read(
 		ms.click_entries.push_back(click_entry);
 	}
 
+	replay_minutes(ms);
+	replay_week(ms);
 	return ms;
 }
 
-std::optional<MouseState> version1_read(
+static std::optional<MouseState> version1_read(
 	const std::vector<std::byte>& bytes, bool strict
 ) noexcept {
 	size_t it = 5; // we start after the version byte and the signature bytes(4).
@@ -331,9 +854,8 @@ std::optional<MouseState> version1_read(
 
 	MouseState ms;
 
-	for (size_t i = 0; it < Version_0::Click_Occurence_Size + Version_0::Click_Occurence_Offset; it += 4, i++) {
-		ms.buttons[i] = read_uint32(bytes, it);
-	}
+	read_buttons(bytes, it, ms);
+	it += Version_0::Click_Occurence_Size;
 
 	auto click_entries_size = read_uint32(bytes, it);
 	ms.click_entries.reserve(click_entries_size);
@@ -368,81 +890,229 @@ std::optional<MouseState> version1_read(
 		i < display_entries_size && it + Display::Byte_Size < bytes.size();
 		++i, it += Display::Byte_Size
 	) {
-		size_t off = 0;
+		ByteReader reader{ bytes, it };
 		Display d;
-
-		d.width = read_uint32(bytes, it + off); off += sizeof(d.width);
-		d.height = read_uint32(bytes, it + off); off += sizeof(d.height);
-		d.x = read_uint32(bytes, it + off); off += sizeof(d.x);
-		d.y = read_uint32(bytes, it + off); off += sizeof(d.y);
-		for (size_t j = 0; j < Display::Unique_Hash_Size; ++j, ++off) {
-			d.unique_hash_char[j] = read_uint8(bytes, it + off);
-		}
-		for (size_t j = 0; j < Display::Custom_Name_Size; ++j, ++off) {
-			d.custom_name[j] = read_uint8(bytes, it + off);
-		}
-		d.timestamp_start = read_uint64(bytes, it + off); off += sizeof(d.timestamp_start);
-		d.timestamp_end = read_uint64(bytes, it + off); off += sizeof(d.timestamp_end);
+		read_display(reader, d);
 
 		ms.display_entries.push_back(d);
 	}
 
-	for (
-		size_t i = 0;
-		i < click_entries_size && it + ClickEntry::Byte_Size < bytes.size();
-		++i, it += ClickEntry::Byte_Size
-	) {
-		ClickEntry click_entry;
+	// When not strict we take as many clicks as there is in the file.
+	size_t n_clicks = bytes.size() > it ? (bytes.size() - it) / ClickEntry::Byte_Size : 0;
+	if (n_clicks > click_entries_size) n_clicks = click_entries_size;
 
-		click_entry.button_code = read_uint8(bytes, it);
-		click_entry.x = read_uint32(bytes, it + 1);
-		click_entry.y = read_uint32(bytes, it + 5);
-		click_entry.timestamp = read_uint64(bytes, it + 9);
+	ms.click_entries.resize(n_clicks);
+	decode_clicks(bytes.data() + it, ms.click_entries.data(), n_clicks);
+	it += ClickEntry::Byte_Size * n_clicks;
 
-		ms.click_entries.push_back(click_entry);
+	// A truncated file lost its sections anyway.
+	if (n_clicks != click_entries_size) {
+		replay_minutes(ms);
+		replay_week(ms);
+	}
+	else {
+		auto sections = read_sections(bytes, it);
+		if (!sections || !read_mouse_sections(bytes, *sections, ms)) replay_minutes(ms);
 	}
 
 	return ms;
 }
 
-bool version0_write(const MouseState& state, const std::filesystem::path& path) noexcept {
+// Only the counters and the ends of the moves, their samples stay in the file until
+// ensure_moves_loaded. False if the section is from before the ends, it is then read whole.
+static bool read_pending_moves(
+	const std::filesystem::path& path, const FileSection& section, MouseState& ms
+) noexcept {
+	if (section.size < MovePath::Header_Size + MovePath::Ends_Size) return false;
+
 	std::vector<std::byte> bytes;
-	insert_uint32(bytes, Mouse_File_Signature);
-	insert_uint8(bytes, 1);
+	if (file_read_range(path, section.offset, MovePath::Header_Size, bytes)) return false;
+	auto n_bytes = read_uint32(bytes, MovePath::Header_Size - 4);
+	if (section.size != MovePath::Header_Size + (std::uint64_t)n_bytes + MovePath::Ends_Size) {
+		return false;
+	}
+
+	auto ends_offset = section.offset + MovePath::Header_Size + n_bytes;
+	if (file_read_range(path, ends_offset, MovePath::Ends_Size, bytes)) return false;
+	if (!ms.moves.load_ends(bytes, 0)) return false;
 
-	for (auto& x : state.buttons) {
-		insert_uint32(bytes, x);
+	if (n_bytes > 0) {
+		ms.pending_moves = PendingSection{ path, section.offset + MovePath::Header_Size, n_bytes };
 	}
-	
-	insert_uint32(bytes, state.click_entries.size());
-	insert_uint32(bytes, state.display_entries.size());
+	return true;
+}
 
-	for (auto& x : state.display_entries) {
-		insert_uint32(bytes, x.width);
-		insert_uint32(bytes, x.height);
-		insert_uint32(bytes, x.x);
-		insert_uint32(bytes, x.y);
-		for (int i = 0; i < Display::Unique_Hash_Size; ++i) {
-			insert_uint8(bytes, x.unique_hash_char[i]);
+// Reads the counters and the displays, the clicks stay in the file until ensure_clicks_loaded.
+static std::optional<MouseState> version1_read_lazy(
+	const std::filesystem::path& path, bool strict
+) noexcept {
+	auto file_size = get_file_length(path);
+	std::vector<std::byte> bytes;
+	bool header_read =
+		file_size && *file_size >= Version_0::Display_List_Offset &&
+		file_read_range(path, 0, Version_0::Display_List_Offset, bytes) == 0;
+	if (!header_read) {
+		ErrorDescription error;
+		error.location = "version1_read_lazy";
+		error.quick_desc = "The mouse file is too short. It's ill-formed.";
+		error.message = "Couldn't read the first " +
+			std::to_string(Version_0::Display_List_Offset) + " bytes of: " + path.generic_string();
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return std::nullopt;
+	}
+
+	MouseState ms;
+	ms.version_number = 1;
+	read_buttons(bytes, Version_0::Click_Occurence_Offset, ms);
+	auto click_entries_size = read_uint32(bytes, Version_0::Click_Entry_Size_Offset);
+	auto display_entries_size = read_uint32(bytes, Version_0::Display_Entry_Size_Offset);
+
+	auto clicks_offset =
+		Version_0::Display_List_Offset + Display::Byte_Size * (std::uint64_t)display_entries_size;
+	auto file_size_verification = clicks_offset + ClickEntry::Byte_Size * (std::uint64_t)click_entries_size;
+	if (*file_size < file_size_verification) {
+		ErrorDescription error;
+		error.location = "version1_read_lazy";
+		error.quick_desc = "The mouse file is too short. It's ill-formed.";
+		error.message = "The file is: " + std::to_string(*file_size) + " when it should be at"
+			"least" + std::to_string(file_size_verification) + " bytes long." +
+			" The error is probably in the click and/or display entry list.";
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		if (strict || *file_size < clicks_offset) return std::nullopt;
+	}
+
+	bytes.clear();
+	if (file_read_range(path, Version_0::Display_List_Offset, clicks_offset - Version_0::Display_List_Offset, bytes)) {
+		return std::nullopt;
+	}
+	ms.display_entries.resize(display_entries_size);
+	ByteReader reader{ bytes };
+	for (auto& d : ms.display_entries) read_display(reader, d);
+
+	// When not strict we take as many clicks as there is in the file.
+	size_t n_clicks = (size_t)((*file_size - clicks_offset) / ClickEntry::Byte_Size);
+	if (n_clicks > click_entries_size) n_clicks = click_entries_size;
+	ms.pending_clicks = PendingRecords{ path, clicks_offset, n_clicks, ClickEntry::Byte_Size };
+
+	auto sections_offset = clicks_offset + ClickEntry::Byte_Size * (std::uint64_t)n_clicks;
+	std::optional<std::vector<FileSection>> sections;
+	if (n_clicks == click_entries_size) {
+		sections = read_file_sections(path, sections_offset, *file_size);
+	}
+
+	// The columns stay in the file with the clicks, the other sections are read one after the
+	// other into bytes.
+	bool sections_read = sections.has_value();
+	if (sections) {
+		for (auto& c : Click_Columns) {
+			bytes.clear();
+			auto column = find_section(*sections, c.tag);
+			bool column_ok =
+				column && column->size == 4 + c.record_size * (std::uint64_t)n_clicks &&
+				!file_read_range(path, column->offset, 4, bytes) &&
+				read_uint32(bytes, 0) == n_clicks;
+			if (column_ok) {
+				ms.*c.pending = PendingRecords{ path, column->offset + 4, n_clicks, c.record_size };
+			}
 		}
-		for (int i = 0; i < Display::Custom_Name_Size; ++i) {
-			insert_uint8(bytes, x.custom_name[i]);
+
+		// So are the samples of the moves.
+		auto moves = find_section(*sections, MouseState::Moves_Tag);
+		bool moves_pending = moves && read_pending_moves(path, *moves, ms);
+
+		bytes.clear();
+		std::vector<FileSection> loaded;
+		for (auto& x : *sections) {
+			if (is_click_column(x.tag)) continue;
+			if (moves_pending && x.tag == MouseState::Moves_Tag) continue;
+			loaded.push_back({ x.tag, bytes.size(), x.size });
+			sections_read = sections_read && !file_read_range(path, x.offset, x.size, bytes);
 		}
-		insert_uint64(bytes, x.timestamp_start);
-		insert_uint64(bytes, x.timestamp_end);
+		sections_read = sections_read && read_mouse_sections(bytes, loaded, ms);
+	}
+	if (!sections_read) {
+		if (!ms.ensure_clicks_loaded()) return std::nullopt;
+		replay_minutes(ms);
+		replay_week(ms);
+	}
+
+	return ms;
+}
+
+static bool version0_write(
+	const MouseState& state, const std::filesystem::path& path, std::vector<FileSection>& written
+) noexcept {
+	FileParts parts;
+	ByteWriter writer{ parts.bytes() };
+	size_t n_pending = state.pending_clicks ? state.pending_clicks->count : 0;
+	size_t n_clicks = n_pending + state.click_entries.size();
+
+	writer.reserve(
+		Version_0::Display_List_Offset + Display::Byte_Size * state.display_entries.size()
+	);
+
+	writer.write(Mouse_File_Signature);
+	writer.write((std::uint8_t)1);
+
+	write_buttons(writer, state);
+
+	writer.write((std::uint32_t)n_clicks);
+	writer.write((std::uint32_t)state.display_entries.size());
+
+	for (auto& x : state.display_entries) {
+		writer.write(x.width);
+		writer.write(x.height);
+		writer.write(x.x);
+		writer.write(x.y);
+		writer.write_bytes(x.unique_hash_char, Display::Unique_Hash_Size);
+		writer.write_bytes(x.custom_name, Display::Custom_Name_Size);
+		writer.write(x.timestamp_start);
+		writer.write(x.timestamp_end);
 	}
 
+	// The clicks that were never loaded are copied as is from the old file, before we overwrite it.
+	if (state.pending_clicks) {
+		auto& pending = *state.pending_clicks;
+		parts.copy(pending.path, pending.offset, n_pending * pending.record_size);
+	}
+
+	ByteWriter clicks{ parts.bytes() };
+	auto dst = clicks.claim(ClickEntry::Byte_Size * state.click_entries.size());
 	for (auto& x : state.click_entries) {
-		insert_uint8(bytes, x.button_code);
-		insert_uint32(bytes, x.x);
-		insert_uint32(bytes, x.y);
-		insert_uint64(bytes, x.timestamp);
+		encode_click(x, dst);
+		dst += ClickEntry::Byte_Size;
 	}
 
-	return file_overwrite_byte(bytes, path) == 0;
+	if (write_mouse_sections(parts, state, written)) return false;
+	return file_replace_atomic(parts, path) == 0;
 }
 
 void MouseState::remove_display(size_t display_idx) noexcept {
 	cache.n_keys.erase(display_entries[display_idx].unique_hash_char);
 	display_entries.erase(std::begin(display_entries) + display_idx);
+	// The indices after it moved.
+	index_displays();
+}
+
+void MouseState::add_display(const Display& d) noexcept {
+	display_entries.push_back(d);
+	display_times.insert(d.timestamp_start, d.timestamp_end, display_entries.size() - 1);
+}
+
+void MouseState::end_display(size_t display_idx, std::uint64_t timestamp) noexcept {
+	display_entries[display_idx].timestamp_end = timestamp;
+	display_times.set_end(display_idx, timestamp);
+}
+
+void MouseState::index_displays() noexcept {
+	std::vector<IntervalTree::Interval> intervals;
+	intervals.reserve(display_entries.size());
+	for (size_t i = 0; i < display_entries.size(); ++i) {
+		auto& d = display_entries[i];
+		intervals.push_back({ d.timestamp_start, d.timestamp_end, i });
+	}
+	display_times.build(std::move(intervals));
 }
@@ -5,15 +5,38 @@
 #include <array>
 #include <algorithm>
 #include <unordered_map>
+#include <map>
 #include <string_view>
+#include <string>
+
+#include "Common.hpp"
+#include "MinuteIndex.hpp"
+#include "Retention.hpp"
+#include "IntervalTree.hpp"
+#include "MouseMoves.hpp"
+#include "ClickGestures.hpp"
+#include "WeekHours.hpp"
 
 struct ClickEntry {
 	static constexpr size_t Byte_Size = 17;
+	// The columns of the save file: u8 wheel_scrolled, u8 wheel_delta, and u8 gesture.
+	static constexpr size_t Wheel_Packed_Size = 2;
+	static constexpr size_t Gesture_Packed_Size = 1;
+	// The write ahead log record: the version 1 record then the wheel fields. The gesture is only
+	// known later, a replayed click has none.
+	static constexpr size_t Log_Size = Byte_Size + Wheel_Packed_Size;
 
-	std::uint8_t specify_display;
-	std::uint8_t wheel_scrolled;
-	std::uint8_t wheel_delta;
+	std::uint8_t specify_display{ 0 };
+	// A Wheel_Up or Wheel_Down entry is a whole scroll summed by the hook, see WheelCoalescer.
+	// How long it lasted, in WheelCoalescer::Tick_Ms.
+	std::uint8_t wheel_scrolled{ 0 };
+	// Notches scrolled, 0 when it's not known (the write ahead log, an old file) and counts as 1.
+	std::uint8_t wheel_delta{ 0 };
 	std::uint8_t button_code;
+	// The ClickGesture::Kind of the press this up ended, the first and second ups of a double are
+	// both Double. ClickGesture::Count when it's not known: a scroll, the write ahead log, a single
+	// not ended yet.
+	std::uint8_t gesture{ ClickGesture::Count };
 	std::uint32_t x;
 	std::uint32_t y;
 	std::uint64_t timestamp;
@@ -32,10 +55,25 @@ struct Display {
 	char custom_name[Unique_Hash_Size];
 	std::uint64_t timestamp_start;
 	std::uint64_t timestamp_end{ 0 };
+
+	// Clicks in this display that were dropped by a compaction, not part of the 96 bytes.
+	std::uint64_t compacted_clicks{ 0 };
+	// Pixels the pointer went through in this display, not part of the 96 bytes either.
+	std::uint64_t travel{ 0 };
+	// Wheel notches scrolled in this display, same.
+	std::uint64_t scroll{ 0 };
 };
 
 constexpr std::uint32_t Mouse_File_Signature = 'SUOM'; // 'MOUS' byte swapped.
 
+[[nodiscard]] extern bool click_in_display(const Display& d, const ClickEntry& x) noexcept;
+// The version 1 record, also the one of the write ahead logs written before they had the wheel.
+extern void encode_click(const ClickEntry& x, std::byte* dst) noexcept;
+extern void decode_clicks(const std::byte* src, ClickEntry* dst, size_t n) noexcept;
+// The write ahead log record, ClickEntry::Log_Size bytes.
+extern void encode_logged_click(const ClickEntry& x, std::byte* dst) noexcept;
+extern void decode_logged_clicks(const std::byte* src, ClickEntry* dst, size_t n) noexcept;
+
 struct MouseStateCache {
 	template<typename T>
 	struct Cached {
@@ -59,7 +97,15 @@ struct MouseStateCache {
 
 struct MouseState {
 	static const std::filesystem::path Default_Path;
-	static const size_t Save_Every_Mod;
+	static constexpr std::uint32_t Minutes_Tag = 'XNIM'; // 'MINX' byte swapped.
+	static constexpr std::uint32_t Compaction_Tag = 'TPMC'; // 'CMPT' byte swapped.
+	static constexpr std::uint32_t Moves_Tag = 'HTAP'; // 'PATH' byte swapped.
+	static constexpr std::uint32_t Travel_Tag = 'LVRT'; // 'TRVL' byte swapped.
+	static constexpr std::uint32_t Wheels_Tag = 'LEHW'; // 'WHEL' byte swapped.
+	static constexpr std::uint32_t Scroll_Tag = 'LRCS'; // 'SCRL' byte swapped.
+	static constexpr std::uint32_t Gestures_Tag = 'RTSG'; // 'GSTR' byte swapped.
+	static constexpr std::uint32_t Gesture_Kinds_Tag = 'DNKG'; // 'GKND' byte swapped.
+	static constexpr std::uint32_t Week_Tag = 'KEEW'; // 'WEEK' byte swapped.
 	
 	enum class ButtonMap : uint8_t {
 		Left = 0,
@@ -76,27 +122,124 @@ struct MouseState {
 
 	uint8_t version_number;
 	std::vector<ClickEntry> click_entries;
+	// Set by a lazy load, the clicks in the file that are not in click_entries yet.
+	std::optional<PendingRecords> pending_clicks;
+	// The wheel and gesture columns of the pending clicks, read with them. Not set if the file
+	// had none.
+	std::optional<PendingRecords> pending_wheels;
+	std::optional<PendingRecords> pending_gestures;
 	std::vector<Display> display_entries;
+	// The lifetimes of display_entries by index, for the displays alive at a given time. Goes
+	// through add_display, end_display and remove_display.
+	IntervalTree display_times;
+	// Wheel_Up and Wheel_Down count notches, the other buttons clicks.
 	std::array<size_t, N_Button_Supported + 2> buttons;
+	MinuteIndex minutes; // clicks per minute, fed with the timestamps in ms.
+	// The decimated pointer path, its samples are not in the write ahead log. A lazy load leaves
+	// the ones of the file in it until ensure_moves_loaded, moves then only has the ones added
+	// since and pending_moves_base is the sample the first of the file is encoded against.
+	MovePath moves;
+	std::optional<PendingSection> pending_moves;
+	MoveSample pending_moves_base{};
+	// What the presses were, from the downs and ups paired in the ingest. Not in the write ahead
+	// log either.
+	ClickGestures gestures;
+	// Since the start, the serial of the next click for the ups waiting in gestures.
+	std::uint64_t clicks_added{ 0 };
+	// Clicks and scrolls by local weekday and hour, like the minutes.
+	WeekHours week;
+	LocalClock clock;
+	// Seconds since epoch, the clicks before it were dropped by a compaction and only remain in
+	// minutes and in the compacted_clicks of the displays. 0 if none were.
+	std::uint64_t raw_since{ 0 };
 
 	size_t modifications_since_save{ 0 };
+	std::uint64_t generation{ 0 }; // of the last snapshot, see WriteAheadLog.
 
 	[[nodiscard]]
 	static std::optional<MouseState> load_from_file(
-		const std::filesystem::path& path, bool strict
+		const std::filesystem::path& path, bool strict, bool lazy = false
 	) noexcept;
 	[[nodiscard]] bool save_to_file(const std::filesystem::path& path) noexcept;
+	// The display stats and the usage plot need the clicks, they are read on their first call.
+	[[nodiscard]] bool ensure_clicks_loaded() noexcept;
+	// For now only a compaction that drops all the samples of the file reads them.
+	[[nodiscard]] bool ensure_moves_loaded() noexcept;
+	// Drops the clicks older than the policy, counting them in their displays first, and folds
+	// the old minutes into hours. Returns true if something changed.
+	[[nodiscard]] bool compact(const RetentionPolicy& policy, std::uint64_t now) noexcept;
 
 	size_t increment_button(ClickEntry click) noexcept;
+	// In canonical coordinates, the distance goes to the display the sample is in.
+	void add_move(const MoveSample& x) noexcept;
+	// After the increment_button of the click of the up, its gesture comes later.
+	void add_button_up(const ButtonEvent& x) noexcept;
+	// Goes in the counters and in the clicks of its ups.
+	void add_gesture(const ClickGesture& x) noexcept;
 
 	[[nodiscard]] bool reset_everything() noexcept;
 	[[nodiscard]] bool save_blank_state(const std::filesystem::path& path) noexcept;
 
+	void add_display(const Display& d) noexcept;
+	// The display got disconnected at timestamp.
+	void end_display(size_t display_idx, std::uint64_t timestamp) noexcept;
 	void remove_display(size_t display_idx) noexcept;
+	void index_displays() noexcept;
 
 	mutable MouseStateCache cache;
 };
 
+[[nodiscard]] inline bool is_wheel(std::uint8_t button_code) noexcept {
+	return
+		button_code == (std::uint8_t)MouseState::ButtonMap::Wheel_Up ||
+		button_code == (std::uint8_t)MouseState::ButtonMap::Wheel_Down;
+}
+// What a click adds to its button counter.
+[[nodiscard]] inline size_t wheel_notches(const ClickEntry& x) noexcept {
+	return is_wheel(x.button_code) && x.wheel_delta > 0 ? x.wheel_delta : 1;
+}
+
+// In the mouse hook. A free spinning wheel sends hundreds of WM_MOUSEWHEEL in a flick, the ones in
+// the same direction less than Gap_Ms apart are summed into a single Wheel_Up or Wheel_Down entry.
+// The entry ends before a field would overflow. Fixed size, no allocation.
+struct WheelCoalescer {
+	static constexpr std::int32_t Notch = 120; // WHEEL_DELTA, a smooth wheel sends less.
+	static constexpr std::uint64_t Gap_Ms = 300;
+	static constexpr std::uint64_t Tick_Ms = 10;
+
+	bool pending{ false };
+	ClickEntry click{}; // where and when (s) the scroll started.
+	std::int32_t delta{ 0 }; // summed, always positive.
+	std::uint64_t start_ms{ 0 };
+	std::uint64_t last_ms{ 0 };
+
+	// raw is the signed high word of mouseData, x and y in the hook's coordinates. Returns the
+	// entry it ends, if it does.
+	[[nodiscard]] std::optional<ClickEntry> wheel(
+		std::int32_t raw, std::uint32_t x, std::uint32_t y, std::uint64_t now_ms
+	) noexcept;
+	// The wheel stopped for Gap_Ms, to be called on every message of the hook and by a timer when
+	// none comes.
+	[[nodiscard]] std::optional<ClickEntry> idle(std::uint64_t now_ms) noexcept;
+	[[nodiscard]] std::optional<ClickEntry> flush() noexcept;
+};
+
+// The wheel entries (timestamp in s, notches) and what they scrolled in each exe, joined with the
+// app usages by join_scroll_apps once the event lock is taken. Only the new wheels and the new
+// usages are joined, the notches by exe are kept from one join to the next.
+struct ScrollApps {
+	size_t n_scanned{ 0 }; // click entries already looked at.
+	std::uint64_t raw_since{ 0 }; // of the state when they were.
+	// Sorted by timestamp up to n_joined, the ones scanned since come after.
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> wheels;
+	size_t n_joined{ 0 };
+
+	bool apps_dirty{ true };
+	size_t apps_usages_size{ 0 }; // the usages joined.
+	std::map<std::string, std::uint64_t, std::less<>> notches;
+	std::vector<std::pair<std::string, std::uint64_t>> apps;
+};
+
 struct MouseWindow {
 	const size_t Reset_Button_Time = 5;
 
@@ -112,5 +255,7 @@ struct MouseWindow {
 	bool reload{ false };
 	bool save{ false };
 
+	ScrollApps scroll_apps;
+
 	void render(std::optional<MouseState>& state) noexcept;
 };
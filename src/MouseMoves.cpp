@@ -0,0 +1,288 @@
+#include "MouseMoves.hpp"
+
+#include <algorithm>
+
+#include "ByteStream.hpp"
+
+// Distance of p to the line through a and b, to a if they are the same point.
+static double distance_to_line(
+	const MoveDecimator::Point& p, const MoveDecimator::Point& a, const MoveDecimator::Point& b
+) noexcept {
+	double dx = b.x - a.x;
+	double dy = b.y - a.y;
+	double px = p.x - a.x;
+	double py = p.y - a.y;
+	auto length = std::sqrt(dx * dx + dy * dy);
+	if (length == 0) return std::sqrt(px * px + py * py);
+	return std::abs(dx * py - dy * px) / length;
+}
+
+void MoveDecimator::simplify(std::array<bool, Max_Points>& kept) const noexcept {
+	kept[0] = true;
+	kept[n_points - 1] = true;
+
+	// Top down with a budget: each round keeps the point the farthest from the kept ones around
+	// it, the first rounds take the corners that matter the most.
+	size_t n_kept = n_points > 1 ? 2 : 1;
+	while (n_kept < Max_Samples + 1) {
+		double worst = Epsilon;
+		size_t worst_i = 0;
+		size_t a = 0;
+		size_t b = 0;
+		for (size_t i = 1; i < n_points; ++i) {
+			if (kept[i]) {
+				a = i;
+				continue;
+			}
+			if (b < i) for (b = i + 1; !kept[b]; ++b);
+			auto d = distance_to_line(points[i], points[a], points[b]);
+			if (d > worst) {
+				worst = d;
+				worst_i = i;
+			}
+		}
+		if (worst_i == 0) break;
+		kept[worst_i] = true;
+		n_kept++;
+	}
+}
+
+static void append_varint(std::vector<std::uint8_t>& out, std::uint64_t z) noexcept {
+	while (z >= 0x80) {
+		out.push_back((std::uint8_t)(z | 0x80));
+		z >>= 7;
+	}
+	out.push_back((std::uint8_t)z);
+}
+static void append_zigzag(std::vector<std::uint8_t>& out, std::int64_t x) noexcept {
+	append_varint(out, ((std::uint64_t)x << 1) ^ (std::uint64_t)(x >> 63));
+}
+
+// The first sample is encoded against zeros.
+static void encode_sample(
+	std::vector<std::uint8_t>& out, const MoveSample& previous, const MoveSample& x
+) noexcept {
+	append_zigzag(out, (std::int64_t)(x.timestamp - previous.timestamp));
+	append_zigzag(out, (std::int32_t)(x.x - previous.x));
+	append_zigzag(out, (std::int32_t)(x.y - previous.y));
+	append_varint(out, x.distance);
+}
+
+// The sample at it, encoded against x, goes in x.
+static void decode_sample(
+	const std::uint8_t*& it, const std::uint8_t* end, MoveSample& x
+) noexcept {
+	auto varint = [&]() noexcept {
+		std::uint64_t z = 0;
+		for (unsigned shift = 0; it < end && shift < 64; shift += 7) {
+			auto byte = *it++;
+			z |= (std::uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		return z;
+	};
+	auto zigzag = [&]() noexcept {
+		auto z = varint();
+		return (z >> 1) ^ (0 - (z & 1));
+	};
+	x.timestamp += zigzag();
+	x.x += (std::uint32_t)zigzag();
+	x.y += (std::uint32_t)zigzag();
+	x.distance = (std::uint32_t)varint();
+}
+
+void MovePath::add(const MoveSample& x) noexcept {
+	if (count == 0) first = x;
+	encode_sample(bytes, count == 0 ? MoveSample{} : last, x);
+
+	// A sample with a distance continues the segment of the previous one.
+	if (count > 0 && x.distance > 0 && x.timestamp > last.timestamp) {
+		active_ms += x.timestamp - last.timestamp;
+	}
+	distance += x.distance;
+	last = x;
+	count++;
+}
+
+bool MovePath::drop_before(std::uint64_t cutoff) noexcept {
+	if (count == 0 || first.timestamp >= cutoff) return false;
+
+	std::vector<std::uint8_t> kept;
+	size_t n = 0;
+	MoveSample previous{};
+	for_each([&](const MoveSample& x) {
+		if (x.timestamp < cutoff) return;
+		if (n == 0) first = x;
+		encode_sample(kept, previous, x);
+		previous = x;
+		n++;
+	});
+
+	bool dropped = n != count;
+	bytes = std::move(kept);
+	count = n;
+	if (n == 0) first = last = {};
+	return dropped;
+}
+
+static void write_sample(ByteWriter& writer, const MoveSample& x) noexcept {
+	writer.write(x.timestamp);
+	writer.write(x.x);
+	writer.write(x.y);
+	writer.write(x.distance);
+}
+static MoveSample read_sample(ByteReader& reader) noexcept {
+	MoveSample x;
+	x.timestamp = reader.read<std::uint64_t>();
+	x.x = reader.read<std::uint32_t>();
+	x.y = reader.read<std::uint32_t>();
+	x.distance = reader.read<std::uint32_t>();
+	return x;
+}
+
+// u32 count, u64 distance, u64 active ms, u32 size, the encoded samples then the first and the
+// last ones as u64 timestamp, u32 x, y and distance. The files before the ends don't have them.
+void MovePath::save(std::vector<std::byte>& out) const noexcept {
+	ByteWriter writer{ out };
+	writer.reserve(Header_Size + bytes.size() + Ends_Size);
+	writer.write((std::uint32_t)count);
+	writer.write(distance);
+	writer.write(active_ms);
+	writer.write((std::uint32_t)bytes.size());
+	writer.write_bytes(bytes.data(), bytes.size());
+	write_sample(writer, first);
+	write_sample(writer, last);
+}
+
+[[nodiscard]] bool MovePath::load(
+	const std::vector<std::byte>& in, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ in, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(Header_Size)) return false;
+
+	MovePath loaded;
+	auto n = reader.read<std::uint32_t>();
+	loaded.distance = reader.read<std::uint64_t>();
+	loaded.active_ms = reader.read<std::uint64_t>();
+	auto n_bytes = reader.read<std::uint32_t>();
+	if (!reader.can_read(n_bytes)) return false;
+	loaded.bytes.resize(n_bytes);
+	reader.read_bytes(loaded.bytes.data(), n_bytes);
+
+	// The ends are needed to append, a garbled stream shows as a count that doesn't match.
+	loaded.for_each([&](const MoveSample& x) {
+		if (loaded.count == 0) loaded.first = x;
+		loaded.last = x;
+		loaded.count++;
+	});
+	if (loaded.count != n) return false;
+
+	*this = std::move(loaded);
+	return true;
+}
+
+[[nodiscard]] bool MovePath::load_ends(const std::vector<std::byte>& in, size_t offset) noexcept {
+	ByteReader reader{ in, offset };
+	if (!reader.can_read(Header_Size + Ends_Size)) return false;
+
+	MovePath loaded;
+	loaded.count = reader.read<std::uint32_t>();
+	loaded.distance = reader.read<std::uint64_t>();
+	loaded.active_ms = reader.read<std::uint64_t>();
+	(void)reader.read<std::uint32_t>(); // the size of the samples.
+	loaded.first = read_sample(reader);
+	loaded.last = read_sample(reader);
+
+	*this = std::move(loaded);
+	return true;
+}
+
+// The file is read a block at a time, a sample is only decoded once all of its bytes are in.
+static_assert(FileParts::File_Copy_Block >= MovePath::Max_Sample_Size);
+int MovePath::drop_file_before(
+	const std::filesystem::path& path,
+	std::uint64_t& offset,
+	size_t& size,
+	MoveSample& base,
+	std::uint64_t cutoff,
+	size_t& n
+) noexcept {
+	n = 0;
+	if (count == 0 || first.timestamp >= cutoff) return 0;
+
+	std::vector<std::byte> block;
+	while (size > 0) {
+		size_t want = std::min(size, FileParts::File_Copy_Block);
+		block.clear();
+		if (auto err = file_read_range(path, offset, want, block)) return err;
+
+		auto it = (const std::uint8_t*)block.data();
+		auto end = it + block.size();
+		bool last_block = want == size;
+		while (it < end && (last_block || (size_t)(end - it) >= Max_Sample_Size)) {
+			auto start = it;
+			auto x = base;
+			decode_sample(it, end, x);
+			if (x.timestamp >= cutoff) {
+				first = x;
+				return 0;
+			}
+			base = x;
+			offset += it - start;
+			size -= it - start;
+			count--;
+			n++;
+		}
+	}
+	return 0;
+}
+
+void MovePath::prepend(const std::vector<std::byte>& in, const MoveSample& base) noexcept {
+	auto src = (const std::uint8_t*)in.data();
+	std::vector<std::uint8_t> samples(src, src + in.size());
+	samples.insert(std::end(samples), std::begin(bytes), std::end(bytes));
+	bytes.clear();
+	if (count == 0) return;
+
+	// The first one is back against zeros.
+	auto it = (const std::uint8_t*)samples.data();
+	auto end = it + samples.size();
+	first = base;
+	decode_sample(it, end, first);
+	encode_sample(bytes, {}, first);
+	bytes.insert(std::end(bytes), it, end);
+}
+
+int MovePath::save_after(
+	const std::filesystem::path& path,
+	std::uint64_t offset,
+	size_t size,
+	const MoveSample& base,
+	FileParts& out
+) const noexcept {
+	std::vector<std::byte> head;
+	if (auto err = file_read_range(path, offset, std::min(size, Max_Sample_Size), head)) return err;
+
+	// The first one is back against zeros.
+	auto it = (const std::uint8_t*)head.data();
+	auto x = base;
+	decode_sample(it, it + head.size(), x);
+	std::vector<std::uint8_t> rebased;
+	encode_sample(rebased, {}, x);
+	size_t n_read = it - (const std::uint8_t*)head.data();
+
+	ByteWriter writer{ out.bytes() };
+	writer.write((std::uint32_t)count);
+	writer.write(distance);
+	writer.write(active_ms);
+	writer.write((std::uint32_t)(rebased.size() + size - n_read + bytes.size()));
+	writer.write_bytes(rebased.data(), rebased.size());
+	out.copy(path, offset + n_read, size - n_read);
+
+	ByteWriter tail{ out.bytes() };
+	tail.write_bytes(bytes.data(), bytes.size());
+	write_sample(tail, first);
+	write_sample(tail, last);
+	return 0;
+}
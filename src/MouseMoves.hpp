@@ -0,0 +1,194 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "file.hpp"
+
+// A point of the pointer path. The hook sees the moves at the rate of the mouse (up to 1000 Hz),
+// only a few of them make it to the queue, see MoveDecimator.
+struct MoveSample {
+	std::uint32_t x; // in the hook's coordinates then canonical ones, like the clicks.
+	std::uint32_t y;
+	// Pixels the pointer went through since the previous sample, along the raw path. 0 for the
+	// first sample after a pause.
+	std::uint32_t distance;
+	std::uint64_t timestamp; // ms since epoch.
+};
+
+// In the mouse hook. The moves of a segment (until a pause or Max_Segment_Ms) are kept at most
+// every Min_Point_Ms in a fixed buffer, the distance is summed on all of them. When the segment
+// ends it's simplified with Douglas-Peucker: the point farthest from the simplified path is kept
+// until the path is within Epsilon or Max_Samples are kept. A steady move then gives at most
+// Max_Samples per second. No allocation, a move is O(1) and the end of a segment
+// O(Max_Points * Max_Samples).
+struct MoveDecimator {
+	static constexpr size_t Max_Points = 128;
+	static constexpr std::uint64_t Min_Point_Ms = 8;
+	static constexpr std::uint64_t Pause_Ms = 100;
+	static constexpr std::uint64_t Max_Segment_Ms = 1'000;
+	static constexpr size_t Max_Samples = 4;
+	static constexpr double Epsilon = 6; // pixels.
+
+	struct Point {
+		std::int32_t x;
+		std::int32_t y;
+		std::uint64_t timestamp;
+		double distance; // since the start of the segment.
+	};
+	std::array<Point, Max_Points> points;
+	size_t n_points{ 0 };
+	// The first point is the last sample emitted, not to be emitted again.
+	bool continued{ false };
+	Point last_move{};
+
+	// Calls out(MoveSample) for the samples of the segment it ends, if it does.
+	template<typename F>
+	void move(std::int32_t x, std::int32_t y, std::uint64_t timestamp, F&& out) noexcept {
+		if (n_points > 0 && timestamp - last_move.timestamp > Pause_Ms) flush(out);
+
+		double distance = 0;
+		if (n_points > 0) {
+			double dx = x - last_move.x;
+			double dy = y - last_move.y;
+			distance = last_move.distance + std::sqrt(dx * dx + dy * dy);
+		}
+		last_move = { x, y, timestamp, distance };
+
+		if (n_points == 0) {
+			points[n_points++] = last_move;
+			return;
+		}
+		if (timestamp - points[n_points - 1].timestamp < Min_Point_Ms) return;
+
+		points[n_points++] = last_move;
+		bool full = n_points == Max_Points || timestamp - points[0].timestamp >= Max_Segment_Ms;
+		if (full) end_segment(out);
+	}
+
+	// The segment is over (a pause, a click), its samples are emitted.
+	template<typename F>
+	void flush(F&& out) noexcept {
+		// The last moves may have been skipped by Min_Point_Ms, the segment ends where the pointer
+		// stopped.
+		if (n_points > 0 && points[n_points - 1].timestamp != last_move.timestamp) {
+			if (n_points == Max_Points) n_points--;
+			points[n_points++] = last_move;
+		}
+		if (n_points > 0) end_segment(out);
+		n_points = 0;
+		continued = false;
+	}
+
+private:
+	// Marks the kept points, the ends always are.
+	void simplify(std::array<bool, Max_Points>& kept) const noexcept;
+
+	// Emits the kept points and starts the next segment from the last one.
+	template<typename F>
+	void end_segment(F&& out) noexcept {
+		std::array<bool, Max_Points> kept{};
+		simplify(kept);
+
+		double previous = 0;
+		for (size_t i = continued ? 1 : 0; i < n_points; ++i) {
+			if (!kept[i]) continue;
+			auto& p = points[i];
+			auto distance = (std::uint32_t)(p.distance - previous + 0.5);
+			out(MoveSample{ (std::uint32_t)p.x, (std::uint32_t)p.y, distance, p.timestamp });
+			previous = p.distance;
+		}
+
+		auto end = points[n_points - 1];
+		last_move.distance -= end.distance;
+		end.distance = 0;
+		points[0] = end;
+		n_points = 1;
+		continued = true;
+	}
+};
+
+// The samples of the state, delta encoded: each one is the zigzag varints of its dt (ms), dx and
+// dy with the previous one, then the varint of its distance. A few bytes a sample against the
+// 20 of a MoveSample.
+struct MovePath {
+	static constexpr size_t Header_Size = 24; // of the section, before the samples.
+	static constexpr size_t Ends_Size = 40; // the first and last samples, after them.
+	static constexpr size_t Max_Sample_Size = 25; // encoded.
+
+	// After a lazy load, only the samples added since: the ones of the file come before them.
+	// The counters and the ends are of all of them.
+	std::vector<std::uint8_t> bytes;
+	size_t count{ 0 };
+	MoveSample first{};
+	MoveSample last{};
+
+	std::uint64_t distance{ 0 }; // pixels, of all the samples even the dropped ones.
+	std::uint64_t active_ms{ 0 }; // time spent moving, between samples of the same segment.
+
+	void add(const MoveSample& x) noexcept;
+
+	template<typename F>
+	void for_each(F&& f) const noexcept {
+		auto it = bytes.data();
+		auto end = it + bytes.size();
+		MoveSample x{};
+		auto varint = [&]() noexcept {
+			std::uint64_t z = 0;
+			for (unsigned shift = 0; it < end && shift < 64; shift += 7) {
+				auto byte = *it++;
+				z |= (std::uint64_t)(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) break;
+			}
+			return z;
+		};
+		auto zigzag = [&]() noexcept {
+			auto z = varint();
+			return (z >> 1) ^ (0 - (z & 1));
+		};
+		while (it < end) {
+			x.timestamp += zigzag();
+			x.x += (std::uint32_t)zigzag();
+			x.y += (std::uint32_t)zigzag();
+			x.distance = (std::uint32_t)varint();
+			f(x);
+		}
+	}
+
+	// Drops the samples before cutoff (ms since epoch), the totals stay. Returns true if any was.
+	bool drop_before(std::uint64_t cutoff) noexcept;
+
+	void save(std::vector<std::byte>& out) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& in, size_t offset, size_t size) noexcept;
+
+	// For a lazy load, the samples stay in the file: size bytes at offset, the first one encoded
+	// against base, not {} once the ones before it were dropped.
+
+	// Only the counters and the ends, in is the Header_Size then the Ends_Size bytes of the
+	// section from offset. bytes is left empty.
+	[[nodiscard]] bool load_ends(const std::vector<std::byte>& in, size_t offset) noexcept;
+	// Drops the samples of the file before cutoff, moving the range past them: only those are
+	// read. Returns an errno, n is the number dropped even on error.
+	[[nodiscard]] int drop_file_before(
+		const std::filesystem::path& path,
+		std::uint64_t& offset,
+		size_t& size,
+		MoveSample& base,
+		std::uint64_t cutoff,
+		size_t& n
+	) noexcept;
+	// Puts the samples of the file, read into in, before the ones added since.
+	void prepend(const std::vector<std::byte>& in, const MoveSample& base) noexcept;
+	// As save, the first sample of the file is re-encoded and the others are copied. Returns an
+	// errno.
+	[[nodiscard]] int save_after(
+		const std::filesystem::path& path,
+		std::uint64_t offset,
+		size_t size,
+		const MoveSample& base,
+		FileParts& out
+	) const noexcept;
+};
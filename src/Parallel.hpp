@@ -0,0 +1,37 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+// Under that many records it's not worth starting a thread.
+constexpr size_t Min_Decode_Block = 1 << 16;
+
+// Splits [0, n) in contiguous blocks and calls f(begin, end) for each of them on its own
+// thread, the calling thread takes the first block. The records of our files are fixed width so
+// the block boundaries are just multiples of the record size and every block can decode straight
+// to its place in a pre-sized vector, no stitching needed.
+// Small inputs (less than two blocks of min_block) run on the calling thread.
+template<typename F>
+void parallel_blocks(size_t n, size_t min_block, F&& f) noexcept {
+	size_t n_threads = std::thread::hardware_concurrency();
+	if (n_threads == 0) n_threads = 1;
+	if (n_threads > n / min_block) n_threads = n / min_block;
+	if (n_threads <= 1) {
+		f((size_t)0, n);
+		return;
+	}
+
+	auto block = (n + n_threads - 1) / n_threads;
+
+	std::vector<std::thread> workers;
+	workers.reserve(n_threads - 1);
+	for (size_t i = 1; i < n_threads; ++i) {
+		auto begin = i * block;
+		auto end = begin + block < n ? begin + block : n;
+		if (begin >= end) break;
+		workers.emplace_back([&f, begin, end] { f(begin, end); });
+	}
+
+	f((size_t)0, block < n ? block : n);
+	for (auto& x : workers) x.join();
+}
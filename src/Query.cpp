@@ -0,0 +1,343 @@
+#include "Query.hpp"
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+constexpr size_t Flush_Size = 1 << 16;
+constexpr size_t Max_Request_Size = 1 << 10;
+constexpr size_t Max_Buckets = 1 << 20;
+
+static std::uint64_t ms_to_us(std::uint64_t t) noexcept {
+	return t > UINT64_MAX / 1'000 ? UINT64_MAX : t * 1'000;
+}
+
+struct QueryOut {
+	const QueryWrite& write;
+	std::string buffer;
+	bool ok{ true };
+	size_t n_rows{ 0 };
+
+	void print(const char* fmt, ...) noexcept {
+		char line[512];
+		va_list args;
+		va_start(args, fmt);
+		auto n = vsnprintf(line, sizeof(line), fmt, args);
+		va_end(args);
+		if (n > 0) buffer.append(line, std::min((size_t)n, sizeof(line) - 1));
+		if (buffer.size() >= Flush_Size) flush();
+	}
+
+	void string(const char* str, size_t max_size) noexcept {
+		buffer.push_back('"');
+		for (size_t i = 0; i < max_size && str[i]; ++i) {
+			auto c = str[i];
+			if (c == '"' || c == '\\') {
+				buffer.push_back('\\');
+				buffer.push_back(c);
+			}
+			else if ((unsigned char)c < 0x20) {
+				print("\\u%04x", (unsigned)c);
+			}
+			else {
+				buffer.push_back(c);
+			}
+		}
+		buffer.push_back('"');
+	}
+
+	void flush() noexcept {
+		if (ok && !buffer.empty()) ok = write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+};
+
+static void end(QueryOut& out, const QuerySnapshot& snapshot, bool complete) noexcept {
+	out.print(
+		"{\"end\":true,\"rows\":%zu,\"snapshot_ms\":%llu,\"complete\":%s}\n",
+		out.n_rows,
+		(unsigned long long)snapshot.time,
+		complete ? "true" : "false"
+	);
+}
+
+static void error(QueryOut& out, const char* message) noexcept {
+	out.print("{\"error\":");
+	out.string(message, Max_Request_Size);
+	out.print(",\"end\":true}\n");
+}
+
+static std::vector<std::string_view> split(std::string_view str) noexcept {
+	std::vector<std::string_view> words;
+	size_t i = 0;
+	while (i < str.size()) {
+		while (i < str.size() && (str[i] == ' ' || str[i] == '\t' || str[i] == '\r')) ++i;
+		auto start = i;
+		while (i < str.size() && str[i] != ' ' && str[i] != '\t' && str[i] != '\r') ++i;
+		if (i > start) words.push_back(str.substr(start, i - start));
+	}
+	return words;
+}
+
+static bool parse_u64(std::string_view str, std::uint64_t& out) noexcept {
+	if (str.empty() || str.size() > 20) return false;
+	out = 0;
+	for (auto c : str) {
+		if (c < '0' || c > '9') return false;
+		out = out * 10 + (c - '0');
+	}
+	return true;
+}
+
+static void info(QueryOut& out, const QuerySnapshot& snapshot) noexcept {
+	auto b = [](bool x) { return x ? "true" : "false"; };
+	out.print(
+		"{\"snapshot_ms\":%llu,"
+		"\"keyboard\":{\"loaded\":%s,\"complete\":%s,\"keys\":%zu},"
+		"\"mouse\":{\"loaded\":%s,\"complete\":%s,\"clicks\":%zu},"
+		"\"event\":{\"loaded\":%s,\"complete\":%s,\"usages\":%zu}}\n",
+		(unsigned long long)snapshot.time,
+		b(snapshot.keyboard.loaded), b(snapshot.keyboard.complete), snapshot.keyboard.keys.size,
+		b(snapshot.mouse.loaded), b(snapshot.mouse.complete), snapshot.mouse.clicks.size,
+		b(snapshot.event.loaded), b(snapshot.event.complete), snapshot.event.usages.size
+	);
+	out.n_rows++;
+	end(out, snapshot, true);
+}
+
+template<size_t N>
+static void counters(
+	QueryOut& out, const QuerySnapshot& snapshot, const std::array<std::uint64_t, N>& counts
+) noexcept {
+	out.print("{\"counts\":[");
+	for (size_t i = 0; i < N; ++i) out.print(i ? ",%llu" : "%llu", (unsigned long long)counts[i]);
+	out.print("]}\n");
+	out.n_rows++;
+	end(out, snapshot, true);
+}
+
+static void histogram(
+	QueryOut& out,
+	const QuerySnapshot& snapshot,
+	const MinuteIndex& minutes,
+	std::uint64_t from,
+	std::uint64_t to,
+	std::uint64_t bucket
+) noexcept {
+	if (bucket == 0 || to < from || (to - from) / bucket >= Max_Buckets) {
+		return error(out, "the range needs to be less than a million buckets");
+	}
+
+	for (auto t = from; t < to && out.ok; t += bucket) {
+		auto t_end = to - t < bucket ? to : t + bucket;
+		out.print(
+			"{\"start_ms\":%llu,\"count\":%.10g}\n", (unsigned long long)t, minutes.count_between(t, t_end)
+		);
+		out.n_rows++;
+	}
+	end(out, snapshot, true);
+}
+
+static void top_apps(
+	QueryOut& out, const QuerySnapshot& snapshot, size_t n, std::uint64_t from, std::uint64_t to
+) noexcept {
+	struct Total {
+		std::uint64_t us{ 0 };
+		size_t usages{ 0 };
+	};
+	std::unordered_map<std::string_view, Total> totals;
+
+	// The usages are sorted by their end, a long one can start before a shorter one that ended
+	// sooner so the starts are checked all the way.
+	auto& usages = snapshot.event.usages;
+	auto from_us = ms_to_us(from);
+	auto to_us = ms_to_us(to);
+	auto first = usages.lower_bound(from_us, [](auto& x) { return x.end_us; });
+	for (auto i = first; i < usages.size; ++i) {
+		auto& x = usages[i];
+		if (x.start_us > to_us) continue;
+
+		auto& total = totals[{ x.exe.data(), strnlen(x.exe.data(), x.exe.size()) }];
+		total.us += std::min(x.end_us, to_us) - std::max(x.start_us, from_us);
+		total.usages++;
+	}
+
+	std::vector<std::pair<std::string_view, Total>> sorted{ std::begin(totals), std::end(totals) };
+	std::sort(std::begin(sorted), std::end(sorted), [](auto& a, auto& b) {
+		return a.second.us > b.second.us;
+	});
+	if (sorted.size() > n) sorted.resize(n);
+
+	for (auto& [exe, total] : sorted) {
+		out.print("{\"exe\":");
+		out.string(exe.data(), exe.size());
+		out.print(",\"ms\":%llu,\"usages\":%zu}\n", (unsigned long long)(total.us / 1'000), total.usages);
+		out.n_rows++;
+	}
+	end(out, snapshot, snapshot.event.complete);
+}
+
+static void scan_keyboard(
+	QueryOut& out, const QuerySnapshot& snapshot, std::uint64_t from, std::uint64_t to
+) noexcept {
+	auto& keys = snapshot.keyboard.keys;
+	auto first = keys.lower_bound(from, [](auto& x) { return x.timestamp_ms; });
+	for (auto i = first; i < keys.size && out.ok; ++i) {
+		auto& x = keys[i];
+		if (x.timestamp_ms > to) break;
+
+		out.print(
+			"{\"timestamp_ms\":%llu,\"key_code\":%u}\n", (unsigned long long)x.timestamp_ms, (unsigned)x.code
+		);
+		out.n_rows++;
+	}
+	end(out, snapshot, snapshot.keyboard.complete);
+}
+
+static void scan_mouse(
+	QueryOut& out, const QuerySnapshot& snapshot, std::uint64_t from, std::uint64_t to
+) noexcept {
+	// The clicks are in seconds, a second is in the range if any of it is.
+	auto& clicks = snapshot.mouse.clicks;
+	auto from_s = from / 1'000;
+	auto to_s = to / 1'000;
+	auto first = clicks.lower_bound(from_s, [](auto& x) { return x.timestamp_s; });
+	for (auto i = first; i < clicks.size && out.ok; ++i) {
+		auto& x = clicks[i];
+		if (x.timestamp_s > to_s) break;
+
+		out.print(
+			"{\"timestamp_s\":%llu,\"button\":%u,\"x\":%d,\"y\":%d}\n",
+			(unsigned long long)x.timestamp_s,
+			(unsigned)x.button,
+			(int)x.x,
+			(int)x.y
+		);
+		out.n_rows++;
+	}
+	end(out, snapshot, snapshot.mouse.complete);
+}
+
+static void scan_event(
+	QueryOut& out, const QuerySnapshot& snapshot, std::uint64_t from, std::uint64_t to
+) noexcept {
+	auto& usages = snapshot.event.usages;
+	auto from_us = ms_to_us(from);
+	auto to_us = ms_to_us(to);
+	auto first = usages.lower_bound(from_us, [](auto& x) { return x.end_us; });
+	for (auto i = first; i < usages.size && out.ok; ++i) {
+		auto& x = usages[i];
+		if (x.start_us > to_us) continue;
+
+		out.print(
+			"{\"start_us\":%llu,\"end_us\":%llu,\"exe\":",
+			(unsigned long long)x.start_us,
+			(unsigned long long)x.end_us
+		);
+		out.string(x.exe.data(), x.exe.size());
+		out.print(",\"doc\":");
+		out.string(x.doc.data(), x.doc.size());
+		out.print("}\n");
+		out.n_rows++;
+	}
+	end(out, snapshot, snapshot.event.complete);
+}
+
+bool answer_query(
+	std::string_view request, const QuerySnapshot& snapshot, const QueryWrite& write
+) noexcept {
+	QueryOut out{ write, {} };
+
+	auto words = split(request);
+	auto word = [&](size_t i) { return i < words.size() ? words[i] : std::string_view{}; };
+	auto command = word(0);
+	auto kind = word(1);
+
+	std::uint64_t a = 0;
+	std::uint64_t b = 0;
+	std::uint64_t c = 0;
+
+	auto loaded = [&](std::string_view x) {
+		if (x == "keyboard") return snapshot.keyboard.loaded;
+		if (x == "mouse")    return snapshot.mouse.loaded;
+		if (x == "event")    return snapshot.event.loaded;
+		return false;
+	};
+
+	if (command == "info" && words.size() == 1) {
+		info(out, snapshot);
+	}
+	else if (command == "counters" && words.size() == 2 && (kind == "keyboard" || kind == "mouse")) {
+		if (!loaded(kind))           error(out, "still loading");
+		else if (kind == "keyboard") counters(out, snapshot, snapshot.keyboard.counts);
+		else                         counters(out, snapshot, snapshot.mouse.counts);
+	}
+	else if (
+		command == "histogram" && words.size() == 5 && (kind == "keyboard" || kind == "mouse") &&
+		parse_u64(word(2), a) && parse_u64(word(3), b) && parse_u64(word(4), c)
+	) {
+		if (!loaded(kind))           error(out, "still loading");
+		else if (kind == "keyboard") histogram(out, snapshot, snapshot.keyboard.minutes, a, b, c);
+		else                         histogram(out, snapshot, snapshot.mouse.minutes, a, b, c);
+	}
+	else if (
+		command == "top_apps" && (words.size() == 2 || words.size() == 4) && parse_u64(word(1), c) &&
+		(words.size() == 2 || (parse_u64(word(2), a) && parse_u64(word(3), b)))
+	) {
+		if (words.size() == 2) b = UINT64_MAX;
+		if (!loaded("event")) error(out, "still loading");
+		else                  top_apps(out, snapshot, (size_t)c, a, b);
+	}
+	else if (command == "scan" && words.size() == 4 && parse_u64(word(2), a) && parse_u64(word(3), b)) {
+		if (!loaded(kind))           error(out, "unknown kind or still loading");
+		else if (kind == "keyboard") scan_keyboard(out, snapshot, a, b);
+		else if (kind == "mouse")    scan_mouse(out, snapshot, a, b);
+		else                         scan_event(out, snapshot, a, b);
+	}
+	else {
+		error(out, "unknown request, see Query.hpp");
+	}
+
+	out.flush();
+	return out.ok;
+}
+
+void serve_query_client(
+	const QuerySource& source, const QueryRead& read, const QueryWrite& write
+) noexcept {
+	std::string pending;
+	char buffer[4096];
+
+	while (auto n = read(buffer, sizeof(buffer))) {
+		pending.append(buffer, n);
+
+		size_t line_start = 0;
+		for (auto eol = pending.find('\n'); eol != std::string::npos; eol = pending.find('\n', line_start)) {
+			std::string_view line{ pending.data() + line_start, eol - line_start };
+			line_start = eol + 1;
+			if (split(line).empty()) continue;
+
+			auto snapshot = source();
+			if (!snapshot) {
+				QuerySnapshot empty;
+				if (!answer_query(line, empty, write)) return;
+			}
+			else if (!answer_query(line, *snapshot, write)) {
+				return;
+			}
+		}
+		pending.erase(0, line_start);
+
+		if (pending.size() > Max_Request_Size) {
+			QueryOut out{ write, {} };
+			error(out, "request too long");
+			out.flush();
+			return;
+		}
+	}
+}
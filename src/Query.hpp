@@ -0,0 +1,153 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "MinuteIndex.hpp"
+
+// The query api answers from an immutable copy of the states, a client only holds a shared_ptr to
+// one and never takes the locks of the states. The app publishes a new one every
+// Snapshot_Period_Ms while clients are around, see publish_query_snapshot in Main.
+//
+// A client sends one request per line and gets json lines back, the last one has "end". The
+// timestamps of the requests are in ms since epoch, the rows are the ones of the json lines export.
+//   info                                          the snapshot time and what's loaded.
+//   counters keyboard|mouse                       {"counts":[...]} by key or button code.
+//   histogram keyboard|mouse <from> <to> <bucket> {"start_ms":..,"count":..} per bucket.
+//   top_apps <n> [<from> <to>]                    {"exe":..,"ms":..,"usages":..} most used first.
+//   scan keyboard|mouse|event <from> <to>         the records in the range, a usage if it overlaps.
+// "end" also has "rows", "snapshot_ms" and "complete", false when the oldest records of a scan
+// are still only in the file. A bad request gets {"error":..,"end":true}.
+
+struct QueryKey {
+	std::uint64_t timestamp_ms;
+	std::uint8_t code;
+};
+struct QueryClick {
+	std::uint64_t timestamp_s;
+	std::uint8_t button;
+	std::int32_t x;
+	std::int32_t y;
+};
+struct QueryUsage {
+	static constexpr size_t Max_String_Size = 128;
+
+	std::uint64_t start_us;
+	std::uint64_t end_us;
+	std::array<char, Max_String_Size> exe;
+	std::array<char, Max_String_Size> doc;
+};
+
+inline bool operator==(const QueryKey& a, const QueryKey& b) noexcept {
+	return a.timestamp_ms == b.timestamp_ms && a.code == b.code;
+}
+inline bool operator==(const QueryClick& a, const QueryClick& b) noexcept {
+	return a.timestamp_s == b.timestamp_s && a.button == b.button && a.x == b.x && a.y == b.y;
+}
+inline bool operator==(const QueryUsage& a, const QueryUsage& b) noexcept {
+	return a.start_us == b.start_us && a.end_us == b.end_us && a.exe == b.exe;
+}
+
+// Records in chunks shared between the snapshots, a new snapshot only copies the chunk that was
+// still filling up and what came since.
+template<typename T>
+struct SnapshotLog {
+	static constexpr size_t Chunk_Size = 1 << 14;
+
+	std::vector<std::shared_ptr<const std::vector<T>>> chunks;
+	size_t size{ 0 };
+
+	[[nodiscard]] const T& operator[](size_t i) const noexcept {
+		return (*chunks[i / Chunk_Size])[i % Chunk_Size];
+	}
+
+	// Brings the log up to src, convert(src[i]) gives the record. When src isn't this log with
+	// more records at the end, it was compacted, reset or reloaded, it's copied from scratch.
+	template<typename S, typename F>
+	void sync(const std::vector<S>& src, F&& convert) {
+		bool appended =
+			src.size() >= size &&
+			(size == 0 || (convert(src[0]) == (*this)[0] && convert(src[size - 1]) == (*this)[size - 1]));
+		if (!appended) {
+			chunks.clear();
+			size = 0;
+		}
+
+		while (size < src.size()) {
+			auto chunk = std::make_shared<std::vector<T>>();
+			// The older snapshots keep the chunk they had.
+			if (size % Chunk_Size != 0) {
+				*chunk = *chunks.back();
+				chunks.pop_back();
+			}
+
+			chunk->reserve(Chunk_Size);
+			while (chunk->size() < Chunk_Size && size < src.size()) chunk->push_back(convert(src[size++]));
+			chunks.push_back(std::move(chunk));
+		}
+	}
+
+	// The first record whose key is at least t, the records are sorted by key.
+	template<typename K>
+	[[nodiscard]] size_t lower_bound(std::uint64_t t, K&& key) const noexcept {
+		size_t lo = 0;
+		size_t hi = size;
+		while (lo < hi) {
+			auto mid = lo + (hi - lo) / 2;
+			if (key((*this)[mid]) < t) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo;
+	}
+};
+
+struct QuerySnapshot {
+	static constexpr std::uint64_t Snapshot_Period_Ms = 1'000;
+	// Without requests for that long the snapshot is dropped, it's a copy of all the records.
+	static constexpr std::uint64_t Idle_Ms = 5 * 60 * 1'000;
+
+	std::uint64_t time{ 0 }; // when it was taken, ms since epoch.
+
+	struct Keyboard {
+		bool loaded{ false };
+		bool complete{ true }; // false while some of the entries are only in the file.
+		std::array<std::uint64_t, 0xff> counts{};
+		MinuteIndex minutes;
+		SnapshotLog<QueryKey> keys;
+	} keyboard;
+
+	struct Mouse {
+		bool loaded{ false };
+		bool complete{ true };
+		std::array<std::uint64_t, 34> counts{};
+		MinuteIndex minutes;
+		SnapshotLog<QueryClick> clicks;
+	} mouse;
+
+	struct Event {
+		bool loaded{ false };
+		bool complete{ true };
+		SnapshotLog<QueryUsage> usages; // in the order they ended.
+	} event;
+};
+
+using QuerySource = std::function<std::shared_ptr<const QuerySnapshot>()>;
+// Returns the bytes read, 0 once the client is gone.
+using QueryRead = std::function<size_t(char* dst, size_t size)>;
+// Returns false once the client is gone.
+using QueryWrite = std::function<bool(const char* src, size_t size)>;
+
+// Writes the answer of one request, streamed in pieces of a few tens of KB. Returns false if the
+// client is gone.
+[[nodiscard]] extern bool answer_query(
+	std::string_view request, const QuerySnapshot& snapshot, const QueryWrite& write
+) noexcept;
+
+// Answers the requests of a client in order until it disconnects, each one from the snapshot of
+// the time it came.
+extern void serve_query_client(
+	const QuerySource& source, const QueryRead& read, const QueryWrite& write
+) noexcept;
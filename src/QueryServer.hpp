@@ -0,0 +1,46 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "Query.hpp"
+
+// Serves the query api of Query.hpp to the local clients, one thread per client. On windows on the
+// named pipe \\.\pipe\<name>, elsewhere on the unix socket at the path <name>.
+struct QueryServer {
+	static constexpr auto Default_Name = "mes_touches";
+
+	// Returns 0 or the error code of the system.
+	[[nodiscard]] int start(const std::string& name, QuerySource source) noexcept;
+	// Disconnects the clients and waits for their threads.
+	void stop() noexcept;
+
+	QueryServer() = default;
+	QueryServer(const QueryServer&) = delete;
+	QueryServer& operator=(const QueryServer&) = delete;
+	~QueryServer() noexcept { stop(); }
+
+private:
+	struct Client {
+		std::intptr_t handle{ -1 }; // the pipe or the socket.
+		std::thread thread;
+		std::atomic<bool> done{ false };
+	};
+
+	std::string name;
+	QuerySource source;
+	std::intptr_t listener{ -1 };
+	std::thread accept_thread;
+	std::atomic<bool> stopping{ false };
+
+	std::mutex mut_clients;
+	std::vector<std::unique_ptr<Client>> clients;
+
+	void accept_loop() noexcept;
+	// Joins the threads of the clients that are gone.
+	void reap_clients() noexcept;
+};
@@ -0,0 +1,108 @@
+#include "QueryServer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int QueryServer::start(const std::string& name, QuerySource source) noexcept {
+	stop();
+	this->name = name;
+	this->source = std::move(source);
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (name.size() >= sizeof(address.sun_path)) return ENAMETOOLONG;
+	memcpy(address.sun_path, name.c_str(), name.size() + 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return errno;
+
+	// A socket file left by a crash would fail the bind.
+	unlink(name.c_str());
+	if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0) {
+		auto err = errno;
+		close(fd);
+		return err;
+	}
+
+	listener = fd;
+	stopping = false;
+	accept_thread = std::thread{ [this] { accept_loop(); } };
+	return 0;
+}
+
+void QueryServer::accept_loop() noexcept {
+	while (!stopping) {
+		int fd = accept((int)listener, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		reap_clients();
+
+		auto client = std::make_unique<Client>();
+		client->handle = fd;
+		auto x = client.get();
+		client->thread = std::thread{ [this, x] {
+			int fd = (int)x->handle;
+			auto read = [fd](char* dst, size_t size) -> size_t {
+				while (true) {
+					auto n = recv(fd, dst, size, 0);
+					if (n < 0 && errno == EINTR) continue;
+					return n > 0 ? (size_t)n : 0;
+				}
+			};
+			auto write = [fd](const char* src, size_t size) {
+				while (size > 0) {
+					auto n = send(fd, src, size, MSG_NOSIGNAL);
+					if (n < 0 && errno == EINTR) continue;
+					if (n <= 0) return false;
+					src += n;
+					size -= (size_t)n;
+				}
+				return true;
+			};
+			serve_query_client(source, read, write);
+			x->done = true;
+		} };
+
+		std::lock_guard lock{ mut_clients };
+		clients.push_back(std::move(client));
+	}
+}
+
+void QueryServer::reap_clients() noexcept {
+	std::lock_guard lock{ mut_clients };
+	for (size_t i = 0; i < clients.size();) {
+		if (!clients[i]->done) {
+			++i;
+			continue;
+		}
+		clients[i]->thread.join();
+		close((int)clients[i]->handle);
+		clients.erase(std::begin(clients) + i);
+	}
+}
+
+void QueryServer::stop() noexcept {
+	if (listener < 0) return;
+
+	// Wakes up the blocking accept and recv.
+	stopping = true;
+	shutdown((int)listener, SHUT_RDWR);
+	accept_thread.join();
+	close((int)listener);
+	unlink(name.c_str());
+	listener = -1;
+
+	std::lock_guard lock{ mut_clients };
+	for (auto& x : clients) shutdown((int)x->handle, SHUT_RDWR);
+	for (auto& x : clients) {
+		x->thread.join();
+		close((int)x->handle);
+	}
+	clients.clear();
+}
@@ -0,0 +1,136 @@
+#include "QueryServer.hpp"
+
+#include <Windows.h>
+
+constexpr DWORD Pipe_Buffer_Size = 1 << 16;
+
+static std::wstring pipe_path(const std::string& name) noexcept {
+	return L"\\\\.\\pipe\\" + std::wstring(std::begin(name), std::end(name));
+}
+
+// Only the first instance creates the pipe, a second app or anything else holding the name makes
+// start fail instead of sharing the clients.
+static HANDLE create_pipe(const std::wstring& path, bool first) noexcept {
+	return CreateNamedPipeW(
+		path.c_str(),
+		PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		PIPE_UNLIMITED_INSTANCES,
+		Pipe_Buffer_Size,
+		Pipe_Buffer_Size,
+		0,
+		nullptr
+	);
+}
+
+int QueryServer::start(const std::string& name, QuerySource source) noexcept {
+	stop();
+	this->name = name;
+	this->source = std::move(source);
+
+	// The instance that waits for the next client, a new one is created each time it's taken.
+	auto pipe = create_pipe(pipe_path(name), true);
+	if (pipe == INVALID_HANDLE_VALUE) return (int)GetLastError();
+
+	listener = (std::intptr_t)pipe;
+	stopping = false;
+	accept_thread = std::thread{ [this] { accept_loop(); } };
+	return 0;
+}
+
+void QueryServer::accept_loop() noexcept {
+	auto path = pipe_path(name);
+
+	while (!stopping) {
+		auto pipe = (HANDLE)listener;
+		bool connected = ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+		if (stopping) break;
+
+		auto next = create_pipe(path, false);
+		if (next == INVALID_HANDLE_VALUE) {
+			// We keep the current instance and try again with the next client.
+			if (connected) DisconnectNamedPipe(pipe);
+			Sleep(1'000);
+			continue;
+		}
+		listener = (std::intptr_t)next;
+		if (!connected) {
+			CloseHandle(pipe);
+			continue;
+		}
+
+		reap_clients();
+
+		auto client = std::make_unique<Client>();
+		client->handle = (std::intptr_t)pipe;
+		auto x = client.get();
+		client->thread = std::thread{ [this, x] {
+			auto pipe = (HANDLE)x->handle;
+			auto read = [pipe](char* dst, size_t size) -> size_t {
+				DWORD n = 0;
+				if (!ReadFile(pipe, dst, (DWORD)size, &n, nullptr)) return 0;
+				return n;
+			};
+			auto write = [pipe](const char* src, size_t size) {
+				while (size > 0) {
+					DWORD n = 0;
+					if (!WriteFile(pipe, src, (DWORD)size, &n, nullptr) || n == 0) return false;
+					src += n;
+					size -= n;
+				}
+				return true;
+			};
+			serve_query_client(source, read, write);
+
+			FlushFileBuffers(pipe);
+			DisconnectNamedPipe(pipe);
+			x->done = true;
+		} };
+
+		std::lock_guard lock{ mut_clients };
+		clients.push_back(std::move(client));
+	}
+}
+
+void QueryServer::reap_clients() noexcept {
+	std::lock_guard lock{ mut_clients };
+	for (size_t i = 0; i < clients.size();) {
+		if (!clients[i]->done) {
+			++i;
+			continue;
+		}
+		clients[i]->thread.join();
+		CloseHandle((HANDLE)clients[i]->handle);
+		clients.erase(std::begin(clients) + i);
+	}
+}
+
+void QueryServer::stop() noexcept {
+	if (listener == -1) return;
+
+	// Connecting ourselves wakes up the blocking ConnectNamedPipe.
+	stopping = true;
+	HANDLE self = CreateFileW(
+		pipe_path(name).c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr
+	);
+	if (self != INVALID_HANDLE_VALUE) CloseHandle(self);
+	accept_thread.join();
+	CloseHandle((HANDLE)listener);
+	listener = -1;
+
+	// After the disconnect their next ReadFile or WriteFile fails, the one they may be blocked in
+	// needs to be cancelled.
+	std::lock_guard lock{ mut_clients };
+	for (auto& x : clients) DisconnectNamedPipe((HANDLE)x->handle);
+	for (auto& x : clients) {
+		while (!x->done) {
+			CancelSynchronousIo((HANDLE)x->thread.native_handle());
+			Sleep(1);
+		}
+	}
+	for (auto& x : clients) {
+		x->thread.join();
+		CloseHandle((HANDLE)x->handle);
+	}
+	clients.clear();
+}
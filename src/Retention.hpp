@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Common.hpp"
+#include "file.hpp"
+
+// How long each resolution of the history is kept. The raw entries are dropped after raw_days,
+// the per minute counts are folded into per hour counts after minute_days and the hours are kept
+// forever. 0 keeps the tier forever.
+// The counters and the rollups are fed as the entries come, so dropping the entries doesn't
+// change them.
+struct RetentionPolicy {
+	static constexpr std::uint64_t Hour_Ms = 60 * 60 * 1'000;
+	static constexpr std::uint64_t Day_Ms = 24 * Hour_Ms;
+	static constexpr std::uint64_t Compaction_Period_Ms = Hour_Ms;
+
+	std::uint16_t raw_days{ 0 };
+	std::uint16_t minute_days{ 365 };
+
+	// In ms since epoch, rounded down to the hour so the tiers meet on a bucket boundary. 0 when
+	// the tier is kept forever.
+	[[nodiscard]] std::uint64_t raw_cutoff(std::uint64_t now) const noexcept {
+		return cutoff(raw_days, now);
+	}
+	[[nodiscard]] std::uint64_t minute_cutoff(std::uint64_t now) const noexcept {
+		return cutoff(minute_days, now);
+	}
+
+private:
+	[[nodiscard]] static std::uint64_t cutoff(std::uint16_t days, std::uint64_t now) noexcept {
+		if (days == 0 || now < days * Day_Ms) return 0;
+		return (now - days * Day_Ms) / Hour_Ms * Hour_Ms;
+	}
+};
+
+// Drops the records at the front of a pending block as long as drop(record) returns true. The
+// block is read Scan_Block records at a time so compacting a file never loads it whole.
+// Returns an errno. pending and dropped are updated after each block, so on a read error they
+// still count what drop has seen and the columns of the records can follow.
+template<typename F>
+[[nodiscard]] int drop_pending_prefix(PendingRecords& pending, size_t& dropped, F&& drop) noexcept {
+	constexpr size_t Scan_Block = 1 << 16;
+
+	std::vector<std::byte> bytes;
+	while (pending.count > 0) {
+		auto n = pending.count < Scan_Block ? pending.count : Scan_Block;
+
+		bytes.clear();
+		auto err = file_read_range(pending.path, pending.offset, n * pending.record_size, bytes);
+		if (err) return err;
+
+		size_t i = 0;
+		while (i < n && drop(bytes.data() + i * pending.record_size)) ++i;
+
+		pending.offset += i * pending.record_size;
+		pending.count -= i;
+		dropped += i;
+		if (i < n) break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include "SaveReader.hpp"
+
+#include <cerrno>
+
+#include "ByteStream.hpp"
+#include "WriteAheadLog.hpp"
+
+static std::FILE* open_read(const std::filesystem::path& path) noexcept {
+	return std::fopen(path.generic_string().c_str(), "rb");
+}
+
+// Replaces out by the next n bytes of the file.
+static bool read_exact(std::FILE* f, size_t n, std::vector<std::byte>& out) noexcept {
+	out.resize(n);
+	return n == 0 || fread(out.data(), 1, n, f) == n;
+}
+
+const char* save_kind_name(SaveKind kind) noexcept {
+	switch (kind) {
+	case SaveKind::Keyboard: return "keyboard";
+	case SaveKind::Mouse:    return "mouse";
+	case SaveKind::Event:    return "event";
+	default:                 return "unknown";
+	}
+}
+
+SaveReader::SaveReader(SaveReader&& other) noexcept {
+	*this = std::move(other);
+}
+
+SaveReader& SaveReader::operator=(SaveReader&& other) noexcept {
+	close();
+	kind = other.kind;
+	record_size = other.record_size;
+	log_record_size = other.log_record_size;
+	header = std::move(other.header);
+	n_file_records = other.n_file_records;
+	displays = std::move(other.displays);
+	sections = std::move(other.sections);
+	generation = other.generation;
+	error = other.error;
+	phase = other.phase;
+	path = std::move(other.path);
+	file = other.file;
+	wal = other.wal;
+	remaining = other.remaining;
+	chunk = std::move(other.chunk);
+	chunk_size = other.chunk_size;
+	chunk_next = other.chunk_next;
+
+	other.file = nullptr;
+	other.wal = nullptr;
+	other.phase = Phase::Done;
+	return *this;
+}
+
+SaveReader::~SaveReader() noexcept {
+	close();
+}
+
+void SaveReader::close() noexcept {
+	if (file) fclose(file);
+	if (wal) fclose(wal);
+	file = nullptr;
+	wal = nullptr;
+}
+
+int SaveReader::open(SaveKind kind, const std::filesystem::path& path) noexcept {
+	close();
+	*this = {};
+	if (kind >= SaveKind::Count) return EINVAL;
+
+	auto& layout = Save_Layouts[(size_t)kind];
+	this->kind = kind;
+	this->path = path;
+	record_size = layout.record_size;
+
+	file = open_read(path);
+	if (!file) return errno ? errno : ENOENT;
+
+	if (!read_exact(file, layout.count_offset + 4, header)) return EILSEQ;
+	if (load_le<std::uint32_t>(header.data()) != layout.signature) return EILSEQ;
+	if ((std::uint8_t)header[4] != layout.version) return EILSEQ;
+	n_file_records = load_le<std::uint32_t>(header.data() + layout.count_offset);
+
+	if (kind == SaveKind::Mouse) {
+		std::vector<std::byte> n;
+		if (!read_exact(file, 4, n)) return EILSEQ;
+		if (!read_exact(file, Save_Display_Size * load_le<std::uint32_t>(n.data()), displays)) {
+			return EILSEQ;
+		}
+	}
+
+	remaining = n_file_records;
+	phase = Phase::File;
+	return 0;
+}
+
+const std::byte* SaveReader::next() noexcept {
+	while (chunk_next == chunk_size) {
+		if (phase == Phase::Done || !read_chunk()) return nullptr;
+	}
+	auto size = phase == Phase::Wal ? log_record_size : record_size;
+	return chunk.data() + size * chunk_next++;
+}
+
+bool SaveReader::read_chunk() noexcept {
+	chunk_size = 0;
+	chunk_next = 0;
+
+	if (phase == Phase::File) {
+		if (remaining == 0) {
+			// The sections come after the records, we need the generation to know what of the log
+			// is not in the file yet. A file without it is from before the logs, like the app we
+			// take 0.
+			index_sections();
+			if (auto x = section(WriteAheadLog::Generation_Tag); x && x->size() >= 8) {
+				generation = load_le<std::uint64_t>(x->data());
+			}
+
+			// The file stays opened until the log is read, on windows it keeps the app from
+			// replacing both in the meantime.
+			open_wal();
+			return true;
+		}
+
+		auto n = Chunk_Bytes / record_size;
+		if (n > remaining) n = remaining;
+		if (!read_exact(file, n * record_size, chunk)) {
+			error = EIO;
+			phase = Phase::Done;
+			return false;
+		}
+		remaining -= n;
+		chunk_size = n;
+		return true;
+	}
+
+	// Same checks as WriteAheadLog::read, one batch at a time. A damaged batch ends the log.
+	std::vector<std::byte> batch_header;
+	if (!read_exact(wal, WriteAheadLog::Batch_Header_Size, batch_header)) {
+		phase = Phase::Done;
+		return false;
+	}
+	auto n = load_le<std::uint32_t>(batch_header.data());
+	auto sum = load_le<std::uint32_t>(batch_header.data() + 4);
+	bool valid =
+		n > 0 && n <= Max_Wal_Batch &&
+		read_exact(wal, n * log_record_size, chunk) &&
+		WriteAheadLog::checksum(chunk.data(), chunk.size()) == sum;
+	if (!valid) {
+		phase = Phase::Done;
+		return false;
+	}
+
+	chunk_size = n;
+	return true;
+}
+
+// Skips n bytes, in steps as long is 32 bits on windows.
+static bool skip(std::FILE* f, std::uint64_t n) noexcept {
+	constexpr std::uint64_t Max_Step = 1ull << 30;
+	while (n > 0) {
+		auto step = n < Max_Step ? n : Max_Step;
+		if (fseek(f, (long)step, SEEK_CUR)) return false;
+		n -= step;
+	}
+	return true;
+}
+
+// Only the headers are read, a truncated list keeps the sections before.
+void SaveReader::index_sections() noexcept {
+	std::vector<std::byte> bytes;
+	if (!read_exact(file, 4, bytes)) return;
+
+	auto count = load_le<std::uint32_t>(bytes.data());
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (!read_exact(file, 8, bytes)) return;
+
+		Section x;
+		x.tag = load_le<std::uint32_t>(bytes.data());
+		x.size = load_le<std::uint32_t>(bytes.data() + 4);
+		if (fgetpos(file, &x.position) || !skip(file, x.size)) return;
+		sections.push_back(x);
+	}
+}
+
+void SaveReader::open_wal() noexcept {
+	phase = Phase::Done;
+
+	auto wal_path = path;
+	wal_path.replace_extension(".wal");
+	wal = open_read(wal_path);
+	if (!wal) return;
+
+	std::vector<std::byte> wal_header;
+	bool follows =
+		read_exact(wal, WriteAheadLog::Header_Size, wal_header) &&
+		load_le<std::uint32_t>(wal_header.data()) == WriteAheadLog::Signature &&
+		load_le<std::uint64_t>(wal_header.data() + 8) == generation;
+	if (!follows) return;
+
+	log_record_size = load_le<std::uint32_t>(wal_header.data() + 4);
+	auto& layout = Save_Layouts[(size_t)kind];
+	if (log_record_size == layout.log_record_size || log_record_size == record_size) {
+		phase = Phase::Wal;
+	}
+}
+
+std::optional<std::vector<std::byte>> SaveReader::section(std::uint32_t tag) const noexcept {
+	for (auto& x : sections) if (x.tag == tag) {
+		std::vector<std::byte> payload;
+		if (!file || fsetpos(file, &x.position) || !read_exact(file, x.size, payload)) break;
+		return payload;
+	}
+	return std::nullopt;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+// Reads the records of a save file in order, a chunk at a time, then the ones of its write ahead
+// log that follow the same generation and so aren't in the file yet. The memory doesn't depend on
+// the size of the file.
+// Only uses the standard library and the portable headers, for the tools that run on copied files
+// (export, merge). It reads the current versions of the files; an older file has to be opened and
+// saved by the app once first.
+
+enum class SaveKind : std::uint8_t {
+	Keyboard = 0,
+	Mouse,
+	Event,
+	Count
+};
+
+// The layouts of version2_write (keyboard), version0_write (mouse, written as version 1) and
+// version0_write (event). They are repeated here so the tools don't need the states, they pull
+// the windows and imgui code.
+struct SaveLayout {
+	std::uint32_t signature;
+	std::uint8_t version;
+	size_t count_offset; // of the u32 record count, the records follow it.
+	size_t record_size;
+	size_t timestamp_offset; // of the u64 the records are sorted by, the end for a usage.
+	// The records of the write ahead log start with the one of the file, then the fields the file
+	// has in its columns.
+	size_t log_record_size;
+};
+constexpr SaveLayout Save_Layouts[] = {
+	// The log has the hold.
+	{ 'BYEK', 2, 5 + 255 * 4, 9, 1, 12 },
+	// Then an u32 display count and the displays before the clicks. The log has the wheel.
+	{ 'SUOM', 1, 5 + 34 * 4, 17, 9, 19 },
+	{ 'NEVE', 0, 5, 272, 264, 272 },
+};
+constexpr size_t Save_Display_Size = 96;
+constexpr size_t Save_String_Size = 128;
+
+[[nodiscard]] extern const char* save_kind_name(SaveKind kind) noexcept;
+
+struct SaveReader {
+	static constexpr size_t Chunk_Bytes = 1 << 20;
+	// A log batch is at most a few hundred records, more means its header is garbage.
+	static constexpr size_t Max_Wal_Batch = 1 << 20;
+
+	SaveKind kind{ SaveKind::Count };
+	size_t record_size{ 0 };
+	// Of the records of the log, it also reads the logs of before they had the columns.
+	size_t log_record_size{ 0 };
+
+	// Up to the record count, the signature, the version and the counters.
+	std::vector<std::byte> header;
+	size_t n_file_records{ 0 };
+	std::vector<std::byte> displays; // the mouse displays, Save_Display_Size bytes each.
+	// The section list after the records, indexed once they are all read. Only the payload of
+	// the asked section is read, the others can hold a column per record.
+	struct Section {
+		std::uint32_t tag;
+		std::uint32_t size;
+		std::fpos_t position; // of the payload.
+	};
+	std::vector<Section> sections;
+	std::uint64_t generation{ 0 };
+
+	SaveReader() = default;
+	SaveReader(SaveReader&& other) noexcept;
+	SaveReader& operator=(SaveReader&& other) noexcept;
+	SaveReader(const SaveReader&) = delete;
+	SaveReader& operator=(const SaveReader&) = delete;
+	~SaveReader() noexcept;
+
+	// Reads up to the records. Returns 0 or an errno value, EILSEQ if the file isn't a save file
+	// of that kind in its current version.
+	[[nodiscard]] int open(SaveKind kind, const std::filesystem::path& path) noexcept;
+
+	// The next record, nullptr at the end. error tells if it ended early. A record of the log is
+	// log_record_size bytes, the record_size first ones are as in the file.
+	[[nodiscard]] const std::byte* next() noexcept;
+	int error{ 0 };
+
+	// The payload of a section of the file, once the records are read.
+	[[nodiscard]] std::optional<std::vector<std::byte>> section(std::uint32_t tag) const noexcept;
+
+private:
+	enum class Phase { File, Wal, Done } phase{ Phase::Done };
+	std::filesystem::path path;
+	std::FILE* file{ nullptr };
+	std::FILE* wal{ nullptr };
+	size_t remaining{ 0 }; // records of the file not read yet.
+	std::vector<std::byte> chunk;
+	size_t chunk_size{ 0 }; // in records.
+	size_t chunk_next{ 0 };
+
+	void close() noexcept;
+	bool read_chunk() noexcept;
+	void index_sections() noexcept;
+	void open_wal() noexcept;
+};
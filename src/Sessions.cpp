@@ -0,0 +1,112 @@
+#include "Sessions.hpp"
+
+#include "ByteStream.hpp"
+
+void ActivitySessions::add(const ActivitySession& x) noexcept {
+	if (open.end == 0) {
+		open = x;
+		return;
+	}
+
+	// Out of order, the spans of a batch are by device. Before the open session, it's either
+	// close enough to extend it back or it's lost with the closed ones.
+	if (x.start <= open.end + idle_gap_ms && x.end + idle_gap_ms >= open.start) {
+		if (x.start < open.start && (closed.empty() || x.start > closed.back().end)) {
+			open.start = x.start;
+		}
+		if (x.end > open.end) open.end = x.end;
+		return;
+	}
+	if (x.end < open.start) return;
+
+	close();
+	open = x;
+}
+
+void ActivitySessions::close() noexcept {
+	closed.push_back(open);
+
+	// Split over the local days it covers, the clock only asks the timezone for another day.
+	bool first = true;
+	auto start = open.start;
+	do {
+		(void)clock.locate(start);
+		auto until = open.end < clock.next_midnight ? open.end : clock.next_midnight;
+
+		// The day is the last one, unless the clock was set back.
+		size_t i = days.size();
+		while (i > 0 && days[i - 1].date > clock.date) i--;
+		if (i > 0 && days[i - 1].date == clock.date) i--;
+		else days.insert(std::begin(days) + i, { clock.date, 0, 0 });
+		days[i].sessions += first;
+		days[i].active_ms += until - start;
+
+		first = false;
+		start = until;
+	} while (start < open.end);
+}
+
+// u32 n closed, the closed sessions, u8 1 and the open one if any, u32 n days, then per day
+// u32 date, u32 sessions and u64 active ms.
+void ActivitySessions::save(std::vector<std::byte>& bytes) const noexcept {
+	ByteWriter writer{ bytes };
+	writer.reserve(4 + Packed_Size * (closed.size() + 1) + 1 + 4 + 16 * days.size());
+
+	auto write_session = [&](const ActivitySession& x) {
+		auto duration = x.end - x.start;
+		writer.write(x.start);
+		writer.write((std::uint32_t)(duration < UINT32_MAX ? duration : UINT32_MAX));
+	};
+	writer.write((std::uint32_t)closed.size());
+	for (auto& x : closed) write_session(x);
+	writer.write((std::uint8_t)(open.end != 0));
+	if (open.end) write_session(open);
+
+	writer.write((std::uint32_t)days.size());
+	for (auto& x : days) {
+		writer.write(x.date);
+		writer.write(x.sessions);
+		writer.write(x.active_ms);
+	}
+}
+
+[[nodiscard]] bool ActivitySessions::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+
+	auto read_session = [&] {
+		ActivitySession x;
+		x.start = reader.read<std::uint64_t>();
+		x.end = x.start + reader.read<std::uint32_t>();
+		return x;
+	};
+
+	if (!reader.can_read(4)) return false;
+	size_t n_closed = reader.read<std::uint32_t>();
+	if (!reader.can_read(Packed_Size * n_closed + 1)) return false;
+	std::vector<ActivitySession> loaded_closed(n_closed);
+	for (auto& x : loaded_closed) x = read_session();
+
+	ActivitySession loaded_open{};
+	if (reader.read<std::uint8_t>()) {
+		if (!reader.can_read(Packed_Size)) return false;
+		loaded_open = read_session();
+	}
+
+	if (!reader.can_read(4)) return false;
+	size_t n_days = reader.read<std::uint32_t>();
+	if (!reader.can_read(16 * n_days)) return false;
+	std::vector<Day> loaded_days(n_days);
+	for (auto& x : loaded_days) {
+		x.date = reader.read<std::uint32_t>();
+		x.sessions = reader.read<std::uint32_t>();
+		x.active_ms = reader.read<std::uint64_t>();
+	}
+
+	closed = std::move(loaded_closed);
+	open = loaded_open;
+	days = std::move(loaded_days);
+	return true;
+}
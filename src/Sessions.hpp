@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "WeekHours.hpp"
+
+// How long without a key, a click or a focus change before a session ends, see the settings.
+constexpr std::uint64_t Default_Session_Idle_Gap_Ms = 5 * 60'000;
+
+// A stretch of time at the computer, ms since epoch. A lone event makes one with start == end.
+struct ActivitySession {
+	std::uint64_t start{ 0 };
+	std::uint64_t end{ 0 };
+};
+
+// In the ingest, the keys, clicks and moves of a batch as spans of activity. An event is one
+// comparison with the end of the last span, an event after a gap or out of order starts another.
+struct ActivitySpans {
+	std::uint64_t idle_gap_ms{ Default_Session_Idle_Gap_Ms };
+	ActivitySession last{}; // end is 0 if there is none.
+	std::vector<ActivitySession> spans; // the ones before last.
+
+	void feed(std::uint64_t ms) noexcept {
+		if (ms - last.end <= idle_gap_ms) {
+			last.end = ms;
+			return;
+		}
+		if (last.end) spans.push_back(last);
+		last = { ms, ms };
+	}
+
+	[[nodiscard]] bool empty() const noexcept { return last.end == 0; }
+
+	// Calls f(ActivitySession) for the spans in the order they came and forgets them.
+	template<typename F>
+	void drain(F&& f) noexcept {
+		for (auto& x : spans) f(x);
+		if (last.end) f(last);
+		spans.clear();
+		last = {};
+	}
+};
+
+// The sessions of the merged key, click and focus stream: one goes on while the activity is
+// less than idle_gap_ms apart. The last one stays open until an activity comes after the gap.
+// The time of the closed sessions is summed by local day.
+struct ActivitySessions {
+	// A session record of the save file: u64 start, u32 duration ms.
+	static constexpr size_t Packed_Size = 12;
+
+	struct Day {
+		std::uint32_t date; // yyyymmdd, local.
+		std::uint32_t sessions; // that started that day.
+		std::uint64_t active_ms;
+	};
+
+	std::uint64_t idle_gap_ms{ Default_Session_Idle_Gap_Ms };
+	ActivitySession open{}; // end is 0 before the first activity.
+	std::vector<ActivitySession> closed; // in order.
+	std::vector<Day> days; // in order, of the closed sessions.
+	LocalClock clock;
+
+	void feed(std::uint64_t ms) noexcept {
+		if (ms - open.end <= idle_gap_ms) {
+			open.end = ms;
+			return;
+		}
+		add({ ms, ms });
+	}
+	// A span of activity, it extends the open session or closes it.
+	void add(const ActivitySession& x) noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+
+private:
+	void close() noexcept;
+};
@@ -6,6 +6,7 @@
 
 #include "file.hpp"
 #include "Common.hpp"
+#include "ByteStream.hpp"
 #include "Logs.hpp"
 #include "TimeInfo.hpp"
 
@@ -30,13 +31,58 @@ std::optional<Settings> Settings::load_from_file(const std::filesystem::path& pa
 	set.start_on_startup = (bool)raw[it];
 	it++;
 
+	if (set.version >= 1) {
+		if (raw.size() < it + 1) return std::nullopt;
+		set.live_fps = (uint8_t)raw[it];
+		it++;
+	}
+
+	if (set.version >= 2) {
+		if (raw.size() < it + 4) return std::nullopt;
+		ByteReader reader{ raw, it };
+		set.retention.raw_days = reader.read<uint16_t>();
+		set.retention.minute_days = reader.read<uint16_t>();
+		it += 4;
+	}
+
+	if (set.version >= 3) {
+		if (raw.size() < it + 2) return std::nullopt;
+		set.commit_interval_ms = read_uint16(raw, it);
+		it += 2;
+	}
+
+	if (set.version >= 4) {
+		if (raw.size() < it + 1) return std::nullopt;
+		auto layout = read_uint8(raw, it);
+		if (layout < (uint8_t)KeyboardLayout::Count) set.keyboard_layout = (KeyboardLayout)layout;
+		it++;
+	}
+	else {
+		set.keyboard_layout = detect_keyboard_layout();
+	}
+
+	if (set.version >= 5) {
+		if (raw.size() < it + 2) return std::nullopt;
+		set.session_idle_minutes = read_uint16(raw, it);
+		it += 2;
+	}
+
+	set.version = 5;
 	return set;
 }
 
 bool Settings::save_to_file(const std::filesystem::path& path) noexcept {
-	std::vector<std::byte> raw(2);
-	raw[0] = (std::byte)version;
-	raw[1] = (std::byte)start_on_startup;
+	std::vector<std::byte> raw;
+	ByteWriter writer{ raw };
+	writer.reserve(12);
+	writer.write(version);
+	writer.write((uint8_t)start_on_startup);
+	writer.write(live_fps);
+	writer.write(retention.raw_days);
+	writer.write(retention.minute_days);
+	writer.write(commit_interval_ms);
+	writer.write((uint8_t)keyboard_layout);
+	writer.write(session_idle_minutes);
 
 	return file_write_byte(raw, path) == 0;
 }
@@ -146,6 +192,21 @@ void Settings::copy_system() noexcept {
 	return true;
 }
 
+KeyboardLayout detect_keyboard_layout() noexcept {
+	auto language = LOWORD(GetKeyboardLayout(0));
+	switch (PRIMARYLANGID(language)) {
+	case LANG_FRENCH:
+		// Canada types on a QWERTY and Switzerland on a QWERTZ.
+		if (SUBLANGID(language) == SUBLANG_FRENCH_CANADIAN) return KeyboardLayout::Qwerty;
+		if (SUBLANGID(language) == SUBLANG_FRENCH_SWISS) return KeyboardLayout::Qwertz;
+		return KeyboardLayout::Azerty;
+	case LANG_GERMAN:
+		return KeyboardLayout::Qwertz;
+	default:
+		return KeyboardLayout::Qwerty;
+	}
+}
+
 void SettingsWindow::render(Settings& settings) noexcept {
 	constexpr time_t Reset_Down_Reset_Time{ 5 };
 
@@ -155,6 +216,44 @@ void SettingsWindow::render(Settings& settings) noexcept {
 	if (ImGui::Checkbox("Start on startup", &settings.start_on_startup)) {
 		settings.start_on_startup = set_start_on_startup(settings.start_on_startup);
 	}
+
+	int live_fps = settings.live_fps;
+	if (ImGui::SliderInt("Live refresh (fps)", &live_fps, 0, 30)) {
+		settings.live_fps = (uint8_t)live_fps;
+		save = true;
+	}
+
+	// How long a new entry can wait before it's synced to disk, 0 syncs after every batch.
+	int commit_interval_ms = settings.commit_interval_ms;
+	if (ImGui::SliderInt("Max loss on crash (ms)", &commit_interval_ms, 0, 10'000)) {
+		settings.commit_interval_ms = (uint16_t)commit_interval_ms;
+		save = true;
+	}
+
+	int layout = (int)settings.keyboard_layout;
+	if (ImGui::Combo("Keyboard layout", &layout, Keyboard_Layout_Names)) {
+		settings.keyboard_layout = (KeyboardLayout)layout;
+		save = true;
+	}
+
+	// The open session closes at the next activity after the gap, the closed ones are kept as is.
+	int session_idle_minutes = settings.session_idle_minutes;
+	if (ImGui::SliderInt("Session idle gap (min)", &session_idle_minutes, 1, 120)) {
+		settings.session_idle_minutes = (uint16_t)session_idle_minutes;
+		save = true;
+	}
+
+	// 0 keeps the entries forever. The compaction runs every hour on the ingest thread.
+	int raw_days = settings.retention.raw_days;
+	if (ImGui::SliderInt("Raw entries (days)", &raw_days, 0, 3650, raw_days ? "%d" : "forever")) {
+		settings.retention.raw_days = (uint16_t)raw_days;
+		save = true;
+	}
+	int minute_days = settings.retention.minute_days;
+	if (ImGui::SliderInt("Per minute (days)", &minute_days, 0, 3650, minute_days ? "%d" : "forever")) {
+		settings.retention.minute_days = (uint16_t)minute_days;
+		save = true;
+	}
 	
 	if (reset_down_time_start > 0) {
 		auto dt = (get_seconds_epoch() - reset_down_time_start);
@@ -181,6 +280,13 @@ void SettingsWindow::render(Settings& settings) noexcept {
 		show_log = true;
 	}
 
+	ImGui::Separator();
+	ImGui::Combo("Export format", &export_format, "csv\0json lines\0columns\0");
+	ImGui::SliderInt("Export last (days)", &export_days, 0, 3650, export_days ? "%d" : "all");
+	ImGui::InputText("Export app", export_app, sizeof(export_app));
+	if (ImGui::Button("Export")) export_data = true;
+	ImGui::Separator();
+
 	if (ImGui::Button("Quit")) {
 		quit = true;
 	}
@@ -2,12 +2,27 @@
 #include <optional>
 #include <filesystem>
 
+#include "Retention.hpp"
+#include "KeyLayout.hpp"
+#include "Sessions.hpp"
+
 struct Settings {
 	static const std::filesystem::path Default_Path;
 
-	uint8_t version{ 0 };
+	uint8_t version{ 5 };
 	bool start_on_startup{ false };
 	bool show_logs{ false };
+	// Frames per second of the stats window when nothing happens, 0 means it only redraws on
+	// input or new data.
+	uint8_t live_fps{ 1 };
+	RetentionPolicy retention;
+	// The new entries are synced to the write ahead logs at least that often, it's how much a
+	// crash can lose.
+	uint16_t commit_interval_ms{ 1'000 };
+	// For the key names and where the keys are, the system's one when there are no settings yet.
+	KeyboardLayout keyboard_layout{ KeyboardLayout::Qwerty };
+	// Minutes without a key, a click, a move or a focus change before an activity session ends.
+	uint16_t session_idle_minutes{ (uint16_t)(Default_Session_Idle_Gap_Ms / 60'000) };
 
 	static std::optional<Settings> load_from_file(const std::filesystem::path& path) noexcept;
 
@@ -22,6 +37,13 @@ struct SettingsWindow {
 	bool show_log{ false };
 
 	bool install{ false };
+	bool save{ false };
+
+	// Writes the three files in <app data>/export, see Export.hpp.
+	bool export_data{ false };
+	int export_format{ 0 };
+	int export_days{ 0 }; // 0 for everything.
+	char export_app[128] = {};
 
 	time_t reset_down_time_start{ 0 };
 
@@ -29,4 +51,6 @@ struct SettingsWindow {
 };
 
 [[nodiscard]] extern bool set_start_on_startup(bool v) noexcept;
+// From the language of the input locale of the calling thread.
+[[nodiscard]] extern KeyboardLayout detect_keyboard_layout() noexcept;
 
@@ -0,0 +1,155 @@
+#include "TDigest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Common.hpp"
+#include "ByteStream.hpp"
+
+constexpr double Pi = 3.14159265358979323846;
+
+void TDigest::add(double x) noexcept {
+	if (total_weight == 0) {
+		min = x;
+		max = x;
+	}
+	min = min < x ? min : x;
+	max = max > x ? max : x;
+
+	buffer.push_back(x);
+	total_weight += 1;
+
+	if (buffer.size() >= Buffer_Size) compress();
+}
+
+void TDigest::compress() noexcept {
+	if (buffer.empty()) return;
+
+	std::vector<Centroid> all;
+	all.reserve(centroids.size() + buffer.size());
+	for (auto& x : centroids) all.push_back(x);
+	for (auto& x : buffer) all.push_back({ x, 1 });
+	buffer.clear();
+
+	std::sort(std::begin(all), std::end(all), [](auto a, auto b) { return a.mean < b.mean; });
+
+	// The k1 scale function, a centroid can't span more than one unit of k. The centroids at
+	// the tails stay small so the extreme quantiles are precise and there is at most
+	// Compression of them.
+	auto k = [](double q) { return Compression / (2 * Pi) * std::asin(2 * q - 1); };
+
+	centroids.clear();
+	double weight_so_far = 0;
+	auto current = all.front();
+	auto k_left = k(0);
+	for (size_t i = 1; i < all.size(); ++i) {
+		auto& x = all[i];
+
+		auto q_right = (weight_so_far + current.weight + x.weight) / total_weight;
+		if (k(q_right) - k_left <= 1) {
+			current.mean += (x.mean - current.mean) * x.weight / (current.weight + x.weight);
+			current.weight += x.weight;
+		}
+		else {
+			weight_so_far += current.weight;
+			k_left = k(weight_so_far / total_weight);
+			centroids.push_back(current);
+			current = x;
+		}
+	}
+	centroids.push_back(current);
+}
+
+[[nodiscard]] double TDigest::quantile(double q) const noexcept {
+	if (!buffer.empty()) {
+		auto copy = *this;
+		copy.compress();
+		return copy.quantile(q);
+	}
+	if (centroids.empty()) return 0;
+	if (centroids.size() == 1) return centroids.front().mean;
+
+	q = q < 0 ? 0 : (q > 1 ? 1 : q);
+	auto target = q * total_weight;
+
+	// We interpolate between the centers of the centroids, the tails are interpolated toward
+	// the min and the max.
+	auto first_center = centroids.front().weight / 2;
+	if (target < first_center) {
+		return min + (centroids.front().mean - min) * target / first_center;
+	}
+
+	double cumulative = 0;
+	for (size_t i = 0; i + 1 < centroids.size(); ++i) {
+		auto& a = centroids[i];
+		auto& b = centroids[i + 1];
+
+		auto center_a = cumulative + a.weight / 2;
+		auto center_b = cumulative + a.weight + b.weight / 2;
+		if (target < center_b) {
+			return a.mean + (b.mean - a.mean) * (target - center_a) / (center_b - center_a);
+		}
+		cumulative += a.weight;
+	}
+
+	auto& last = centroids.back();
+	auto last_center = total_weight - last.weight / 2;
+	if (total_weight == last_center) return max;
+	return last.mean + (max - last.mean) * (target - last_center) / (total_weight - last_center);
+}
+
+[[nodiscard]] size_t TDigest::count() const noexcept {
+	return (size_t)total_weight;
+}
+
+static void write_double(ByteWriter& writer, double x) noexcept {
+	std::uint64_t u;
+	memcpy(&u, &x, sizeof(u));
+	writer.write(u);
+}
+static double read_double(ByteReader& reader) noexcept {
+	auto u = reader.read<std::uint64_t>();
+	double x;
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+void TDigest::save(std::vector<std::byte>& bytes) const noexcept {
+	auto copy = *this;
+	copy.compress();
+
+	ByteWriter writer{ bytes };
+	writer.reserve(20 + 16 * copy.centroids.size());
+	write_double(writer, copy.min);
+	write_double(writer, copy.max);
+	writer.write((std::uint32_t)copy.centroids.size());
+	for (auto& x : copy.centroids) {
+		write_double(writer, x.mean);
+		write_double(writer, x.weight);
+	}
+}
+
+[[nodiscard]] bool TDigest::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	if (size < 20) return false;
+
+	ByteReader reader{ bytes, offset };
+	TDigest digest;
+	digest.min = read_double(reader);
+	digest.max = read_double(reader);
+	auto n = reader.read<std::uint32_t>();
+	if (size < 20 + (size_t)n * 16) return false;
+
+	for (size_t i = 0; i < n; ++i) {
+		Centroid c;
+		c.mean = read_double(reader);
+		c.weight = read_double(reader);
+		digest.total_weight += c.weight;
+		digest.centroids.push_back(c);
+	}
+
+	*this = std::move(digest);
+	return true;
+}
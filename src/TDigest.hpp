@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Merging t-digest (Dunning). Values are buffered and folded in the centroid list once the
+// buffer is full so add is amortized O(1) and the memory stays bounded by the compression.
+struct TDigest {
+	static constexpr double Compression = 100;
+	static constexpr size_t Buffer_Size = 512;
+
+	struct Centroid {
+		double mean;
+		double weight;
+	};
+
+	std::vector<Centroid> centroids;
+	std::vector<double> buffer;
+
+	double total_weight{ 0 };
+	double min{ 0 };
+	double max{ 0 };
+
+	void add(double x) noexcept;
+	void compress() noexcept;
+
+	[[nodiscard]] double quantile(double q) const noexcept;
+	[[nodiscard]] size_t count() const noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+};
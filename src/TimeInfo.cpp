@@ -15,4 +15,19 @@
 	using namespace std::chrono;
 	return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
 }
-
+[[nodiscard]] std::tm get_local_time(std::time_t x) noexcept {
+	std::tm result{};
+#ifdef _WIN32
+	localtime_s(&result, &x);
+#else
+	localtime_r(&x, &result);
+#endif
+	return result;
+}
+void reload_timezone() noexcept {
+#ifdef _WIN32
+	_tzset();
+#else
+	tzset();
+#endif
+}
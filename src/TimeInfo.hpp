@@ -1,6 +1,12 @@
 #pragma once
 #include <cstdint>
+#include <ctime>
 
 [[nodiscard]] extern uint64_t get_microseconds_epoch() noexcept;
 [[nodiscard]] extern uint64_t get_milliseconds_epoch() noexcept;
 [[nodiscard]] extern uint64_t get_seconds_epoch() noexcept;
+
+// localtime_s on windows, localtime_r elsewhere.
+[[nodiscard]] extern std::tm get_local_time(std::time_t x) noexcept;
+// The C runtime reads the timezone once, it has to be told when it changed.
+extern void reload_timezone() noexcept;
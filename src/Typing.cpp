@@ -0,0 +1,132 @@
+#include "Typing.hpp"
+
+#include "Common.hpp"
+#include "ByteStream.hpp"
+
+void TypingMetrics::feed(std::uint64_t timestamp) noexcept {
+	auto hour = timestamp / 3'600'000;
+	// If the clock goes backward we keep counting in the last hour, the rollup stays sorted.
+	if (hours.empty() || hours.back().hour < hour) {
+		TypingHour new_hour;
+		new_hour.hour = hour;
+		hours.push_back(new_hour);
+	}
+	auto& current = hours.back();
+	current.keys++;
+
+	if (last_timestamp != 0 && timestamp >= last_timestamp) {
+		auto gap = timestamp - last_timestamp;
+
+		if (gap < Idle_Gap_Ms) {
+			current.active_ms += (std::uint32_t)gap;
+			intervals.add((double)gap);
+		}
+		else {
+			current.idle_gaps++;
+		}
+
+		if (gap <= Burst_Gap_Ms) {
+			burst_keys++;
+		}
+		else {
+			close_burst();
+			burst_start = timestamp;
+			burst_keys = 1;
+		}
+	}
+	else {
+		burst_start = timestamp;
+		burst_keys = 1;
+	}
+	last_timestamp = last_timestamp > timestamp ? last_timestamp : timestamp;
+
+	// Sliding window, at most N_Buckets buckets are cleared per key so it's still O(1).
+	auto bucket = timestamp / Bucket_Ms;
+	if (bucket >= window_bucket + N_Buckets) {
+		window.fill(0);
+		window_count = 0;
+		window_bucket = bucket;
+	}
+	else if (bucket > window_bucket) {
+		for (auto b = window_bucket + 1; b <= bucket; ++b) {
+			window_count -= window[b % N_Buckets];
+			window[b % N_Buckets] = 0;
+		}
+		window_bucket = bucket;
+	}
+	window[window_bucket % N_Buckets]++;
+	window_count++;
+
+	// The window is exactly one minute so its count is the instant keys per minute.
+	if (current.peak_kpm < window_count) current.peak_kpm = (std::uint32_t)window_count;
+}
+
+void TypingMetrics::close_burst() noexcept {
+	if (burst_keys < Burst_Min_Keys || hours.empty()) return;
+
+	hours.back().bursts++;
+	hours.back().burst_keys += (std::uint32_t)burst_keys;
+}
+
+[[nodiscard]] size_t TypingMetrics::keys_in_window(std::uint64_t now) const noexcept {
+	auto bucket = now / Bucket_Ms;
+	if (bucket >= window_bucket + N_Buckets) return 0;
+	if (bucket <= window_bucket) return window_count;
+
+	// The buckets that slid out of the window since the last key.
+	auto count = window_count;
+	for (auto b = window_bucket + 1; b <= bucket; ++b) count -= window[b % N_Buckets];
+	return count;
+}
+
+[[nodiscard]] float TypingMetrics::keys_per_minute(std::uint64_t now) const noexcept {
+	return keys_in_window(now) * 60'000.f / Window_Ms;
+}
+
+[[nodiscard]] float TypingMetrics::words_per_minute(std::uint64_t now) const noexcept {
+	return keys_per_minute(now) / Chars_Per_Word;
+}
+
+[[nodiscard]] bool TypingMetrics::in_burst(std::uint64_t now) const noexcept {
+	return burst_keys >= Burst_Min_Keys && now - last_timestamp <= Burst_Gap_Ms;
+}
+
+void TypingMetrics::save_hours(std::vector<std::byte>& bytes) const noexcept {
+	ByteWriter writer{ bytes };
+	writer.reserve(12 + TypingHour::Byte_Size * hours.size());
+	writer.write(last_timestamp);
+	writer.write((std::uint32_t)hours.size());
+	for (auto& x : hours) {
+		writer.write(x.hour);
+		writer.write(x.keys);
+		writer.write(x.active_ms);
+		writer.write(x.bursts);
+		writer.write(x.burst_keys);
+		writer.write(x.idle_gaps);
+		writer.write(x.peak_kpm);
+	}
+}
+
+[[nodiscard]] bool TypingMetrics::load_hours(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	if (size < 12) return false;
+
+	last_timestamp = read_uint64(bytes, offset);
+	auto n = read_uint32(bytes, offset + 8);
+	if (size < 12 + n * TypingHour::Byte_Size) return false;
+
+	ByteReader reader{ bytes, offset + 12 };
+	hours.resize(n);
+	for (auto& x : hours) {
+		x.hour       = reader.read<std::uint64_t>();
+		x.keys       = reader.read<std::uint32_t>();
+		x.active_ms  = reader.read<std::uint32_t>();
+		x.bursts     = reader.read<std::uint32_t>();
+		x.burst_keys = reader.read<std::uint32_t>();
+		x.idle_gaps  = reader.read<std::uint32_t>();
+		x.peak_kpm   = reader.read<std::uint32_t>();
+	}
+
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "TDigest.hpp"
+
+// One hour of typing, that's the rollup that gets saved so the ui can plot months of typing
+// speed without going back to the key entries.
+struct TypingHour {
+	static constexpr size_t Byte_Size = 8 + 6 * 4;
+
+	std::uint64_t hour{ 0 }; // hours since epoch.
+	std::uint32_t keys{ 0 };
+	std::uint32_t active_ms{ 0 }; // sum of the inter key intervals shorter than the idle gap.
+	std::uint32_t bursts{ 0 };
+	std::uint32_t burst_keys{ 0 };
+	std::uint32_t idle_gaps{ 0 };
+	std::uint32_t peak_kpm{ 0 };
+};
+
+// Streaming typing metrics, everything is updated in O(1) per key stroke.
+struct TypingMetrics {
+	static constexpr std::uint64_t Window_Ms = 60'000;
+	static constexpr size_t N_Buckets = 60; // one per second of the sliding window.
+	static constexpr std::uint64_t Bucket_Ms = Window_Ms / N_Buckets;
+
+	// Two keys closer than that are in the same burst, a burst needs at least Burst_Min_Keys.
+	static constexpr std::uint64_t Burst_Gap_Ms = 1'000;
+	static constexpr size_t Burst_Min_Keys = 10;
+	// Anything longer than that is not typing anymore.
+	static constexpr std::uint64_t Idle_Gap_Ms = 60'000;
+	static constexpr size_t Chars_Per_Word = 5;
+
+	static constexpr std::uint32_t Hours_Tag = 'HPYT'; // 'TYPH' byte swapped.
+	static constexpr std::uint32_t Digest_Tag = 'GIDT'; // 'TDIG' byte swapped.
+
+	std::vector<TypingHour> hours;
+	TDigest intervals; // of the inter key intervals in ms, idle gaps excluded.
+
+	std::uint64_t last_timestamp{ 0 };
+	std::uint64_t burst_start{ 0 };
+	size_t burst_keys{ 0 };
+
+	void feed(std::uint64_t timestamp) noexcept;
+
+	[[nodiscard]] size_t keys_in_window(std::uint64_t now) const noexcept;
+	[[nodiscard]] float keys_per_minute(std::uint64_t now) const noexcept;
+	[[nodiscard]] float words_per_minute(std::uint64_t now) const noexcept;
+	[[nodiscard]] bool in_burst(std::uint64_t now) const noexcept;
+
+	void save_hours(std::vector<std::byte>& bytes) const noexcept;
+	[[nodiscard]] bool load_hours(
+		const std::vector<std::byte>& bytes, size_t offset, size_t size
+	) noexcept;
+
+private:
+	std::array<std::uint16_t, N_Buckets> window{};
+	std::uint64_t window_bucket{ 0 }; // index of the last bucket written, in Bucket_Ms since epoch.
+	size_t window_count{ 0 };
+
+	void close_burst() noexcept;
+};
@@ -0,0 +1,119 @@
+#include "WeekHours.hpp"
+#include <ctime>
+
+#include "ByteStream.hpp"
+#include "TimeInfo.hpp"
+
+void LocalClock::timezone_changed() noexcept {
+	reload_timezone();
+	Timezone_Changes++;
+}
+
+void LocalClock::refresh(std::uint64_t ms) noexcept {
+	timezone_changes = Timezone_Changes.load(std::memory_order_relaxed);
+	auto local = get_local_time((std::time_t)(ms / 1'000));
+	weekday = (std::uint8_t)((local.tm_wday + 6) % 7);
+	auto year = (std::uint32_t)(local.tm_year + 1900);
+	date = year * 10'000 + (std::uint32_t)(local.tm_mon + 1) * 100 + (std::uint32_t)local.tm_mday;
+
+	// mktime normalizes the day after the last of the month, and picks the DST of each midnight.
+	std::tm day = local;
+	day.tm_hour = 0;
+	day.tm_min = 0;
+	day.tm_sec = 0;
+	day.tm_isdst = -1;
+	auto start = std::mktime(&day);
+	day = local;
+	day.tm_mday++;
+	day.tm_hour = 0;
+	day.tm_min = 0;
+	day.tm_sec = 0;
+	day.tm_isdst = -1;
+	auto end = std::mktime(&day);
+
+	auto since_midnight = (local.tm_hour * 3'600 + local.tm_min * 60 + local.tm_sec) * 1'000ull;
+	if (start == -1 || end <= start || (std::uint64_t)start * 1'000 > ms) {
+		midnight = ms - ms % 1'000 - since_midnight;
+		next_midnight = midnight + Day_Ms;
+	}
+	else {
+		midnight = (std::uint64_t)start * 1'000;
+		next_midnight = (std::uint64_t)end * 1'000;
+	}
+	hour_start = hour_end = 0;
+}
+
+LocalClock::Slot LocalClock::locate(std::uint64_t ms) noexcept {
+	bool checked = timezone_changes == Timezone_Changes.load(std::memory_order_relaxed);
+	if (checked && hour_start <= ms && ms < hour_end) return { index, hour_end };
+
+	if (!checked || ms < midnight || ms >= next_midnight) refresh(ms);
+
+	size_t hour;
+	if (next_midnight - midnight == Day_Ms) {
+		hour = (size_t)((ms - midnight) / Hour_Ms);
+		hour_start = midnight + hour * Hour_Ms;
+		hour_end = hour_start + Hour_Ms;
+	}
+	else {
+		// The day of a DST change, the hours are asked once each.
+		auto local = get_local_time((std::time_t)(ms / 1'000));
+		hour = (size_t)local.tm_hour;
+		hour_start = ms - ms % 1'000 - (local.tm_min * 60 + local.tm_sec) * 1'000ull;
+		hour_end = hour_start + Hour_Ms < next_midnight ? hour_start + Hour_Ms : next_midnight;
+	}
+	index = weekday * WeekHours::N_Hours + (hour < WeekHours::N_Hours ? hour : 23);
+	return { index, hour_end };
+}
+
+void WeekHours::add(LocalClock& clock, std::uint64_t ms, std::uint64_t n) noexcept {
+	counts[clock.locate(ms).index] += n;
+	total += n;
+}
+
+void WeekHours::add_span(LocalClock& clock, std::uint64_t start, std::uint64_t end) noexcept {
+	while (start < end) {
+		auto slot = clock.locate(start);
+		auto until = slot.end < end ? slot.end : end;
+		counts[slot.index] += until - start;
+		total += until - start;
+		start = until;
+	}
+}
+
+// u8 n slots used, then per slot u8 index and u64 count.
+void WeekHours::save(std::vector<std::byte>& bytes) const noexcept {
+	size_t n_used = 0;
+	for (auto x : counts) n_used += x != 0;
+
+	ByteWriter writer{ bytes };
+	writer.reserve(1 + 9 * n_used);
+	writer.write((std::uint8_t)n_used);
+	for (size_t i = 0; i < counts.size(); ++i) if (counts[i]) {
+		writer.write((std::uint8_t)i);
+		writer.write(counts[i]);
+	}
+}
+
+[[nodiscard]] size_t WeekHours::load(
+	const std::vector<std::byte>& bytes, size_t offset, size_t size
+) noexcept {
+	ByteReader reader{ bytes, offset };
+	reader.size = offset + size;
+	if (!reader.can_read(1)) return 0;
+
+	auto n_used = reader.read<std::uint8_t>();
+	if (!reader.can_read(9 * (size_t)n_used)) return 0;
+
+	WeekHours loaded;
+	for (size_t i = 0; i < n_used; ++i) {
+		auto idx = reader.read<std::uint8_t>();
+		auto n = reader.read<std::uint64_t>();
+		if (idx >= N_Slots) return 0;
+		loaded.counts[idx] = n;
+		loaded.total += n;
+	}
+
+	*this = loaded;
+	return 1 + 9 * (size_t)n_used;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The local weekday and hour of timestamps, for the states that count by them. The local
+// midnights of the day of the last timestamp are cached, a timestamp of the same day is placed
+// with a subtraction and a division. The timezone is only asked again on another day, on the
+// days of a DST change once per hour, and after timezone_changed.
+struct LocalClock {
+	static constexpr std::uint64_t Hour_Ms = 3'600'000;
+	static constexpr std::uint64_t Day_Ms = 24 * Hour_Ms;
+
+	// Bumped by timezone_changed, the clocks with an older one refresh.
+	inline static std::atomic<std::uint32_t> Timezone_Changes{ 0 };
+	// From WM_TIMECHANGE, on any thread.
+	static void timezone_changed() noexcept;
+
+	struct Slot {
+		size_t index; // weekday * 24 + hour, monday is 0.
+		std::uint64_t end; // ms since epoch, of the end of the hour.
+	};
+
+	// ms since epoch, the day of the last timestamp, 23 or 25 hours long when the DST changes.
+	std::uint64_t midnight{ 0 };
+	std::uint64_t next_midnight{ 0 };
+	std::uint32_t timezone_changes{ UINT32_MAX }; // Timezone_Changes when it was asked.
+	std::uint32_t date{ 0 }; // yyyymmdd
+	std::uint8_t weekday{ 0 };
+
+	// The hour of the last timestamp.
+	std::uint64_t hour_start{ 0 };
+	std::uint64_t hour_end{ 0 };
+	size_t index{ 0 };
+
+	[[nodiscard]] Slot locate(std::uint64_t ms) noexcept;
+
+private:
+	void refresh(std::uint64_t ms) noexcept;
+};
+
+// Counters by local weekday and hour. Kept when the entries they come from are compacted.
+struct WeekHours {
+	static constexpr size_t N_Days = 7;
+	static constexpr size_t N_Hours = 24;
+	static constexpr size_t N_Slots = N_Days * N_Hours;
+
+	std::array<std::uint64_t, N_Slots> counts{}; // by weekday * N_Hours + hour, monday is 0.
+	std::uint64_t total{ 0 };
+
+	void add(LocalClock& clock, std::uint64_t ms, std::uint64_t n = 1) noexcept;
+	// Adds the ms of [start, end) to each hour they are in.
+	void add_span(LocalClock& clock, std::uint64_t start, std::uint64_t end) noexcept;
+
+	void save(std::vector<std::byte>& bytes) const noexcept;
+	// Returns the size read, 0 if it's ill formed.
+	[[nodiscard]] size_t load(const std::vector<std::byte>& bytes, size_t offset, size_t size) noexcept;
+};
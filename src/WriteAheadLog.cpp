@@ -0,0 +1,129 @@
+#include "WriteAheadLog.hpp"
+
+#include <cerrno>
+
+#include "file.hpp"
+#include "Common.hpp"
+#include "ByteStream.hpp"
+#include "Logs.hpp"
+
+WriteAheadLog::~WriteAheadLog() noexcept {
+	close();
+}
+
+void WriteAheadLog::close() noexcept {
+	if (file) fclose(file);
+	file = nullptr;
+}
+
+int WriteAheadLog::reset(std::uint64_t generation, std::uint64_t now) noexcept {
+	close();
+	batch.clear();
+	n_committed = 0;
+	reset_time = now;
+	broken = false;
+
+	std::vector<std::byte> header;
+	ByteWriter writer{ header };
+	writer.reserve(Header_Size);
+	writer.write(Signature);
+	writer.write((std::uint32_t)record_size);
+	writer.write(generation);
+
+	if (auto err = file_replace_atomic(header, path); err) {
+		broken = true;
+		return err;
+	}
+
+	file = file_open_append(path);
+	if (!file) {
+		broken = true;
+		return EIO;
+	}
+	return 0;
+}
+
+std::byte* WriteAheadLog::append(std::uint64_t now) noexcept {
+	ByteWriter writer{ batch };
+	if (batch.empty()) {
+		first_append_time = now;
+		writer.reserve(Batch_Header_Size + Max_Batch_Records * record_size);
+		(void)writer.claim(Batch_Header_Size);
+	}
+	return writer.claim(record_size);
+}
+
+size_t WriteAheadLog::n_buffered() const noexcept {
+	if (batch.empty() || record_size == 0) return 0;
+	return (batch.size() - Batch_Header_Size) / record_size;
+}
+
+std::uint64_t WriteAheadLog::commit_time(std::uint64_t interval) const noexcept {
+	if (batch.empty()) return UINT64_MAX;
+	if (n_buffered() >= Max_Batch_Records) return 0;
+	return first_append_time + interval;
+}
+
+bool WriteAheadLog::snapshot_due(std::uint64_t now) const noexcept {
+	if (broken) return true;
+	if (n_committed >= Snapshot_Records) return true;
+	return n_committed > 0 && now >= reset_time + Snapshot_Period_Ms;
+}
+
+int WriteAheadLog::commit() noexcept {
+	if (batch.empty()) return 0;
+	if (!file) return EIO;
+
+	auto n = n_buffered();
+	store_le(batch.data() + 0, (std::uint32_t)n);
+	store_le(
+		batch.data() + 4,
+		checksum(batch.data() + Batch_Header_Size, batch.size() - Batch_Header_Size)
+	);
+
+	if (auto err = file_append_sync(file, batch); err) {
+		// Part of the batch may be in the file, what we append after it would never be read
+		// back. The next snapshot starts a new log.
+		broken = true;
+		return err;
+	}
+
+	n_committed += n;
+	batch.clear();
+	return 0;
+}
+
+std::vector<std::byte> WriteAheadLog::read(
+	const std::filesystem::path& path, size_t record_size, std::uint64_t generation
+) noexcept {
+	std::vector<std::byte> records;
+	if (!std::filesystem::is_regular_file(path)) return records;
+
+	auto opt = file_read_byte(path);
+	if (!opt) return records;
+	auto& bytes = *opt;
+
+	if (bytes.size() < Header_Size) return records;
+	if (read_uint32(bytes, 0) != Signature) return records;
+	if (read_uint32(bytes, 4) != record_size) return records;
+	if (read_uint64(bytes, 8) != generation) return records;
+
+	size_t it = Header_Size;
+	while (it + Batch_Header_Size <= bytes.size()) {
+		size_t n = read_uint32(bytes, it);
+		auto sum = read_uint32(bytes, it + 4);
+		auto size = n * record_size;
+		if (n == 0 || size > bytes.size() - it - Batch_Header_Size) break;
+
+		auto data = bytes.data() + it + Batch_Header_Size;
+		if (checksum(data, size) != sum) break;
+
+		records.insert(std::end(records), data, data + size);
+		it += Batch_Header_Size + size;
+	}
+
+	if (it != bytes.size()) {
+		logs.write(LogTag::FileIO, "Ignored the last {} bytes of a damaged log.", bytes.size() - it);
+	}
+	return records;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+// The entries that came since the last snapshot of a state, appended to <state>.wal as fixed
+// width records in the same encoding as the save file.
+// The records are buffered and written in batches (group commit), one sync per batch. A batch is
+// committed when its oldest record is older than the commit interval or when it's full, so a
+// crash loses at most the interval.
+// The log starts with the generation of the snapshot it follows, the snapshots store theirs in a
+// section. After a crash a log whose generation doesn't match the snapshot is already in it.
+//
+// Header: u32 signature, u32 record size, u64 generation.
+// Batch:  u32 n records, u32 checksum of the records, the records.
+// A batch cut by a crash fails its size or checksum check and it and what follows are ignored.
+struct WriteAheadLog {
+	static constexpr std::uint32_t Signature = 'GOLW'; // 'WLOG' byte swapped.
+	static constexpr std::uint32_t Generation_Tag = 'LNRJ'; // 'JRNL' byte swapped.
+	static constexpr size_t Header_Size = 16;
+	static constexpr size_t Batch_Header_Size = 8;
+	static constexpr size_t Max_Batch_Records = 256;
+
+	// A snapshot is taken and the log restarted after that many records or that much time.
+	static constexpr size_t Snapshot_Records = 1 << 16;
+	static constexpr std::uint64_t Snapshot_Period_Ms = 10 * 60 * 1'000;
+
+	std::filesystem::path path;
+	size_t record_size{ 0 };
+
+	size_t n_committed{ 0 }; // since the last reset.
+	std::uint64_t reset_time{ 0 };
+
+	WriteAheadLog() = default;
+	WriteAheadLog(const WriteAheadLog&) = delete;
+	WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+	~WriteAheadLog() noexcept;
+
+	// Replaces the log by an empty one that follows the snapshot of the given generation, the
+	// buffered records are dropped, the snapshot has them.
+	[[nodiscard]] int reset(std::uint64_t generation, std::uint64_t now) noexcept;
+
+	// Room for one record in the current batch, now is when it was appended.
+	[[nodiscard]] std::byte* append(std::uint64_t now) noexcept;
+
+	[[nodiscard]] size_t n_buffered() const noexcept;
+	// When the current batch has to be committed, UINT64_MAX if it's empty.
+	[[nodiscard]] std::uint64_t commit_time(std::uint64_t interval) const noexcept;
+	[[nodiscard]] bool snapshot_due(std::uint64_t now) const noexcept;
+
+	// Writes and syncs the current batch.
+	[[nodiscard]] int commit() noexcept;
+
+	// FNV-1a, we only want to catch a batch cut in the middle.
+	[[nodiscard]] static std::uint32_t checksum(const std::byte* data, size_t size) noexcept {
+		std::uint32_t h = 2166136261u;
+		for (size_t i = 0; i < size; ++i) h = (h ^ (std::uint32_t)data[i]) * 16777619u;
+		return h;
+	}
+
+	// The records of the log at path if it follows the snapshot of that generation, up to the first
+	// damaged batch.
+	[[nodiscard]] static std::vector<std::byte> read(
+		const std::filesystem::path& path, size_t record_size, std::uint64_t generation
+	) noexcept;
+
+private:
+	std::FILE* file{ nullptr };
+	std::vector<std::byte> batch; // batch header then the records.
+	std::uint64_t first_append_time{ 0 };
+	bool broken{ false }; // a write failed, the log can't be trusted until the next reset.
+
+	void close() noexcept;
+};
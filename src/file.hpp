@@ -1,5 +1,7 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <vector>
 #include <filesystem>
 #include <optional>
@@ -36,3 +38,45 @@ file_write_integer(const std::filesystem::path& path, uint32_t x, size_t offset)
 
 [[nodiscard]] extern std::optional<uint64_t>
 get_file_length(const std::filesystem::path& path) noexcept;
+
+// Appends size bytes of the file starting at offset to out.
+[[nodiscard]] extern int file_read_range(
+	const std::filesystem::path& path, uint64_t offset, size_t size, std::vector<std::byte>& out
+) noexcept;
+
+// A file to write made of bytes in memory and of ranges of other files, so the records a lazy
+// load left in a file are copied into the new one File_Copy_Block bytes at a time instead of
+// being read whole.
+struct FileParts {
+	static constexpr size_t File_Copy_Block = 1 << 20;
+
+	struct Part {
+		std::vector<std::byte> bytes;
+		// When not empty, the part is size bytes of this file from offset and not bytes.
+		std::filesystem::path path;
+		std::uint64_t offset{ 0 };
+		std::uint64_t size{ 0 };
+	};
+	std::vector<Part> parts;
+
+	// The bytes at the end, to write into.
+	[[nodiscard]] std::vector<std::byte>& bytes() noexcept;
+	void copy(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t size) noexcept;
+	void append(FileParts&& other) noexcept;
+	[[nodiscard]] std::uint64_t size() const noexcept;
+	// At the position of f, returns an errno.
+	[[nodiscard]] int write(std::FILE* f) const noexcept;
+};
+
+// Writes bytes to a temporary file next to path, syncs it and renames it over path, so after a
+// crash path is either the old file or the new one, never a mix.
+[[nodiscard]] extern int
+file_replace_atomic(const std::vector<std::byte>& bytes, const std::filesystem::path& path) noexcept;
+// The same for parts, the ranges they copy can be in the file at path.
+[[nodiscard]] extern int
+file_replace_atomic(const FileParts& parts, const std::filesystem::path& path) noexcept;
+
+// For the logs that are only ever appended to.
+[[nodiscard]] extern std::FILE* file_open_append(const std::filesystem::path& path) noexcept;
+// Appends bytes and waits for them to be on the disk.
+[[nodiscard]] extern int file_append_sync(std::FILE* file, const std::vector<std::byte>& bytes) noexcept;
@@ -1,5 +1,7 @@
 #include "keyboard.hpp"
 #include <cassert>
+#include <algorithm>
+#include <cerrno>
 
 #include "imgui.h"
 
@@ -7,6 +9,9 @@
 #include "TimeInfo.hpp"
 #include "ErrorCode.hpp"
 #include "Common.hpp"
+#include "ByteStream.hpp"
+#include "Parallel.hpp"
+#include "WriteAheadLog.hpp"
 #include "Logs.hpp"
 #include "render_stats.hpp"
 
@@ -19,9 +24,111 @@ struct Version_0 {
 	static constexpr size_t Key_Entry_List_Offset                                = 5 + 255 * 4 + 4;
 };
 
-std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes) noexcept;
-std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes) noexcept;
-bool version1_write(const KeyboardState& state, const std::filesystem::path& path) noexcept;
+static std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes) noexcept;
+static std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes) noexcept;
+static std::optional<KeyboardState> version2_read(const std::vector<std::byte>& bytes) noexcept;
+static std::optional<KeyboardState> version2_read_lazy(const std::filesystem::path& path) noexcept;
+static int version2_write(
+	const KeyboardState& state, const std::filesystem::path& path, std::vector<FileSection>& written
+) noexcept;
+
+// Before version 2 there was no typing rollup in the file, so we build it once from the
+// entries.
+void replay_typing(KeyboardState& ks) noexcept {
+	ks.typing = {};
+	for (auto& x : ks.key_entries) ks.typing.feed(x.timestamp);
+}
+void replay_minutes(KeyboardState& ks) noexcept {
+	ks.minutes = {};
+	for (auto& x : ks.key_entries) ks.minutes.add(x.timestamp);
+}
+void replay_postings(KeyboardState& ks) noexcept {
+	ks.postings = {};
+	ks.pending_postings.reset();
+	ks.pending_postings_cutoff = 0;
+	for (auto& x : ks.key_entries) ks.postings.add(x.key_code, x.timestamp);
+}
+void replay_holds(KeyboardState& ks) noexcept {
+	ks.holds = {};
+	for (auto& x : ks.key_entries) ks.holds.add(x.key_code, x.hold);
+}
+void replay_bigrams(KeyboardState& ks) noexcept {
+	ks.load.bigrams = {};
+	for (auto& x : ks.key_entries) ks.load.bigrams.add(x.key_code, x.timestamp);
+}
+void replay_week(KeyboardState& ks) noexcept {
+	ks.week = {};
+	for (auto& x : ks.key_entries) ks.week.add(ks.clock, x.timestamp);
+}
+
+// The counters are size_t in memory but u32 in the file, so they go through a u32 array to be
+// copied in one go.
+void read_key_times(const std::vector<std::byte>& bytes, size_t offset, KeyboardState& ks) noexcept {
+	std::array<uint32_t, 255> counts;
+	ByteReader reader{ bytes, offset };
+	reader.read_array(counts.data(), counts.size());
+	for (size_t i = 0; i < counts.size(); ++i) ks.key_times[i] = counts[i];
+}
+void write_key_times(ByteWriter& writer, const KeyboardState& ks) noexcept {
+	std::array<uint32_t, 255> counts;
+	for (size_t i = 0; i < counts.size(); ++i) counts[i] = (uint32_t)ks.key_times[i];
+	writer.write_array(counts.data(), counts.size());
+}
+
+// The version 2 entries, 9 bytes each: u8 key code and u64 timestamp.
+void encode_key_entry(const KeyEntry& x, std::byte* dst) noexcept {
+	dst[0] = (std::byte)x.key_code;
+	store_le(dst + 1, x.timestamp);
+}
+// The holds column, KeyHold::Packed_Size bytes per entry: u8 modifiers, u16 ms.
+static void encode_holds(const std::vector<KeyEntry>& entries, ByteWriter& writer) noexcept {
+	auto dst = writer.claim(KeyHold::Packed_Size * entries.size());
+	for (auto& x : entries) {
+		dst[0] = (std::byte)x.hold.modifiers;
+		store_le(dst + 1, x.hold.ms);
+		dst += KeyHold::Packed_Size;
+	}
+}
+static void decode_holds(const std::byte* src, KeyEntry* dst, size_t n) noexcept {
+	for (size_t i = 0; i < n; ++i) {
+		dst[i].hold.modifiers = (std::uint8_t)src[0];
+		dst[i].hold.ms = load_le<std::uint16_t>(src + 1);
+		src += KeyHold::Packed_Size;
+	}
+}
+// The column of a file is only used if it has one hold per entry, from a file written by
+// something else it may not.
+static const std::byte* find_holds(
+	const std::vector<std::byte>& bytes, const std::vector<FileSection>& sections, size_t n
+) noexcept {
+	auto column = find_section(sections, KeyboardState::Holds_Tag);
+	if (!column || column->size != 4 + KeyHold::Packed_Size * n) return nullptr;
+	if (read_uint32(bytes, column->offset) != n) return nullptr;
+	return bytes.data() + column->offset + 4;
+}
+
+void decode_key_entries(const std::byte* src, KeyEntry* dst, size_t n) noexcept {
+	parallel_blocks(n, Min_Decode_Block, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			auto record = src + KeyEntry::Packed_Size * i;
+			dst[i].key_code = (uint8_t)record[0];
+			dst[i].timestamp = load_le<uint64_t>(record + 1);
+		}
+	});
+}
+
+void encode_logged_key_entry(const KeyEntry& x, std::byte* dst) noexcept {
+	encode_key_entry(x, dst);
+	dst[KeyEntry::Packed_Size + 0] = (std::byte)x.hold.modifiers;
+	store_le(dst + KeyEntry::Packed_Size + 1, x.hold.ms);
+}
+void decode_logged_key_entries(const std::byte* src, KeyEntry* dst, size_t n) noexcept {
+	for (size_t i = 0; i < n; ++i, src += KeyEntry::Log_Size) {
+		decode_key_entries(src, dst + i, 1);
+		dst[i].hold.modifiers = (std::uint8_t)src[KeyEntry::Packed_Size + 0];
+		dst[i].hold.ms = load_le<std::uint16_t>(src + KeyEntry::Packed_Size + 1);
+	}
+}
 
 // ughhhh constexpr as a first class cityzen in this langage can not happen soon enough.
 extern const std::filesystem::path Default_Keyboard_Path{ "keyboard.mto" };
@@ -53,11 +160,21 @@ void set_raw_keyboard_data(const std::vector<std::byte>& bytes) noexcept {
 	//>TODO: error handling.
 	auto err = file_replace_byte(full_path, bytes, 0);
 	if (err) {
-		logs.lock_and_write("set_raw_keyboard_data, file_replace_byte: " + std::to_string(err));
+		logs.write(LogTag::FileIO, "set_raw_keyboard_data, file_replace_byte: {}", err);
 	}
 }
 
-std::optional<KeyboardState> KeyboardState::load_from_file(std::filesystem::path path) noexcept {
+std::optional<KeyboardState>
+KeyboardState::load_from_file(std::filesystem::path path, bool lazy) noexcept {
+	if (lazy) {
+		std::vector<std::byte> header;
+		bool current_version =
+			file_read_range(path, 0, 5, header) == 0 &&
+			read_uint32(header, 0) == Keyboard_File_Signature &&
+			read_uint8(header, 4) == 2;
+		if (current_version) return version2_read_lazy(path);
+	}
+
 	auto opt_bytes = get_raw_keyboard_data(path);
 	if (!opt_bytes) {
 		ErrorDescription error;
@@ -103,6 +220,8 @@ std::optional<KeyboardState> KeyboardState::load_from_file(std::filesystem::path
 		return version0_read(bytes);
 	case 1:
 		return version1_read(bytes);
+	case 2:
+		return version2_read(bytes);
 	default: {
 		ErrorDescription error;
 		error.location = "KeyboardState::load_from_file";
@@ -115,8 +234,66 @@ std::optional<KeyboardState> KeyboardState::load_from_file(std::filesystem::path
 	}
 }
 
-[[nodiscard]] bool KeyboardState::save_to_file(std::filesystem::path path) const noexcept {
-	return version1_write(*this, path) == 0;
+[[nodiscard]] bool KeyboardState::save_to_file(std::filesystem::path path) noexcept {
+	std::vector<FileSection> written;
+	if (version2_write(*this, path, written)) return false;
+	modifications_since_save = 0;
+
+	// The entries that were never loaded now start right after the header.
+	if (pending_entries && pending_entries->path == path) {
+		pending_entries->offset = Version_0::Key_Entry_List_Offset;
+	}
+	if (pending_holds && pending_holds->path == path) {
+		pending_holds->offset = find_section(written, Holds_Tag)->offset + 4;
+	}
+	// The postings written have the ones typed since the load, they are all in the file now.
+	if (pending_postings && pending_postings->path == path) {
+		auto section = find_section(written, Postings_Tag);
+		pending_postings->offset = section->offset;
+		pending_postings->size = section->size;
+		pending_postings_cutoff = 0;
+		postings = {};
+	}
+	return true;
+}
+
+bool KeyboardState::compact(const RetentionPolicy& policy, std::uint64_t now) noexcept {
+	size_t dropped = 0;
+
+	// The entries come in order, the ones to drop are at the front of the file then of memory.
+	if (auto cutoff = policy.raw_cutoff(now); cutoff) {
+		if (pending_entries) {
+			size_t n = 0;
+			auto err = drop_pending_prefix(*pending_entries, n, [&](const std::byte* record) {
+				return load_le<uint64_t>(record + 1) < cutoff;
+			});
+			if (err) {
+				logs.write(LogTag::FileIO, "KeyboardState::compact, can't read the entries: {}", err);
+			}
+			// The column goes along with the entries, even the ones dropped before an error.
+			if (pending_holds) {
+				pending_holds->offset += KeyHold::Packed_Size * n;
+				pending_holds->count -= n;
+			}
+			dropped += n;
+			if (pending_entries->count == 0) {
+				pending_entries.reset();
+				pending_holds.reset();
+			}
+		}
+		if (!pending_entries) {
+			auto it = std::find_if(BEG_END(key_entries), [&](auto& x) { return x.timestamp >= cutoff; });
+			dropped += it - std::begin(key_entries);
+			key_entries.erase(std::begin(key_entries), it);
+		}
+		if (dropped > 0) postings.drop_before(cutoff);
+		if (dropped > 0 && pending_postings) pending_postings_cutoff = cutoff;
+	}
+
+	bool folded = false;
+	if (auto cutoff = policy.minute_cutoff(now); cutoff) folded = minutes.compact(cutoff);
+
+	return dropped > 0 || folded;
 }
 
 std::array<size_t, 0xff> KeyboardState::get_n_of_all_keys() const noexcept {
@@ -127,17 +304,29 @@ bool KeyboardState::reset_everything() noexcept {
 	modifications_since_save = 0;
 	version_number = 0;
 	key_times = {};
+	key_entries.clear();
+	pending_entries.reset();
+	pending_holds.reset();
+	generation = 0;
+	typing = {};
+	minutes = {};
+	postings = {};
+	pending_postings.reset();
+	pending_postings_cutoff = 0;
+	holds = {};
+	load.clear();
+	week = {};
 
 	std::vector<std::byte> bytes;
-	insert_uint32(bytes, Keyboard_File_Signature);
-	insert_uint8(bytes, version_number);
-	for (size_t i = 0; i < 255; ++i) {
-		insert_uint32(bytes, key_times[i]);
-	}
-	insert_uint32(bytes, 0);
+	ByteWriter writer{ bytes };
+	writer.reserve(5 + 255 * 4 + 4);
+	writer.write(Keyboard_File_Signature);
+	writer.write(version_number);
+	write_key_times(writer, *this);
+	writer.write((uint32_t)0);
 
 	auto full_path = get_app_data_path() / Default_Keyboard_Path;
-	if (auto err = file_overwrite_byte(bytes, full_path); err) {
+	if (auto err = file_replace_atomic(bytes, full_path); err) {
 		ErrorDescription error;
 		error.location = "KeyboardState::reset_everything";
 		error.quick_desc = "Couldn't overwrite byte to the keyboard save file.";
@@ -153,18 +342,83 @@ void KeyboardState::increment_key(KeyEntry key_entry) noexcept {
 	key_entries.push_back(key_entry);
 	++modifications_since_save;
 	++key_times[key_entry.key_code];
+	typing.feed(key_entry.timestamp);
+	minutes.add(key_entry.timestamp);
+	postings.add(key_entry.key_code, key_entry.timestamp);
+	holds.add(key_entry.key_code, key_entry.hold);
+	load.add(key_entry.key_code, key_entry.timestamp);
+	week.add(clock, key_entry.timestamp);
+}
 
-	if (modifications_since_save >= Keyboard_Save_Every_Mod) {
-		if (save_to_file(get_app_data_path() / Default_Keyboard_Path)) {
-			modifications_since_save = 0;
-		}
-		else {
-			logs.lock_and_write(
-				"KeyboardState::increment_key."
-				"Error when trying to auto save after n modifications."
-			);
+bool KeyboardState::ensure_entries_loaded() noexcept {
+	if (!pending_entries) return true;
+	auto& pending = *pending_entries;
+
+	std::vector<std::byte> bytes;
+	auto err = file_read_range(pending.path, pending.offset, pending.count * pending.record_size, bytes);
+	if (err) {
+		ErrorDescription error;
+		error.location = "KeyboardState::ensure_entries_loaded";
+		error.quick_desc = "Couldn't read the key entries from the keyboard save file.";
+		error.message = format_errno(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+		return false;
+	}
+
+	// The entries typed since the load go after the ones from the file.
+	std::vector<KeyEntry> entries(pending.count + key_entries.size());
+	decode_key_entries(bytes.data(), entries.data(), pending.count);
+	if (pending_holds && pending_holds->count == pending.count) {
+		bytes.clear();
+		auto size = pending.count * KeyHold::Packed_Size;
+		if (!file_read_range(pending_holds->path, pending_holds->offset, size, bytes)) {
+			decode_holds(bytes.data(), entries.data(), pending.count);
 		}
+		else logs.write(LogTag::FileIO, "ensure_entries_loaded, can't read the holds column.");
 	}
+	std::copy(BEG_END(key_entries), std::begin(entries) + pending.count);
+
+	key_entries = std::move(entries);
+	pending_entries.reset();
+	pending_holds.reset();
+	return true;
+}
+
+// The postings left in the file by a lazy load, then the ones added since.
+static int read_pending_postings(const KeyboardState& ks, KeyPostings& out) noexcept {
+	auto& pending = *ks.pending_postings;
+	std::vector<std::byte> bytes;
+	if (auto err = file_read_range(pending.path, pending.offset, pending.size, bytes)) return err;
+	if (!out.load(bytes, 0, bytes.size())) return EINVAL;
+
+	if (ks.pending_postings_cutoff) out.drop_before(ks.pending_postings_cutoff);
+	out.append(ks.postings);
+	return 0;
+}
+
+bool KeyboardState::ensure_postings_loaded() noexcept {
+	if (!pending_postings) return true;
+
+	KeyPostings loaded;
+	if (auto err = read_pending_postings(*this, loaded); err) {
+		ErrorDescription error;
+		error.location = "KeyboardState::ensure_postings_loaded";
+		error.quick_desc = "Couldn't read the postings from the keyboard save file.";
+		error.message = format_errno(err);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		// They can still be rebuilt from the entries.
+		if (!ensure_entries_loaded()) return false;
+		replay_postings(*this);
+		return true;
+	}
+
+	postings = std::move(loaded);
+	pending_postings.reset();
+	pending_postings_cutoff = 0;
+	return true;
 }
 
 void KeyboardWindow::render(std::optional<KeyboardState>& state) noexcept {
@@ -203,16 +457,32 @@ void KeyboardWindow::render(std::optional<KeyboardState>& state) noexcept {
 		reload = true;
 	}
 	ImGui::Separator();
+	// Under the keyboard lock like the ingest, the counters are redone for the new fingers.
+	if (state->load.layout != layout) state->load.set_layout(layout, state->key_times);
+
+	if (ImGui::CollapsingHeader("Typing")) {
+		render_typing_stats(*state);
+	}
+	if (ImGui::CollapsingHeader("Chords")) {
+		render_chords(*state, layout);
+	}
+	if (ImGui::CollapsingHeader("Hands")) {
+		render_key_load(*state);
+	}
+	if (ImGui::CollapsingHeader("Week")) {
+		render_week_hours("Keys by weekday and hour", state->week, 1, "keys");
+	}
+	ImGui::Separator();
 	ImGui::Checkbox("key list", &render_key_list_checkbox);
 
 	render_keyboard_activity_timeline(*state);
 
 	if (render_key_list_checkbox) {
-		render_key_list(*state);
+		render_key_list(*state, key_details, layout);
 	}
 }
 
-std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes) noexcept {
+static std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes) noexcept {
 	size_t it = 5; // we start after the version byte and the signature bytes(4).
 
 	if (bytes.size() < it + (1 + 255) * 4) {
@@ -229,14 +499,11 @@ std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes)
 
 	KeyboardState ks;
 
-	for (size_t i = 0; i < 255; ++i) {
-		ks.key_times[i] = read_uint32(bytes, it);
-		it += 4;
-	}
+	read_key_times(bytes, it, ks);
+	it += 255 * 4;
 
 	// The next uint32_t is the size of the list of KeyEntries
 	auto key_entries_size = read_uint32(bytes, it);
-	ks.key_entries.reserve(key_entries_size);
 	
 	it += 4;
 
@@ -253,17 +520,227 @@ std::optional<KeyboardState> version1_read(const std::vector<std::byte>& bytes)
 		return std::nullopt;
 	}
 
-	for (size_t i = it; i < it + KeyEntry::Packed_Size * key_entries_size; i += 9) {
-		KeyEntry entry;
-		entry.key_code = read_uint8(bytes, i);
-		entry.timestamp = read_uint64(bytes, i + 1);
-		ks.key_entries.push_back(entry);
+	ks.key_entries.resize(key_entries_size);
+	auto src = bytes.data() + it;
+	parallel_blocks(ks.key_entries.size(), Min_Decode_Block, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			auto record = src + KeyEntry::Packed_Size * i;
+			ks.key_entries[i].key_code = (uint8_t)record[0];
+			ks.key_entries[i].timestamp = load_le<uint64_t>(record + 1) * 1'000;
+		}
+	});
+
+	replay_typing(ks);
+	replay_minutes(ks);
+	replay_postings(ks);
+	replay_bigrams(ks);
+	replay_week(ks);
+	ks.load.set_layout(ks.load.layout, ks.key_times);
+	return ks;
+}
+
+static std::optional<KeyboardState> version2_read(const std::vector<std::byte>& bytes) noexcept {
+	size_t it = 5; // we start after the version byte and the signature bytes(4).
+
+	if (bytes.size() < it + (1 + 255) * 4) {
+		ErrorDescription error;
+		error.location = "version2_read";
+		error.quick_desc = "The keyboard file save is too small to be well formed.";
+		error.message = "The file is: " + std::to_string(bytes.size()) + " when it should be at"
+			"least 5 + (1 + 255) * 4bytes.";
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
+	}
+
+	KeyboardState ks;
+
+	read_key_times(bytes, it, ks);
+	it += 255 * 4;
+
+	// The next uint32_t is the size of the list of KeyEntries
+	auto key_entries_size = read_uint32(bytes, it);
+
+	it += 4;
+
+	if (bytes.size() < it + KeyEntry::Packed_Size * key_entries_size) {
+		ErrorDescription error;
+		error.location = "version2_read";
+		error.quick_desc = "The keyboard file save is too small to be well formed.";
+		error.message = "The file is: " + std::to_string(bytes.size()) + " long when it should be"
+			" at least" + std::to_string(it + KeyEntry::Packed_Size * key_entries_size) + " bytes."
+			"\nSince the key entry list size's is: " + std::to_string(key_entries_size);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
+	}
+
+	ks.key_entries.resize(key_entries_size);
+	decode_key_entries(bytes.data() + it, ks.key_entries.data(), key_entries_size);
+	it += KeyEntry::Packed_Size * key_entries_size;
+
+	auto sections = read_sections(bytes, it);
+	if (!sections) {
+		ErrorDescription error;
+		error.location = "version2_read";
+		error.quick_desc = "The keyboard file save's sections are ill formed.";
+		error.message = "The section list starting at: " + std::to_string(it) + " goes past the"
+			" end of the file (" + std::to_string(bytes.size()) + " bytes).";
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
+	}
+
+	auto hours = find_section(*sections, TypingMetrics::Hours_Tag);
+	auto digest = find_section(*sections, TypingMetrics::Digest_Tag);
+	bool typing_loaded =
+		hours && ks.typing.load_hours(bytes, hours->offset, hours->size) &&
+		digest && ks.typing.intervals.load(bytes, digest->offset, digest->size);
+	if (!typing_loaded) replay_typing(ks);
+
+	auto minutes = find_section(*sections, KeyboardState::Minutes_Tag);
+	if (!minutes || !ks.minutes.load(bytes, minutes->offset, minutes->size)) replay_minutes(ks);
+
+	auto postings = find_section(*sections, KeyboardState::Postings_Tag);
+	if (!postings || !ks.postings.load(bytes, postings->offset, postings->size)) replay_postings(ks);
+
+	if (auto column = find_holds(bytes, *sections, ks.key_entries.size())) {
+		decode_holds(column, ks.key_entries.data(), ks.key_entries.size());
+	}
+	auto holds = find_section(*sections, KeyboardState::Hold_Stats_Tag);
+	if (!holds || !ks.holds.load(bytes, holds->offset, holds->size)) replay_holds(ks);
+
+	auto bigrams = find_section(*sections, KeyboardState::Bigrams_Tag);
+	bool bigrams_loaded =
+		bigrams && ks.load.bigrams.load(bytes, bigrams->offset, bigrams->size);
+	if (!bigrams_loaded) replay_bigrams(ks);
+	ks.load.set_layout(ks.load.layout, ks.key_times);
+
+	auto week = find_section(*sections, KeyboardState::Week_Tag);
+	if (!week || !ks.week.load(bytes, week->offset, week->size)) replay_week(ks);
+
+	auto generation = find_section(*sections, WriteAheadLog::Generation_Tag);
+	if (generation && generation->size >= 8) ks.generation = read_uint64(bytes, generation->offset);
+
+	return ks;
+}
+
+// Reads the header and the sections that come after the entries, the entries themselves stay
+// in the file. If a rollup is missing we have to read them anyway to rebuild it.
+static std::optional<KeyboardState> version2_read_lazy(const std::filesystem::path& path) noexcept {
+	constexpr size_t Header_Size = Version_0::Key_Entry_List_Offset;
+
+	auto file_size = get_file_length(path);
+	std::vector<std::byte> bytes;
+	if (!file_size || *file_size < Header_Size || file_read_range(path, 0, Header_Size, bytes)) {
+		ErrorDescription error;
+		error.location = "version2_read_lazy";
+		error.quick_desc = "The keyboard file save is too small to be well formed.";
+		error.message = "Couldn't read the first " + std::to_string(Header_Size) + " bytes of: " +
+			path.generic_string();
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
+	}
+
+	KeyboardState ks;
+	ks.version_number = 2;
+	read_key_times(bytes, Version_0::Key_Entry_Occurence_Offset, ks);
+	auto key_entries_size = read_uint32(bytes, Version_0::Key_Entry_List_Size_Offset);
+
+	auto sections_offset = Header_Size + KeyEntry::Packed_Size * (uint64_t)key_entries_size;
+	if (*file_size < sections_offset) {
+		ErrorDescription error;
+		error.location = "version2_read_lazy";
+		error.quick_desc = "The keyboard file save is too small to be well formed.";
+		error.message = "The file is: " + std::to_string(*file_size) + " long when it should be"
+			" at least" + std::to_string(sections_offset) + " bytes."
+			"\nSince the key entry list size's is: " + std::to_string(key_entries_size);
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
+	}
+	ks.pending_entries = PendingRecords{
+		path, Header_Size, key_entries_size, KeyEntry::Packed_Size
+	};
+
+	auto sections = read_file_sections(path, sections_offset, *file_size);
+	if (!sections) {
+		ErrorDescription error;
+		error.location = "version2_read_lazy";
+		error.quick_desc = "The keyboard file save's sections are ill formed.";
+		error.message = "The section list starting at: " + std::to_string(sections_offset) +
+			" goes past the end of the file (" + std::to_string(*file_size) + " bytes).";
+		error.type = ErrorDescription::Type::FileIO;
+		logs.lock_and_write(error);
+
+		return std::nullopt;
 	}
 
+	// Only the small rollups are read, each on its own.
+	auto read = [&](std::uint32_t tag) -> const FileSection* {
+		bytes.clear();
+		auto section = find_section(*sections, tag);
+		if (!section) return nullptr;
+		if (file_read_range(path, section->offset, section->size, bytes)) return nullptr;
+		return section;
+	};
+	auto hours = read(TypingMetrics::Hours_Tag);
+	bool typing_loaded = hours && ks.typing.load_hours(bytes, 0, hours->size);
+	auto digest = read(TypingMetrics::Digest_Tag);
+	typing_loaded = typing_loaded && digest && ks.typing.intervals.load(bytes, 0, digest->size);
+	auto minutes = read(KeyboardState::Minutes_Tag);
+	bool minutes_loaded = minutes && ks.minutes.load(bytes, 0, minutes->size);
+	auto holds = read(KeyboardState::Hold_Stats_Tag);
+	bool holds_loaded = holds && ks.holds.load(bytes, 0, holds->size);
+	auto bigrams = read(KeyboardState::Bigrams_Tag);
+	bool bigrams_loaded = bigrams && ks.load.bigrams.load(bytes, 0, bigrams->size);
+	auto week = read(KeyboardState::Week_Tag);
+	bool week_loaded = week && ks.week.load(bytes, 0, week->size);
+	auto generation = read(WriteAheadLog::Generation_Tag);
+	if (generation && generation->size >= 8) ks.generation = read_uint64(bytes, 0);
+
+	// The largest of the rollups, only read when a key is drilled into.
+	auto postings = find_section(*sections, KeyboardState::Postings_Tag);
+	if (postings) ks.pending_postings = PendingSection{ path, postings->offset, postings->size };
+	bool postings_loaded = postings != nullptr;
+
+	// The holds column stays in the file with the entries, only its count is checked.
+	auto column = find_section(*sections, KeyboardState::Holds_Tag);
+	bytes.clear();
+	bool column_ok =
+		column && column->size == 4 + KeyHold::Packed_Size * (uint64_t)key_entries_size &&
+		!file_read_range(path, column->offset, 4, bytes) &&
+		read_uint32(bytes, 0) == key_entries_size;
+	if (column_ok) {
+		ks.pending_holds = PendingRecords{
+			path, column->offset + 4, key_entries_size, KeyHold::Packed_Size
+		};
+	}
+
+	bool all_loaded =
+		typing_loaded && minutes_loaded && postings_loaded && holds_loaded && bigrams_loaded &&
+		week_loaded;
+	if (!all_loaded) {
+		if (!ks.ensure_entries_loaded()) return std::nullopt;
+		if (!typing_loaded) replay_typing(ks);
+		if (!minutes_loaded) replay_minutes(ks);
+		if (!postings_loaded) replay_postings(ks);
+		if (!holds_loaded) replay_holds(ks);
+		if (!bigrams_loaded) replay_bigrams(ks);
+		if (!week_loaded) replay_week(ks);
+	}
+	ks.load.set_layout(ks.load.layout, ks.key_times);
+
 	return ks;
 }
 
-std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes) noexcept {
+static std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes) noexcept {
 	size_t it = 5; // we start after the version byte and the signature bytes(4).
 
 	if (bytes.size() < it + (1 + 255) * 4) {
@@ -280,14 +757,11 @@ std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes)
 
 	KeyboardState ks;
 
-	for (size_t i = 0; i < 255; ++i) {
-		ks.key_times[i] = read_uint32(bytes, it);
-		it += 4;
-	}
+	read_key_times(bytes, it, ks);
+	it += 255 * 4;
 
 	// The next uint32_t is the size of the list of KeyEntries
 	auto key_entries_size = read_uint32(bytes, it);
-	ks.key_entries.reserve(key_entries_size);
 	
 	it += 4;
 
@@ -304,38 +778,113 @@ std::optional<KeyboardState> version0_read(const std::vector<std::byte>& bytes)
 		return std::nullopt;
 	}
 
-	for (size_t i = it; i < it + 5 * key_entries_size; i += 5) {
-		KeyEntry entry;
-		entry.key_code = read_uint8(bytes, i);
-		entry.timestamp = (uint64_t)read_uint32(bytes, i + 1);
-		ks.key_entries.push_back(entry);
-	}
-
+	ks.key_entries.resize(key_entries_size);
+	auto src = bytes.data() + it;
+	parallel_blocks(ks.key_entries.size(), Min_Decode_Block, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			auto record = src + 5 * i;
+			ks.key_entries[i].key_code = (uint8_t)record[0];
+			ks.key_entries[i].timestamp = (uint64_t)load_le<uint32_t>(record + 1) * 1'000;
+		}
+	});
+
+	replay_typing(ks);
+	replay_minutes(ks);
+	replay_postings(ks);
+	replay_bigrams(ks);
+	replay_week(ks);
+	ks.load.set_layout(ks.load.layout, ks.key_times);
 	return ks;
 }
 
-bool version1_write(const KeyboardState& state, const std::filesystem::path& path) noexcept {
-	std::vector<std::byte> bytes;
+static int version2_write(
+	const KeyboardState& state, const std::filesystem::path& path, std::vector<FileSection>& written
+) noexcept {
+	size_t n_pending = state.pending_entries ? state.pending_entries->count : 0;
+	size_t n_entries = n_pending + state.key_entries.size();
 
-	insert_uint32(bytes, Keyboard_File_Signature);
-	insert_uint8(bytes, 1);
+	FileParts parts;
+	ByteWriter writer{ parts.bytes() };
+	writer.reserve(5 + 255 * 4 + 4);
 
-	for (auto& x : state.key_times) {
-		insert_uint32(bytes, x);
-	}
+	writer.write(Keyboard_File_Signature);
+	writer.write((uint8_t)2);
+
+	write_key_times(writer, state);
 
-	insert_uint32(bytes, state.key_entries.size());
+	writer.write((uint32_t)n_entries);
 
+	// The entries that were never loaded are copied as is from the old file, before we overwrite
+	// it.
+	if (state.pending_entries) {
+		auto& pending = *state.pending_entries;
+		parts.copy(pending.path, pending.offset, n_pending * pending.record_size);
+	}
+
+	ByteWriter entries{ parts.bytes() };
+	auto dst = entries.claim(KeyEntry::Packed_Size * state.key_entries.size());
 	for (auto& x : state.key_entries) {
-		insert_uint8(bytes, x.key_code);
-		insert_uint64(bytes, x.timestamp);
+		encode_key_entry(x, dst);
+		dst += KeyEntry::Packed_Size;
+	}
+
+	std::vector<std::pair<std::uint32_t, FileParts>> sections;
+	sections.push_back({ TypingMetrics::Hours_Tag, {} });
+	state.typing.save_hours(sections.back().second.bytes());
+	sections.push_back({ TypingMetrics::Digest_Tag, {} });
+	state.typing.intervals.save(sections.back().second.bytes());
+	sections.push_back({ KeyboardState::Minutes_Tag, {} });
+	state.minutes.save(sections.back().second.bytes());
+	sections.push_back({ KeyboardState::Postings_Tag, {} });
+	if (state.pending_postings) {
+		auto& pending = *state.pending_postings;
+		auto err = state.postings.save_after(
+			pending.path,
+			pending.offset,
+			pending.size,
+			state.pending_postings_cutoff,
+			sections.back().second
+		);
+		if (err) {
+			logs.write(LogTag::FileIO, "version2_write, KeyPostings::save_after: {}", err);
+			return err;
+		}
+	}
+	else state.postings.save(sections.back().second.bytes());
+	sections.push_back({ KeyboardState::Hold_Stats_Tag, {} });
+	state.holds.save(sections.back().second.bytes());
+	sections.push_back({ KeyboardState::Bigrams_Tag, {} });
+	state.load.bigrams.save(sections.back().second.bytes());
+	sections.push_back({ KeyboardState::Week_Tag, {} });
+	state.week.save(sections.back().second.bytes());
+
+	sections.push_back({ KeyboardState::Holds_Tag, {} });
+	{
+		auto& column = sections.back().second;
+		ByteWriter{ column.bytes() }.write((uint32_t)n_entries);
+		auto& holds = state.pending_holds;
+		if (holds && holds->count == n_pending) {
+			column.copy(holds->path, holds->offset, n_pending * holds->record_size);
+		}
+		else {
+			ByteWriter unknown{ column.bytes() };
+			for (size_t i = 0; i < n_pending; ++i) {
+				unknown.write((uint8_t)0);
+				unknown.write(KeyHold::Unknown_Ms);
+			}
+		}
+		ByteWriter column_writer{ column.bytes() };
+		encode_holds(state.key_entries, column_writer);
 	}
+	sections.push_back({ WriteAheadLog::Generation_Tag, {} });
+	ByteWriter{ sections.back().second.bytes() }.write(state.generation);
+	written = insert_sections(parts, std::move(sections));
 
-	return file_overwrite_byte(bytes, path);
+	return file_replace_atomic(parts, path);
 }
 
 void KeyboardState::repair() noexcept {
-	if (key_entries.empty()) return;
+	if (!ensure_entries_loaded() || key_entries.empty()) return;
 
 	auto first = key_entries.front().timestamp;
 
@@ -345,4 +894,5 @@ void KeyboardState::repair() noexcept {
 		}),
 		std::end(key_entries)
 	);
+	replay_postings(*this);
 }
@@ -4,39 +4,125 @@
 #include <array>
 #include <filesystem>
 #include <optional>
-#include <d3d9.h>
+#include <string>
+
+#include "Typing.hpp"
+#include "MinuteIndex.hpp"
+#include "KeyPostings.hpp"
+#include "KeyHolds.hpp"
+#include "KeyLayout.hpp"
+#include "KeyLoad.hpp"
+#include "WeekHours.hpp"
+#include "Common.hpp"
+#include "Retention.hpp"
 
 struct KeyEntry {
 	static constexpr size_t Packed_Size = 9;
+	// The write ahead log record: the version 2 record then the hold as in its column.
+	static constexpr size_t Log_Size = Packed_Size + KeyHold::Packed_Size;
 
 	uint8_t key_code;
-	uint64_t timestamp;
+	// Not in the record, the version 2 files have it in a column of its own and the log after it.
+	KeyHold hold;
+	uint64_t timestamp; // milliseconds since epoch, the files before version 2 were in seconds.
 };
 
 extern const std::filesystem::path Default_Keyboard_Path;
-constexpr size_t Keyboard_Save_Every_Mod{ 50 };
 
 constexpr std::uint32_t Keyboard_File_Signature = 'BYEK'; // 'KEYB' byte swapped.
 
+// The version 2 record, also the one of the write ahead logs written before they had the hold.
+extern void encode_key_entry(const KeyEntry& x, std::byte* dst) noexcept;
+extern void decode_key_entries(const std::byte* src, KeyEntry* dst, size_t n) noexcept;
+// The write ahead log record, KeyEntry::Log_Size bytes.
+extern void encode_logged_key_entry(const KeyEntry& x, std::byte* dst) noexcept;
+extern void decode_logged_key_entries(const std::byte* src, KeyEntry* dst, size_t n) noexcept;
+
 struct KeyboardState {
+	static constexpr std::uint32_t Minutes_Tag = 'XNIM'; // 'MINX' byte swapped.
+	static constexpr std::uint32_t Postings_Tag = 'TSPK'; // 'KPST' byte swapped.
+	static constexpr std::uint32_t Holds_Tag = 'DLOH'; // 'HOLD' byte swapped.
+	static constexpr std::uint32_t Hold_Stats_Tag = 'TSLH'; // 'HLST' byte swapped.
+	static constexpr std::uint32_t Bigrams_Tag = 'MRGB'; // 'BGRM' byte swapped.
+	static constexpr std::uint32_t Week_Tag = 'KEEW'; // 'WEEK' byte swapped.
+
 	uint8_t version_number;
 	std::array<size_t, 0xff> key_times;
 	std::vector<KeyEntry> key_entries;
+	// Set by a lazy load, the entries in the file that are not in key_entries yet.
+	std::optional<PendingRecords> pending_entries;
+	// The holds column of the pending entries, read with them. Not set if the file had none.
+	std::optional<PendingRecords> pending_holds;
+	TypingMetrics typing;
+	MinuteIndex minutes;
+	// The timestamps of key_entries by key, for the history of a single key. A lazy load leaves
+	// the ones of the file in it until ensure_postings_loaded, postings then only has the keys
+	// typed since.
+	KeyPostings postings;
+	std::optional<PendingSection> pending_postings;
+	std::uint64_t pending_postings_cutoff{ 0 }; // of the compactions, applied when they are read.
+	HoldStats holds;
+	// The fingers and hands of the keys, only the bigrams are in the file.
+	KeyLoad load;
+	// Keys by local weekday and hour.
+	WeekHours week;
+	LocalClock clock;
 
 	size_t modifications_since_save{ 0 };
+	std::uint64_t generation{ 0 }; // of the last snapshot, see WriteAheadLog.
 
-	static std::optional<KeyboardState> load_from_file(std::filesystem::path path) noexcept;
+	// With lazy the counters and the sections are read but the key entries are left in the file
+	// until ensure_entries_loaded is called. Only the current version can be read that way, the
+	// older ones need the entries to rebuild the rollups.
+	static std::optional<KeyboardState>
+	load_from_file(std::filesystem::path path, bool lazy = false) noexcept;
 
-	[[nodiscard]] bool save_to_file(std::filesystem::path path) const noexcept;
+	[[nodiscard]] bool save_to_file(std::filesystem::path path) noexcept;
 	
 	std::array<size_t, 0xff> get_n_of_all_keys() const noexcept;
 	void increment_key(KeyEntry key_entry) noexcept;
+	[[nodiscard]] bool ensure_entries_loaded() noexcept;
+	[[nodiscard]] bool ensure_postings_loaded() noexcept;
+	// Drops the entries older than the policy and folds the old minutes into hours, the counters
+	// and the typing rollups are untouched. Returns true if something changed.
+	[[nodiscard]] bool compact(const RetentionPolicy& policy, std::uint64_t now) noexcept;
 
 	void repair() noexcept;
 
 	[[nodiscard]] bool reset_everything() noexcept;
 };
 
+// The history of the key selected in the key list, the uses added to the postings since are
+// decoded when its count changes.
+struct KeyDetails {
+	std::optional<std::uint8_t> key;
+	std::string title;
+	size_t count{ 0 }; // of the key when it was decoded.
+
+	std::vector<std::uint64_t> timestamps;
+	std::vector<float> days; // since the day of the first use.
+	std::vector<float> per_day;
+	std::array<float, 24> per_hour{};
+
+	// Where the decoding stopped, the hour and day the last use fell in.
+	KeyPostings::Cursor cursor;
+	struct {
+		std::uint64_t first_day{ 0 };
+		std::uint64_t hour_start{ 1 };
+		std::uint64_t hour_end{ 0 };
+		std::uint64_t day_start{ 1 };
+		std::uint64_t day_end{ 0 };
+		int hour{ 0 };
+		size_t day{ 0 };
+	} clock;
+
+	// Uses of the key in each exe, joined with the app usages by join_key_apps once the event
+	// lock is taken.
+	bool apps_dirty{ true };
+	size_t apps_usages_size{ 0 }; // the usages count it was joined at.
+	std::vector<std::pair<std::string, size_t>> apps;
+};
+
 struct KeyboardWindow {
 	const size_t Reset_Button_Time{ 5 };
 
@@ -48,5 +134,8 @@ struct KeyboardWindow {
 	size_t reset_button_timer = Reset_Button_Time;
 	time_t reset_time_start = 0;
 
+	KeyDetails key_details;
+	KeyboardLayout layout{ KeyboardLayout::Qwerty }; // of the names, from the settings.
+
 	void render(std::optional<KeyboardState>& state) noexcept;
 };
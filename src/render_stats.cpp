@@ -1,115 +1,14 @@
 #include "render_stats.hpp"
-#include <Windows.h>
 #include "imgui.h"
 #include "imgui_ext.h"
 #include "Common.hpp"
+#include "TimeInfo.hpp"
+#include "KeyLayout.hpp"
 #include <string>
+#include <ctime>
 #include <algorithm>
+#include <map>
 
-std::string get_name_of_key(uint8_t key_code) noexcept {
-	switch (key_code)
-	{
-	#define X(x) x: return #x
-		case X(VK_NUMPAD0	);
-		case X(VK_NUMPAD1	);
-		case X(VK_NUMPAD2	);
-		case X(VK_NUMPAD3	);
-		case X(VK_NUMPAD4	);
-		case X(VK_NUMPAD5	);
-		case X(VK_NUMPAD6	);
-		case X(VK_NUMPAD7	);
-		case X(VK_NUMPAD8	);
-		case X(VK_NUMPAD9	);
-		case X(VK_SEPARATOR	);
-		case X(VK_SUBTRACT	);
-		case X(VK_DECIMAL	);
-		case X(VK_DIVIDE	);
-		case X(VK_F1		);
-		case X(VK_F2		);
-		case X(VK_F3		);
-		case X(VK_F4		);
-		case X(VK_F5		);
-		case X(VK_F6		);
-		case X(VK_F7		);
-		case X(VK_F8		);
-		case X(VK_F9		);
-		case X(VK_F10		);
-		case X(VK_F11		);
-		case X(VK_F12		);
-		case X(VK_F13		);
-		case X(VK_F14		);
-		case X(VK_F15		);
-		case X(VK_F16		);
-		case X(VK_F17		);
-		case X(VK_F18		);
-		case X(VK_F19		);
-		case X(VK_F20		);
-		case X(VK_F21		);
-		case X(VK_F22		);
-		case X(VK_F23		);
-		case X(VK_F24		);
-		case X(VK_NUMLOCK	);
-		case X(VK_SCROLL	);
-		case X(VK_LSHIFT	);
-		case X(VK_RSHIFT	);
-		case X(VK_LCONTROL	);
-		case X(VK_RCONTROL	);
-		case X(VK_LMENU		);
-		case X(VK_RMENU		);
-		case X(VK_PLAY		);
-		case X(VK_ZOOM		);
-		case X(VK_LBUTTON	);
-		case X(VK_RBUTTON	);
-		case X(VK_CANCEL	);
-		case X(VK_MBUTTON	);
-		case X(VK_BACK		);
-		case X(VK_TAB		);
-		case X(VK_CLEAR		);
-		case X(VK_RETURN	);
-		case X(VK_SHIFT		);
-		case X(VK_CONTROL	);
-		case X(VK_MENU		);
-		case X(VK_PAUSE		);
-		case X(VK_CAPITAL	);
-		case X(VK_ESCAPE	);
-		case X(VK_SPACE		);
-		case X(VK_PRIOR		);
-		case X(VK_NEXT		);
-		case X(VK_END		);
-		case X(VK_HOME		);
-		case X(VK_LEFT		);
-		case X(VK_UP		);
-		case X(VK_RIGHT		);
-		case X(VK_DOWN		);
-		case X(VK_SELECT	);
-		case X(VK_PRINT		);
-		case X(VK_EXECUTE	);
-		case X(VK_SNAPSHOT	);
-		case X(VK_INSERT	);
-		case X(VK_DELETE	);
-		case X(VK_HELP		);
-#undef X
-		case 190: return ".";
-		case 0x07: case 0x0A: case 0x0B: case 0x0E: case 0x0F: case 0x16: case 0x1A: case 0x5E:
-		case 0x97: case 0x98: case 0x99: case 0x9A: case 0x9B: case 0x9C: case 0x9D: case 0x9E:
-		case 0x9F: case 0xB8: case 0xB9: case 0xC1: case 0xC2: case 0xC3: case 0xC4: case 0xC5:
-		case 0xC6: case 0xC7: case 0xC8: case 0xC9: case 0xCA: case 0xCB: case 0xCC: case 0xCD:
-		case 0xCE: case 0xCF: case 0xD0: case 0xD1: case 0xD2: case 0xD3: case 0xD4: case 0xD5:
-		case 0xD6: case 0xD7: case 0xD8: case 0xD9: case 0xDA: case 0xE0: case 0xE8:
-		// reserved we do nothing.
-
-		case 0x92: case 0x93: case 0x94: case 0x95: case 0x96: case 0xE1: case 0xE3: case 0xE4:
-		case 0xE6: case 0xE9: case 0xEA: case 0xEB: case 0xEC: case 0xED: case 0xEE: case 0xEF:
-		case 0xF1: case 0xF2: case 0xF3: case 0xF4: case 0xF5:
-		//>TODO OEM specific
-			return "OEM specific";
-	default:
-		// so now we are in the 0-Z ascii range so we can just cast to a char.
-
-		return { (char)key_code };
-		break;
-	}
-}
 std::string get_name_of_mouse_button(uint8_t button) noexcept {
 	switch ((MouseState::ButtonMap)button)
 	{
@@ -134,85 +33,436 @@ std::string get_name_of_mouse_button(uint8_t button) noexcept {
 	}
 }
 
-void render_key_list(const KeyboardState& ks) noexcept {
-	static std::optional<uint8_t> key_selected;
-	static bool render_idx{ false };
-	const auto& list = ks.get_n_of_all_keys();
+// The local hour and day of each use. Consecutive uses mostly fall in the same hour, so the
+// local time is only asked for when one leaves the cached hour, and the day boundary comes from
+// mktime to stay right across a dst change.
+// Only the uses past the cursor are decoded, unless the list was compacted or read from the file
+// since, then it starts over.
+static void decode_key_details(const KeyboardState& ks, KeyDetails& details) noexcept {
+	auto key = *details.key;
+	auto& list = ks.postings.lists[key];
+	bool append =
+		details.count == details.cursor.index && details.count <= list.count &&
+		(details.timestamps.empty() || details.timestamps.front() == list.first);
+	if (!append) {
+		details.timestamps.clear();
+		details.days.clear();
+		details.per_day.clear();
+		details.per_hour = {};
+		details.cursor = {};
+		details.clock = {};
+	}
+	details.apps_dirty = true;
+
+	auto begin = details.timestamps.size();
+	details.count = list.count;
+	details.timestamps.reserve(details.count);
+	ks.postings.for_each_from(key, details.cursor, [&](std::uint64_t t) {
+		details.timestamps.push_back(t);
+	});
 
-	std::vector<std::pair<std::uint8_t, size_t>> key_pair(list.size());
-	for (size_t i = 0; i < list.size(); ++i) {
-		key_pair[i] = { (std::uint8_t)i, list[i] };
+	auto& c = details.clock;
+	for (size_t i = begin; i < details.timestamps.size(); ++i) {
+		auto t = details.timestamps[i];
+		if (t < c.hour_start || c.hour_end <= t) {
+			auto tm = get_local_time((std::time_t)(t / 1'000));
+			c.hour = tm.tm_hour;
+			c.hour_start = t - t % 1'000 - (tm.tm_min * 60ull + tm.tm_sec) * 1'000;
+			c.hour_end = c.hour_start + 3'600'000;
+
+			if (t < c.day_start || c.day_end <= t) {
+				c.day_start = c.hour_start - tm.tm_hour * 3'600'000ull;
+				tm.tm_mday += 1;
+				tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+				tm.tm_isdst = -1;
+				auto next = std::mktime(&tm);
+				c.day_end = next > 0 ? (std::uint64_t)next * 1'000 : c.day_start + 86'400'000;
+				if (c.first_day == 0) c.first_day = c.day_start;
+				// A day is 23 to 25 hours, the rounding absorbs it.
+				c.day = (size_t)((c.day_start - c.first_day + 43'200'000) / 86'400'000);
+			}
+		}
+
+		details.per_hour[c.hour] += 1;
+		if (c.day >= details.per_day.size()) details.per_day.resize(c.day + 1, 0.f);
+		details.per_day[c.day] += 1;
+	}
+	for (size_t i = details.days.size(); i < details.per_day.size(); ++i) {
+		details.days.push_back((float)i);
 	}
+}
 
-	std::sort(std::begin(key_pair), std::end(key_pair), [](auto a, auto b) {
+static void render_key_details(const KeyboardState& ks, KeyDetails& details) noexcept {
+	auto& list = ks.postings.lists[*details.key];
+	bool moved = !details.timestamps.empty() && details.timestamps.front() != list.first;
+	if (details.count != list.count || moved) decode_key_details(ks, details);
+
+	bool open = true;
+	ImGui::Begin(details.title.c_str(), &open);
+	defer{ ImGui::End(); };
+	if (!open) {
+		details = {};
+		return;
+	}
+
+	if (details.timestamps.empty()) {
+		ImGui::Text("No use of this key is kept, it may have been compacted.");
+		return;
+	}
+
+	char first[64];
+	char last[64];
+	auto first_tm = get_local_time((std::time_t)(details.timestamps.front() / 1'000));
+	auto last_tm = get_local_time((std::time_t)(details.timestamps.back() / 1'000));
+	strftime(first, sizeof(first), "%Y-%m-%d %H:%M", &first_tm);
+	strftime(last, sizeof(last), "%Y-%m-%d %H:%M", &last_tm);
+	ImGui::Text("%zu uses from %s to %s.", details.timestamps.size(), first, last);
+
+	if (ImPlot::BeginPlot("Per day", "Days since the first use", "Uses")) {
+		defer{ ImPlot::EndPlot(); };
+		ImPlot::PlotBars(
+			"Uses", details.days.data(), details.per_day.data(), (int)details.days.size(), 0.9f
+		);
+	}
+	if (ImPlot::BeginPlot("Per hour of the day", "Hour", "Uses")) {
+		defer{ ImPlot::EndPlot(); };
+		ImPlot::PlotBars("Uses", details.per_hour.data(), (int)details.per_hour.size(), 0.9f);
+	}
+
+	if (!ImGui::CollapsingHeader("By app")) return;
+	if (details.apps_dirty) {
+		ImGui::Text("Waiting for the app usages.");
+		return;
+	}
+	if (details.apps.empty()) ImGui::Text("No app usage covers these uses.");
+	ImGui::Columns(2, "app - n", false);
+	for (auto& [name, n] : details.apps) {
+		ImGui::TextUnformatted(name.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("%zu", n);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
+
+void join_key_apps(KeyDetails& details, const EventState& es) noexcept {
+	if (!details.key || es.pending_usages) return;
+	if (!details.apps_dirty && details.apps_usages_size == es.apps_usages.size()) return;
+	details.apps_dirty = false;
+	details.apps_usages_size = es.apps_usages.size();
+	details.apps.clear();
+
+	std::map<AppUsage::Stack_String, size_t> counts;
+	for (auto t : details.timestamps) {
+		// The usages are in microseconds.
+		es.usage_times.containing(t * 1'000, [&](size_t id) {
+			counts[es.apps_usages[id].exe_name]++;
+		});
+	}
+
+	for (auto& [name, n] : counts) details.apps.push_back({ name.data(), n });
+	std::sort(std::begin(details.apps), std::end(details.apps), [](auto& a, auto& b) {
 		return a.second > b.second;
 	});
+}
+
+void render_key_list(KeyboardState& ks, KeyDetails& details, KeyboardLayout layout) noexcept {
+	struct Row {
+		std::uint8_t key_code;
+		size_t n;
+		std::string_view name; // from the key table, null terminated.
+		std::string n_text;
+		std::string hold_text;
+	};
+
+	static bool render_idx{ false };
+	// The rows are only rebuilt when a counter moved, not every frame.
+	static std::array<size_t, 0xff> cached_list{};
+	static KeyboardLayout cached_layout{};
+	static std::vector<Row> rows;
+	const auto& list = ks.get_n_of_all_keys();
+
+	if (list != cached_list || layout != cached_layout) {
+		cached_list = list;
+		cached_layout = layout;
+		rows.clear();
+		for (size_t i = 0; i < list.size(); ++i) {
+			if (list[i] == 0) continue;
+			char hold[32] = "";
+			auto average = ks.holds.average_ms((uint8_t)i);
+			if (ks.holds.n_holds[i]) snprintf(hold, sizeof(hold), "%.0fms", average);
+			auto name = key_name((uint8_t)i, layout);
+			rows.push_back({ (std::uint8_t)i, list[i], name, std::to_string(list[i]), hold });
+		}
+
+		std::sort(std::begin(rows), std::end(rows), [](auto& a, auto& b) {
+			return a.n > b.n;
+		});
+	}
 
 	ImGui::Text("All keys");
 	ImGui::SameLine();
 	ImGui::Checkbox("Index", &render_idx);
-	ImGui::Columns(render_idx ? 3 : 2, "key - n", false);
-	for (uint8_t i = 0; i < key_pair.size(); ++i) {
-		auto it = key_pair[i].first;
-		auto x = key_pair[i].second;
-		if (x == 0) continue;
+	ImGui::Columns(render_idx ? 4 : 3, "key - n - hold", false);
+
+	ImGuiListClipper clipper((int)rows.size());
+	while (clipper.Step()) for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+		auto& row = rows[i];
+		ImGui::PushID(row.key_code);
+		defer{ ImGui::PopID(); };
 
 		if (render_idx) {
-			ImGui::Text("%u", it);
+			ImGui::Text("%u", row.key_code);
 			ImGui::NextColumn();
 		}
 
 		bool selected = ImGui::Selectable(
-			get_name_of_key(it).c_str(),
-			key_selected && *key_selected == it,
+			row.name.data(),
+			details.key && *details.key == row.key_code,
 			ImGuiSelectableFlags_SpanAllColumns
 		);
-		if (selected) {
-			key_selected = it;
+		if (selected && details.key != row.key_code) {
+			details = {};
+			details.key = row.key_code;
+			details.title = "Data of: " + std::string(row.name);
 		}
 
 		ImGui::NextColumn();
-		ImGui::Text("%s", std::to_string(x).c_str());
+		ImGui::TextUnformatted(row.n_text.c_str());
+		ImGui::NextColumn();
+		ImGui::TextUnformatted(row.hold_text.c_str());
 		ImGui::NextColumn();
 	}
+	ImGui::Columns(1);
 
-	if (key_selected) {
-		std::string window_data_title = "Data of: " + get_name_of_key(*key_selected);
-		ImGui::Begin(window_data_title.c_str());
-		ImGui::Text("Come back later !");
-		ImGui::End();
+	// The postings a lazy load left in the file are read with the first key drilled into.
+	if (details.key && !ks.ensure_postings_loaded()) details = {};
+	if (details.key) render_key_details(ks, details);
+}
+
+void render_chords(const KeyboardState& ks, KeyboardLayout layout) noexcept {
+	struct Row {
+		std::uint32_t n;
+		std::string name;
+	};
+	static size_t cached_n_chords{ SIZE_MAX };
+	static KeyboardLayout cached_layout{};
+	static std::vector<Row> rows;
+
+	auto& holds = ks.holds;
+	if (cached_n_chords != holds.n_chords || cached_layout != layout) {
+		cached_n_chords = holds.n_chords;
+		cached_layout = layout;
+		rows.clear();
+		for (size_t i = 0; i < holds.chords.size(); ++i) {
+			if (holds.chords[i] == 0) continue;
+
+			auto modifiers = (std::uint8_t)(i / HoldStats::N_Keys);
+			auto key = (std::uint8_t)(i % HoldStats::N_Keys);
+			char name[32];
+			append_modifiers_name(modifiers, name, sizeof(name));
+			rows.push_back({ holds.chords[i], name + std::string(key_name(key, layout)) });
+		}
+		std::sort(std::begin(rows), std::end(rows), [](auto& a, auto& b) { return a.n > b.n; });
 	}
+
+	if (rows.empty()) {
+		ImGui::Text("No chord yet.");
+		return;
+	}
+
+	ImGui::Text("%zu chords.", holds.n_chords);
+	ImGui::Columns(2, "chord - n", false);
+	ImGuiListClipper clipper((int)rows.size());
+	while (clipper.Step()) for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+		ImGui::TextUnformatted(rows[i].name.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("%u", rows[i].n);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
+
+void render_key_load(const KeyboardState& ks) noexcept {
+	constexpr const char* Finger_Names[] = {
+		"None", "Left pinky", "Left ring", "Left middle", "Left index", "Thumbs",
+		"Right index", "Right middle", "Right ring", "Right pinky",
+	};
+	constexpr const char* Row_Names[] = {
+		"None", "Function", "Number", "Top", "Home", "Bottom", "Space",
+	};
+	constexpr size_t Max_Bigrams = 20;
+	struct Row {
+		std::uint32_t n;
+		std::string name;
+	};
+	static std::uint64_t cached_same_finger{ UINT64_MAX };
+	static KeyboardLayout cached_layout{};
+	static std::vector<Row> rows;
+
+	auto& load = ks.load;
+	std::uint64_t n_keys = 0;
+	for (size_t i = 1; i < load.fingers.size(); ++i) n_keys += load.fingers[i];
+	if (n_keys == 0) {
+		ImGui::Text("No key with a finger yet.");
+		return;
+	}
+
+	auto percent = [](std::uint64_t x, std::uint64_t n) { return n ? 100.0 * x / n : 0.0; };
+	ImGui::Text(
+		"Left hand %.1f%%  Right hand %.1f%%  Thumbs %.1f%%",
+		percent(load.hand_keys(Hand::Left), n_keys),
+		percent(load.hand_keys(Hand::Right), n_keys),
+		percent(load.fingers[(size_t)Finger::Thumb], n_keys)
+	);
+	ImGui::Text(
+		"Hand alternation %.1f%%  Same finger %.1f%% of %llu bigrams.",
+		100 * load.alternation_rate(),
+		100 * load.same_finger_rate(),
+		(unsigned long long)load.bigrams.n_bigrams
+	);
+
+	ImGui::Columns(2, "finger - load", false);
+	for (size_t i = 1; i < load.fingers.size(); ++i) {
+		ImGui::TextUnformatted(Finger_Names[i]);
+		ImGui::NextColumn();
+		char text[32];
+		snprintf(text, sizeof(text), "%.1f%%", percent(load.fingers[i], n_keys));
+		ImGui::ProgressBar(load.fingers[i] / (float)n_keys, ImVec2(-1, 0), text);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+
+	for (size_t i = 1; i < load.rows.size(); ++i) {
+		if (i > 1) ImGui::SameLine();
+		ImGui::Text("%s %.1f%%", Row_Names[i], percent(load.rows[i], n_keys));
+	}
+
+	// The whole matrix is only walked again when a same finger bigram was added.
+	if (cached_same_finger != load.same_finger || cached_layout != load.layout) {
+		cached_same_finger = load.same_finger;
+		cached_layout = load.layout;
+		rows.clear();
+		auto& counts = load.bigrams.counts;
+		for (size_t i = 0; i < counts.size(); ++i) {
+			if (counts[i] == 0) continue;
+
+			auto first = (std::uint8_t)(i / KeyBigrams::N_Keys);
+			auto second = (std::uint8_t)(i % KeyBigrams::N_Keys);
+			auto finger = key_info(first, load.layout).finger;
+			if (first == second || finger == Finger::None) continue;
+			if (finger != key_info(second, load.layout).finger) continue;
+
+			std::string name{ key_name(first, load.layout) };
+			name += " ";
+			name += key_name(second, load.layout);
+			rows.push_back({ counts[i], std::move(name) });
+		}
+		std::sort(std::begin(rows), std::end(rows), [](auto& a, auto& b) { return a.n > b.n; });
+		if (rows.size() > Max_Bigrams) rows.resize(Max_Bigrams);
+	}
+
+	if (rows.empty()) return;
+	ImGui::Text("Worst same finger bigrams:");
+	ImGui::Columns(2, "bigram - n", false);
+	for (auto& x : rows) {
+		ImGui::TextUnformatted(x.name.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("%u", x.n);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
 }
 
 void render_keyboard_activity_timeline(const KeyboardState& ks) noexcept {
-	return;
-	static bool dirty{true};
 	static int day_step{1};
+	static std::uint64_t first_minute{ 0 };
 	static std::vector<float> occ;
+	static std::vector<float> xs;
 
 	if (ImGui::SliderInt("Day step", &day_step, 1, 31)) {
-		dirty = true;
+		occ.clear();
+	}
+	if (ks.minutes.empty()) return;
+
+	// A reload, a reset or a compaction can move the start of the index.
+	if (first_minute != ks.minutes.origin_minute()) {
+		first_minute = ks.minutes.origin_minute();
+		occ.clear();
 	}
-	if (ks.key_entries.empty()) return;
 
-	if (dirty) {
-		auto time_start = ks.key_entries.front().timestamp;
-		auto time_end = ks.key_entries.back().timestamp;
-		auto step = (day_step * 3600 * 24);
+	ks.minutes.reduce((size_t)day_step * 24 * 60, occ);
+	if (xs.size() > occ.size()) xs.clear();
+	for (size_t i = xs.size(); i < occ.size(); ++i) xs.push_back((float)(i * day_step));
 
-		occ.resize(0);
-		occ.resize(std::ceill((time_end - time_start) / step));
+	time_t first_time = (time_t)(first_minute * 60);
+	tm first_tm = get_local_time(first_time);
+	char since[64];
+	strftime(since, sizeof(since), "Days since %Y-%m-%d", &first_tm);
 
-		for (size_t i = 0; i < ks.key_entries.size(); ++i) {
-			auto& x = ks.key_entries[i];
-			auto it = (x.timestamp - time_start) / step;
-			occ[it]++;
+	if (!ImPlot::BeginPlot("Keyboard activity", since, "Keys")) return;
+	defer{ ImPlot::EndPlot(); };
+
+	ImPlot::PlotBars("Keys", xs.data(), occ.data(), (int)occ.size(), day_step * 0.9f);
+}
+
+void render_typing_stats(const KeyboardState& ks) noexcept {
+	static size_t cached_hours{ 0 };
+	static uint32_t cached_last_keys{ 0 };
+	static std::vector<double> xs;
+	static std::vector<double> wpm;
+	static std::vector<double> peak_wpm;
+
+	auto& typing = ks.typing;
+	auto now = get_milliseconds_epoch();
+
+	ImGui::Text(
+		"%6.1f keys/min  %5.1f wpm%s",
+		typing.keys_per_minute(now),
+		typing.words_per_minute(now),
+		typing.in_burst(now) ? "  (burst)" : ""
+	);
+	ImGui::Text(
+		"Inter key interval p50 %.0fms p90 %.0fms p99 %.0fms over %zu intervals.",
+		typing.intervals.quantile(0.5),
+		typing.intervals.quantile(0.9),
+		typing.intervals.quantile(0.99),
+		typing.intervals.count()
+	);
+
+	if (typing.hours.empty()) return;
+
+	// The rollup only ever grows at the back, so that's all we need to check.
+	if (cached_hours != typing.hours.size() || cached_last_keys != typing.hours.back().keys) {
+		cached_hours = typing.hours.size();
+		cached_last_keys = typing.hours.back().keys;
+
+		xs.clear();
+		wpm.clear();
+		peak_wpm.clear();
+		auto first_hour = typing.hours.front().hour;
+		for (auto& x : typing.hours) {
+			if (x.active_ms == 0) continue;
+
+			xs.push_back((x.hour - first_hour) / 24.0);
+			wpm.push_back(x.keys * 60'000.0 / x.active_ms / TypingMetrics::Chars_Per_Word);
+			peak_wpm.push_back(x.peak_kpm / (double)TypingMetrics::Chars_Per_Word);
 		}
+	}
 
-		dirty = false;
+	size_t bursts = 0;
+	size_t idle_gaps = 0;
+	for (auto& x : typing.hours) {
+		bursts += x.bursts;
+		idle_gaps += x.idle_gaps;
 	}
+	ImGui::Text("%zu bursts, %zu idle gaps.", bursts, idle_gaps);
 
-	ImGui::PlotHistogram("", occ.data(), occ.size());
+	if (!ImPlot::BeginPlot("Typing speed", "Days", "Wpm")) return;
+	defer{ ImPlot::EndPlot(); };
+
+	ImPlot::PlotLine("Average", xs.data(), wpm.data(), (int)xs.size());
+	ImPlot::PlotScatter("Peak", xs.data(), peak_wpm.data(), (int)xs.size());
 }
 
 void render_mouse_list(const MouseState& ms) noexcept {
@@ -251,31 +501,44 @@ void render_mouse_plot(const MouseState& ms) noexcept {
 	if (!ImPlot::BeginPlot("Mouse usage", "Time", "Usage")) return;
 	defer { ImPlot::EndPlot(); };
 
-	if (ms.cache.usage_plot.dirty && !ms.click_entries.empty()) {
+	if (ms.cache.usage_plot.dirty && (!ms.click_entries.empty() || !ms.minutes.empty())) {
 		ms.cache.usage_plot.dirty = false;
 		ms.cache.usage_plot.values.clear();
 
-		auto range = ms.cache.usage_plot.rolling_average * 500'000;
-		size_t n = 0;
+		auto range = ms.cache.usage_plot.rolling_average * 500'000.0;
+		double n = 0;
 
-		auto min = ms.click_entries.front().timestamp;
-		auto max = ms.click_entries.front().timestamp;
+		// The clicks before raw_since were compacted, there we only have the per minute (or per
+		// hour) counts.
+		double min = (double)ms.minutes.origin_minute() * 60;
+		double max = (double)ms.minutes.end_minute() * 60;
+		if (ms.minutes.empty()) {
+			min = (double)ms.click_entries.front().timestamp;
+			max = min;
+		}
 		for (auto& x : ms.click_entries) {
 			min = min > x.timestamp ? x.timestamp : min;
 			max = max > x.timestamp ? max : x.timestamp;
 		}
 		auto u = max - min;
+		auto raw_since = (double)ms.raw_since;
 
 		for (size_t i = 0; i < ms.cache.usage_plot.resolution; ++i) {
 			n = 0;
 
 			auto t = i / (ms.cache.usage_plot.resolution - 1.f);
-			for (auto& x : ms.click_entries) if (
-				min + u * t -range < x.timestamp &&
-				x.timestamp < min + u * t + range
-			) n++;
+			auto begin = min + u * t - range;
+			auto end = min + u * t + range;
+			if (begin < raw_since) {
+				auto compacted_end = end < raw_since ? end : raw_since;
+				n += ms.minutes.count_between(
+					begin > 0 ? (std::uint64_t)(begin * 1'000) : 0,
+					(std::uint64_t)(compacted_end * 1'000)
+				);
+			}
+			for (auto& x : ms.click_entries) if (begin < x.timestamp && x.timestamp < end) n++;
 			
-			ms.cache.usage_plot.values.push_back(n / (2.f * range / 1'000'000.f));
+			ms.cache.usage_plot.values.push_back((float)(n / (2.0 * range / 1'000'000.0)));
 		}
 	}
 
@@ -291,15 +554,16 @@ void render_display_stat(const MouseState& ms, const Display& d) noexcept {
 	auto& it = ms.cache.n_keys[d.unique_hash_char];
 
 	if (it.dirty) {
-		size_t sum = 0;
-		for (size_t i = 0; i < ms.click_entries.size(); ++i) {
-			auto& x = ms.click_entries[i];
-
-			if (x.timestamp < d.timestamp_start) continue;
-			if (x.timestamp > d.timestamp_end) break;
-			if (d.x > x.x || x.x > d.x + d.width) continue;
-			if (d.y > x.y || x.y > d.y + d.height) continue;
-			sum++;
+		size_t sum = d.compacted_clicks;
+		// The clicks are in time order, we start at the first one of the display's lifetime.
+		auto first = std::lower_bound(
+			BEG_END(ms.click_entries),
+			d.timestamp_start,
+			[](const ClickEntry& x, std::uint64_t t) { return x.timestamp < t; }
+		);
+		for (auto it = first; it != std::end(ms.click_entries); ++it) {
+			if (it->timestamp > d.timestamp_end) break;
+			if (click_in_display(d, *it)) sum++;
 		}
 
 		it.v = sum;
@@ -310,4 +574,275 @@ void render_display_stat(const MouseState& ms, const Display& d) noexcept {
 	if (*d.custom_name) name = d.custom_name;
 
 	ImGui::Text("Click entry in %.32s: %zu", d.custom_name, it.v);
+	ImGui::Text("Travel in %.32s: %llu px", name, (unsigned long long)d.travel);
+	ImGui::Text("Scroll in %.32s: %llu notches", name, (unsigned long long)d.scroll);
+}
+
+void render_click_gestures(const MouseState& ms) noexcept {
+	if (!ImGui::CollapsingHeader("Clicks")) return;
+	auto& gestures = ms.gestures;
+
+	ImGui::Columns(5, "button - gestures", false);
+	for (auto x : { "Button", "Single", "Double", "Drag", "Long press" }) {
+		ImGui::TextUnformatted(x);
+		ImGui::NextColumn();
+	}
+	for (std::uint8_t i = 0; i < ClickGesture::N_Buttons; ++i) {
+		std::uint64_t n = 0;
+		for (std::uint8_t kind = 0; kind < ClickGesture::Count; ++kind) {
+			n += gestures.count(kind, i);
+		}
+		if (n == 0) continue;
+
+		ImGui::TextUnformatted(get_name_of_mouse_button(i).c_str());
+		ImGui::NextColumn();
+		for (std::uint8_t kind = 0; kind < ClickGesture::Count; ++kind) {
+			ImGui::Text("%llu", (unsigned long long)gestures.count(kind, i));
+			ImGui::NextColumn();
+		}
+	}
+	ImGui::Columns(1);
+
+	auto n_drags = gestures.count(ClickGesture::Drag);
+	auto n_long = gestures.count(ClickGesture::Long_Press);
+	ImGui::Text(
+		"Drags %.0f px on average, long presses %.0f ms.",
+		n_drags ? gestures.drag_distance / (double)n_drags : 0.0,
+		n_long ? gestures.long_press_ms / (double)n_long : 0.0
+	);
+}
+
+void render_mouse_scroll(const MouseState& ms, ScrollApps& scroll) noexcept {
+	if (!ImGui::CollapsingHeader("Scroll")) return;
+	ImGui::Text(
+		"%zu notches up, %zu down.",
+		ms.buttons[(size_t)MouseState::ButtonMap::Wheel_Up],
+		ms.buttons[(size_t)MouseState::ButtonMap::Wheel_Down]
+	);
+
+	// Only the new clicks are looked at, unless a compaction or a reload changed the old ones.
+	if (ms.pending_clicks) return;
+	if (scroll.n_scanned > ms.click_entries.size() || scroll.raw_since != ms.raw_since) {
+		scroll = {};
+		scroll.raw_since = ms.raw_since;
+	}
+	for (size_t i = scroll.n_scanned; i < ms.click_entries.size(); ++i) {
+		auto& x = ms.click_entries[i];
+		if (!is_wheel(x.button_code)) continue;
+		scroll.wheels.push_back({ x.timestamp, (std::uint32_t)wheel_notches(x) });
+		scroll.apps_dirty = true;
+	}
+	scroll.n_scanned = ms.click_entries.size();
+
+	if (scroll.apps_dirty) {
+		ImGui::Text("Waiting for the app usages.");
+		return;
+	}
+	if (scroll.apps.empty()) ImGui::Text("No app usage covers the scrolls.");
+	ImGui::Columns(2, "app - notches", false);
+	for (auto& [name, n] : scroll.apps) {
+		ImGui::TextUnformatted(name.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("%llu", (unsigned long long)n);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
+
+void join_scroll_apps(ScrollApps& scroll, const EventState& es) noexcept {
+	if (es.pending_usages) return;
+	if (!scroll.apps_dirty && scroll.apps_usages_size == es.apps_usages.size()) return;
+	scroll.apps_dirty = false;
+
+	auto add = [&](const AppUsage& x, std::uint64_t n) {
+		std::string_view name = x.exe_name.data();
+		auto it = scroll.notches.find(name);
+		if (it == std::end(scroll.notches)) it = scroll.notches.emplace(name, 0).first;
+		it->second += n;
+	};
+
+	// The usages were reloaded or compacted, they are all joined again.
+	if (scroll.apps_usages_size > es.apps_usages.size()) {
+		scroll.apps_usages_size = 0;
+		scroll.notches.clear();
+	}
+
+	// The new usages with the wheels already joined. The clicks are in seconds, the usages in
+	// microseconds.
+	auto joined = std::begin(scroll.wheels) + scroll.n_joined;
+	for (size_t i = scroll.apps_usages_size; i < es.apps_usages.size(); ++i) {
+		auto& x = es.apps_usages[i];
+		auto it = std::lower_bound(std::begin(scroll.wheels), joined, x.timestamp_start,
+			[](auto& w, std::uint64_t t) { return w.first * 1'000'000 < t; }
+		);
+		for (; it != joined && it->first * 1'000'000 <= x.timestamp_end; ++it) add(x, it->second);
+	}
+	scroll.apps_usages_size = es.apps_usages.size();
+
+	// Then the new wheels with all the usages.
+	for (auto it = joined; it != std::end(scroll.wheels); ++it) {
+		es.usage_times.containing(it->first * 1'000'000, [&](size_t id) {
+			add(es.apps_usages[id], it->second);
+		});
+	}
+	std::sort(joined, std::end(scroll.wheels));
+	std::inplace_merge(std::begin(scroll.wheels), joined, std::end(scroll.wheels));
+	scroll.n_joined = scroll.wheels.size();
+
+	scroll.apps.clear();
+	for (auto& [name, n] : scroll.notches) scroll.apps.push_back({ name, n });
+	std::sort(std::begin(scroll.apps), std::end(scroll.apps), [](auto& a, auto& b) {
+		return a.second > b.second;
+	});
+}
+
+void render_week_hours(
+	const char* title, const WeekHours& week, double scale, const char* unit
+) noexcept {
+	static const char* Day_Names[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+	constexpr int Hour_Step = 3;
+
+	size_t peak = 0;
+	for (size_t i = 0; i < week.counts.size(); ++i) {
+		if (week.counts[i] > week.counts[peak]) peak = i;
+	}
+	if (week.counts[peak] == 0) {
+		ImGui::Text("Nothing yet.");
+		return;
+	}
+
+	// 168 cells, it's cheaper to convert them every frame than to check if they changed.
+	std::array<float, WeekHours::N_Slots> values;
+	for (size_t i = 0; i < values.size(); ++i) values[i] = (float)(week.counts[i] * scale);
+
+	ImGui::Text(
+		"Peak on %s at %zuh, %.1f %s.",
+		Day_Names[peak / WeekHours::N_Hours],
+		peak % WeekHours::N_Hours,
+		week.counts[peak] * scale,
+		unit
+	);
+
+	// The heatmap draws its first row at the top.
+	double day_ticks[WeekHours::N_Days];
+	for (size_t i = 0; i < WeekHours::N_Days; ++i) day_ticks[i] = WeekHours::N_Days - i - 0.5;
+	double hour_ticks[WeekHours::N_Hours / Hour_Step];
+	const char* hour_labels[WeekHours::N_Hours / Hour_Step];
+	char hour_names[WeekHours::N_Hours / Hour_Step][4];
+	for (int i = 0; i < (int)WeekHours::N_Hours / Hour_Step; ++i) {
+		hour_ticks[i] = i * Hour_Step + 0.5;
+		snprintf(hour_names[i], sizeof(hour_names[i]), "%dh", i * Hour_Step);
+		hour_labels[i] = hour_names[i];
+	}
+
+	ImPlot::SetNextPlotLimits(0, WeekHours::N_Hours, 0, WeekHours::N_Days, ImGuiCond_Always);
+	ImPlot::SetNextPlotTicksX(hour_ticks, (int)WeekHours::N_Hours / Hour_Step, hour_labels);
+	ImPlot::SetNextPlotTicksY(day_ticks, (int)WeekHours::N_Days, Day_Names);
+	auto axis = ImPlotAxisFlags_TickLabels | ImPlotAxisFlags_LockMin | ImPlotAxisFlags_LockMax;
+	if (!ImPlot::BeginPlot(title, nullptr, nullptr, ImVec2(-1, 220), 0, axis, axis)) return;
+	defer{ ImPlot::EndPlot(); };
+
+	ImPlot::PlotHeatmap(
+		unit,
+		values.data(),
+		(int)WeekHours::N_Days,
+		(int)WeekHours::N_Hours,
+		0.f,
+		values[peak],
+		nullptr,
+		ImPlotPoint(0, 0),
+		ImPlotPoint(WeekHours::N_Hours, WeekHours::N_Days)
+	);
+}
+
+void render_sessions(const ActivitySessions& sessions) noexcept {
+	constexpr size_t Max_Days = 30;
+	auto& open = sessions.open;
+	if (open.end == 0) {
+		ImGui::Text("Nothing yet.");
+		return;
+	}
+
+	// Only the ui thread renders, the clock stays on today.
+	static LocalClock clock;
+	auto now = get_milliseconds_epoch();
+	(void)clock.locate(now);
+	auto midnight = clock.midnight;
+
+	// The closed sessions are in the days, the open one is counted since it started or midnight.
+	std::uint64_t active_ms = 0;
+	size_t n_sessions = 0;
+	if (!sessions.days.empty() && sessions.days.back().date == clock.date) {
+		active_ms = sessions.days.back().active_ms;
+		n_sessions = sessions.days.back().sessions;
+	}
+	if (open.end >= midnight) active_ms += open.end - (std::max)(open.start, midnight);
+	n_sessions += open.start >= midnight && open.start < clock.next_midnight;
+
+	bool ongoing = now <= open.end + sessions.idle_gap_ms;
+	ImGui::Text(
+		"Today %dh%02d active in %zu sessions%s.",
+		(int)(active_ms / LocalClock::Hour_Ms),
+		(int)(active_ms % LocalClock::Hour_Ms / 60'000),
+		n_sessions,
+		ongoing ? ", one is going on" : ""
+	);
+
+	auto text_session = [&](const ActivitySession& x) {
+		auto start_tm = get_local_time((std::time_t)(x.start / 1'000));
+		auto end_tm = get_local_time((std::time_t)(x.end / 1'000));
+		auto minutes = (x.end - x.start) / 60'000;
+		ImGui::BulletText(
+			"%02d:%02d - %02d:%02d (%dh%02d)",
+			start_tm.tm_hour,
+			start_tm.tm_min,
+			end_tm.tm_hour,
+			end_tm.tm_min,
+			(int)(minutes / 60),
+			(int)(minutes % 60)
+		);
+	};
+	if (ImGui::TreeNode("Today's sessions")) {
+		defer{ ImGui::TreePop(); };
+
+		auto& closed = sessions.closed;
+		size_t first = closed.size();
+		while (first > 0 && closed[first - 1].end >= midnight) first--;
+		for (size_t i = first; i < closed.size(); ++i) text_session(closed[i]);
+		if (open.end >= midnight) text_session(open);
+	}
+
+	// The days with a closed session, the last ones.
+	auto& days = sessions.days;
+	size_t n = (std::min)(days.size(), Max_Days);
+	if (n == 0) return;
+	float hours[Max_Days];
+	double ticks[Max_Days];
+	char names[Max_Days][6];
+	const char* labels[Max_Days];
+	for (size_t i = 0; i < n; ++i) {
+		auto& day = days[days.size() - n + i];
+		hours[i] = (float)day.active_ms / LocalClock::Hour_Ms;
+		ticks[i] = (double)i;
+		snprintf(names[i], sizeof(names[i]), "%02u/%02u", day.date / 100 % 100, day.date % 100);
+		labels[i] = names[i];
+	}
+
+	ImPlot::SetNextPlotTicksX(ticks, (int)n, labels);
+	if (!ImPlot::BeginPlot("Active time per day", nullptr, "Hours", ImVec2(-1, 220))) return;
+	defer{ ImPlot::EndPlot(); };
+	ImPlot::PlotBars("Hours", hours, (int)n, 0.8f);
+}
+
+void render_mouse_travel(const MouseState& ms) noexcept {
+	auto& moves = ms.moves;
+	size_t n_bytes = moves.bytes.size() + (ms.pending_moves ? ms.pending_moves->size : 0);
+	double speed = moves.active_ms ? moves.distance * 1'000.0 / moves.active_ms : 0;
+	ImGui::Text(
+		"Travel %llu px, %.0f px/s while moving, %zu path samples in %zu KB.",
+		(unsigned long long)moves.distance,
+		speed,
+		moves.count,
+		n_bytes / 1'024
+	);
 }
@@ -1,10 +1,31 @@
 #pragma once
 #include "keyboard.hpp"
 #include "Mouse.hpp"
+#include "Event.hpp"
 
-extern void render_key_list(const KeyboardState& ks) noexcept;
+// Not const, the postings are read from the file when the first key is selected.
+extern void render_key_list(KeyboardState& ks, KeyDetails& details, KeyboardLayout layout) noexcept;
+// Counts the uses of the selected key in each exe, to be called with the event lock and without
+// the keyboard one.
+extern void join_key_apps(KeyDetails& details, const EventState& es) noexcept;
 extern void render_keyboard_heatmap(const KeyboardState& ks) noexcept;
 extern void render_keyboard_activity_timeline(const KeyboardState& ms) noexcept;
+extern void render_typing_stats(const KeyboardState& ks) noexcept;
+extern void render_chords(const KeyboardState& ks, KeyboardLayout layout) noexcept;
+// The hand balance and the worst same finger bigrams, with the layout of ks.load.
+extern void render_key_load(const KeyboardState& ks) noexcept;
 extern void render_mouse_list(const MouseState& ms) noexcept;
+// A 7x24 heatmap of the week, the counts are multiplied by scale for the unit.
+extern void render_week_hours(
+	const char* title, const WeekHours& week, double scale, const char* unit
+) noexcept;
+// Today's active time and sessions, and the active hours of the last days.
+extern void render_sessions(const ActivitySessions& sessions) noexcept;
 extern void render_mouse_plot(const MouseState& ms) noexcept;
+extern void render_mouse_travel(const MouseState& ms) noexcept;
+extern void render_click_gestures(const MouseState& ms) noexcept;
+extern void render_mouse_scroll(const MouseState& ms, ScrollApps& scroll) noexcept;
+// Sums the notches scrolled in each exe, to be called with the event lock and without the mouse
+// one.
+extern void join_scroll_apps(ScrollApps& scroll, const EventState& es) noexcept;
 extern void render_display_stat(const MouseState& ms, const Display& d) noexcept;
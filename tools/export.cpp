@@ -0,0 +1,91 @@
+// Exports a save file, run mes_touches_export <keyboard|mouse|event> <file.mto> [options].
+//   --format csv|jsonl|columns  csv by default, see Export.hpp for the columns.
+//   --from ms, --to ms          only the records in that range, in ms since epoch.
+//   --app name                  only the records of the apps whose exe contains name.
+//   --events path               the event.mto used by --app, next to the file by default.
+//   --out path                  stdout by default.
+// Portable, it's meant to run on copies of the files. Quit the app or save from it before copying
+// or copy the .wal files along.
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Export.hpp"
+
+static int usage() noexcept {
+	fprintf(
+		stderr,
+		"usage: mes_touches_export <keyboard|mouse|event> <file.mto> [--format csv|jsonl|columns]"
+		" [--from ms] [--to ms] [--app name] [--events event.mto] [--out path]\n"
+	);
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) return usage();
+
+	SaveKind kind = SaveKind::Count;
+	for (size_t i = 0; i < (size_t)SaveKind::Count; ++i) {
+		if (strcmp(argv[1], save_kind_name((SaveKind)i)) == 0) kind = (SaveKind)i;
+	}
+	if (kind == SaveKind::Count) return usage();
+
+	std::filesystem::path path = argv[2];
+	std::filesystem::path out_path;
+	ExportOptions options;
+	options.event_path = path.parent_path() / "event.mto";
+
+	for (int i = 3; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) return usage();
+		const char* value = argv[++i];
+
+		if (arg == "--format") {
+			options.format = ExportFormat::Count;
+			for (size_t j = 0; j < (size_t)ExportFormat::Count; ++j) {
+				if (strcmp(value, export_format_extension((ExportFormat)j)) == 0) {
+					options.format = (ExportFormat)j;
+				}
+			}
+			if (options.format == ExportFormat::Count) return usage();
+		}
+		else if (arg == "--from")   options.from_ms = strtoull(value, nullptr, 10);
+		else if (arg == "--to")     options.to_ms = strtoull(value, nullptr, 10);
+		else if (arg == "--app")    options.app = value;
+		else if (arg == "--events") options.event_path = value;
+		else if (arg == "--out")    out_path = value;
+		else return usage();
+	}
+
+	auto out = stdout;
+	if (!out_path.empty()) {
+		out = fopen(out_path.generic_string().c_str(), "wb");
+		if (!out) {
+			fprintf(stderr, "Can't open %s: %s\n", out_path.generic_string().c_str(), strerror(errno));
+			return 1;
+		}
+	}
+
+	ExportStats stats;
+	auto err = export_records(kind, path, out, options, stats);
+	if (out != stdout) fclose(out);
+
+	if (err == EILSEQ) {
+		fprintf(
+			stderr,
+			"%s isn't a %s file in its current version, open and save it with the app first.\n",
+			path.generic_string().c_str(),
+			save_kind_name(kind)
+		);
+		return 1;
+	}
+	if (err) {
+		fprintf(stderr, "Export of %s failed: %s\n", path.generic_string().c_str(), strerror(err));
+		return 1;
+	}
+
+	fprintf(stderr, "Wrote %zu of %zu records.\n", stats.n_written, stats.n_read);
+	return 0;
+}
@@ -0,0 +1,74 @@
+// Merges the save files of several machines, run
+// mes_touches_merge <keyboard|mouse|event> <out.mto> [machine=]<file.mto>...
+// The machine names the displays and the apps of its file, the name of the folder of the file by
+// default. Portable like the export, it's meant to run on copies of the files with their .wal.
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "Merge.hpp"
+
+static int usage() noexcept {
+	fprintf(stderr, "usage: mes_touches_merge <keyboard|mouse|event> <out.mto> [machine=]<file.mto>...\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) return usage();
+
+	SaveKind kind = SaveKind::Count;
+	for (size_t i = 0; i < (size_t)SaveKind::Count; ++i) {
+		if (strcmp(argv[1], save_kind_name((SaveKind)i)) == 0) kind = (SaveKind)i;
+	}
+	if (kind == SaveKind::Count) return usage();
+
+	std::filesystem::path out_path = argv[2];
+	std::vector<MergeInput> inputs;
+	for (int i = 3; i < argc; ++i) {
+		std::string arg = argv[i];
+		MergeInput input;
+
+		auto eq = arg.find('=');
+		if (eq != std::string::npos && eq > 0) {
+			input.machine = arg.substr(0, eq);
+			input.path = arg.substr(eq + 1);
+		}
+		else {
+			input.path = arg;
+			input.machine = std::filesystem::absolute(input.path).parent_path().filename().string();
+		}
+
+		std::error_code ec;
+		if (std::filesystem::equivalent(input.path, out_path, ec)) {
+			fprintf(stderr, "The output can't be one of the inputs.\n");
+			return 1;
+		}
+		inputs.push_back(std::move(input));
+	}
+
+	MergeStats stats;
+	auto err = merge_saves(kind, inputs, out_path, stats);
+	if (err == EILSEQ) {
+		fprintf(
+			stderr,
+			"One of the files isn't a %s file in its current version, open and save it with the app first.\n",
+			save_kind_name(kind)
+		);
+		return 1;
+	}
+	if (err) {
+		fprintf(stderr, "Merge failed: %s\n", strerror(err));
+		return 1;
+	}
+
+	fprintf(stderr, "Wrote %zu records from %zu files.\n", stats.n_records, inputs.size());
+	if (stats.n_compacted > 0) {
+		fprintf(
+			stderr,
+			"%zu files had records dropped by a compaction, they are only in the counters now.\n",
+			stats.n_compacted
+		);
+	}
+	return 0;
+}
@@ -0,0 +1,150 @@
+// Serves the query api of Query.hpp from save files instead of the running app, run
+// mes_touches_serve <folder> [name]. The name is the socket path (the pipe name on windows),
+// /tmp/mes_touches.sock by default. The files are read once at startup, along with their .wal.
+// It stands in for the app on the machines where it doesn't run, for the scripts and dashboards.
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ByteStream.hpp"
+#include "QueryServer.hpp"
+#include "SaveReader.hpp"
+
+constexpr std::uint32_t Minutes_Tag = 'XNIM'; // KeyboardState::Minutes_Tag and MouseState's.
+
+// The minutes of the file, the ones of the records of the log are added to them. A file without
+// them is replayed from its records.
+static void read_minutes(const SaveReader& reader, MinuteIndex& minutes, bool& from_file) noexcept {
+	auto section = reader.section(Minutes_Tag);
+	from_file = section && minutes.load(*section, 0, section->size());
+	if (!from_file) minutes = {};
+}
+
+static void read_counters(const SaveReader& reader, std::uint64_t* counts, size_t n) noexcept {
+	for (size_t i = 0; i < n; ++i) {
+		counts[i] = load_le<std::uint32_t>(reader.header.data() + 5 + 4 * i);
+	}
+}
+
+static int read_keyboard(SaveReader& reader, QuerySnapshot::Keyboard& x) noexcept {
+	read_counters(reader, x.counts.data(), x.counts.size());
+
+	// The minutes section is after the records, they are kept until then.
+	std::vector<QueryKey> keys;
+	while (auto record = reader.next()) {
+		keys.push_back({ load_le<std::uint64_t>(record + 1), (std::uint8_t)record[0] });
+	}
+	if (reader.error) return reader.error;
+
+	bool from_file = false;
+	read_minutes(reader, x.minutes, from_file);
+	for (size_t i = from_file ? reader.n_file_records : 0; i < keys.size(); ++i) {
+		x.minutes.add(keys[i].timestamp_ms);
+		if (i >= reader.n_file_records && keys[i].code < x.counts.size()) x.counts[keys[i].code]++;
+	}
+
+	x.keys.sync(keys, [](const QueryKey& y) { return y; });
+	x.loaded = true;
+	return 0;
+}
+
+static int read_mouse(SaveReader& reader, QuerySnapshot::Mouse& x) noexcept {
+	read_counters(reader, x.counts.data(), x.counts.size());
+
+	std::vector<QueryClick> clicks;
+	while (auto record = reader.next()) {
+		clicks.push_back({
+			load_le<std::uint64_t>(record + 9),
+			(std::uint8_t)record[0],
+			(std::int32_t)load_le<std::uint32_t>(record + 1),
+			(std::int32_t)load_le<std::uint32_t>(record + 5),
+		});
+	}
+	if (reader.error) return reader.error;
+
+	bool from_file = false;
+	read_minutes(reader, x.minutes, from_file);
+	for (size_t i = from_file ? reader.n_file_records : 0; i < clicks.size(); ++i) {
+		x.minutes.add(clicks[i].timestamp_s * 1'000);
+		auto button = clicks[i].button;
+		if (i >= reader.n_file_records && button < x.counts.size()) x.counts[button]++;
+	}
+
+	x.clicks.sync(clicks, [](const QueryClick& y) { return y; });
+	x.loaded = true;
+	return 0;
+}
+
+static int read_event(SaveReader& reader, QuerySnapshot::Event& x) noexcept {
+	std::vector<QueryUsage> usages;
+	while (auto record = reader.next()) {
+		QueryUsage usage;
+		memcpy(usage.exe.data(), record, Save_String_Size);
+		memcpy(usage.doc.data(), record + Save_String_Size, Save_String_Size);
+		usage.start_us = load_le<std::uint64_t>(record + 2 * Save_String_Size);
+		usage.end_us = load_le<std::uint64_t>(record + 2 * Save_String_Size + 8);
+		usages.push_back(usage);
+	}
+	if (reader.error) return reader.error;
+
+	x.usages.sync(usages, [](const QueryUsage& y) { return y; });
+	x.loaded = true;
+	return 0;
+}
+
+// A missing file leaves its kind not loaded, the queries on it say so.
+static int load(QuerySnapshot& snapshot, const std::filesystem::path& folder) noexcept {
+	SaveReader reader;
+	auto read = [&](SaveKind kind, const char* file, auto&& f) {
+		auto err = reader.open(kind, folder / file);
+		if (err == ENOENT) return 0;
+		return err ? err : f();
+	};
+
+	auto keyboard = [&] { return read_keyboard(reader, snapshot.keyboard); };
+	auto mouse = [&] { return read_mouse(reader, snapshot.mouse); };
+	auto event = [&] { return read_event(reader, snapshot.event); };
+
+	if (auto err = read(SaveKind::Keyboard, "keyboard.mto", keyboard)) return err;
+	if (auto err = read(SaveKind::Mouse, "mouse.mto", mouse)) return err;
+	return read(SaveKind::Event, "event.mto", event);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: mes_touches_serve <folder> [name]\n");
+		return 2;
+	}
+
+	auto snapshot = std::make_shared<QuerySnapshot>();
+	snapshot->time = (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+	if (auto err = load(*snapshot, argv[1])) {
+		fprintf(stderr, "Couldn't read the files of %s: %s\n", argv[1], strerror(err));
+		return 1;
+	}
+
+	std::string name = argc > 2 ? argv[2] : "/tmp/mes_touches.sock";
+	std::shared_ptr<const QuerySnapshot> published = snapshot;
+
+	QueryServer server;
+	if (auto err = server.start(name, [published] { return published; })) {
+		fprintf(stderr, "Couldn't serve on %s: error %d\n", name.c_str(), err);
+		return 1;
+	}
+
+	fprintf(
+		stderr,
+		"Serving %zu keys, %zu clicks and %zu usages on %s.\n",
+		snapshot->keyboard.keys.size,
+		snapshot->mouse.clicks.size,
+		snapshot->event.usages.size,
+		name.c_str()
+	);
+	while (true) std::this_thread::sleep_for(std::chrono::hours(1));
+}